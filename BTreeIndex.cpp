@@ -0,0 +1,216 @@
+/**
+ * @file BTreeIndex.cpp
+ * @author Justin Thoreson
+ * @see Seattle University, CPSC5300
+ */
+
+#include <cstring>
+#include "BTreeIndex.h"
+
+BTreeIndex::BTreeIndex(DbRelation& relation, Identifier name, ColumnNames key_columns, bool unique)
+    : DbIndex(relation, name, key_columns, unique), file(relation.get_table_name() + "-" + name),
+      encoder(relation, key_columns), root_id(0), height(0), closed(true) {
+}
+
+void BTreeIndex::create() {
+    this->file.create();  // block 1 (STAT) comes with it
+    this->closed = false;
+    BTreeLeaf root(this->file, this->new_block());
+    root.save();
+    this->root_id = root.get_id();
+    this->height = 1;
+    this->save_stat();
+
+    Handles* handles = this->relation.select();
+    for (Handle& handle: *handles)
+        this->insert(handle);
+    delete handles;
+}
+
+void BTreeIndex::drop() {
+    this->file.drop();
+    this->closed = true;
+}
+
+void BTreeIndex::open() {
+    if (!this->closed) return;
+    this->file.open();
+    this->closed = false;
+}
+
+void BTreeIndex::close() {
+    this->file.close();
+    this->closed = true;
+}
+
+Handles* BTreeIndex::lookup(ValueDict* key_values) const {
+    KeyBytes key = this->encoder.encode(key_values);
+    return this->scan(key, &key);
+}
+
+Handles* BTreeIndex::range(ValueDict* min_key, ValueDict* max_key) const {
+    return this->range(min_key, max_key, SIZE_MAX);
+}
+
+Handles* BTreeIndex::range(ValueDict* min_key, ValueDict* max_key, size_t limit) const {
+    KeyBytes min = min_key ? this->encoder.encode_prefix(min_key) : KeyBytes();
+    if (max_key == nullptr)
+        return this->scan(min, nullptr, limit);
+    KeyBytes max = this->encoder.encode_prefix(max_key);
+    return this->scan(min, &max, limit);
+}
+
+void BTreeIndex::insert(Handle record) {
+    this->open();
+    KeyBytes key = this->record_key(record);
+    if (this->unique) {
+        KeyBytes search_key = key.substr(0, key.size() - BTreeLeaf::HANDLE_SZ);
+        Handles* handles = this->scan(search_key, &search_key, 1);
+        bool duplicate = !handles->empty();
+        delete handles;
+        if (duplicate)
+            throw DbRelationError("duplicate key for unique index " + this->name);
+    }
+
+    this->read_stat(this->root_id, this->height);
+    KeyBytes separator;
+    BlockID new_id;
+    if (this->insert_key(this->root_id, key, separator, new_id)) {
+        // root split, so grow the tree by one level
+        BTreeInterior root(this->file, this->new_block(), this->root_id);
+        root.insert(separator, new_id);
+        root.save();
+        this->root_id = root.get_id();
+        this->height++;
+        this->save_stat();
+    }
+}
+
+void BTreeIndex::del(Handle record) {
+    this->open();
+    KeyBytes key = this->record_key(record);
+    BTreeLeaf* leaf = this->find_leaf(key);
+    if (leaf->del(key))
+        leaf->save();
+    delete leaf;
+}
+
+void BTreeIndex::save_stat() {
+    char block[DbBlock::BLOCK_SZ];
+    std::memset(block, 0, sizeof(block));
+    Dbt data(block, sizeof(block));
+    SlottedPage page(data, STAT, true);
+    u_int32_t stat[] = {this->root_id, this->height};
+    Dbt stat_data(stat, sizeof(stat));
+    page.add(&stat_data);
+    this->file.put(&page);
+}
+
+// The stat block is read in the current thread's transaction each time, so
+// that a snapshot reader finds the root as of its snapshot, not one moved by
+// a split another transaction hasn't committed (or has rolled back).
+void BTreeIndex::read_stat(BlockID& root_id, uint& height) const {
+    SlottedPage* page = this->file.get(STAT);
+    Dbt* stat_data = page->get(1);
+    if (stat_data == nullptr) {
+        delete page;
+        throw DbRelationError("missing stat block for index " + this->name);
+    }
+    u_int32_t stat[2];
+    std::memcpy(stat, stat_data->get_data(), sizeof(stat));
+    root_id = stat[0];
+    height = stat[1];
+    delete stat_data;
+    delete page;
+}
+
+uint BTreeIndex::get_height() const {
+    BlockID root_id;
+    uint height;
+    this->read_stat(root_id, height);
+    return height;
+}
+
+BlockID BTreeIndex::new_block() {
+    SlottedPage* page = this->file.get_new();
+    BlockID block_id = page->get_block_id();
+    delete page;
+    return block_id;
+}
+
+KeyBytes BTreeIndex::record_key(Handle record) {
+    ValueDict* row = this->relation.project(record, &this->key_columns);
+    KeyBytes search_key = this->encoder.encode(row);
+    delete row;
+    if (search_key.size() > MAX_KEY_SZ)
+        throw DbRelationError("search key too long for btree index " + this->name);
+    return BTreeLeaf::make_key(search_key, record);
+}
+
+bool BTreeIndex::insert_key(BlockID node_id, const KeyBytes& key, KeyBytes& separator, BlockID& new_id) {
+    BTreeNode* node = BTreeNode::load(this->file, node_id);
+    bool split = false;
+    if (node->is_leaf()) {
+        BTreeLeaf* leaf = (BTreeLeaf*)node;
+        leaf->insert(key);
+        if (!leaf->fits()) {
+            BTreeLeaf sibling(this->file, this->new_block());
+            separator = leaf->split(&sibling);
+            sibling.save();
+            new_id = sibling.get_id();
+            split = true;
+        }
+        leaf->save();
+    } else {
+        BTreeInterior* interior = (BTreeInterior*)node;
+        KeyBytes child_separator;
+        BlockID child_id;
+        if (this->insert_key(interior->find(key), key, child_separator, child_id)) {
+            interior->insert(child_separator, child_id);
+            if (!interior->fits()) {
+                BTreeInterior sibling(this->file, this->new_block());
+                separator = interior->split(&sibling);
+                sibling.save();
+                new_id = sibling.get_id();
+                split = true;
+            }
+            interior->save();
+        }
+    }
+    delete node;
+    return split;
+}
+
+BTreeLeaf* BTreeIndex::find_leaf(const KeyBytes& key) const {
+    BlockID root_id;
+    uint height;
+    this->read_stat(root_id, height);
+    BTreeNode* node = BTreeNode::load(this->file, root_id);
+    while (!node->is_leaf()) {
+        BlockID child_id = ((BTreeInterior*)node)->find(key);
+        delete node;
+        node = BTreeNode::load(this->file, child_id);
+    }
+    return (BTreeLeaf*)node;
+}
+
+Handles* BTreeIndex::scan(const KeyBytes& min, const KeyBytes* max, size_t limit) const {
+    Handles* handles = new Handles();
+    BTreeLeaf* leaf = this->find_leaf(min);
+    size_t i = leaf->lower_bound(min);
+    while (leaf != nullptr) {
+        for (; i < leaf->size(); i++) {
+            const KeyBytes& key = leaf->get_key(i);
+            if (handles->size() == limit || (max != nullptr && key.compare(0, max->size(), *max) > 0)) {
+                delete leaf;
+                return handles;
+            }
+            handles->push_back(BTreeLeaf::get_handle(key));
+        }
+        BlockID next_leaf = leaf->get_next_leaf();
+        delete leaf;
+        leaf = next_leaf ? (BTreeLeaf*)BTreeNode::load(this->file, next_leaf) : nullptr;
+        i = 0;
+    }
+    return handles;
+}
@@ -0,0 +1,165 @@
+/**
+ * @file BTreeIndex.h - Implementation of storage_engine index with a B+tree structure.
+ * BTreeIndex: DbIndex
+ *
+ * @author Justin Thoreson
+ * @see "Seattle University, CPSC5300, Winter 2023"
+ */
+
+#pragma once
+
+#include "storage_engine.h"
+#include "HeapFile.h"
+#include "KeyEncoder.h"
+#include "BTreeNode.h"
+
+/**
+ * @class BTreeIndex - B+tree implementation of DbIndex
+ *
+ * Nodes are stored one per block of a HeapFile (see BTreeNode), with keys
+ * prefix-compressed within each node and suffix-truncated separators in the
+ * interior nodes. Block 1 holds the tree's stats (root block and height).
+ * Keys are encoded with KeyEncoder, so all comparisons are plain byte
+ * comparisons. Supports exact-match lookups and (inclusive) range queries.
+ * Deletes do not merge underfull nodes.
+ */
+class BTreeIndex : public DbIndex {
+public:
+    /**
+     * Longest encoded search key we allow, so that any overfull node can be split in two that fit
+     */
+    static const uint MAX_KEY_SZ = DbBlock::BLOCK_SZ / 8;
+
+    /**
+     * Constructor
+     * @param relation     the relation being indexed
+     * @param name         name of this index (unique by relation)
+     * @param key_columns  search key columns, in order
+     * @param unique       true if the search key is a key for the relation
+     */
+    BTreeIndex(DbRelation& relation, Identifier name, ColumnNames key_columns, bool unique);
+
+    virtual ~BTreeIndex() {}
+
+    BTreeIndex(const BTreeIndex& other) = delete;
+
+    BTreeIndex(BTreeIndex&& temp) = delete;
+
+    BTreeIndex& operator=(const BTreeIndex& other) = delete;
+
+    BTreeIndex& operator=(BTreeIndex&& temp) = delete;
+
+    /**
+     * Create the physical index file and populate it from the relation
+     */
+    virtual void create();
+
+    /**
+     * Remove the physical index file
+     */
+    virtual void drop();
+
+    /**
+     * Open the index file
+     */
+    virtual void open();
+
+    /**
+     * Close the index file
+     */
+    virtual void close();
+
+    /**
+     * Lookup a specific search key.
+     * @param key_values  dictionary of values for the search key
+     * @returns           list of handles for records with key_values, in key order (freed by caller)
+     */
+    virtual Handles* lookup(ValueDict* key_values) const;
+
+    /**
+     * Lookup a range of search keys. A bound may give just some leading key columns,
+     * or be nullptr for an open-ended range.
+     * @param min_key  dictionary of min (inclusive) search key
+     * @param max_key  dictionary of max (inclusive) search key
+     * @returns        list of handles for records in range, in key order (freed by caller)
+     */
+    virtual Handles* range(ValueDict* min_key, ValueDict* max_key) const;
+
+    /**
+     * Lookup the first limit records in a range of search keys, reading no
+     * more leaves than it takes to find them.
+     * @param min_key  dictionary of min (inclusive) search key
+     * @param max_key  dictionary of max (inclusive) search key
+     * @param limit    most handles to return
+     * @returns        list of handles for records in range, in key order (freed by caller)
+     */
+    virtual Handles* range(ValueDict* min_key, ValueDict* max_key, size_t limit) const;
+
+    /**
+     * Insert the index entry for the given record.
+     * @param record  handle of the record (must be in the relation)
+     * @throws        DbRelationError if a unique index already has the key
+     */
+    virtual void insert(Handle record);
+
+    /**
+     * Delete the index entry for the given record.
+     * @param record  handle of the record (must still be in the relation)
+     */
+    virtual void del(Handle record);
+
+    /**
+     * Number of levels in the tree (1 when the root is a leaf).
+     */
+    virtual uint get_height() const;
+
+protected:
+    static const BlockID STAT = 1;
+    mutable HeapFile file;  // reading blocks is non-const even for lookups
+    KeyEncoder encoder;
+    BlockID root_id;  // as of the insert being done
+    uint height;
+    bool closed;
+
+    // persist the root and height in the stat block
+    virtual void save_stat();
+
+    /**
+     * Read the root and height from the stat block, as the current thread's transaction sees it.
+     * @param root_id  returned by reference: the root block
+     * @param height   returned by reference: the number of levels
+     */
+    virtual void read_stat(BlockID& root_id, uint& height) const;
+
+    /**
+     * Allocate a new block for a node.
+     */
+    virtual BlockID new_block();
+
+    /**
+     * Encode the search key of the given record into a full index key.
+     */
+    virtual KeyBytes record_key(Handle record);
+
+    /**
+     * Insert a full key into the subtree rooted at node_id.
+     * @param node_id    root of the subtree
+     * @param key        full index key to insert
+     * @param separator  returned by reference: separator for the new sibling if the node split
+     * @param new_id     returned by reference: block of the new sibling if the node split
+     * @returns          true if the node split
+     */
+    virtual bool insert_key(BlockID node_id, const KeyBytes& key, KeyBytes& separator, BlockID& new_id);
+
+    /**
+     * Descend to the leaf where the given key is or would be.
+     * @returns  the leaf (freed by caller)
+     */
+    virtual BTreeLeaf* find_leaf(const KeyBytes& key) const;
+
+    /**
+     * Collect the handles of the first limit entries whose search key is at least
+     * min and whose leading max->size() bytes are at most max.
+     */
+    virtual Handles* scan(const KeyBytes& min, const KeyBytes* max, size_t limit = SIZE_MAX) const;
+};
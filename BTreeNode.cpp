@@ -0,0 +1,198 @@
+/**
+ * @file BTreeNode.cpp
+ * @author Justin Thoreson
+ * @see Seattle University, CPSC5300
+ */
+
+#include <algorithm>
+#include <cstring>
+#include "BTreeNode.h"
+
+/*
+ * ******************************
+ * BTreeNode class implementation
+ * ******************************
+ */
+
+BTreeNode* BTreeNode::load(HeapFile& file, BlockID id) {
+    SlottedPage* page = file.get(id);
+    Dbt* header = page->get(1);
+    if (header == nullptr || header->get_size() < 1 + sizeof(BlockID)) {
+        delete header;
+        delete page;
+        throw DbRelationError("corrupt btree node " + std::to_string(id));
+    }
+    char* bytes = (char*)header->get_data();
+    BlockID link;
+    std::memcpy(&link, bytes + 1, sizeof(link));
+    KeyBytes prefix(bytes + 1 + sizeof(link), header->get_size() - 1 - sizeof(link));
+    BTreeNode* node;
+    if (bytes[0] == LEAF)
+        node = new BTreeLeaf(file, id, link);
+    else
+        node = new BTreeInterior(file, id, link);
+    delete header;
+
+    RecordIDs* record_ids = page->ids();
+    for (RecordID& record_id: *record_ids) {
+        if (record_id == 1)
+            continue;
+        Dbt* entry = page->get(record_id);
+        node->unmarshal_entry(prefix, (char*)entry->get_data(), entry->get_size());
+        delete entry;
+    }
+    delete record_ids;
+    delete page;
+    return node;
+}
+
+void BTreeNode::save() {
+    KeyBytes prefix = this->key_prefix();
+    char block[DbBlock::BLOCK_SZ];
+    std::memset(block, 0, sizeof(block));
+    Dbt data(block, sizeof(block));
+    SlottedPage page(data, this->id, true);
+
+    std::string header(1, this->is_leaf() ? LEAF : INTERIOR);
+    BlockID link = this->get_link();
+    header.append((char*)&link, sizeof(link));
+    header.append(prefix);
+    Dbt header_data((void*)header.data(), (u_int32_t)header.size());
+    page.add(&header_data);
+    for (size_t i = 0; i < this->keys.size(); i++) {
+        std::string entry = this->marshal_entry(i, prefix.size());
+        Dbt entry_data((void*)entry.data(), (u_int32_t)entry.size());
+        page.add(&entry_data);
+    }
+    this->file.put(&page);
+}
+
+// Mirrors SlottedPage::has_room for the header record plus one record per entry.
+bool BTreeNode::fits() const {
+    size_t prefix_size = this->key_prefix().size();
+    size_t bytes = 1 + sizeof(BlockID) + prefix_size;
+    for (const KeyBytes& key: this->keys)
+        bytes += key.size() - prefix_size + this->payload_size();
+    size_t records = 1 + this->keys.size();
+    return 4 * (records + 1) + bytes <= DbBlock::BLOCK_SZ - 1;
+}
+
+size_t BTreeNode::common_prefix(const KeyBytes& a, const KeyBytes& b) {
+    size_t n = std::min(a.size(), b.size());
+    size_t i = 0;
+    while (i < n && a[i] == b[i])
+        i++;
+    return i;
+}
+
+// Keys are sorted, so whatever the first and last share, they all share.
+KeyBytes BTreeNode::key_prefix() const {
+    if (this->keys.empty())
+        return KeyBytes();
+    return this->keys.front().substr(0, common_prefix(this->keys.front(), this->keys.back()));
+}
+
+
+/*
+ * ******************************
+ * BTreeLeaf class implementation
+ * ******************************
+ */
+
+void BTreeLeaf::insert(const KeyBytes& key) {
+    size_t i = this->lower_bound(key);
+    if (i < this->keys.size() && this->keys[i] == key)
+        return;
+    this->keys.insert(this->keys.begin() + i, key);
+}
+
+bool BTreeLeaf::del(const KeyBytes& key) {
+    size_t i = this->lower_bound(key);
+    if (i == this->keys.size() || this->keys[i] != key)
+        return false;
+    this->keys.erase(this->keys.begin() + i);
+    return true;
+}
+
+KeyBytes BTreeLeaf::split(BTreeLeaf* new_leaf) {
+    size_t mid = this->keys.size() / 2;
+    new_leaf->keys.assign(this->keys.begin() + mid, this->keys.end());
+    this->keys.resize(mid);
+    new_leaf->next_leaf = this->next_leaf;
+    this->next_leaf = new_leaf->get_id();
+
+    // suffix truncation: the shortest prefix of the right's first key that is still above the left's last key
+    const KeyBytes& left = this->keys.back();
+    const KeyBytes& right = new_leaf->keys.front();
+    return right.substr(0, common_prefix(left, right) + 1);
+}
+
+size_t BTreeLeaf::lower_bound(const KeyBytes& key) const {
+    return std::lower_bound(this->keys.begin(), this->keys.end(), key) - this->keys.begin();
+}
+
+KeyBytes BTreeLeaf::make_key(const KeyBytes& search_key, Handle handle) {
+    KeyBytes key(search_key);
+    for (int shift = 24; shift >= 0; shift -= 8)
+        key.push_back((char)(handle.first >> shift));
+    key.push_back((char)(handle.second >> 8));
+    key.push_back((char)handle.second);
+    return key;
+}
+
+Handle BTreeLeaf::get_handle(const KeyBytes& key) {
+    const unsigned char* bytes = (const unsigned char*)key.data() + key.size() - HANDLE_SZ;
+    BlockID block_id = ((BlockID)bytes[0] << 24) | ((BlockID)bytes[1] << 16) | ((BlockID)bytes[2] << 8) | bytes[3];
+    RecordID record_id = (RecordID)((bytes[4] << 8) | bytes[5]);
+    return Handle(block_id, record_id);
+}
+
+std::string BTreeLeaf::marshal_entry(size_t i, size_t prefix_size) const {
+    return this->keys[i].substr(prefix_size);
+}
+
+void BTreeLeaf::unmarshal_entry(const KeyBytes& prefix, const char* bytes, size_t size) {
+    this->keys.push_back(prefix + KeyBytes(bytes, size));
+}
+
+
+/*
+ * **********************************
+ * BTreeInterior class implementation
+ * **********************************
+ */
+
+BlockID BTreeInterior::find(const KeyBytes& key) const {
+    size_t i = std::upper_bound(this->keys.begin(), this->keys.end(), key) - this->keys.begin();
+    return i == 0 ? this->first : this->children[i - 1];
+}
+
+void BTreeInterior::insert(const KeyBytes& separator, BlockID child) {
+    size_t i = std::upper_bound(this->keys.begin(), this->keys.end(), separator) - this->keys.begin();
+    this->keys.insert(this->keys.begin() + i, separator);
+    this->children.insert(this->children.begin() + i, child);
+}
+
+KeyBytes BTreeInterior::split(BTreeInterior* new_node) {
+    size_t mid = this->keys.size() / 2;
+    KeyBytes middle = this->keys[mid];
+    new_node->first = this->children[mid];
+    new_node->keys.assign(this->keys.begin() + mid + 1, this->keys.end());
+    new_node->children.assign(this->children.begin() + mid + 1, this->children.end());
+    this->keys.resize(mid);
+    this->children.resize(mid);
+    return middle;
+}
+
+std::string BTreeInterior::marshal_entry(size_t i, size_t prefix_size) const {
+    std::string entry((const char*)&this->children[i], sizeof(BlockID));
+    entry.append(this->keys[i], prefix_size, std::string::npos);
+    return entry;
+}
+
+void BTreeInterior::unmarshal_entry(const KeyBytes& prefix, const char* bytes, size_t size) {
+    BlockID child;
+    std::memcpy(&child, bytes, sizeof(child));
+    this->children.push_back(child);
+    this->keys.push_back(prefix + KeyBytes(bytes + sizeof(child), size - sizeof(child)));
+}
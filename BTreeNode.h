@@ -0,0 +1,226 @@
+/**
+ * @file BTreeNode.h - B+tree nodes stored in heap file blocks.
+ * BTreeNode
+ * BTreeLeaf: BTreeNode
+ * BTreeInterior: BTreeNode
+ *
+ * @author Justin Thoreson
+ * @see "Seattle University, CPSC5300, Winter 2023"
+ */
+
+#pragma once
+
+#include <vector>
+#include "HeapFile.h"
+#include "KeyEncoder.h"
+
+/**
+ * @class BTreeNode - abstract base class for a B+tree node held in one DbBlock
+ *
+ * A node is kept in memory with its keys fully expanded and is written out as
+ * a fresh SlottedPage on save(). On disk, the longest prefix shared by all the
+ * keys in the node is stored once, in the node header, and each key only
+ * stores its remaining suffix. Since neighboring keys in a node tend to share
+ * long prefixes (URLs, hierarchical ids, composite keys with a common leading
+ * column), this raises the fan-out of a 4kB block considerably.
+ *
+ * Page layout:
+ *     Record 1:   node type (1 byte), link (4 bytes), common key prefix
+ *     Record 2..: one per entry (see subclasses)
+ */
+class BTreeNode {
+public:
+    /**
+     * Node type tags stored in the node header
+     */
+    static const char LEAF = 'L';
+    static const char INTERIOR = 'I';
+
+    /**
+     * Constructor
+     * @param file  file the node lives in
+     * @param id    block holding the node
+     */
+    BTreeNode(HeapFile& file, BlockID id) : file(file), id(id) {}
+
+    virtual ~BTreeNode() {}
+
+    /**
+     * Read a node of either type from its block.
+     * @param file  file the node lives in
+     * @param id    block holding the node
+     * @returns     the node (freed by caller)
+     */
+    static BTreeNode* load(HeapFile& file, BlockID id);
+
+    /**
+     * Write the node out to its block, prefix-compressing the keys.
+     */
+    virtual void save();
+
+    /**
+     * Check if the node (as it would be saved) fits into one block.
+     */
+    virtual bool fits() const;
+
+    virtual bool is_leaf() const = 0;
+
+    BlockID get_id() const { return id; }
+
+    /**
+     * Number of keys in this node.
+     */
+    size_t size() const { return keys.size(); }
+
+    /**
+     * Longest common prefix length of two keys.
+     */
+    static size_t common_prefix(const KeyBytes& a, const KeyBytes& b);
+
+protected:
+    HeapFile& file;
+    BlockID id;
+    std::vector<KeyBytes> keys;  // in ascending order
+
+    /**
+     * Common prefix of all the keys in this node
+     */
+    virtual KeyBytes key_prefix() const;
+
+    // node header link field (next leaf, or leftmost child)
+    virtual BlockID get_link() const = 0;
+
+    /**
+     * Bytes stored with each entry besides its key suffix.
+     */
+    virtual size_t payload_size() const = 0;
+
+    /**
+     * Marshal entry i for storage, given that the first prefix_size bytes of its key are implied.
+     */
+    virtual std::string marshal_entry(size_t i, size_t prefix_size) const = 0;
+
+    /**
+     * Unmarshal an entry and append it to this node.
+     */
+    virtual void unmarshal_entry(const KeyBytes& prefix, const char* bytes, size_t size) = 0;
+};
+
+
+/**
+ * @class BTreeLeaf - leaf node holding index entries
+ *
+ * Each entry is a full index key: the encoded search key followed by the
+ * big-endian handle of the record. Appending the handle makes every key in
+ * the tree distinct (so duplicates of a non-unique search key are ordered by
+ * handle) and means the entry carries no separate payload.
+ * Leaves are chained left to right for range scans.
+ */
+class BTreeLeaf : public BTreeNode {
+public:
+    /**
+     * Size of the handle suffix on each key
+     */
+    static const size_t HANDLE_SZ = sizeof(BlockID) + sizeof(RecordID);
+
+    BTreeLeaf(HeapFile& file, BlockID id, BlockID next_leaf = 0) : BTreeNode(file, id), next_leaf(next_leaf) {}
+
+    virtual ~BTreeLeaf() {}
+
+    virtual bool is_leaf() const { return true; }
+
+    /**
+     * Insert a key in order (no-op if already present).
+     */
+    virtual void insert(const KeyBytes& key);
+
+    /**
+     * Remove a key if present.
+     * @returns true if the key was found
+     */
+    virtual bool del(const KeyBytes& key);
+
+    /**
+     * Move the upper half of this leaf's keys into new_leaf and link it in after this one.
+     * @param new_leaf  empty leaf to receive the upper half
+     * @returns         the shortest separator that divides the two leaves (suffix truncation)
+     */
+    virtual KeyBytes split(BTreeLeaf* new_leaf);
+
+    /**
+     * Index of the first key >= the given search key (or size() if none).
+     */
+    virtual size_t lower_bound(const KeyBytes& key) const;
+
+    const KeyBytes& get_key(size_t i) const { return keys[i]; }
+
+    BlockID get_next_leaf() const { return next_leaf; }
+
+    /**
+     * Build a full index key from an encoded search key and a record handle.
+     */
+    static KeyBytes make_key(const KeyBytes& search_key, Handle handle);
+
+    /**
+     * Pull the record handle back out of a full index key.
+     */
+    static Handle get_handle(const KeyBytes& key);
+
+protected:
+    BlockID next_leaf;
+
+    virtual BlockID get_link() const { return next_leaf; }
+
+    virtual size_t payload_size() const { return 0; }
+
+    virtual std::string marshal_entry(size_t i, size_t prefix_size) const;
+
+    virtual void unmarshal_entry(const KeyBytes& prefix, const char* bytes, size_t size);
+};
+
+
+/**
+ * @class BTreeInterior - interior node holding separators and child pointers
+ *
+ * Layout is p0, k1, p1, k2, p2, ..., kn, pn: keys less than k1 are under p0,
+ * keys at least ki (and less than ki+1) are under pi. Separators pushed up from
+ * leaf splits are suffix-truncated, so they are typically much shorter than
+ * the full keys they route.
+ */
+class BTreeInterior : public BTreeNode {
+public:
+    BTreeInterior(HeapFile& file, BlockID id, BlockID first = 0) : BTreeNode(file, id), first(first) {}
+
+    virtual ~BTreeInterior() {}
+
+    virtual bool is_leaf() const { return false; }
+
+    /**
+     * Child block to descend into for the given key.
+     */
+    virtual BlockID find(const KeyBytes& key) const;
+
+    /**
+     * Insert a separator and the child to its right (after a child split).
+     */
+    virtual void insert(const KeyBytes& separator, BlockID child);
+
+    /**
+     * Move the upper half of this node into new_node.
+     * @param new_node  empty interior node to receive the upper half
+     * @returns         the middle separator, which moves up to the parent
+     */
+    virtual KeyBytes split(BTreeInterior* new_node);
+
+protected:
+    BlockID first;
+    std::vector<BlockID> children;  // children[i] is to the right of keys[i]
+
+    virtual BlockID get_link() const { return first; }
+
+    virtual size_t payload_size() const { return sizeof(BlockID); }
+
+    virtual std::string marshal_entry(size_t i, size_t prefix_size) const;
+
+    virtual void unmarshal_entry(const KeyBytes& prefix, const char* bytes, size_t size);
+};
@@ -0,0 +1,170 @@
+/**
+ * @file BlockSummaryFile.cpp
+ * @author Justin Thoreson
+ * @see Seattle University, CPSC5300
+ */
+
+#include "BlockSummaryFile.h"
+
+using u32 = u_int32_t;
+
+static const BlockID COLUMNS_KEY = 0;  // BlockIDs start at 1
+
+BlockSummaryFile::BlockSummaryFile(std::string name)
+    : dbfilename(name + ".db"), db(nullptr), column_names(), summaries(), probed(false), mutex() {
+}
+
+BlockSummaryFile::~BlockSummaryFile() {
+    if (this->db) {
+        this->db->close(0);
+        delete this->db;
+    }
+}
+
+void BlockSummaryFile::create(const ColumnNames& column_names, const ColumnAttributes& column_attributes) {
+    std::lock_guard<std::recursive_mutex> lock(this->mutex);
+    for (uint i = 0; i < column_names.size(); i++) {
+        ColumnAttribute ca = column_attributes[i];
+        if (!this->can_summarize(ca.get_data_type()))
+            throw DbRelationError("cannot summarize column '" + column_names[i] + "' of this type");
+    }
+    this->close();
+    this->db_open(DB_CREATE | DB_EXCL);
+    this->column_names = column_names;
+    std::string names;
+    for (auto const& column_name: column_names)
+        names += column_name + '\0';
+    BlockID key_id = COLUMNS_KEY;
+    Dbt key(&key_id, sizeof(key_id)), data((void*)names.data(), (u32)names.size());
+    this->db->put(nullptr, &key, &data, 0);
+}
+
+void BlockSummaryFile::drop() {
+    std::lock_guard<std::recursive_mutex> lock(this->mutex);
+    this->close();
+    try {
+        Transaction::remove(this->dbfilename, false);
+    } catch (DbException& e) {
+        // nothing to drop
+    }
+}
+
+void BlockSummaryFile::open() {
+    std::lock_guard<std::recursive_mutex> lock(this->mutex);
+    if (this->db || this->probed)
+        return;
+    this->probed = true;
+    try {
+        this->db_open();
+    } catch (DbException& e) {
+        // no summaries kept for this file
+    }
+}
+
+void BlockSummaryFile::close() {
+    std::lock_guard<std::recursive_mutex> lock(this->mutex);
+    if (this->db) {
+        this->db->close(0);
+        delete this->db;
+        this->db = nullptr;
+    }
+    this->column_names.clear();
+    this->summaries.clear();
+    this->probed = false;
+}
+
+void BlockSummaryFile::add(BlockID block_id, const ValueDict* row) {
+    std::lock_guard<std::recursive_mutex> lock(this->mutex);
+    this->widen(block_id, row);
+    this->put_summary(block_id);
+}
+
+void BlockSummaryFile::add(BlockID block_id, const ValueDicts& rows) {
+    std::lock_guard<std::recursive_mutex> lock(this->mutex);
+    for (const ValueDict* row: rows)
+        this->widen(block_id, row);
+    this->put_summary(block_id);
+}
+
+void BlockSummaryFile::widen(BlockID block_id, const ValueDict* row) {
+    uint size = this->column_summary_size();
+    if (this->summaries.size() <= block_id)
+        this->summaries.resize(block_id + 1);
+    std::string& summary = this->summaries[block_id];
+    if (summary.empty()) {
+        summary.assign(this->column_names.size() * size, '\0');
+        for (uint i = 0; i < this->column_names.size(); i++)
+            this->init_column_summary(&summary[i * size]);
+    }
+    for (uint i = 0; i < this->column_names.size(); i++)
+        this->add_value(&summary[i * size], row->at(this->column_names[i]));
+}
+
+bool BlockSummaryFile::might_match(BlockID block_id, const ValueDict* where, const IntRanges* ranges) const {
+    std::lock_guard<std::recursive_mutex> lock(this->mutex);
+    const char* summary = this->get_summary(block_id);
+    if (summary == nullptr)
+        return true;
+    uint size = this->column_summary_size();
+    for (uint i = 0; i < this->column_names.size(); i++) {
+        if (where != nullptr) {
+            ValueDict::const_iterator column = where->find(this->column_names[i]);
+            if (column != where->end() && !this->might_contain(summary + i * size, column->second))
+                return false;
+        }
+        if (ranges != nullptr) {
+            IntRanges::const_iterator range = ranges->find(this->column_names[i]);
+            if (range != ranges->end() && !this->might_overlap(summary + i * size, range->second))
+                return false;
+        }
+    }
+    return true;
+}
+
+const char* BlockSummaryFile::get_summary(BlockID block_id) const {
+    if (block_id >= this->summaries.size() || this->summaries[block_id].empty())
+        return nullptr;
+    return this->summaries[block_id].data();
+}
+
+void BlockSummaryFile::db_open(uint flags) {
+    Db* db = new Db(_DB_ENV, 0);
+    db->set_message_stream(_DB_ENV->get_message_stream());
+    db->set_error_stream(_DB_ENV->get_error_stream());
+    try {
+        db->open(nullptr, this->dbfilename.c_str(), nullptr, DB_HASH, flags, 0644);
+    } catch (DbException& e) {
+        delete db;
+        throw;
+    }
+    this->db = db;
+    if (flags & DB_CREATE)
+        return;
+
+    // load the column names and all the summaries
+    Dbt key, data;
+    Dbc* cursor;
+    this->db->cursor(nullptr, &cursor, 0);
+    while (cursor->get(&key, &data, DB_NEXT) == 0) {
+        BlockID block_id = *(BlockID*)key.get_data();
+        std::string bytes((char*)data.get_data(), data.get_size());
+        if (block_id == COLUMNS_KEY) {
+            size_t start = 0, end;
+            while ((end = bytes.find('\0', start)) != std::string::npos) {
+                this->column_names.push_back(bytes.substr(start, end - start));
+                start = end + 1;
+            }
+        } else {
+            if (this->summaries.size() <= block_id)
+                this->summaries.resize(block_id + 1);
+            this->summaries[block_id] = bytes;
+        }
+    }
+    cursor->close();
+}
+
+void BlockSummaryFile::put_summary(BlockID block_id) {
+    std::string& summary = this->summaries[block_id];
+    Dbt key(&block_id, sizeof(block_id)), data((void*)summary.data(), (u32)summary.size());
+    this->db->put(nullptr, &key, &data, 0);
+}
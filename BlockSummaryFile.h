@@ -0,0 +1,172 @@
+/**
+ * @file BlockSummaryFile.h - Per-block summaries kept in a side file next to a HeapFile.
+ * BlockSummaryFile
+ *
+ * @author Justin Thoreson
+ * @see "Seattle University, CPSC5300, Winter 2023"
+ */
+
+#pragma once
+
+#include <mutex>
+#include <string>
+#include <vector>
+#include "db_cxx.h"
+#include "storage_engine.h"
+#include "Transaction.h"
+
+/**
+ * @class BlockSummaryFile - abstract base class for per-block column summaries
+ *
+ * Keeps a small fixed-size summary of the values of some chosen columns for
+ * each block of a heap file (e.g., a Bloom filter or a min/max zone map), so
+ * that scans can rule blocks out without reading them. Summaries can only
+ * ever err on the side of "might match": they are widened as rows are added
+ * and are not tightened when rows are deleted.
+ *
+ * Built on a Berkeley DB Hash file keyed by BlockID. Key 0 holds the list of
+ * summarized columns. The summaries are small, so they are all cached in
+ * memory on open and written through on change. They are kept outside of
+ * transactions: a summary widened for rows whose transaction is rolled back
+ * is still a summary of what is left. The file is opened without
+ * DB_AUTO_COMMIT, so its writes are logged (and recovered along with the
+ * table's) but never wait for the log to reach the disk themselves. A table's
+ * summaries are read by every session scanning it while its writer widens
+ * them, so they are only used under a mutex.
+ */
+class BlockSummaryFile {
+public:
+    /**
+     * Constructor
+     * @param name  name of the file (without extension)
+     */
+    BlockSummaryFile(std::string name);
+
+    virtual ~BlockSummaryFile();
+
+    BlockSummaryFile(const BlockSummaryFile& other) = delete;
+
+    BlockSummaryFile(BlockSummaryFile&& temp) = delete;
+
+    BlockSummaryFile& operator=(const BlockSummaryFile& other) = delete;
+
+    BlockSummaryFile& operator=(BlockSummaryFile&& temp) = delete;
+
+    /**
+     * Create the (empty) summary file for the given columns.
+     * @param column_names       columns to summarize
+     * @param column_attributes  attributes of those columns
+     * @throws                   DbRelationError if a column can't be summarized
+     */
+    virtual void create(const ColumnNames& column_names, const ColumnAttributes& column_attributes);
+
+    /**
+     * Remove the summary file, if there is one.
+     */
+    virtual void drop();
+
+    /**
+     * Open the summary file if there is one. Cheap to call repeatedly.
+     */
+    virtual void open();
+
+    /**
+     * Close the summary file (the next open() will look for it again).
+     */
+    virtual void close();
+
+    /**
+     * Is there an open summary file?
+     */
+    virtual bool is_open() const {
+        std::lock_guard<std::recursive_mutex> lock(this->mutex);
+        return db != nullptr;
+    }
+
+    /**
+     * Accessor for the summarized columns.
+     */
+    virtual const ColumnNames& get_column_names() const { return column_names; }
+
+    /**
+     * Widen the summary of a block to cover the given row.
+     * @param block_id  block the row was written to
+     * @param row       the row (must have all the summarized columns)
+     */
+    virtual void add(BlockID block_id, const ValueDict* row);
+
+    /**
+     * Widen the summary of a block to cover all the given rows (one write).
+     * @param block_id  block the rows were written to
+     * @param rows      the rows (must have all the summarized columns)
+     */
+    virtual void add(BlockID block_id, const ValueDicts& rows);
+
+    /**
+     * Check if a block could hold rows matching the given predicates.
+     * @param block_id  block to check
+     * @param where     column values to match (non-summarized columns are ignored)
+     * @param ranges    INT column ranges to match (likewise)
+     * @returns         false only if the block definitely has no matching rows
+     */
+    virtual bool might_match(BlockID block_id, const ValueDict* where, const IntRanges* ranges = nullptr) const;
+
+protected:
+    std::string dbfilename;
+    Db* db;
+    ColumnNames column_names;
+    std::vector<std::string> summaries;  // indexed by BlockID, empty if no summary yet
+    bool probed;
+    mutable std::recursive_mutex mutex;
+
+    /**
+     * Bytes of summary per column per block.
+     */
+    virtual uint column_summary_size() const = 0;
+
+    /**
+     * Check that a column can be summarized by this kind of file.
+     */
+    virtual bool can_summarize(ColumnAttribute::DataType data_type) const = 0;
+
+    /**
+     * Initialize a column summary for a block with no rows.
+     */
+    virtual void init_column_summary(char* summary) const = 0;
+
+    /**
+     * Widen a column summary to cover value.
+     */
+    virtual void add_value(char* summary, const Value& value) const = 0;
+
+    /**
+     * Check if a column summary could cover value.
+     */
+    virtual bool might_contain(const char* summary, const Value& value) const = 0;
+
+    /**
+     * Check if a column summary could cover any value in range (true if it can't tell).
+     */
+    virtual bool might_overlap(const char* summary, const IntRange& range) const { return true; }
+
+    /**
+     * Get the cached summary for a block (nullptr if none).
+     */
+    virtual const char* get_summary(BlockID block_id) const;
+
+    /**
+     * Widen the cached summary of a block to cover row (without writing it through).
+     */
+    virtual void widen(BlockID block_id, const ValueDict* row);
+
+    /**
+     * Open the Berkeley DB file and load the columns and summaries.
+     * @param flags  Flags to provide the Berkeley DB database file
+     */
+    virtual void db_open(uint flags = 0);
+
+    /**
+     * Write one block's summary through to the file.
+     */
+    virtual void put_summary(BlockID block_id);
+};
@@ -0,0 +1,43 @@
+/**
+ * @file BloomFilterFile.cpp
+ * @author Justin Thoreson
+ * @see Seattle University, CPSC5300
+ */
+
+#include "BloomFilterFile.h"
+
+using u32 = u_int32_t;
+
+void BloomFilterFile::add_value(char* summary, const Value& value) const {
+    u32 h1, h2;
+    hash(value, h1, h2);
+    for (uint i = 0; i < NUM_HASHES; i++) {
+        u32 bit = (h1 + i * h2) % FILTER_BITS;
+        summary[bit / 8] |= (char)(1 << (bit % 8));
+    }
+}
+
+bool BloomFilterFile::might_contain(const char* summary, const Value& value) const {
+    u32 h1, h2;
+    hash(value, h1, h2);
+    for (uint i = 0; i < NUM_HASHES; i++) {
+        u32 bit = (h1 + i * h2) % FILTER_BITS;
+        if (!(summary[bit / 8] & (1 << (bit % 8))))
+            return false;
+    }
+    return true;
+}
+
+// INT and BOOLEAN hash their number, TEXT its characters, so equal Values hash equally.
+void BloomFilterFile::hash(const Value& value, u32& h1, u32& h2) {
+    uint64_t h = 14695981039346656037ULL;
+    if (value.data_type == ColumnAttribute::TEXT) {
+        for (char c: value.s)
+            h = (h ^ (uint8_t)c) * 1099511628211ULL;
+    } else {
+        for (int shift = 0; shift < 32; shift += 8)
+            h = (h ^ (uint8_t)(value.n >> shift)) * 1099511628211ULL;
+    }
+    h1 = (u32)h;
+    h2 = (u32)(h >> 32) | 1;  // odd, so the probes don't repeat
+}
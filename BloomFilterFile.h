@@ -0,0 +1,56 @@
+/**
+ * @file BloomFilterFile.h - Per-block Bloom filters for equality scans.
+ * BloomFilterFile: BlockSummaryFile
+ *
+ * @author Justin Thoreson
+ * @see "Seattle University, CPSC5300, Winter 2023"
+ */
+
+#pragma once
+
+#include "BlockSummaryFile.h"
+
+/**
+ * @class BloomFilterFile - one Bloom filter per block per chosen column
+ *
+ * Lets an equality scan on a column with no index skip blocks that cannot
+ * hold the value. Each filter is FILTER_BITS bits with NUM_HASHES probes,
+ * which keeps false positives to a few percent for the couple hundred rows
+ * a full block of small rows holds. Deleted rows leave their bits set.
+ */
+class BloomFilterFile : public BlockSummaryFile {
+public:
+    /**
+     * Filter size (bits) per column per block
+     */
+    static const uint FILTER_BITS = 2048;
+
+    /**
+     * Number of bits set per value
+     */
+    static const uint NUM_HASHES = 3;
+
+    /**
+     * Constructor
+     * @param table_name  table whose heap file is being summarized
+     */
+    BloomFilterFile(Identifier table_name) : BlockSummaryFile(table_name + "-bloom") {}
+
+    virtual ~BloomFilterFile() {}
+
+protected:
+    virtual uint column_summary_size() const { return FILTER_BITS / 8; }
+
+    virtual bool can_summarize(ColumnAttribute::DataType data_type) const { return true; }
+
+    virtual void init_column_summary(char* summary) const {}  // already zeroed
+
+    virtual void add_value(char* summary, const Value& value) const;
+
+    virtual bool might_contain(const char* summary, const Value& value) const;
+
+    /**
+     * 64-bit hash of a value (FNV-1a), split into the two halves used for double hashing.
+     */
+    static void hash(const Value& value, u_int32_t& h1, u_int32_t& h2);
+};
@@ -0,0 +1,49 @@
+/**
+ * @file BloomIndex.cpp - Implementation of BloomIndex
+ * @author Justin Thoreson
+ * @see "Seattle University, CPSC5300, Winter 2023"
+ */
+
+#include <algorithm>
+#include "BloomIndex.h"
+#include "schema_tables.h"
+
+const Identifier BloomIndex::INDEX_TYPE = "BLOOM";
+
+void BloomIndex::create() {
+    this->build(true);
+}
+
+void BloomIndex::drop() {
+    this->build(false);
+}
+
+Handles* BloomIndex::lookup(ValueDict* key_values) const {
+    throw DbRelationError("a BLOOM index can't look rows up");
+}
+
+// Add the columns not already there.
+static void add_columns(ColumnNames& column_names, const ColumnNames& more) {
+    for (const Identifier& column_name: more)
+        if (std::find(column_names.begin(), column_names.end(), column_name) == column_names.end())
+            column_names.push_back(column_name);
+}
+
+// The other indices' columns come from the catalog, which has this index's
+// _indices rows too, from before it is created until after it is dropped.
+void BloomIndex::build(bool with_this) {
+    HeapTable* table = dynamic_cast<HeapTable*>(&this->relation);
+    if (table == nullptr)
+        throw DbRelationError("a BLOOM index can only be made on a heap table");
+    ColumnNames column_names;
+    const Catalog::TableEntry* entry = Catalog::get_table(this->relation.get_table_name());
+    for (uint i = 0; entry != nullptr && i < entry->indices.size(); i++) {
+        const Catalog::IndexEntry& index = entry->indices[i];
+        if (index.index_type == INDEX_TYPE && index.index_name != this->name)
+            add_columns(column_names, index.column_names);
+    }
+    if (with_this)
+        add_columns(column_names, this->key_columns);
+    if (column_names != table->get_bloom_filter_columns())
+        table->create_bloom_filters(column_names);
+}
@@ -0,0 +1,94 @@
+/**
+ * @file BloomIndex.h - Per-block Bloom filters of a heap table, kept as an index.
+ * BloomIndex: DbIndex
+ *
+ * @author Justin Thoreson
+ * @see "Seattle University, CPSC5300, Winter 2023"
+ */
+
+#pragma once
+
+#include "storage_engine.h"
+#include "HeapTable.h"
+
+/**
+ * @class BloomIndex - Bloom filters on some of a heap table's columns
+ *
+ * Made with CREATE INDEX ... USING BLOOM. It finds no rows itself: it has the
+ * table keep per-block Bloom filters on its columns (see
+ * HeapTable::create_bloom_filters), so that table scans with equality
+ * predicates on them skip the blocks that can't hold the value. A table keeps
+ * one set of filters, on the columns of all of its BLOOM indices together.
+ * The table widens the filters itself as rows are added, and they are kept
+ * in their own file, which the table reopens along with its heap file.
+ */
+class BloomIndex : public DbIndex {
+public:
+    /**
+     * The index_type of a BLOOM index in _indices
+     */
+    static const Identifier INDEX_TYPE;
+
+    /**
+     * Constructor
+     * @param relation     the table whose blocks are summarized (must be a HeapTable)
+     * @param name         name of this index (unique by relation)
+     * @param key_columns  columns to keep filters on
+     */
+    BloomIndex(DbRelation& relation, Identifier name, ColumnNames key_columns)
+        : DbIndex(relation, name, key_columns, false) {}
+
+    virtual ~BloomIndex() {}
+
+    BloomIndex(const BloomIndex& other) = delete;
+
+    BloomIndex(BloomIndex&& temp) = delete;
+
+    BloomIndex& operator=(const BloomIndex& other) = delete;
+
+    BloomIndex& operator=(BloomIndex&& temp) = delete;
+
+    /**
+     * Rebuild the table's filters on the columns of its BLOOM indices, this one included.
+     * @throws  DbRelationError if the table isn't a heap table
+     */
+    virtual void create();
+
+    /**
+     * Rebuild the table's filters on the columns of its other BLOOM indices (dropping them if there are none).
+     */
+    virtual void drop();
+
+    /**
+     * Nothing to do: the table opens its filters.
+     */
+    virtual void open() {}
+
+    /**
+     * Nothing to do: the table closes its filters.
+     */
+    virtual void close() {}
+
+    /**
+     * Not supported: the filters only rule blocks out.
+     * @throws  DbRelationError
+     */
+    virtual Handles* lookup(ValueDict* key_values) const;
+
+    /**
+     * Nothing to do: the table widens its filters as rows are added.
+     */
+    virtual void insert(Handle record) {}
+
+    /**
+     * Nothing to do: the filters aren't narrowed when rows are deleted.
+     */
+    virtual void del(Handle record) {}
+
+protected:
+    /**
+     * Rebuild the table's filters on the columns of its BLOOM indices.
+     * @param with_this  whether to include this index's columns
+     */
+    virtual void build(bool with_this);
+};
@@ -0,0 +1,288 @@
+/**
+ * @file HashAggregate.cpp - implementation of the hash aggregate operator
+ * @author Justin Thoreson
+ * @see "Seattle University, CPSC5300, Winter 2023"
+ */
+
+#include <atomic>
+#include <functional>
+#include <limits>
+#include "HashAggregate.h"
+
+// aggregates made so far (by any session), to give each one's spill files their own names
+static std::atomic<uint> hash_aggregates(0);
+
+// fewest slots in the hash table
+static const size_t MIN_SLOTS = 16;
+
+// partitions are picked by successive groups of PARTITION_BITS of the hash, high bits first
+static const uint PARTITION_BITS = 3;
+static const uint MAX_LEVEL = 64 / PARTITION_BITS - 1;
+
+HashAggregate::HashAggregate(PlanOperator* child, ColumnNames group_columns, Aggregates aggregates,
+                             size_t expected_groups, size_t memory_groups)
+    : PlanOperator(), child(child), group_columns(group_columns), aggregates(aggregates),
+      expected_groups(expected_groups), memory_groups(memory_groups), id(++hash_aggregates), width(0), slots(),
+      hashes(), keys(), states(), position(0), spilling(false), spills(), spill_count(0) {
+    for (const Aggregate& aggregate: this->aggregates)
+        this->width += aggregate.width();
+}
+
+HashAggregate::~HashAggregate() {
+    this->drop_spills();
+    delete this->child;
+}
+
+void HashAggregate::open() {
+    this->drop_spills();
+    this->spilling = false;
+    this->spill_count = 0;
+    this->reset(std::min(this->expected_groups, this->memory_groups));
+    this->consume(this->child, 0);
+    if (this->group_columns.empty() && this->hashes.empty())
+        this->add_group(0, nullptr);
+}
+
+// The groups in memory go out first, then each spill file is aggregated in turn.
+bool HashAggregate::next(RowBatch& batch) {
+    batch.clear();
+    while (true) {
+        while (this->position < this->hashes.size() && batch.size() < RowBatch::CAPACITY)
+            batch.add(Handle(), this->result(this->position++));
+        if (!batch.empty())
+            return true;
+        if (this->spills.empty())
+            return false;
+        Spill spill = this->spills.back();
+        this->spills.pop_back();
+        this->reset(std::min(this->expected_groups, this->memory_groups));
+        TableScan scan(*spill.table, ColumnNames());
+        this->consume(&scan, spill.level);
+        spill.table->drop();
+        delete spill.table;
+    }
+}
+
+void HashAggregate::close() {
+    this->drop_spills();
+    this->reset(0);
+}
+
+// Counts and sums add up, and MIN and MAX take whichever value wins (if the other group has one).
+void HashAggregate::merge(const HashAggregate& other) {
+    size_t n = this->group_columns.size();
+    for (size_t g = 0; g < other.hashes.size(); g++) {
+        ValueDict key;
+        for (size_t i = 0; i < n; i++)
+            key[this->group_columns[i]] = other.keys[g * n + i];
+        int64_t group = this->find(other.hashes[g], &key);
+        if (group < 0)
+            group = this->add_group(other.hashes[g], &key);
+        int64_t* state = &this->states[group * this->width];
+        const int64_t* other_state = &other.states[g * this->width];
+        for (const Aggregate& aggregate: this->aggregates) {
+            switch (aggregate.function) {
+                case Aggregate::COUNT:
+                case Aggregate::SUM:
+                case Aggregate::AVG:
+                    for (uint i = 0; i < aggregate.width(); i++)
+                        state[i] += other_state[i];
+                    break;
+                case Aggregate::MIN:
+                case Aggregate::MAX:
+                    if (other_state[1] && (!state[1] || (aggregate.function == Aggregate::MIN
+                                                         ? other_state[0] < state[0] : other_state[0] > state[0])))
+                        state[0] = other_state[0];
+                    state[1] = state[1] || other_state[1];
+                    break;
+            }
+            state += aggregate.width();
+            other_state += aggregate.width();
+        }
+    }
+}
+
+std::string HashAggregate::explain(uint depth) const {
+    std::string list;
+    for (const Aggregate& aggregate: this->aggregates)
+        list += (list.empty() ? "" : ", ") + aggregate.output_name;
+    std::string groups;
+    for (const Identifier& column_name: this->group_columns)
+        groups += (groups.empty() ? " GROUP BY " : ", ") + column_name;
+    return std::string(2 * depth, ' ') + "HashAggregate " + list + groups + "\n" + this->child->explain(depth + 1);
+}
+
+// Combines the group values' hashes the way boost::hash_combine does, then
+// finishes with MurmurHash3's mixer so every bit depends on all the values.
+size_t HashAggregate::hash(const ValueDict* row) const {
+    uint64_t h = 0;
+    for (const Identifier& column_name: this->group_columns) {
+        const Value& value = row->at(column_name);
+        size_t k = value.data_type == ColumnAttribute::TEXT ? std::hash<std::string>()(value.s)
+                                                            : std::hash<int32_t>()(value.n);
+        h ^= k + 0x9e3779b9 + (h << 6) + (h >> 2);
+    }
+    h ^= h >> 33;
+    h *= 0xff51afd7ed558ccdULL;
+    h ^= h >> 33;
+    h *= 0xc4ceb9fe1a85ec53ULL;
+    h ^= h >> 33;
+    return (size_t) h;
+}
+
+int64_t HashAggregate::find(size_t h, const ValueDict* row) const {
+    size_t mask = this->slots.size() - 1;
+    size_t n = this->group_columns.size();
+    for (size_t slot = h & mask; this->slots[slot] >= 0; slot = (slot + 1) & mask) {
+        int64_t group = this->slots[slot];
+        if (this->hashes[group] != h)
+            continue;
+        bool equal = true;
+        for (size_t i = 0; i < n && equal; i++)
+            equal = this->keys[group * n + i] == row->at(this->group_columns[i]);
+        if (equal)
+            return group;
+    }
+    return -1;
+}
+
+int64_t HashAggregate::add_group(size_t h, const ValueDict* row) {
+    int64_t group = (int64_t) this->hashes.size();
+    this->hashes.push_back(h);
+    for (const Identifier& column_name: this->group_columns)
+        this->keys.push_back(row->at(column_name));
+    this->states.resize(this->states.size() + this->width, 0);
+
+    if (2 * this->hashes.size() > this->slots.size()) {
+        this->slots.assign(2 * this->slots.size(), -1);
+        for (int64_t g = 0; g < group; g++) {
+            size_t slot = this->hashes[g] & (this->slots.size() - 1);
+            while (this->slots[slot] >= 0)
+                slot = (slot + 1) & (this->slots.size() - 1);
+            this->slots[slot] = g;
+        }
+    }
+    size_t slot = h & (this->slots.size() - 1);
+    while (this->slots[slot] >= 0)
+        slot = (slot + 1) & (this->slots.size() - 1);
+    this->slots[slot] = group;
+    return group;
+}
+
+// MIN and MAX keep the value and whether there has been one yet; AVG keeps the sum and the count.
+void HashAggregate::accumulate(int64_t group, const ValueDict* row) {
+    int64_t* state = &this->states[group * this->width];
+    for (const Aggregate& aggregate: this->aggregates) {
+        int64_t value = aggregate.column_name.empty() ? 0 : row->at(aggregate.column_name).n;
+        switch (aggregate.function) {
+            case Aggregate::COUNT:
+                state[0]++;
+                break;
+            case Aggregate::SUM:
+                state[0] += value;
+                break;
+            case Aggregate::AVG:
+                state[0] += value;
+                state[1]++;
+                break;
+            case Aggregate::MIN:
+                if (!state[1] || value < state[0])
+                    state[0] = value;
+                state[1] = 1;
+                break;
+            case Aggregate::MAX:
+                if (!state[1] || value > state[0])
+                    state[0] = value;
+                state[1] = 1;
+                break;
+        }
+        state += aggregate.width();
+    }
+}
+
+void HashAggregate::consume(PlanOperator* input, uint level) {
+    std::vector<HeapTable*> partitions(PARTITIONS, nullptr);
+    std::vector<ValueDicts> pending(PARTITIONS);
+    input->open();
+    RowBatch batch;
+    while (input->next(batch)) {
+        if (this->group_columns.empty()) {
+            if (this->hashes.empty())
+                this->add_group(0, nullptr);
+            for (size_t i = 0; i < batch.size(); i++)
+                this->accumulate(0, batch.get_row(i));
+            continue;
+        }
+        for (size_t i = 0; i < batch.size(); i++) {
+            const ValueDict* row = batch.get_row(i);
+            size_t h = this->hash(row);
+            int64_t group = this->find(h, row);
+            if (group < 0) {
+                if (this->hashes.size() < this->memory_groups || level >= MAX_LEVEL) {
+                    group = this->add_group(h, row);
+                } else {
+                    this->spilling = true;
+                    pending[(h >> (64 - PARTITION_BITS * (level + 1))) % PARTITIONS].push_back(new ValueDict(*row));
+                    continue;
+                }
+            }
+            this->accumulate(group, row);
+        }
+        for (uint p = 0; p < PARTITIONS; p++) {
+            if (pending[p].empty())
+                continue;
+            if (partitions[p] == nullptr)
+                partitions[p] = HeapTable::create_temporary("_hash_aggregate_" + std::to_string(this->id) + "_spill"
+                                                            + std::to_string(++this->spill_count), pending[p].front());
+            Handles* handles = partitions[p]->insert(&pending[p]);
+            delete handles;
+            for (ValueDict* row: pending[p])
+                delete row;
+            pending[p].clear();
+        }
+    }
+    input->close();
+    for (HeapTable* partition: partitions)
+        if (partition != nullptr)
+            this->spills.push_back(Spill(partition, level + 1));
+}
+
+void HashAggregate::reset(size_t groups) {
+    size_t size = MIN_SLOTS;
+    while (size < 2 * groups)
+        size *= 2;
+    this->slots.assign(size, -1);
+    this->hashes.clear();
+    this->keys.clear();
+    this->states.clear();
+    this->position = 0;
+}
+
+ValueDict* HashAggregate::result(size_t group) const {
+    ValueDict* row = new ValueDict();
+    for (size_t i = 0; i < this->group_columns.size(); i++)
+        (*row)[this->group_columns[i]] = this->keys[group * this->group_columns.size() + i];
+    const int64_t* state = &this->states[group * this->width];
+    for (const Aggregate& aggregate: this->aggregates) {
+        int64_t value = state[0];
+        if (aggregate.function == Aggregate::AVG)
+            value = state[1] == 0 ? 0 : state[0] / state[1];
+        if (value < std::numeric_limits<int32_t>::min() || value > std::numeric_limits<int32_t>::max()) {
+            delete row;
+            throw DbRelationError(aggregate.output_name + " is out of range for an INT");
+        }
+        Value result((int32_t) value);
+        result.data_type = aggregate.get_output_type();
+        (*row)[aggregate.output_name] = result;
+        state += aggregate.width();
+    }
+    return row;
+}
+
+void HashAggregate::drop_spills() {
+    for (Spill& spill: this->spills) {
+        spill.table->drop();
+        delete spill.table;
+    }
+    this->spills.clear();
+}
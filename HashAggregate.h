@@ -0,0 +1,207 @@
+/**
+ * @file HashAggregate.h - Grouping and aggregation plan operator that spills to disk when short of memory.
+ * Aggregate
+ * HashAggregate: PlanOperator
+ *
+ * @author Justin Thoreson
+ * @see "Seattle University, CPSC5300, Winter 2023"
+ */
+
+#pragma once
+
+#include <vector>
+#include "QueryPlan.h"
+#include "HeapTable.h"
+
+/**
+ * @class Aggregate - an aggregate function over a column (or over the rows, for COUNT(*))
+ */
+class Aggregate {
+public:
+    enum Function {
+        COUNT,
+        SUM,
+        MIN,
+        MAX,
+        AVG
+    };
+
+    /**
+     * Constructor
+     * @param function     what to compute
+     * @param column_name  column to compute it over (empty for COUNT(*))
+     * @param output_name  what to call the result column
+     * @param data_type    data type of the column (INT or BOOLEAN)
+     */
+    Aggregate(Function function, Identifier column_name, Identifier output_name,
+              ColumnAttribute::DataType data_type = ColumnAttribute::INT)
+        : function(function), column_name(column_name), output_name(output_name), data_type(data_type) {}
+
+    /**
+     * Number of int64_t slots the function's running state takes.
+     */
+    uint width() const { return function == COUNT || function == SUM ? 1 : 2; }
+
+    /**
+     * Data type of the result column.
+     */
+    ColumnAttribute::DataType get_output_type() const {
+        return function == MIN || function == MAX ? data_type : ColumnAttribute::INT;
+    }
+
+    Function function;
+    Identifier column_name;
+    Identifier output_name;
+    ColumnAttribute::DataType data_type;
+};
+
+using Aggregates = std::vector<Aggregate>;
+
+
+/**
+ * @class HashAggregate - one result row per distinct combination of the group
+ * columns' values, with the aggregates computed over the group's input rows
+ *
+ * Each group's aggregate state is a fixed number of int64_t slots, kept for
+ * all the groups in one flat array, and the groups are found through an
+ * open-addressing hash table sized up front for the expected number of groups.
+ * Once memory_groups groups are in memory, rows of groups already there are
+ * still aggregated in place but rows of any other group are spilled by hash
+ * into PARTITIONS temporary heap files, so the groups in memory are complete
+ * when the input runs out. Each spill file is then aggregated in turn the same
+ * way (partitioning on different bits of the hash if it spills again).
+ *
+ * Without group columns there is just the one group, and each batch of input
+ * rows is folded straight into its state without any hashing. It produces a
+ * row even for no input rows (with 0 for every aggregate, there being no NULLs).
+ *
+ * AVG is the integer average (rounded toward zero), and SUM throws
+ * DbRelationError if the total doesn't fit in an INT.
+ */
+class HashAggregate : public PlanOperator {
+public:
+    /**
+     * Number of partitions the rows are spilled to when the groups don't fit
+     */
+    static const uint PARTITIONS = 8;
+
+    /**
+     * Default for the most groups held in memory at once
+     */
+    static const size_t MEMORY_GROUPS = 100000;
+
+    /**
+     * Constructor
+     * @param child            operator producing the rows to aggregate (now owned by the aggregate)
+     * @param group_columns    columns to group by (none for a single group of all the rows)
+     * @param aggregates       aggregates to compute for each group
+     * @param expected_groups  estimated number of groups, to size the hash table (0 if unknown)
+     * @param memory_groups    most groups to hold in memory before spilling
+     */
+    HashAggregate(PlanOperator* child, ColumnNames group_columns, Aggregates aggregates, size_t expected_groups = 0,
+                  size_t memory_groups = MEMORY_GROUPS);
+
+    virtual ~HashAggregate();
+
+    /**
+     * Open the input and read all of it, aggregating it in memory and spilling what doesn't fit.
+     */
+    virtual void open();
+
+    virtual bool next(RowBatch& batch);
+
+    /**
+     * Close the input and drop any spill files.
+     */
+    virtual void close();
+
+    virtual std::string explain(uint depth = 0) const;
+
+    /**
+     * Did the last open() have to spill to disk?
+     */
+    virtual bool spilled() const { return spilling; }
+
+    /**
+     * Fold another aggregate's groups into this one's, as if this one had also
+     * read the other's input. Both must be open, with the same group columns and
+     * aggregates, and neither may have spilled.
+     * @param other  the aggregate to take the groups of
+     */
+    virtual void merge(const HashAggregate& other);
+
+protected:
+    /**
+     * A spill file still to be aggregated, and how many times its rows have been spilled
+     */
+    class Spill {
+    public:
+        Spill(HeapTable* table, uint level) : table(table), level(level) {}
+
+        HeapTable* table;
+        uint level;
+    };
+
+    PlanOperator* child;
+    ColumnNames group_columns;
+    Aggregates aggregates;
+    size_t expected_groups;
+    size_t memory_groups;
+    uint id;
+    uint width;
+    std::vector<int64_t> slots;     // group number in each slot of the hash table (-1 if empty)
+    std::vector<size_t> hashes;     // hash of each group's values
+    std::vector<Value> keys;        // each group's values, group_columns.size() per group
+    std::vector<int64_t> states;    // each group's aggregate state, width per group
+    size_t position;
+    bool spilling;
+    std::vector<Spill> spills;
+    uint spill_count;
+
+    /**
+     * Hash of a row's group values (mixed so that its high bits can pick partitions).
+     */
+    virtual size_t hash(const ValueDict* row) const;
+
+    /**
+     * Find a row's group.
+     * @param h    hash of the row's group values
+     * @param row  the row
+     * @returns    the group number, or -1 if it isn't in memory
+     */
+    virtual int64_t find(size_t h, const ValueDict* row) const;
+
+    /**
+     * Add a new group for a row's group values, growing the hash table if it gets over half full.
+     * @returns  the new group number
+     */
+    virtual int64_t add_group(size_t h, const ValueDict* row);
+
+    /**
+     * Fold a row into a group's aggregate state.
+     */
+    virtual void accumulate(int64_t group, const ValueDict* row);
+
+    /**
+     * Read all of an input into the groups in memory and the spill files.
+     * @param input  operator producing the rows (opened and closed here)
+     * @param level  how many times its rows have already been spilled
+     */
+    virtual void consume(PlanOperator* input, uint level);
+
+    /**
+     * Empty the hash table and the groups, sizing the table for the given number of groups.
+     */
+    virtual void reset(size_t groups);
+
+    /**
+     * Result row for a group.
+     * @returns  the row (freed by caller)
+     */
+    virtual ValueDict* result(size_t group) const;
+
+    /**
+     * Drop and free the spill files not yet aggregated.
+     */
+    virtual void drop_spills();
+};
@@ -0,0 +1,117 @@
+/**
+ * @file HashIndex.cpp
+ * @author Justin Thoreson
+ * @see Seattle University, CPSC5300
+ */
+
+#include <cstring>
+#include "HashIndex.h"
+
+using u32 = u_int32_t;
+
+static const uint HANDLE_SZ = sizeof(BlockID) + sizeof(RecordID);
+
+// pack a handle into the fixed-size data portion of an index entry
+static void marshal_handle(Handle handle, char* bytes) {
+    *(BlockID*)bytes = handle.first;
+    *(RecordID*)(bytes + sizeof(BlockID)) = handle.second;
+}
+
+static Handle unmarshal_handle(const Dbt& data) {
+    char* bytes = (char*)data.get_data();
+    return Handle(*(BlockID*)bytes, *(RecordID*)(bytes + sizeof(BlockID)));
+}
+
+HashIndex::HashIndex(DbRelation& relation, Identifier name, ColumnNames key_columns, bool unique)
+    : DbIndex(relation, name, key_columns, unique), dbfilename(""), closed(true), db(_DB_ENV, 0),
+      encoder(relation, key_columns), mutex() {
+    this->dbfilename = relation.get_table_name() + "-" + name + ".db";
+}
+
+void HashIndex::create() {
+    this->db_open(DB_CREATE | DB_EXCL);
+    Handles* handles = this->relation.select();
+    for (Handle& handle: *handles)
+        this->insert(handle);
+    delete handles;
+}
+
+void HashIndex::drop() {
+    this->close();
+    Transaction::remove(this->dbfilename);
+}
+
+void HashIndex::open() {
+    this->db_open();
+}
+
+void HashIndex::close() {
+    std::lock_guard<std::mutex> lock(this->mutex);
+    this->db.close(0);
+    this->closed = true;
+}
+
+// The handle is free-threaded, so what the cursor returns is read into memory
+// of our own: the key found is the one looked up, so it fits where that is.
+Handles* HashIndex::lookup(ValueDict* key_values) const {
+    KeyBytes key_bytes = this->encoder.encode(key_values);
+    char handle_bytes[HANDLE_SZ];
+    Dbt key((void*)key_bytes.data(), (u32)key_bytes.size()), data(handle_bytes, HANDLE_SZ);
+    key.set_ulen((u32)key_bytes.size());
+    key.set_flags(DB_DBT_USERMEM);
+    data.set_ulen(HANDLE_SZ);
+    data.set_flags(DB_DBT_USERMEM);
+    Handles* handles = new Handles();
+    Dbc* cursor;
+    this->db.cursor(Transaction::current(), &cursor, 0);
+    int status = cursor->get(&key, &data, DB_SET);
+    while (status == 0) {
+        handles->push_back(unmarshal_handle(data));
+        status = cursor->get(&key, &data, DB_NEXT_DUP);
+    }
+    cursor->close();
+    return handles;
+}
+
+void HashIndex::insert(Handle record) {
+    this->open();
+    ValueDict* row = this->relation.project(record, &this->key_columns);
+    KeyBytes key_bytes = this->encoder.encode(row);
+    delete row;
+    char handle_bytes[HANDLE_SZ];
+    marshal_handle(record, handle_bytes);
+    Dbt key((void*)key_bytes.data(), (u32)key_bytes.size()), data(handle_bytes, HANDLE_SZ);
+    if (this->db.put(Transaction::current(), &key, &data, this->unique ? DB_NOOVERWRITE : 0) == DB_KEYEXIST)
+        throw DbRelationError("duplicate key for unique index " + this->name);
+}
+
+void HashIndex::del(Handle record) {
+    this->open();
+    ValueDict* row = this->relation.project(record, &this->key_columns);
+    KeyBytes key_bytes = this->encoder.encode(row);
+    delete row;
+    char handle_bytes[HANDLE_SZ];
+    marshal_handle(record, handle_bytes);
+    Dbt key((void*)key_bytes.data(), (u32)key_bytes.size()), data(handle_bytes, HANDLE_SZ);
+    key.set_ulen((u32)key_bytes.size());
+    key.set_flags(DB_DBT_USERMEM);
+    data.set_ulen(HANDLE_SZ);
+    data.set_flags(DB_DBT_USERMEM);
+    Dbc* cursor;
+    this->db.cursor(Transaction::current(), &cursor, 0);
+    if (cursor->get(&key, &data, DB_GET_BOTH) == 0)
+        cursor->del(0);
+    cursor->close();
+}
+
+void HashIndex::db_open(uint flags) {
+    std::lock_guard<std::mutex> lock(this->mutex);
+    if (!this->closed) return;
+    this->db.set_message_stream(_DB_ENV->get_message_stream());
+    this->db.set_error_stream(_DB_ENV->get_error_stream());
+    if (!this->unique)
+        this->db.set_flags(DB_DUP);  // will be ignored if file already exists
+    flags |= DB_AUTO_COMMIT | DB_MULTIVERSION | DB_THREAD;
+    this->db.open(nullptr, this->dbfilename.c_str(), nullptr, DB_HASH, flags, 0644);
+    this->closed = false;
+}
@@ -0,0 +1,101 @@
+/**
+ * @file HashIndex.h - Implementation of storage_engine index with a hash file structure.
+ * HashIndex: DbIndex
+ *
+ * @author Justin Thoreson
+ * @see "Seattle University, CPSC5300, Winter 2023"
+ */
+
+#pragma once
+
+#include <mutex>
+#include <string>
+#include "db_cxx.h"
+#include "storage_engine.h"
+#include "KeyEncoder.h"
+#include "Transaction.h"
+
+/**
+ * @class HashIndex - hash file implementation of DbIndex
+ *
+ * Built on top of a Berkeley DB Hash file. Each entry maps the encoded search
+ * key (see KeyEncoder) to the 6-byte handle (BlockID, RecordID) of the indexed record.
+ * Non-unique indices store duplicate keys (DB_DUP); unique indices reject them.
+ * Only supports exact-match lookups (no range queries). Reads and writes are
+ * done in the current thread's transaction (see Transaction). The Berkeley DB
+ * handle is opened free-threaded, so one index serves every session at once.
+ */
+class HashIndex : public DbIndex {
+public:
+    /**
+     * Constructor
+     * @param relation     the relation being indexed
+     * @param name         name of this index (unique by relation)
+     * @param key_columns  search key columns, in order
+     * @param unique       true if the search key is a key for the relation
+     */
+    HashIndex(DbRelation& relation, Identifier name, ColumnNames key_columns, bool unique);
+
+    virtual ~HashIndex() {}
+
+    HashIndex(const HashIndex& other) = delete;
+
+    HashIndex(HashIndex&& temp) = delete;
+
+    HashIndex& operator=(const HashIndex& other) = delete;
+
+    HashIndex& operator=(HashIndex&& temp) = delete;
+
+    /**
+     * Create the physical index file and populate it from the relation
+     */
+    virtual void create();
+
+    /**
+     * Remove the physical index file
+     */
+    virtual void drop();
+
+    /**
+     * Open the index file
+     */
+    virtual void open();
+
+    /**
+     * Close the index file
+     */
+    virtual void close();
+
+    /**
+     * Lookup a specific search key.
+     * @param key_values  dictionary of values for the search key
+     * @returns           list of handles for records with key_values (freed by caller)
+     */
+    virtual Handles* lookup(ValueDict* key_values) const;
+
+    /**
+     * Insert the index entry for the given record.
+     * @param record  handle of the record (must be in the relation)
+     * @throws        DbRelationError if a unique index already has the key
+     */
+    virtual void insert(Handle record);
+
+    /**
+     * Delete the index entry for the given record.
+     * @param record  handle of the record (must still be in the relation)
+     */
+    virtual void del(Handle record);
+
+protected:
+    std::string dbfilename;
+    bool closed;
+    mutable Db db;  // Berkeley DB reads are non-const even for lookups
+    KeyEncoder encoder;
+    std::mutex mutex;  // for opening and closing
+
+    /**
+     * Open the Berkeley DB hash file
+     * @param flags Flags to provide the Berkeley DB database file
+     */
+    virtual void db_open(uint flags = 0);
+};
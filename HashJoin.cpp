@@ -0,0 +1,208 @@
+/**
+ * @file HashJoin.cpp - implementation of the hash join operator
+ * @author Justin Thoreson
+ * @see "Seattle University, CPSC5300, Winter 2023"
+ */
+
+#include <atomic>
+#include <functional>
+#include "HashJoin.h"
+
+// joins made so far (by any session), to give each one's spill files their own names
+static std::atomic<uint> hash_joins(0);
+
+HashJoin::HashJoin(PlanOperator* build, PlanOperator* probe, ColumnNames build_keys, ColumnNames probe_keys,
+                   size_t memory_rows)
+    : PlanOperator(), build(build), probe(probe), build_keys(build_keys), probe_keys(probe_keys),
+      memory_rows(memory_rows), id(++hash_joins), table(), spilling(false), build_spills(PARTITIONS, nullptr),
+      probe_spills(PARTITIONS, nullptr), probe_done(false), partition(0), spilled_handles(nullptr), position(0) {
+}
+
+HashJoin::~HashJoin() {
+    this->clear_table();
+    this->drop_spills();
+    delete this->spilled_handles;
+    delete this->build;
+    delete this->probe;
+}
+
+void HashJoin::open() {
+    this->clear_table();
+    this->drop_spills();
+    delete this->spilled_handles;
+    this->spilled_handles = nullptr;
+    this->spilling = false;
+    this->probe_done = false;
+    this->partition = 0;
+
+    this->build->open();
+    this->probe->open();
+    RowBatch batch;
+    ValueDicts rows;
+    std::vector<ValueDicts> pending(PARTITIONS);
+    while (this->build->next(batch)) {
+        rows.clear();
+        batch.move_rows(rows);
+        for (ValueDict* row: rows) {
+            size_t h = this->hash(row, this->build_keys);
+            if (this->spilling && h % PARTITIONS != 0) {
+                pending[h % PARTITIONS].push_back(row);
+            } else {
+                this->table.insert(std::make_pair(h, row));
+                if (!this->spilling && this->table.size() > this->memory_rows)
+                    this->start_spilling(pending);
+            }
+        }
+        if (this->spilling)
+            this->spill(this->build_spills, pending, "build");
+    }
+}
+
+// First the probe rows are joined with the rows in memory (spilling those of
+// other partitions), then each spilled partition is loaded and joined in turn.
+bool HashJoin::next(RowBatch& batch) {
+    batch.clear();
+    while (!this->probe_done) {
+        RowBatch input;
+        if (!this->probe->next(input)) {
+            this->probe_done = true;
+            break;
+        }
+        std::vector<ValueDicts> pending(PARTITIONS);
+        for (size_t i = 0; i < input.size(); i++) {
+            const ValueDict* row = input.get_row(i);
+            size_t h = this->hash(row, this->probe_keys);
+            if (!this->spilling || h % PARTITIONS == 0)
+                this->join(input.get_handle(i), row, batch);
+            else if (this->build_spills[h % PARTITIONS] != nullptr)
+                pending[h % PARTITIONS].push_back(new ValueDict(*row));
+        }
+        if (this->spilling)
+            this->spill(this->probe_spills, pending, "probe");
+        if (!batch.empty())
+            return true;
+    }
+
+    while (this->spilling && this->partition < PARTITIONS) {
+        if (this->spilled_handles == nullptr) {
+            this->clear_table();
+            if (++this->partition == PARTITIONS)
+                break;
+            HeapTable* build_spill = this->build_spills[this->partition];
+            if (build_spill == nullptr || this->probe_spills[this->partition] == nullptr)
+                continue;
+            Handles* handles = build_spill->select();
+            for (Handle& handle: *handles) {
+                ValueDict* row = build_spill->project(handle);
+                this->table.insert(std::make_pair(this->hash(row, this->build_keys), row));
+            }
+            delete handles;
+            this->spilled_handles = this->probe_spills[this->partition]->select();
+            this->position = 0;
+        }
+        HeapTable* probe_spill = this->probe_spills[this->partition];
+        while (this->position < this->spilled_handles->size() && batch.size() < RowBatch::CAPACITY) {
+            Handle handle = (*this->spilled_handles)[this->position++];
+            ValueDict* row = probe_spill->project(handle);
+            this->join(handle, row, batch);
+            delete row;
+        }
+        if (this->position == this->spilled_handles->size()) {
+            delete this->spilled_handles;
+            this->spilled_handles = nullptr;
+        }
+        if (!batch.empty())
+            return true;
+    }
+    return false;
+}
+
+void HashJoin::close() {
+    this->build->close();
+    this->probe->close();
+    this->clear_table();
+    this->drop_spills();
+    delete this->spilled_handles;
+    this->spilled_handles = nullptr;
+}
+
+// The build input is listed first.
+std::string HashJoin::explain(uint depth) const {
+    std::string keys;
+    for (size_t i = 0; i < this->build_keys.size(); i++)
+        keys += (keys.empty() ? "" : " AND ") + this->build_keys[i] + " = " + this->probe_keys[i];
+    return std::string(2 * depth, ' ') + "HashJoin " + keys + "\n" + this->build->explain(depth + 1)
+           + this->probe->explain(depth + 1);
+}
+
+// Combines the key values' hashes the way boost::hash_combine does.
+size_t HashJoin::hash(const ValueDict* row, const ColumnNames& keys) const {
+    size_t h = 0;
+    for (const Identifier& key: keys) {
+        const Value& value = row->at(key);
+        size_t k = value.data_type == ColumnAttribute::TEXT ? std::hash<std::string>()(value.s)
+                                                            : std::hash<int32_t>()(value.n);
+        h ^= k + 0x9e3779b9 + (h << 6) + (h >> 2);
+    }
+    return h;
+}
+
+void HashJoin::start_spilling(std::vector<ValueDicts>& pending) {
+    this->spilling = true;
+    for (auto entry = this->table.begin(); entry != this->table.end();) {
+        if (entry->first % PARTITIONS != 0) {
+            pending[entry->first % PARTITIONS].push_back(entry->second);
+            entry = this->table.erase(entry);
+        } else {
+            entry++;
+        }
+    }
+}
+
+void HashJoin::spill(std::vector<HeapTable*>& spills, std::vector<ValueDicts>& pending, const std::string& name) {
+    for (uint p = 0; p < PARTITIONS; p++) {
+        if (pending[p].empty())
+            continue;
+        if (spills[p] == nullptr)
+            spills[p] = HeapTable::create_temporary(
+                    "_hash_join_" + std::to_string(this->id) + "_" + name + std::to_string(p), pending[p].front());
+        Handles* handles = spills[p]->insert(&pending[p]);
+        delete handles;
+        for (ValueDict* row: pending[p])
+            delete row;
+        pending[p].clear();
+    }
+}
+
+void HashJoin::join(Handle handle, const ValueDict* probe_row, RowBatch& batch) {
+    auto matches = this->table.equal_range(this->hash(probe_row, this->probe_keys));
+    for (auto match = matches.first; match != matches.second; match++) {
+        const ValueDict* build_row = match->second;
+        bool equal = true;
+        for (size_t i = 0; i < this->build_keys.size() && equal; i++)
+            equal = build_row->at(this->build_keys[i]) == probe_row->at(this->probe_keys[i]);
+        if (equal) {
+            ValueDict* row = new ValueDict(*build_row);
+            row->insert(probe_row->begin(), probe_row->end());
+            batch.add(handle, row);
+        }
+    }
+}
+
+void HashJoin::clear_table() {
+    for (auto& entry: this->table)
+        delete entry.second;
+    this->table.clear();
+}
+
+void HashJoin::drop_spills() {
+    for (std::vector<HeapTable*>* spills: {&this->build_spills, &this->probe_spills}) {
+        for (HeapTable*& spill: *spills) {
+            if (spill != nullptr) {
+                spill->drop();
+                delete spill;
+                spill = nullptr;
+            }
+        }
+    }
+}
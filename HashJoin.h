@@ -0,0 +1,126 @@
+/**
+ * @file HashJoin.h - Equi-join plan operator that spills to disk when short of memory.
+ * HashJoin: PlanOperator
+ *
+ * @author Justin Thoreson
+ * @see "Seattle University, CPSC5300, Winter 2023"
+ */
+
+#pragma once
+
+#include <unordered_map>
+#include <vector>
+#include "QueryPlan.h"
+#include "HeapTable.h"
+
+/**
+ * @class HashJoin - join the rows of two inputs with equal values in their key columns
+ *
+ * The whole build input is read into a hash table on its key columns and then
+ * the probe input is streamed past it, so the build input should be the
+ * smaller of the two. If the build input turns out to have more than
+ * memory_rows rows, the join goes hybrid (grace): the rows are split by hash
+ * into PARTITIONS partitions, the first of which stays in memory while the
+ * others are spilled, from both inputs, to temporary heap files that are then
+ * joined one partition at a time.
+ *
+ * Each result row has the columns of both input rows, so the inputs must not
+ * share any column names (e.g., qualify them with their table names).
+ */
+class HashJoin : public PlanOperator {
+public:
+    /**
+     * Number of partitions the inputs are split into when the build input doesn't fit
+     */
+    static const uint PARTITIONS = 8;
+
+    /**
+     * Default for the most build rows held in memory at once
+     */
+    static const size_t MEMORY_ROWS = 100000;
+
+    /**
+     * Constructor
+     * @param build        operator producing the rows to hash (now owned by the join)
+     * @param probe        operator producing the rows to look up (now owned by the join)
+     * @param build_keys   key columns of the build rows
+     * @param probe_keys   corresponding key columns of the probe rows
+     * @param memory_rows  most build rows to hold in memory before spilling
+     */
+    HashJoin(PlanOperator* build, PlanOperator* probe, ColumnNames build_keys, ColumnNames probe_keys,
+             size_t memory_rows = MEMORY_ROWS);
+
+    virtual ~HashJoin();
+
+    /**
+     * Open both inputs and read the whole build input (spilling if need be).
+     */
+    virtual void open();
+
+    virtual bool next(RowBatch& batch);
+
+    /**
+     * Close both inputs and drop any spill files.
+     */
+    virtual void close();
+
+    virtual std::string explain(uint depth = 0) const;
+
+    /**
+     * Did the last open() have to spill to disk?
+     */
+    virtual bool spilled() const { return spilling; }
+
+protected:
+    PlanOperator* build;
+    PlanOperator* probe;
+    ColumnNames build_keys;
+    ColumnNames probe_keys;
+    size_t memory_rows;
+    uint id;
+    std::unordered_multimap<size_t, ValueDict*> table;
+    bool spilling;
+    std::vector<HeapTable*> build_spills;
+    std::vector<HeapTable*> probe_spills;
+    bool probe_done;
+    uint partition;
+    Handles* spilled_handles;
+    size_t position;
+
+    /**
+     * Hash of a row's key values (equal keys hash the same from either input).
+     */
+    virtual size_t hash(const ValueDict* row, const ColumnNames& keys) const;
+
+    /**
+     * Start spilling: move the rows of all but the first partition out of the hash table.
+     * @param pending  where to put the moved rows, by partition
+     */
+    virtual void start_spilling(std::vector<ValueDicts>& pending);
+
+    /**
+     * Write rows to their partitions' spill files (creating the files as needed).
+     * @param spills   the input's spill files, by partition
+     * @param pending  the rows for each partition (freed and emptied)
+     * @param name     what to call the input in the spill file names
+     */
+    virtual void spill(std::vector<HeapTable*>& spills, std::vector<ValueDicts>& pending, const std::string& name);
+
+    /**
+     * Add the rows matching a probe row to the batch.
+     * @param handle     where the probe row came from
+     * @param probe_row  the probe row
+     * @param batch      where to put the joined rows
+     */
+    virtual void join(Handle handle, const ValueDict* probe_row, RowBatch& batch);
+
+    /**
+     * Free the rows in the hash table and empty it.
+     */
+    virtual void clear_table();
+
+    /**
+     * Drop and free the spill files.
+     */
+    virtual void drop_spills();
+};
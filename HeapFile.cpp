@@ -12,7 +12,8 @@
 using u16 = u_int16_t;
 using u32 = u_int32_t;
 
-HeapFile::HeapFile(std::string name) : DbFile(name), dbfilename(""), last(0), closed(true), db(_DB_ENV, 0) {
+HeapFile::HeapFile(std::string name)
+    : DbFile(name), dbfilename(""), last(0), generation(0), closed(true), transactional(true), db(_DB_ENV, 0) {
     this->dbfilename = this->name + ".db";
 }
 
@@ -25,8 +26,7 @@ void HeapFile::create(void) {
 
 void HeapFile::drop(void) {
     this->close();
-    Db db(_DB_ENV, 0);
-    db.remove(this->dbfilename.c_str(), nullptr, 0);
+    Transaction::remove(this->dbfilename, this->transactional);
 }
 
 void HeapFile::open(void) {
@@ -34,6 +34,7 @@ void HeapFile::open(void) {
 }
 
 void HeapFile::close(void) {
+    std::lock_guard<std::mutex> lock(this->mutex);
     this->db.close(0);
     this->closed = true;
 }
@@ -43,50 +44,75 @@ SlottedPage* HeapFile::get_new(void) {
     std::memset(block, 0, sizeof(block));
     Dbt data(block, sizeof(block));
 
-    int block_id = ++this->last;
+    BlockID block_id;
+    {
+        std::lock_guard<std::mutex> lock(this->mutex);
+        this->refresh();
+        block_id = ++this->last;
+    }
     Dbt key(&block_id, sizeof(block_id));
 
-    // write out an empty block and read it back in so Berkeley DB is managing the memory
-    SlottedPage* page = new SlottedPage(data, this->last, true);
-    this->db.put(nullptr, &key, &data, 0); // write it out with initialization done to it
+    // write out an empty block and read it back in, into memory Berkeley DB allocates for the page
+    SlottedPage* page = new SlottedPage(data, block_id, true);
+    this->db.put(this->txn(), &key, &data, 0); // write it out with initialization done to it
     delete page;
-    this->db.get(nullptr, &key, &data, 0);
-    return new SlottedPage(data, this->last);
+    data.set_flags(DB_DBT_MALLOC);
+    this->db.get(this->txn(), &key, &data, 0);
+    return new SlottedPage(data, block_id);
 }
 
+// A block can be missing from a snapshot when another transaction, still
+// open, has added it since.
 SlottedPage* HeapFile::get(BlockID block_id) {
     Dbt key(&block_id, sizeof(block_id)), data;
-    this->db.get(nullptr, &key, &data, 0);
+    data.set_flags(DB_DBT_MALLOC);  // the handle is free-threaded, so each read gets memory of its own
+    if (this->db.get(this->txn(), &key, &data, 0) != 0)
+        throw DbRelationError("block " + std::to_string(block_id) + " of " + this->name
+                              + " isn't committed yet");
     return new SlottedPage(data, block_id, false);
 }
 
 void HeapFile::put(DbBlock* block) {
     BlockID block_id = block->get_block_id();
     Dbt key(&block_id, sizeof(block_id));
-    this->db.put(nullptr, &key, block->get_block(), 0);
+    this->db.put(this->txn(), &key, block->get_block(), 0);
 }
 
 BlockIDs* HeapFile::block_ids() const {
     BlockIDs* block_ids = new BlockIDs();
-    for (BlockID block_id = 1; block_id <= this->last; block_id++)
+    BlockID last = this->get_last_visible_block_id();
+    for (BlockID block_id = 1; block_id <= last; block_id++)
         block_ids->push_back(block_id);
     return block_ids;
 }
 
-u32 HeapFile::get_block_count() {
+void HeapFile::refresh() {
+    if (this->closed || this->generation == Transaction::generation())
+        return;
+    this->generation = Transaction::generation();
+    this->last = this->get_block_count();
+}
+
+u32 HeapFile::get_block_count() const {
     DB_BTREE_STAT* stat;
-    this->db.stat(nullptr, &stat, DB_FAST_STAT);
+    this->db.stat(this->txn(), &stat, DB_FAST_STAT);
     uint32_t bt_ndata = stat->bt_ndata;
     std::free(stat);
     return bt_ndata;
 }
 
 void HeapFile::db_open(uint flags) {
+    std::lock_guard<std::mutex> lock(this->mutex);
     if (!this->closed) return;
     this->db.set_message_stream(_DB_ENV->get_message_stream());
     this->db.set_error_stream(_DB_ENV->get_error_stream());
     this->db.set_re_len(DbBlock::BLOCK_SZ); // record length - will be ignored if file already exists
-    this->db.open(nullptr, this->dbfilename.c_str(), nullptr, DB_RECNO, flags, 0644);
-    this->last = flags ? 0 : this->get_block_count();
+    if (this->transactional)
+        flags |= DB_AUTO_COMMIT | DB_MULTIVERSION;  // so that the handle can be used in (snapshot) transactions
+    else
+        this->db.set_flags(DB_TXN_NOT_DURABLE);  // not logged, so its writes never wait for the log
+    this->db.open(nullptr, this->dbfilename.c_str(), nullptr, DB_RECNO, flags | DB_THREAD, 0644);
+    this->generation = Transaction::generation();
+    this->last = flags & DB_CREATE ? 0 : this->get_block_count();
     this->closed = false;
 }
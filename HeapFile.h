@@ -8,8 +8,11 @@
 
 #pragma once
 
+#include <algorithm>
+#include <mutex>
 #include "db_cxx.h"
 #include "SlottedPage.h"
+#include "Transaction.h"
 
 
 /**
@@ -19,6 +22,17 @@
  * of our database blocks for each Berkeley DB record in the RecNo file.
  * In this way we are using Berkeley DB for buffer management and file
  * management. Uses SlottedPage for storing records within blocks.
+ *
+ * Reads and writes are done in the current thread's transaction, unless the
+ * file isn't transactional (e.g., a temporary file used only while a
+ * statement runs), in which case they aren't logged either. Transactional
+ * files are multiversion, so that they can be read in snapshot transactions.
+ *
+ * One HeapFile (and its Berkeley DB handle) is used by every session at once:
+ * the handle is opened free-threaded, so each block read comes back in memory
+ * of its own (freed with its SlottedPage), and the count of blocks is kept
+ * under a mutex. Only the table's writer (see SQLExec::lock_for_write) adds
+ * blocks.
  */
 class HeapFile : public DbFile {
 public:
@@ -85,13 +99,45 @@ public:
     /**
      * Retrieves the last block ID within the file
      */
-    virtual u_int32_t get_last_block_id() { return last; }
+    virtual u_int32_t get_last_block_id() {
+        std::lock_guard<std::mutex> lock(this->mutex);
+        this->refresh();
+        return last;
+    }
+
+    /**
+     * Retrieves the last block ID the current thread's transaction can read
+     * (blocks added by other transactions still open aren't in its snapshot)
+     */
+    virtual u_int32_t get_last_visible_block_id() const {
+        u_int32_t count = this->get_block_count();
+        std::lock_guard<std::mutex> lock(this->mutex);
+        return this->generation == Transaction::generation() ? std::min(count, this->last) : count;
+    }
+
+    /**
+     * Sets whether the file's reads and writes are done in transactions (they are unless told otherwise).
+     * Must be set before the file is created or opened.
+     */
+    virtual void set_transactional(bool transactional) { this->transactional = transactional; }
 
 protected:
     std::string dbfilename;
     u_int32_t last;
+    uint64_t generation;  // Transaction::generation() when last was counted
     bool closed;
-    Db db;
+    bool transactional;
+    mutable Db db;
+    mutable std::mutex mutex;  // for last, generation, and closed
+
+    // the transaction to pass to Berkeley DB
+    DbTxn* txn() const { return transactional ? Transaction::current() : nullptr; }
+
+    /**
+     * Count the blocks again if a transaction has been aborted since they were counted
+     * (it may have taken back blocks added to the end). The mutex must be held.
+     */
+    virtual void refresh();
 
     /**
      * Open the Berkeley DB database file
@@ -99,5 +145,5 @@ protected:
      */ 
     virtual void db_open(uint flags = 0);
 
-    virtual uint32_t get_block_count();
+    virtual uint32_t get_block_count() const;
 };
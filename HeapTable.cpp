@@ -3,17 +3,46 @@
  * @authors Kevin Lundeen, Justin Thoreson
  * @see Seattle University, CPSC5300
  */
+#include <algorithm>
 #include <cstring>
+#include <random>
 #include "HeapTable.h"
 
 using u16 = u_int16_t;
 
 HeapTable::HeapTable(Identifier table_name, ColumnNames column_names, ColumnAttributes column_attributes)
-    : DbRelation(table_name, column_names, column_attributes), file(table_name) {
+    : DbRelation(table_name, column_names, column_attributes), file(table_name), bloom_filters(table_name),
+      zone_maps(table_name) {
+}
+
+HeapTable* HeapTable::create_temporary(Identifier table_name, const ValueDict* row) {
+    ColumnNames column_names;
+    ColumnAttributes column_attributes;
+    for (auto const& column: *row) {
+        column_names.push_back(column.first);
+        column_attributes.push_back(ColumnAttribute(column.second.data_type));
+    }
+    HeapTable* table = new HeapTable(table_name, column_names, column_attributes);
+    table->file.set_transactional(false);  // only the statement that made it ever sees it
+    try {
+        table->create();
+    } catch (DbException& e) {
+        table->drop();  // left over from a run that never finished
+        table->create();
+    }
+    return table;
 }
 
 void HeapTable::create() {
     this->file.create();
+    ColumnNames int_columns;
+    for (uint i = 0; i < this->column_names.size(); i++) {
+        ColumnAttribute ca = this->column_attributes[i];
+        if (ca.get_data_type() == ColumnAttribute::INT)
+            int_columns.push_back(this->column_names[i]);
+    }
+    if (!int_columns.empty())
+        this->create_zone_maps(int_columns);
 }
 
 void HeapTable::create_if_not_exists() {
@@ -26,36 +55,84 @@ void HeapTable::create_if_not_exists() {
 
 void HeapTable::drop() {
     this->file.drop();
+    this->bloom_filters.drop();
+    this->zone_maps.drop();
 }
 
 void HeapTable::open() {
     this->file.open();
+    this->bloom_filters.open();
+    this->zone_maps.open();
 }
 
 void HeapTable::close() {
     this->file.close();
+    this->bloom_filters.close();
+    this->zone_maps.close();
 }
 
 Handle HeapTable::insert(const ValueDict* row) {
     this->open();
     ValueDict* full_row = this->validate(row);
     Handle handle = this->append(full_row);
+    if (this->bloom_filters.is_open())
+        this->bloom_filters.add(handle.first, full_row);
+    if (this->zone_maps.is_open())
+        this->zone_maps.add(handle.first, full_row);
     delete full_row;
     return handle;
 }
 
+Handles* HeapTable::insert(const ValueDicts* rows) {
+    this->open();
+    ValueDicts full_rows;
+    Handles* handles = nullptr;
+    try {
+        for (ValueDict* row: *rows)
+            full_rows.push_back(this->validate(row));
+        handles = this->append(&full_rows);
+        this->summarize(handles, &full_rows);
+    } catch (...) {
+        for (ValueDict* full_row: full_rows)
+            delete full_row;
+        delete handles;
+        throw;
+    }
+    for (ValueDict* full_row: full_rows)
+        delete full_row;
+    return handles;
+}
+
 void HeapTable::update(const Handle handle, const ValueDict* new_values) {
     throw DbRelationError("Not implemented");
 }
 
+// Block summaries are left as they are: Bloom filter bits and zones covering the
+// deleted row just become false positives.
 void HeapTable::del(const Handle handle) {
+    Handles handles(1, handle);
+    HeapTable::del(&handles);  // not virtual: subclasses' del(handles) may call back into del(handle)
+}
+
+void HeapTable::del(const Handles* handles) {
     this->open();
-    BlockID block_id = handle.first;
-    RecordID record_id = handle.second;
-    SlottedPage* block = this->file.get(block_id);
-    block->del(record_id);
-    this->file.put(block);
-    delete block;
+    Handles sorted(*handles);
+    std::sort(sorted.begin(), sorted.end());
+    SlottedPage* block = nullptr;
+    for (const Handle& handle: sorted) {
+        if (block == nullptr || block->get_block_id() != handle.first) {
+            if (block != nullptr) {
+                this->file.put(block);
+                delete block;
+            }
+            block = this->file.get(handle.first);
+        }
+        block->del(handle.second);
+    }
+    if (block != nullptr) {
+        this->file.put(block);
+        delete block;
+    }
 }
 
 Handles* HeapTable::select() {
@@ -63,20 +140,97 @@ Handles* HeapTable::select() {
 }
 
 Handles* HeapTable::select(const ValueDict* where) {
+    return this->select(where, nullptr);
+}
+
+Handles* HeapTable::select(const ValueDict* where, const IntRanges* ranges) {
+    BlockID next_block = 1;
+    return this->select(where, ranges, SIZE_MAX, next_block);
+}
+
+Handles* HeapTable::select(const ValueDict* where, const IntRanges* ranges, size_t limit, BlockID& next_block) {
     this->open();
     Handles* handles = new Handles();
-    BlockIDs* block_ids = this->file.block_ids();
-    for (BlockID& block_id: *block_ids) {
+    if (next_block == 0)
+        return handles;
+    BlockID last = this->file.get_last_visible_block_id();
+    BlockID block_id = next_block;
+    for (; block_id <= last && handles->size() < limit; block_id++) {
+        if (!this->bloom_filters.might_match(block_id, where)
+            || !this->zone_maps.might_match(block_id, where, ranges))
+            continue;  // no row in this block can match, so don't even read it
         SlottedPage* block = this->file.get(block_id);
         RecordIDs* record_ids = block->ids();
         for (RecordID& record_id: *record_ids) {
-            Handle handle(block_id, record_id);
-            if (this->selected(handle, where))
-                handles->push_back(handle);
+            Dbt* data = block->get(record_id);
+            ValueDict* row = this->unmarshal(data);
+            delete data;
+            if (this->matches(row, where, ranges))
+                handles->push_back(Handle(block_id, record_id));
+            delete row;
         }
         delete record_ids;
         delete block;
     }
+    next_block = block_id > last ? 0 : block_id;
+    return handles;
+}
+
+void HeapTable::scan_block(BlockID block_id, const ValueDict* where, const IntRanges* ranges,
+                           const ColumnNames* column_names, Handles& handles, ValueDicts& rows) {
+    for (auto const& column_name: *column_names)
+        if (std::find(this->column_names.begin(), this->column_names.end(), column_name) == this->column_names.end())
+            throw DbRelationError("table does not have column named '" + column_name + "'");
+    this->open();
+    if (!this->bloom_filters.might_match(block_id, where) || !this->zone_maps.might_match(block_id, where, ranges))
+        return;
+    SlottedPage* block = this->file.get(block_id);
+    RecordIDs* record_ids = block->ids();
+    for (RecordID& record_id: *record_ids) {
+        Dbt* data = block->get(record_id);
+        ValueDict* row = this->unmarshal(data);
+        delete data;
+        if (!this->matches(row, where, ranges)) {
+            delete row;
+            continue;
+        }
+        if (!column_names->empty()) {
+            ValueDict* projected = new ValueDict();
+            for (auto const& column_name: *column_names)
+                (*projected)[column_name] = (*row)[column_name];
+            delete row;
+            row = projected;
+        }
+        handles.push_back(Handle(block_id, record_id));
+        rows.push_back(row);
+    }
+    delete record_ids;
+    delete block;
+}
+
+// Picks the blocks with a partial shuffle (seeded, so that ANALYZE is repeatable)
+// and reads them in file order.
+Handles* HeapTable::sample(BlockID max_blocks) {
+    this->open();
+    BlockIDs* block_ids = this->file.block_ids();
+    if (block_ids->size() > max_blocks) {
+        std::minstd_rand random(block_ids->size());
+        for (BlockID i = 0; i < max_blocks; i++) {
+            std::uniform_int_distribution<size_t> pick(i, block_ids->size() - 1);
+            std::swap((*block_ids)[i], (*block_ids)[pick(random)]);
+        }
+        block_ids->resize(max_blocks);
+        std::sort(block_ids->begin(), block_ids->end());
+    }
+    Handles* handles = new Handles();
+    for (BlockID& block_id: *block_ids) {
+        SlottedPage* block = this->file.get(block_id);
+        RecordIDs* record_ids = block->ids();
+        for (RecordID& record_id: *record_ids)
+            handles->push_back(Handle(block_id, record_id));
+        delete record_ids;
+        delete block;
+    }
     delete block_ids;
     return handles;
 }
@@ -105,6 +259,57 @@ ValueDict* HeapTable::project(Handle handle, const ColumnNames* column_names) {
     return result;
 }
 
+BlockID HeapTable::get_block_count() {
+    this->open();
+    return this->file.get_last_visible_block_id();
+}
+
+void HeapTable::create_bloom_filters(const ColumnNames& column_names) {
+    this->bloom_filters.drop();
+    if (!column_names.empty())
+        this->build_summaries(this->bloom_filters, column_names);
+}
+
+ColumnNames HeapTable::get_bloom_filter_columns() {
+    this->open();
+    return this->bloom_filters.get_column_names();
+}
+
+void HeapTable::create_zone_maps(const ColumnNames& column_names) {
+    this->zone_maps.drop();
+    this->build_summaries(this->zone_maps, column_names);
+}
+
+void HeapTable::build_summaries(BlockSummaryFile& summaries, const ColumnNames& column_names) {
+    this->open();
+    ColumnAttributes column_attributes;
+    for (auto const& column_name: column_names) {
+        uint col_num = 0;
+        while (col_num < this->column_names.size() && this->column_names[col_num] != column_name)
+            col_num++;
+        if (col_num == this->column_names.size())
+            throw DbRelationError("table does not have column named '" + column_name + "'");
+        column_attributes.push_back(this->column_attributes[col_num]);
+    }
+    summaries.create(column_names, column_attributes);
+
+    BlockIDs* block_ids = this->file.block_ids();
+    for (BlockID& block_id: *block_ids) {
+        SlottedPage* block = this->file.get(block_id);
+        RecordIDs* record_ids = block->ids();
+        for (RecordID& record_id: *record_ids) {
+            Dbt* data = block->get(record_id);
+            ValueDict* row = this->unmarshal(data);
+            summaries.add(block_id, row);
+            delete row;
+            delete data;
+        }
+        delete record_ids;
+        delete block;
+    }
+    delete block_ids;
+}
+
 ValueDict* HeapTable::validate(const ValueDict* row) const {
     ValueDict* full_row = new ValueDict();
     for (auto const& column_name: this->column_names) {
@@ -120,22 +325,63 @@ ValueDict* HeapTable::validate(const ValueDict* row) const {
 }
 
 Handle HeapTable::append(const ValueDict* row) {
-    Dbt* data = marshal(row);
+    ValueDicts rows(1, (ValueDict*)row);
+    Handles* handles = this->append(&rows);
+    Handle handle = handles->front();
+    delete handles;
+    return handle;
+}
+
+Handles* HeapTable::append(const ValueDicts* rows) {
+    Handles* handles = new Handles();
     SlottedPage* block = this->file.get(this->file.get_last_block_id());
-    RecordID record_id;
+    bool dirty = false;
     try {
-        record_id = block->add(data);
-    } catch (DbBlockNoRoomError &e) {
-        // need a new block
+        for (ValueDict* row: *rows) {
+            Dbt* data = marshal(row);
+            RecordID record_id;
+            try {
+                record_id = block->add(data);
+            } catch (DbBlockNoRoomError &e) {
+                // need a new block, so this one is done
+                if (dirty)
+                    this->file.put(block);
+                delete block;
+                block = nullptr;
+                block = this->file.get_new();
+                record_id = block->add(data);
+            }
+            dirty = true;
+            handles->push_back(Handle(block->get_block_id(), record_id));
+            delete[] (char*)data->get_data();
+            delete data;
+        }
+        if (dirty)
+            this->file.put(block);
+    } catch (...) {
         delete block;
-        block = this->file.get_new();
-        record_id = block->add(data);
+        delete handles;
+        throw;
     }
-    this->file.put(block);
     delete block;
-    delete[] (char*)data->get_data();
-    delete data;
-    return Handle(this->file.get_last_block_id(), record_id);
+    return handles;
+}
+
+void HeapTable::summarize(const Handles* handles, const ValueDicts* rows) {
+    BlockSummaryFile* summaries[] = {&this->bloom_filters, &this->zone_maps};
+    size_t start = 0;
+    while (start < handles->size()) {
+        // rows are appended in order, so each block's rows are together
+        BlockID block_id = (*handles)[start].first;
+        size_t end = start;
+        while (end < handles->size() && (*handles)[end].first == block_id)
+            end++;
+        ValueDicts block_rows(rows->begin() + start, rows->begin() + end);
+        for (BlockSummaryFile* block_summaries: summaries)
+            if (block_summaries->is_open())
+                block_summaries->add(block_id, block_rows);
+        start = end;
+    }
 }
 
 Dbt* HeapTable::marshal(const ValueDict* row) const {
@@ -216,3 +462,17 @@ bool HeapTable::selected(Handle handle, const ValueDict* where) {
     delete row;
     return is_selected;
 }
+
+bool HeapTable::matches(const ValueDict* row, const ValueDict* where, const IntRanges* ranges) const {
+    if (where != nullptr)
+        for (auto const& column: *where)
+            if (row->at(column.first) != column.second)
+                return false;
+    if (ranges != nullptr)
+        for (auto const& range: *ranges) {
+            int32_t n = row->at(range.first).n;
+            if (n < range.second.first || n > range.second.second)
+                return false;
+        }
+    return true;
+}
@@ -12,6 +12,8 @@
 #include "storage_engine.h"
 #include "SlottedPage.h"
 #include "HeapFile.h"
+#include "BloomFilterFile.h"
+#include "ZoneMapFile.h"
 
 /**
  * @class HeapTable - Heap storage engine (implementation of DbRelation)
@@ -37,7 +39,17 @@ public:
     HeapTable& operator=(HeapTable&& temp) = delete;
 
     /**
-     * Creates the HeapTable relation
+     * Create a scratch table (not in the schema tables) for holding rows like the
+     * given one, replacing any table of that name left over from an earlier run.
+     * Its reads and writes are done outside of any transaction, and aren't logged.
+     * @param table_name  name of the table
+     * @param row         a row giving the table's columns and their data types
+     * @returns           the created table (freed by caller, who should drop it first)
+     */
+    static HeapTable* create_temporary(Identifier table_name, const ValueDict* row);
+
+    /**
+     * Creates the HeapTable relation, with zone maps on its INT columns
      */
     virtual void create();
 
@@ -68,6 +80,13 @@ public:
      */
     virtual Handle insert(const ValueDict* row);
 
+    /**
+     * Inserts data tuples into the table, writing each block they go to once
+     * @param rows The data tuples to insert
+     * @return Handles locating the block ID and record ID of each inserted tuple, in order
+     */
+    virtual Handles* insert(const ValueDicts* rows);
+
     /**
      * Updates a record to a database
      * @param handle The location (block ID, record ID) of the record
@@ -81,6 +100,12 @@ public:
      */
     virtual void del(const Handle handle);
 
+    /**
+     * Deletes rows from the table, fetching and writing each of their blocks once
+     * @param handles The handles for the rows being deleted
+     */
+    virtual void del(const Handles* handles);
+
     /**
      * Select all data tuples (rows) from the table
      */
@@ -93,6 +118,45 @@ public:
      */
     virtual Handles* select(const ValueDict* where);
 
+    /**
+     * Selects data tuples (rows) from the table matching given predicates and ranges
+     * @param where The where-clause equality predicates (may be nullptr)
+     * @param ranges The where-clause INT ranges (may be nullptr)
+     * @return Handles locating the block IDs and record IDs of the matching rows
+     */
+    virtual Handles* select(const ValueDict* where, const IntRanges* ranges);
+
+    /**
+     * Selects data tuples (rows) from the table matching given predicates and ranges,
+     * reading blocks only until at least limit of them are found
+     * @param where The where-clause equality predicates (may be nullptr)
+     * @param ranges The where-clause INT ranges (may be nullptr)
+     * @param limit The number of rows wanted
+     * @param next_block The block to start from; returned by reference: the block to carry on from (0 at the end)
+     * @return Handles locating the block IDs and record IDs of the matching rows
+     */
+    virtual Handles* select(const ValueDict* where, const IntRanges* ranges, size_t limit, BlockID& next_block);
+
+    /**
+     * Get every row in a random sample of the table's blocks.
+     * @param max_blocks  most blocks to sample (all of them if there are no more than this)
+     * @returns           a pointer to a list of handles for the sampled rows (freed by caller)
+     */
+    virtual Handles* sample(BlockID max_blocks);
+
+    /**
+     * Read the rows of one block that match the given predicates, reading and
+     * decoding the block just once (and not at all if its summaries rule it out).
+     * @param block_id      block to read
+     * @param where         equality predicates (may be nullptr)
+     * @param ranges        INT ranges (may be nullptr)
+     * @param column_names  columns to return (all if empty)
+     * @param handles       returned by reference: where each matching row is (appended)
+     * @param rows          returned by reference: the matching rows (appended, freed by caller)
+     */
+    virtual void scan_block(BlockID block_id, const ValueDict* where, const IntRanges* ranges,
+                            const ColumnNames* column_names, Handles& handles, ValueDicts& rows);
+
     /**
      * Return a sequence of all values for handle (SELECT *).
      * @param handle Location of row to get values from
@@ -110,8 +174,44 @@ public:
 
     using DbRelation::project;
 
+    /**
+     * Number of blocks in the table's heap file
+     */
+    virtual BlockID get_block_count();
+
+    /**
+     * Start keeping per-block Bloom filters on the given columns (replacing any
+     * existing ones) so that equality selects on them can skip whole blocks.
+     * The filters are built from the rows already in the table.
+     * @param column_names  columns to keep filters on (none to stop keeping filters)
+     */
+    virtual void create_bloom_filters(const ColumnNames& column_names);
+
+    /**
+     * The columns the table keeps Bloom filters on (none if it keeps no filters).
+     */
+    virtual ColumnNames get_bloom_filter_columns();
+
+    /**
+     * Start keeping per-block zone maps on the given INT columns (replacing any
+     * existing ones, which also tightens zones widened by deletes) so that range
+     * selects on them can skip whole blocks. The zones are built from the rows
+     * already in the table.
+     * @param column_names  columns to keep zone maps on
+     */
+    virtual void create_zone_maps(const ColumnNames& column_names);
+
 protected:
     HeapFile file;
+    BloomFilterFile bloom_filters;
+    ZoneMapFile zone_maps;
+
+    /**
+     * Create a block summary file on the given columns and fill it from the table's rows
+     * @param summaries The (dropped) summary file to build
+     * @param column_names The columns to summarize
+     */
+    virtual void build_summaries(BlockSummaryFile& summaries, const ColumnNames& column_names);
 
     /**
      * Checks if a row is valid to the table
@@ -127,6 +227,21 @@ protected:
      */
     virtual Handle append(const ValueDict* row);
 
+    /**
+     * Writes data tuples to the database file, filling the last block before
+     * starting new ones. Each block is put once, after all of its tuples are added.
+     * @param rows The data tuples to add
+     * @return Handles locating the block ID and record ID of each written tuple (freed by caller)
+     */
+    virtual Handles* append(const ValueDicts* rows);
+
+    /**
+     * Widen the block summaries to cover newly written tuples (one write per block per summary)
+     * @param handles Where the tuples were written
+     * @param rows The tuples
+     */
+    virtual void summarize(const Handles* handles, const ValueDicts* rows);
+
     /**
      * Return the bits to go into the file. Caller responsible for freeing the
      * returned Dbt and its enclosed ret->get_data().
@@ -145,4 +260,13 @@ protected:
      * @return        true if conditions met, false otherwise
      */
     virtual bool selected(Handle handle, const ValueDict* where);
+
+    /**
+     * See if an unmarshaled row satisfies the given where clause and ranges
+     * @param row     row to check (with at least the columns checked)
+     * @param where   equality conditions to check (may be nullptr)
+     * @param ranges  range conditions to check (may be nullptr)
+     * @return        true if conditions met, false otherwise
+     */
+    virtual bool matches(const ValueDict* row, const ValueDict* where, const IntRanges* ranges) const;
 };
@@ -0,0 +1,74 @@
+/**
+ * @file Kernels.cpp - building the predicate kernels
+ * @author Justin Thoreson
+ * @see "Seattle University, CPSC5300, Winter 2023"
+ */
+
+#include <algorithm>
+#include <map>
+#include "Kernels.h"
+
+// The kernel K<TYPE, OP> for the comparison's operator.
+template <template <ColumnAttribute::DataType, Comparison::Op> class K, ColumnAttribute::DataType TYPE>
+static Kernel* make_typed_kernel(const Comparison& comparison) {
+    switch (comparison.op) {
+        case Comparison::EQ:
+            return new K<TYPE, Comparison::EQ>(comparison);
+        case Comparison::NE:
+            return new K<TYPE, Comparison::NE>(comparison);
+        case Comparison::LT:
+            return new K<TYPE, Comparison::LT>(comparison);
+        case Comparison::LE:
+            return new K<TYPE, Comparison::LE>(comparison);
+        case Comparison::GT:
+            return new K<TYPE, Comparison::GT>(comparison);
+        default:
+            return new K<TYPE, Comparison::GE>(comparison);
+    }
+}
+
+// The kernel K<TYPE, OP> for the comparison's data type and operator.
+template <template <ColumnAttribute::DataType, Comparison::Op> class K>
+static Kernel* make_kernel(const Comparison& comparison) {
+    switch (comparison.value.data_type) {
+        case ColumnAttribute::INT:
+            return make_typed_kernel<K, ColumnAttribute::INT>(comparison);
+        case ColumnAttribute::BOOLEAN:
+            return make_typed_kernel<K, ColumnAttribute::BOOLEAN>(comparison);
+        default:
+            return make_typed_kernel<K, ColumnAttribute::TEXT>(comparison);
+    }
+}
+
+std::vector<Kernel*> Kernel::compile(const Predicate& predicate) {
+    std::vector<Kernel*> kernels;
+    std::map<Identifier, std::pair<int64_t, int64_t>> ranges;
+    ColumnNames range_columns;  // in the order they come up
+    for (const Comparison& comparison: predicate) {
+        if (!comparison.is_literal()) {
+            kernels.push_back(make_kernel<ColumnKernel>(comparison));
+        } else if (comparison.value.data_type != ColumnAttribute::INT || comparison.op == Comparison::NE) {
+            kernels.push_back(make_kernel<LiteralKernel>(comparison));
+        } else {
+            if (ranges.find(comparison.column_name) == ranges.end()) {
+                ranges[comparison.column_name] = std::make_pair((int64_t) INT32_MIN, (int64_t) INT32_MAX);
+                range_columns.push_back(comparison.column_name);
+            }
+            std::pair<int64_t, int64_t>& range = ranges[comparison.column_name];
+            int64_t n = comparison.value.n;
+            if (comparison.op == Comparison::EQ || comparison.op == Comparison::GE || comparison.op == Comparison::GT)
+                range.first = std::max(range.first, comparison.op == Comparison::GT ? n + 1 : n);
+            if (comparison.op == Comparison::EQ || comparison.op == Comparison::LE || comparison.op == Comparison::LT)
+                range.second = std::min(range.second, comparison.op == Comparison::LT ? n - 1 : n);
+        }
+    }
+    for (const Identifier& column_name: range_columns) {
+        const std::pair<int64_t, int64_t>& range = ranges[column_name];
+        if (range.first == range.second)
+            kernels.push_back(new EqKernel<ColumnAttribute::INT>(Comparison(column_name, Comparison::EQ,
+                                                                            Value((int32_t) range.first))));
+        else
+            kernels.push_back(new RangeKernel<ColumnAttribute::INT>(column_name, range.first, range.second));
+    }
+    return kernels;
+}
@@ -0,0 +1,230 @@
+/**
+ * @file Kernels.h - Predicate kernels specialized at compile time on column type and comparison.
+ * Kernel
+ * LiteralKernel<TYPE, OP>: Kernel
+ * ColumnKernel<TYPE, OP>: Kernel
+ * RangeKernel<TYPE>: Kernel
+ *
+ * @author Justin Thoreson
+ * @see "Seattle University, CPSC5300, Winter 2023"
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "QueryPlan.h"
+
+/**
+ * @class Kernel - evaluates one part of a predicate over a whole batch of rows at once
+ *
+ * A kernel first pulls the values of its column(s) out of the batch's rows
+ * into a contiguous array, and then tests them all in a loop that the
+ * compiler can inline, since the type and comparison are template parameters
+ * rather than values checked row by row.
+ */
+class Kernel {
+public:
+    Kernel() {}
+
+    virtual ~Kernel() {}
+
+    Kernel(const Kernel& other) = delete;
+
+    Kernel& operator=(const Kernel& other) = delete;
+
+    /**
+     * Clear the selection flag of each row of the batch that fails this kernel's test.
+     * @param batch     the rows
+     * @param selected  a flag (1 or 0) for each row (returned by reference)
+     */
+    virtual void apply(const RowBatch& batch, std::vector<uint8_t>& selected) = 0;
+
+    /**
+     * Build the kernels for a predicate. The comparisons of an INT column
+     * with literals (other than <>) are combined into a single RangeKernel.
+     * @param predicate  comparisons, each between columns of the same type or
+     *                   a column and a literal of the column's type
+     * @returns          the kernels (freed by caller)
+     */
+    static std::vector<Kernel*> compile(const Predicate& predicate);
+};
+
+
+/**
+ * @class KernelValue - how a kernel holds values of a column type
+ *
+ * INT and BOOLEAN values are held as their numbers, TEXT values by pointer
+ * (into the rows) so that the strings aren't copied.
+ */
+template <ColumnAttribute::DataType TYPE>
+class KernelValue {
+public:
+    using Held = int32_t;
+    using Literal = int32_t;
+
+    static Held get(const Value& value) { return value.n; }
+
+    static Literal literal(const Value& value) { return value.n; }
+
+    static const Literal& deref(const Held& held) { return held; }
+};
+
+template <>
+class KernelValue<ColumnAttribute::TEXT> {
+public:
+    using Held = const std::string*;
+    using Literal = std::string;
+
+    static Held get(const Value& value) { return &value.s; }
+
+    static Literal literal(const Value& value) { return value.s; }
+
+    static const Literal& deref(const Held& held) { return *held; }
+};
+
+
+/**
+ * @class KernelCompare - a comparison operator as a compile-time function
+ */
+template <Comparison::Op OP>
+class KernelCompare;
+
+template <>
+class KernelCompare<Comparison::EQ> {
+public:
+    template <typename T>
+    static bool test(const T& left, const T& right) { return left == right; }
+};
+
+template <>
+class KernelCompare<Comparison::NE> {
+public:
+    template <typename T>
+    static bool test(const T& left, const T& right) { return left != right; }
+};
+
+template <>
+class KernelCompare<Comparison::LT> {
+public:
+    template <typename T>
+    static bool test(const T& left, const T& right) { return left < right; }
+};
+
+template <>
+class KernelCompare<Comparison::LE> {
+public:
+    template <typename T>
+    static bool test(const T& left, const T& right) { return left <= right; }
+};
+
+template <>
+class KernelCompare<Comparison::GT> {
+public:
+    template <typename T>
+    static bool test(const T& left, const T& right) { return left > right; }
+};
+
+template <>
+class KernelCompare<Comparison::GE> {
+public:
+    template <typename T>
+    static bool test(const T& left, const T& right) { return left >= right; }
+};
+
+
+/**
+ * Pull a column's values out of a batch's rows.
+ * @param batch        the rows
+ * @param column_name  the column
+ * @param column       the values, one per row (returned by reference)
+ */
+template <ColumnAttribute::DataType TYPE>
+void kernel_gather(const RowBatch& batch, const Identifier& column_name,
+                   std::vector<typename KernelValue<TYPE>::Held>& column) {
+    column.resize(batch.size());
+    for (size_t i = 0; i < column.size(); i++)
+        column[i] = KernelValue<TYPE>::get(batch.get_row(i)->at(column_name));
+}
+
+
+/**
+ * @class LiteralKernel - compare a column with a literal, e.g. a = 5
+ */
+template <ColumnAttribute::DataType TYPE, Comparison::Op OP>
+class LiteralKernel : public Kernel {
+public:
+    LiteralKernel(const Comparison& comparison)
+        : Kernel(), column_name(comparison.column_name), literal(KernelValue<TYPE>::literal(comparison.value)),
+          column() {}
+
+    virtual void apply(const RowBatch& batch, std::vector<uint8_t>& selected) {
+        kernel_gather<TYPE>(batch, this->column_name, this->column);
+        const size_t n = this->column.size();
+        for (size_t i = 0; i < n; i++)
+            selected[i] &= KernelCompare<OP>::test(KernelValue<TYPE>::deref(this->column[i]), this->literal);
+    }
+
+protected:
+    Identifier column_name;
+    typename KernelValue<TYPE>::Literal literal;
+    std::vector<typename KernelValue<TYPE>::Held> column;
+};
+
+template <ColumnAttribute::DataType TYPE>
+using EqKernel = LiteralKernel<TYPE, Comparison::EQ>;
+
+
+/**
+ * @class ColumnKernel - compare two columns of the same row, e.g. a < b
+ */
+template <ColumnAttribute::DataType TYPE, Comparison::Op OP>
+class ColumnKernel : public Kernel {
+public:
+    ColumnKernel(const Comparison& comparison)
+        : Kernel(), column_name(comparison.column_name), other_column_name(comparison.other_column_name), column(),
+          other_column() {}
+
+    virtual void apply(const RowBatch& batch, std::vector<uint8_t>& selected) {
+        kernel_gather<TYPE>(batch, this->column_name, this->column);
+        kernel_gather<TYPE>(batch, this->other_column_name, this->other_column);
+        const size_t n = this->column.size();
+        for (size_t i = 0; i < n; i++)
+            selected[i] &= KernelCompare<OP>::test(KernelValue<TYPE>::deref(this->column[i]),
+                                                   KernelValue<TYPE>::deref(this->other_column[i]));
+    }
+
+protected:
+    Identifier column_name;
+    Identifier other_column_name;
+    std::vector<typename KernelValue<TYPE>::Held> column;
+    std::vector<typename KernelValue<TYPE>::Held> other_column;
+};
+
+
+/**
+ * @class RangeKernel - check that a column is within inclusive bounds, e.g. 5 <= a AND a < 10
+ *
+ * The bounds are 64-bit so that a bound just past either end of the 32-bit
+ * values (as from a < -2147483648) leaves the range empty rather than wrapping.
+ */
+template <ColumnAttribute::DataType TYPE>
+class RangeKernel : public Kernel {
+public:
+    RangeKernel(Identifier column_name, int64_t min, int64_t max)
+        : Kernel(), column_name(column_name), min(min), max(max), column() {}
+
+    virtual void apply(const RowBatch& batch, std::vector<uint8_t>& selected) {
+        kernel_gather<TYPE>(batch, this->column_name, this->column);
+        const size_t n = this->column.size();
+        for (size_t i = 0; i < n; i++)
+            selected[i] &= (this->column[i] >= this->min) & (this->column[i] <= this->max);
+    }
+
+protected:
+    Identifier column_name;
+    int64_t min;
+    int64_t max;
+    std::vector<typename KernelValue<TYPE>::Held> column;
+};
@@ -0,0 +1,114 @@
+/**
+ * @file KeyEncoder.cpp
+ * @author Justin Thoreson
+ * @see Seattle University, CPSC5300
+ */
+
+#include "KeyEncoder.h"
+
+using u32 = u_int32_t;
+
+static const char ESCAPE = '\x00';
+static const char ESCAPED_NUL = '\xFF';
+static const char TERMINATOR = '\x01';
+
+KeyEncoder::KeyEncoder(const DbRelation& relation, const ColumnNames& key_columns) : key_columns(key_columns) {
+    const ColumnNames& column_names = relation.get_column_names();
+    const ColumnAttributes column_attributes = relation.get_column_attributes();
+    for (auto const& key_column: key_columns) {
+        uint col_num = 0;
+        while (col_num < column_names.size() && column_names[col_num] != key_column)
+            col_num++;
+        if (col_num == column_names.size())
+            throw DbRelationError("table does not have key column named '" + key_column + "'");
+        ColumnAttribute ca = column_attributes[col_num];
+        this->key_types.push_back(ca.get_data_type());
+    }
+}
+
+KeyBytes KeyEncoder::encode(const ValueDict* key_values) const {
+    KeyBytes key;
+    for (uint i = 0; i < this->key_columns.size(); i++) {
+        ValueDict::const_iterator column = key_values->find(this->key_columns[i]);
+        if (column == key_values->end())
+            throw DbRelationError("missing search key column '" + this->key_columns[i] + "'");
+        encode_value(column->second, this->key_types[i], key);
+    }
+    return key;
+}
+
+KeyBytes KeyEncoder::encode_prefix(const ValueDict* key_values) const {
+    KeyBytes key;
+    for (uint i = 0; i < this->key_columns.size(); i++) {
+        ValueDict::const_iterator column = key_values->find(this->key_columns[i]);
+        if (column == key_values->end())
+            break;
+        encode_value(column->second, this->key_types[i], key);
+    }
+    return key;
+}
+
+ValueDict* KeyEncoder::decode(const KeyBytes& key) const {
+    ValueDict* key_values = new ValueDict();
+    size_t offset = 0;
+    for (uint i = 0; i < this->key_columns.size(); i++)
+        (*key_values)[this->key_columns[i]] = decode_value(key, offset, this->key_types[i]);
+    return key_values;
+}
+
+void KeyEncoder::encode_value(const Value& value, ColumnAttribute::DataType data_type, KeyBytes& key) {
+    if (data_type == ColumnAttribute::INT) {
+        u32 bits = (u32)value.n ^ 0x80000000U;  // flip sign so negatives sort first
+        key.push_back((char)(bits >> 24));
+        key.push_back((char)(bits >> 16));
+        key.push_back((char)(bits >> 8));
+        key.push_back((char)bits);
+    } else if (data_type == ColumnAttribute::BOOLEAN) {
+        key.push_back(value.n ? '\x01' : '\x00');
+    } else if (data_type == ColumnAttribute::TEXT) {
+        for (char c: value.s) {
+            key.push_back(c);
+            if (c == ESCAPE)
+                key.push_back(ESCAPED_NUL);
+        }
+        key.push_back(ESCAPE);
+        key.push_back(TERMINATOR);
+    } else {
+        throw DbRelationError("Only know how to encode INT, TEXT, and BOOLEAN keys");
+    }
+}
+
+Value KeyEncoder::decode_value(const KeyBytes& key, size_t& offset, ColumnAttribute::DataType data_type) {
+    Value value;
+    if (data_type == ColumnAttribute::INT) {
+        if (offset + 4 > key.size())
+            throw DbRelationError("truncated INT in search key");
+        u32 bits = 0;
+        for (int i = 0; i < 4; i++)
+            bits = (bits << 8) | (uint8_t)key[offset++];
+        value.n = (int32_t)(bits ^ 0x80000000U);
+    } else if (data_type == ColumnAttribute::BOOLEAN) {
+        if (offset + 1 > key.size())
+            throw DbRelationError("truncated BOOLEAN in search key");
+        value.n = key[offset++] != '\x00';
+    } else if (data_type == ColumnAttribute::TEXT) {
+        value.data_type = ColumnAttribute::TEXT;
+        while (true) {
+            if (offset + 1 >= key.size())
+                throw DbRelationError("unterminated TEXT in search key");
+            char c = key[offset++];
+            if (c != ESCAPE) {
+                value.s.push_back(c);
+            } else if (key[offset++] == ESCAPED_NUL) {
+                value.s.push_back(ESCAPE);
+            } else {
+                break;  // terminator
+            }
+        }
+        return value;
+    } else {
+        throw DbRelationError("Only know how to decode INT, TEXT, and BOOLEAN keys");
+    }
+    value.data_type = data_type;
+    return value;
+}
@@ -0,0 +1,91 @@
+/**
+ * @file KeyEncoder.h - Order-preserving byte encoding of index search keys.
+ * KeyEncoder
+ *
+ * @author Justin Thoreson
+ * @see "Seattle University, CPSC5300, Winter 2023"
+ */
+
+#pragma once
+
+#include <string>
+#include "storage_engine.h"
+
+/**
+ * Encoded search key. Two keys compare (as unsigned bytes, i.e. memcmp) in the
+ * same order as their column values compare, column by column.
+ */
+using KeyBytes = std::string;
+
+/**
+ * @class KeyEncoder - turns a (composite) search key into memcmp-comparable bytes
+ *
+ * Each key column is encoded in turn, based on its declared data type:
+ *     INT:     4 bytes, big-endian, with the sign bit flipped
+ *     BOOLEAN: 1 byte, 0x00 or 0x01
+ *     TEXT:    the bytes of the string with each 0x00 escaped as 0x00 0xFF,
+ *              followed by the terminator 0x00 0x01
+ * Every column encoding is self-delimiting, so the encoding of the first k
+ * columns of a key is a byte prefix of the encoding of the whole key.
+ */
+class KeyEncoder {
+public:
+    /**
+     * Constructor
+     * @param relation     relation whose column attributes give the key column types
+     * @param key_columns  search key columns, in order
+     * @throws             DbRelationError if a key column is not in the relation
+     */
+    KeyEncoder(const DbRelation& relation, const ColumnNames& key_columns);
+
+    virtual ~KeyEncoder() {}
+
+    /**
+     * Encode the search key columns of the given row.
+     * @param key_values  dictionary containing (at least) the key columns
+     * @returns           the encoded key
+     * @throws            DbRelationError if a key column is missing
+     */
+    virtual KeyBytes encode(const ValueDict* key_values) const;
+
+    /**
+     * Encode the leading key columns that are present in the given row, stopping
+     * at the first missing one. Useful as a prefix for range searches.
+     * @param key_values  dictionary of values for some leading key columns
+     * @returns           the encoded key prefix
+     */
+    virtual KeyBytes encode_prefix(const ValueDict* key_values) const;
+
+    /**
+     * Decode an encoded key back into its column values.
+     * @param key  the encoded key (as returned by encode)
+     * @returns    dictionary of key values keyed by key column names (freed by caller)
+     */
+    virtual ValueDict* decode(const KeyBytes& key) const;
+
+    /**
+     * Accessor for the key columns.
+     */
+    virtual const ColumnNames& get_key_columns() const { return key_columns; }
+
+    /**
+     * Append the encoding of a single value to a key.
+     * @param value      the value to encode
+     * @param data_type  declared type of the column the value belongs to
+     * @param key        key to append to
+     */
+    static void encode_value(const Value& value, ColumnAttribute::DataType data_type, KeyBytes& key);
+
+    /**
+     * Decode a single value from a key.
+     * @param key        the encoded key
+     * @param offset     where the value starts; advanced past it on return
+     * @param data_type  declared type of the column the value belongs to
+     * @returns          the decoded value
+     */
+    static Value decode_value(const KeyBytes& key, size_t& offset, ColumnAttribute::DataType data_type);
+
+protected:
+    ColumnNames key_columns;
+    std::vector<ColumnAttribute::DataType> key_types;
+};
@@ -0,0 +1,251 @@
+/**
+ * @file Optimizer.cpp
+ * @author Justin Thoreson
+ * @see Seattle University, CPSC5300
+ */
+
+#include <algorithm>
+#include <cmath>
+#include "Optimizer.h"
+
+// Guesses used when there are no statistics (in the spirit of System R's).
+static const double EQ_SELECTIVITY = 0.005;
+static const double RANGE_SELECTIVITY = 1.0 / 3;
+static const double BETWEEN_SELECTIVITY = 1.0 / 4;
+static const uint TEXT_WIDTH = 20;
+
+TableStatistics::TableStatistics(DbRelation& table)
+    : row_count(0), block_count(table.get_block_count()), column_names(table.get_column_names()),
+      column_attributes(table.get_column_attributes()) {
+    // rows per block from the marshaled row size plus its slotted page header
+    uint width = 4;
+    for (ColumnAttribute& ca: this->column_attributes) {
+        switch (ca.get_data_type()) {
+            case ColumnAttribute::INT:
+                width += 4;
+                break;
+            case ColumnAttribute::BOOLEAN:
+                width += 1;
+                break;
+            default:
+                width += 2 + TEXT_WIDTH;
+        }
+    }
+    this->row_count = this->block_count * ((DbBlock::BLOCK_SZ - 4) / width);
+}
+
+void TableStatistics::use_collected(double row_count, double block_count, const ColumnStatisticsMap& columns) {
+    this->row_count = block_count == 0 ? row_count : row_count * std::max(1.0, this->block_count / block_count);
+    this->columns = columns;
+}
+
+double TableStatistics::selectivity(const Comparison& comparison) const {
+    ColumnStatisticsMap::const_iterator column = this->columns.find(comparison.column_name);
+    if (comparison.is_literal() && comparison.value.data_type == ColumnAttribute::INT && column != this->columns.end()
+        && !column->second.histogram.empty()) {
+        IntRanges ranges;
+        if (Optimizer::narrow_range(ranges, comparison))
+            return this->selectivity(comparison.column_name, ranges.begin()->second);
+    }
+    double eq = EQ_SELECTIVITY;
+    if (column != this->columns.end() && column->second.distinct_count > 0)
+        eq = 1 / column->second.distinct_count;
+    else if (this->get_data_type(comparison.column_name) == ColumnAttribute::BOOLEAN)
+        eq = 0.5;
+    switch (comparison.op) {
+        case Comparison::EQ:
+            return eq;
+        case Comparison::NE:
+            return 1 - eq;
+        default:
+            return RANGE_SELECTIVITY;
+    }
+}
+
+// With a histogram, count each bucket's share of the rows by how much of the
+// bucket's span the range covers (taking values to be spread evenly within it).
+double TableStatistics::selectivity(const Identifier& column_name, const IntRange& range) const {
+    if (range.first > range.second)
+        return 0;
+    ColumnStatisticsMap::const_iterator column = this->columns.find(column_name);
+    if (column != this->columns.end() && !column->second.histogram.empty()) {
+        const std::vector<int32_t>& bounds = column->second.histogram;
+        if (bounds.size() == 1)
+            return range.first <= bounds[0] && bounds[0] <= range.second ? 1 : 0;
+        double fraction = 0;
+        for (size_t i = 0; i + 1 < bounds.size(); i++) {
+            double low = std::max((double) range.first, (double) bounds[i]);
+            double high = std::min((double) range.second, (double) bounds[i + 1]);
+            if (low <= high)
+                fraction += (high - low + 1) / ((double) bounds[i + 1] - bounds[i] + 1);
+        }
+        return fraction / (bounds.size() - 1);
+    }
+    if (range.first == range.second)
+        return this->selectivity(Comparison(column_name, Comparison::EQ, Value(range.first)));
+    if (range.first == INT32_MIN || range.second == INT32_MAX)
+        return RANGE_SELECTIVITY;
+    return BETWEEN_SELECTIVITY;
+}
+
+double TableStatistics::selectivity(const Predicate& predicate) const {
+    double fraction = 1;
+    IntRanges ranges;
+    for (const Comparison& comparison: predicate) {
+        if (!comparison.is_literal() || comparison.value.data_type != ColumnAttribute::INT
+            || !Optimizer::narrow_range(ranges, comparison))
+            fraction *= this->selectivity(comparison);
+    }
+    for (auto const& range: ranges)
+        fraction *= this->selectivity(range.first, range.second);
+    return fraction;
+}
+
+double TableStatistics::distinct_count(const Identifier& column_name) const {
+    ColumnStatisticsMap::const_iterator column = this->columns.find(column_name);
+    double distinct = 1 / EQ_SELECTIVITY;
+    if (column != this->columns.end() && column->second.distinct_count > 0)
+        distinct = column->second.distinct_count;
+    else if (this->get_data_type(column_name) == ColumnAttribute::BOOLEAN)
+        distinct = 2;
+    return std::min(distinct, this->row_count);
+}
+
+ColumnAttribute::DataType TableStatistics::get_data_type(const Identifier& column_name) const {
+    for (uint i = 0; i < this->column_names.size(); i++) {
+        if (this->column_names[i] == column_name) {
+            ColumnAttribute ca = this->column_attributes[i];
+            return ca.get_data_type();
+        }
+    }
+    return ColumnAttribute::INT;
+}
+
+bool Optimizer::narrow_range(IntRanges& ranges, const Comparison& comparison) {
+    int32_t n = comparison.value.n;
+    if (comparison.op == Comparison::NE || (comparison.op == Comparison::LT && n == INT32_MIN)
+        || (comparison.op == Comparison::GT && n == INT32_MAX))
+        return false;
+    IntRanges::iterator range = ranges.find(comparison.column_name);
+    if (range == ranges.end())
+        range = ranges.insert(std::make_pair(comparison.column_name, IntRange(INT32_MIN, INT32_MAX))).first;
+    IntRange& r = range->second;
+    switch (comparison.op) {
+        case Comparison::EQ:
+            r = IntRange(std::max(r.first, n), std::min(r.second, n));
+            return true;
+        case Comparison::LT:
+            r.second = std::min(r.second, n - 1);
+            return true;
+        case Comparison::LE:
+            r.second = std::min(r.second, n);
+            return true;
+        case Comparison::GT:
+            r.first = std::max(r.first, n + 1);
+            return true;
+        case Comparison::GE:
+            r.first = std::max(r.first, n);
+            return true;
+        default:
+            return false;
+    }
+}
+
+// Height of a BTREE index over rows entries.
+static double btree_height(double rows) {
+    return std::max(1.0, std::ceil(std::log(std::max(rows, 1.0)) / std::log((double) Optimizer::BTREE_FANOUT)));
+}
+
+HandleScan* Optimizer::access_path(DbRelation& table, const IndexInfos& indices, const TableStatistics& statistics,
+                                   const ColumnNames& column_names, Predicate& predicate) {
+    double rows = statistics.get_row_count();
+
+    // the full scan: equalities and INT ranges go to the storage engine, the rest stays behind
+    ValueDict where;
+    IntRanges ranges;
+    Predicate pushed, residual;
+    for (const Comparison& comparison: predicate) {
+        if (!comparison.is_literal()) {
+            residual.push_back(comparison);
+        } else if (comparison.op == Comparison::EQ && where.find(comparison.column_name) == where.end()) {
+            where[comparison.column_name] = comparison.value;
+            pushed.push_back(comparison);
+        } else if (comparison.value.data_type == ColumnAttribute::INT && narrow_range(ranges, comparison)) {
+            pushed.push_back(comparison);
+        } else {
+            residual.push_back(comparison);
+        }
+    }
+    double best_cost = statistics.get_block_count();
+    double best_rows = rows * statistics.selectivity(pushed);
+    HandleScan* best = new TableScan(table, column_names, where, ranges);
+    Predicate best_residual = residual;
+
+    for (const IndexInfo& info: indices) {
+        // fix as many leading key columns with equalities as we can
+        std::vector<bool> used(predicate.size(), false);
+        ValueDict key;
+        for (const Identifier& key_column: info.key_columns) {
+            size_t i = 0;
+            while (i < predicate.size() && !(predicate[i].column_name == key_column
+                                             && predicate[i].op == Comparison::EQ && predicate[i].is_literal()))
+                i++;
+            if (i == predicate.size())
+                break;
+            key[key_column] = predicate[i].value;
+            used[i] = true;
+        }
+
+        // then bound the next key column, if it is an INT column with range comparisons
+        IntRanges bound;
+        Identifier bound_column;
+        if (key.size() < info.key_columns.size() && !info.is_hash) {
+            bound_column = info.key_columns[key.size()];
+            for (size_t i = 0; i < predicate.size(); i++) {
+                const Comparison& comparison = predicate[i];
+                if (comparison.column_name == bound_column && comparison.is_literal()
+                    && comparison.value.data_type == ColumnAttribute::INT && narrow_range(bound, comparison))
+                    used[i] = true;
+            }
+        }
+
+        Predicate index_pushed, index_residual;
+        for (size_t i = 0; i < predicate.size(); i++)
+            (used[i] ? index_pushed : index_residual).push_back(predicate[i]);
+        double matched = rows * statistics.selectivity(index_pushed);
+        HandleScan* candidate;
+        double cost;
+        if (key.size() == info.key_columns.size()) {
+            if (info.is_unique)
+                matched = std::min(matched, 1.0);
+            cost = (info.is_hash ? 1 : btree_height(rows)) + matched;
+            candidate = new IndexLookup(table, *info.index, column_names, key);
+        } else if (!info.is_hash && (!key.empty() || !bound.empty())) {
+            ValueDict min_key = key, max_key = key;
+            if (!bound.empty()) {
+                IntRange range = bound.begin()->second;
+                if (range.first != INT32_MIN)
+                    min_key[bound_column] = Value(range.first);
+                if (range.second != INT32_MAX)
+                    max_key[bound_column] = Value(range.second);
+            }
+            cost = btree_height(rows) + matched / BTREE_FANOUT + matched;
+            candidate = new IndexRange(table, *info.index, column_names, min_key, max_key);
+        } else {
+            continue;
+        }
+        if (cost < best_cost) {
+            delete best;
+            best = candidate;
+            best_cost = cost;
+            best_rows = matched;
+            best_residual = index_residual;
+        } else {
+            delete candidate;
+        }
+    }
+
+    best->set_estimate(best_cost, best_rows);
+    predicate = best_residual;
+    return best;
+}
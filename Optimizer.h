@@ -0,0 +1,138 @@
+/**
+ * @file Optimizer.h - Cost-based choice of how to read a table.
+ * TableStatistics
+ * IndexInfo
+ * Optimizer
+ *
+ * @author Justin Thoreson
+ * @see "Seattle University, CPSC5300, Winter 2023"
+ */
+
+#pragma once
+
+#include <vector>
+#include "storage_engine.h"
+#include "schema_tables.h"
+#include "QueryPlan.h"
+
+/**
+ * @class TableStatistics - what the optimizer knows about a table's size and values
+ *
+ * The block count comes from the table itself. Without collected statistics,
+ * the row count is guessed from the block count and the column types, and
+ * selectivities fall back on fixed guesses. With them, equalities use the
+ * distinct counts and INT ranges use the histograms.
+ */
+class TableStatistics {
+public:
+    /**
+     * Constructor
+     * @param table  the table to describe
+     */
+    TableStatistics(DbRelation& table);
+
+    virtual ~TableStatistics() {}
+
+    virtual double get_row_count() const { return row_count; }
+
+    virtual double get_block_count() const { return block_count; }
+
+    /**
+     * Use statistics collected by ANALYZE in place of the guesses.
+     * @param row_count    rows in the table when analyzed
+     * @param block_count  blocks in the table when analyzed (the row count is
+     *                     scaled by how much the table has grown since)
+     * @param columns      statistics for each column
+     */
+    virtual void use_collected(double row_count, double block_count, const ColumnStatisticsMap& columns);
+
+    /**
+     * Estimated fraction of rows satisfying a comparison.
+     */
+    virtual double selectivity(const Comparison& comparison) const;
+
+    /**
+     * Estimated fraction of rows with an INT column's value in range.
+     */
+    virtual double selectivity(const Identifier& column_name, const IntRange& range) const;
+
+    /**
+     * Estimated fraction of rows satisfying all the comparisons (taken as
+     * independent, except that comparisons of an INT column with literals are
+     * combined into a single range).
+     */
+    virtual double selectivity(const Predicate& predicate) const;
+
+    /**
+     * Estimated number of distinct values in a column (no more than the row count).
+     */
+    virtual double distinct_count(const Identifier& column_name) const;
+
+protected:
+    double row_count;
+    double block_count;
+    ColumnNames column_names;
+    ColumnAttributes column_attributes;
+    ColumnStatisticsMap columns;
+
+    /**
+     * Data type of one of the table's columns.
+     */
+    virtual ColumnAttribute::DataType get_data_type(const Identifier& column_name) const;
+};
+
+
+/**
+ * @class IndexInfo - an index the optimizer may use, with what the catalog says about it
+ */
+class IndexInfo {
+public:
+    IndexInfo(DbIndex& index, ColumnNames key_columns, bool is_hash, bool is_unique)
+        : index(&index), key_columns(key_columns), is_hash(is_hash), is_unique(is_unique) {}
+
+    DbIndex* index;
+    ColumnNames key_columns;
+    bool is_hash;
+    bool is_unique;
+};
+
+using IndexInfos = std::vector<IndexInfo>;
+
+
+/**
+ * @class Optimizer - picks the access path for a table by estimated block reads
+ *
+ * Candidates are a full scan (with equalities and INT ranges pushed down to
+ * the storage engine), a DbIndex::lookup on any index whose whole key is
+ * fixed by equalities, and a DbIndex::range on a BTREE index whose leading
+ * columns are fixed or bounded. Each row fetched through an index is counted
+ * as a block read.
+ */
+class Optimizer {
+public:
+    /**
+     * Fan-out assumed for BTREE indices when estimating their height and leaf count
+     */
+    static const uint BTREE_FANOUT = 100;
+
+    /**
+     * Choose the cheapest leaf operator for reading a table.
+     * @param table         table to read
+     * @param indices       indices on the table
+     * @param statistics    statistics for the table
+     * @param column_names  columns the rest of the plan needs
+     * @param predicate     where-clause comparisons; those the leaf fully
+     *                      handles are removed (returned by reference)
+     * @returns             the leaf operator, with its estimates set (freed by caller)
+     */
+    static HandleScan* access_path(DbRelation& table, const IndexInfos& indices, const TableStatistics& statistics,
+                                   const ColumnNames& column_names, Predicate& predicate);
+
+    /**
+     * Narrow the range on comparison's column to what the comparison allows.
+     * @param ranges      ranges by column (a new one is added if needed)
+     * @param comparison  comparison of an INT column with a literal
+     * @returns           false if the comparison can't be expressed as a range
+     */
+    static bool narrow_range(IntRanges& ranges, const Comparison& comparison);
+};
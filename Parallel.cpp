@@ -0,0 +1,240 @@
+/**
+ * @file Parallel.cpp - implementation of the parallel scan operators
+ * @author Justin Thoreson
+ * @see "Seattle University, CPSC5300, Winter 2023"
+ */
+
+#include <algorithm>
+#include <functional>
+#include "Parallel.h"
+#include "Transaction.h"
+
+void MorselQueue::reset() {
+    std::lock_guard<std::mutex> lock(this->mutex);
+    this->next_block = 1;
+    this->last_block = this->relation.get_block_count();
+}
+
+bool MorselQueue::take(BlockID& first, BlockID& last) {
+    std::lock_guard<std::mutex> lock(this->mutex);
+    if (this->next_block > this->last_block)
+        return false;
+    first = this->next_block;
+    last = std::min(this->last_block, first + this->morsel_blocks - 1);
+    this->next_block = last + 1;
+    return true;
+}
+
+MorselScan::MorselScan(const TableScan& scan, MorselQueue* morsels)
+    : TableScan(scan.get_relation(), scan.get_column_names(), scan.get_where(), scan.get_ranges()), morsels(morsels),
+      morsel_next(1), morsel_last(0) {
+}
+
+void MorselScan::open() {
+    this->close();
+    if (this->get_table() == nullptr)
+        throw DbRelationError("a morsel scan can only read a heap table");
+    this->produced = 0;
+    this->morsel_next = 1;
+    this->morsel_last = 0;
+}
+
+void MorselScan::close() {
+    this->clear_block();
+}
+
+bool MorselScan::take_block(BlockID& block_id) {
+    if (this->morsel_next > this->morsel_last && !this->morsels->take(this->morsel_next, this->morsel_last))
+        return false;
+    block_id = this->morsel_next++;
+    return true;
+}
+
+std::string MorselScan::explain(uint depth) const {
+    return this->explain_line(depth, this->describe("MorselScan") + " (" + std::to_string(
+            this->morsels->get_morsel_blocks()) + "-block morsels)");
+}
+
+// A worker reads in a child of the statement's snapshot transaction, so every
+// worker sees just the rows the statement does. Berkeley DB lets a parent have
+// several children at once, so long as it does nothing else until they end,
+// and the statement's thread only waits for the workers' rows meanwhile.
+// Without a statement (as in the tests), each worker has a snapshot of its own.
+static void read_snapshot(DbTxn* parent, std::function<void()> work) {
+    DbTxn* txn = Transaction::begin(parent, true);
+    Transaction::set_current(txn);
+    try {
+        work();
+    } catch (...) {
+        Transaction::set_current(nullptr);
+        Transaction::commit(txn, parent != nullptr, Transaction::ASYNC);  // it only read, so there is nothing to undo
+        throw;
+    }
+    Transaction::set_current(nullptr);
+    Transaction::commit(txn, parent != nullptr, Transaction::ASYNC);
+}
+
+uint Gather::default_workers() {
+    return std::max(1U, std::thread::hardware_concurrency());
+}
+
+Gather::Gather(std::vector<PlanOperator*> workers, MorselQueue* morsels)
+    : PlanOperator(), workers(workers), morsels(morsels), snapshot(nullptr), threads(), mutex(), changed(), chunks(),
+      finished(0), stopping(false), error() {
+}
+
+Gather::~Gather() {
+    this->close();
+    for (PlanOperator* worker: this->workers)
+        delete worker;
+    delete this->morsels;
+}
+
+void Gather::open() {
+    this->close();
+    this->morsels->reset();
+    this->snapshot = Transaction::current();
+    this->finished = 0;
+    this->stopping = false;
+    this->error = nullptr;
+    for (size_t worker = 0; worker < this->workers.size(); worker++)
+        this->threads.push_back(std::thread(&Gather::work, this, worker));
+}
+
+bool Gather::next(RowBatch& batch) {
+    batch.clear();
+    Chunk chunk;
+    {
+        std::unique_lock<std::mutex> lock(this->mutex);
+        this->changed.wait(lock, [this] {
+            return !this->chunks.empty() || this->finished == this->workers.size() || this->error != nullptr;
+        });
+        if (this->error != nullptr)
+            std::rethrow_exception(this->error);
+        if (this->chunks.empty())
+            return false;
+        chunk = std::move(this->chunks.front());
+        this->chunks.pop_front();
+    }
+    this->changed.notify_all();
+    for (size_t i = 0; i < chunk.rows.size(); i++)
+        batch.add(chunk.handles[i], chunk.rows[i]);
+    return true;
+}
+
+void Gather::close() {
+    {
+        std::lock_guard<std::mutex> lock(this->mutex);
+        this->stopping = true;
+    }
+    this->changed.notify_all();
+    for (std::thread& thread: this->threads)
+        thread.join();
+    this->threads.clear();
+    for (Chunk& chunk: this->chunks)
+        for (ValueDict* row: chunk.rows)
+            delete row;
+    this->chunks.clear();
+}
+
+std::string Gather::explain(uint depth) const {
+    return std::string(2 * depth, ' ') + "Gather (" + std::to_string(this->workers.size()) + " workers)\n"
+           + this->workers.front()->explain(depth + 1);
+}
+
+void Gather::work(size_t worker) {
+    PlanOperator* plan = this->workers[worker];
+    try {
+        read_snapshot(this->snapshot, [this, plan] { this->scan(plan); });
+    } catch (...) {
+        std::lock_guard<std::mutex> lock(this->mutex);
+        if (this->error == nullptr)
+            this->error = std::current_exception();
+        this->stopping = true;
+    }
+    {
+        std::lock_guard<std::mutex> lock(this->mutex);
+        this->finished++;
+    }
+    this->changed.notify_all();
+}
+
+void Gather::scan(PlanOperator* plan) {
+    try {
+        plan->open();
+        RowBatch batch;
+        while (plan->next(batch)) {
+            Chunk chunk;
+            for (size_t i = 0; i < batch.size(); i++)
+                chunk.handles.push_back(batch.get_handle(i));
+            batch.move_rows(chunk.rows);
+            std::unique_lock<std::mutex> lock(this->mutex);
+            this->changed.wait(lock, [this] {
+                return this->chunks.size() < QUEUE_BATCHES * this->workers.size() || this->stopping;
+            });
+            if (this->stopping) {
+                for (ValueDict* row: chunk.rows)
+                    delete row;
+                break;
+            }
+            this->chunks.push_back(std::move(chunk));
+            lock.unlock();
+            this->changed.notify_all();
+        }
+        plan->close();
+    } catch (...) {
+        plan->close();
+        throw;
+    }
+}
+
+ParallelAggregate::ParallelAggregate(std::vector<HashAggregate*> workers, MorselQueue* morsels)
+    : PlanOperator(), workers(workers), morsels(morsels) {
+}
+
+ParallelAggregate::~ParallelAggregate() {
+    for (HashAggregate* worker: this->workers)
+        delete worker;
+    delete this->morsels;
+}
+
+// HashAggregate::open() reads its whole input, so each worker's share is done
+// once its thread ends.
+void ParallelAggregate::open() {
+    this->morsels->reset();
+    DbTxn* snapshot = Transaction::current();
+    std::vector<std::exception_ptr> errors(this->workers.size());
+    std::vector<std::thread> threads;
+    for (size_t worker = 0; worker < this->workers.size(); worker++) {
+        threads.push_back(std::thread([this, worker, snapshot, &errors] {
+            try {
+                read_snapshot(snapshot, [this, worker] { this->workers[worker]->open(); });
+            } catch (...) {
+                errors[worker] = std::current_exception();
+            }
+        }));
+    }
+    for (std::thread& thread: threads)
+        thread.join();
+    for (std::exception_ptr& error: errors)
+        if (error != nullptr)
+            std::rethrow_exception(error);
+    for (size_t worker = 1; worker < this->workers.size(); worker++) {
+        this->workers.front()->merge(*this->workers[worker]);
+        this->workers[worker]->close();
+    }
+}
+
+bool ParallelAggregate::next(RowBatch& batch) {
+    return this->workers.front()->next(batch);
+}
+
+void ParallelAggregate::close() {
+    for (HashAggregate* worker: this->workers)
+        worker->close();
+}
+
+std::string ParallelAggregate::explain(uint depth) const {
+    return std::string(2 * depth, ' ') + "ParallelAggregate (" + std::to_string(this->workers.size()) + " workers)\n"
+           + this->workers.front()->explain(depth + 1);
+}
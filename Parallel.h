@@ -0,0 +1,229 @@
+/**
+ * @file Parallel.h - Plan operators that spread a table scan across worker threads.
+ * MorselQueue
+ * MorselScan: TableScan
+ * Gather: PlanOperator
+ * ParallelAggregate: PlanOperator
+ *
+ * @author Justin Thoreson
+ * @see "Seattle University, CPSC5300, Winter 2023"
+ */
+
+#pragma once
+
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "QueryPlan.h"
+#include "HashAggregate.h"
+#include "HeapTable.h"
+
+/**
+ * @class MorselQueue - hands out a table's blocks a range (morsel) at a time to
+ * whichever worker asks next, so that faster workers end up with more of them
+ */
+class MorselQueue {
+public:
+    /**
+     * Default number of blocks in a morsel
+     */
+    static const BlockID MORSEL_BLOCKS = 16;
+
+    /**
+     * Constructor
+     * @param relation       the table whose blocks to hand out
+     * @param morsel_blocks  number of blocks in each morsel
+     */
+    MorselQueue(DbRelation& relation, BlockID morsel_blocks = MORSEL_BLOCKS)
+        : relation(relation), morsel_blocks(morsel_blocks), next_block(1), last_block(0) {}
+
+    virtual ~MorselQueue() {}
+
+    MorselQueue(const MorselQueue& other) = delete;
+
+    MorselQueue& operator=(const MorselQueue& other) = delete;
+
+    /**
+     * Start handing out the table's blocks from the first one again (call before the workers start).
+     */
+    virtual void reset();
+
+    /**
+     * Take the next morsel.
+     * @param first  returned by reference: first block of the morsel
+     * @param last   returned by reference: last block of the morsel
+     * @returns      false if there are no blocks left
+     */
+    virtual bool take(BlockID& first, BlockID& last);
+
+    virtual BlockID get_morsel_blocks() const { return morsel_blocks; }
+
+protected:
+    DbRelation& relation;
+    BlockID morsel_blocks;
+    BlockID next_block;
+    BlockID last_block;
+    std::mutex mutex;
+};
+
+
+/**
+ * @class MorselScan - a table scan of only the morsels it takes from a shared queue
+ *
+ * The morsel scans of a query all read through the query's HeapTable, whose
+ * Berkeley DB handles are free-threaded, so several of them can scan the
+ * table at once from different threads. Each block is read and decoded once,
+ * and the equality predicates and INT ranges are checked on the decoded rows.
+ */
+class MorselScan : public TableScan {
+public:
+    /**
+     * Constructor
+     * @param scan     the table scan to do a share of (table, columns, and pushed-down predicates)
+     * @param morsels  where to take morsels from (not owned)
+     */
+    MorselScan(const TableScan& scan, MorselQueue* morsels);
+
+    virtual ~MorselScan() {}
+
+    /**
+     * Start taking morsels.
+     * @throws  DbRelationError if the table isn't a heap table
+     */
+    virtual void open();
+
+    virtual void close();
+
+    virtual std::string explain(uint depth = 0) const;
+
+protected:
+    MorselQueue* morsels;
+    BlockID morsel_next;  // the next block of the current morsel
+    BlockID morsel_last;
+
+    /**
+     * The next block of the current morsel, taking another morsel once it runs out.
+     */
+    virtual bool take_block(BlockID& block_id);
+};
+
+
+/**
+ * @class Gather - run a plan in each of several worker threads and pass on all their rows
+ *
+ * Each worker pushes its batches onto a queue shared with the consumer, holding
+ * at most QUEUE_BATCHES batches per worker so that fast workers wait on a slow
+ * consumer rather than piling rows up in memory. The rows come out in no
+ * particular order. An exception in any worker stops the others and is
+ * rethrown by next(). Each worker reads in a child of the statement's snapshot
+ * transaction, so the workers see the same rows as the statement and don't
+ * wait on other sessions' locks.
+ */
+class Gather : public PlanOperator {
+public:
+    /**
+     * Most batches queued per worker
+     */
+    static const size_t QUEUE_BATCHES = 4;
+
+    /**
+     * Number of workers to use by default: one per hardware thread.
+     */
+    static uint default_workers();
+
+    /**
+     * Constructor
+     * @param workers  a plan for each worker to run (now owned by the gather)
+     * @param morsels  the queue the workers' scans take their morsels from (now owned by the gather)
+     */
+    Gather(std::vector<PlanOperator*> workers, MorselQueue* morsels);
+
+    virtual ~Gather();
+
+    /**
+     * Start the workers.
+     */
+    virtual void open();
+
+    virtual bool next(RowBatch& batch);
+
+    /**
+     * Stop the workers and wait for them to finish.
+     */
+    virtual void close();
+
+    virtual std::string explain(uint depth = 0) const;
+
+protected:
+    /**
+     * A batch passed from a worker to the consumer
+     */
+    class Chunk {
+    public:
+        Handles handles;
+        ValueDicts rows;
+    };
+
+    std::vector<PlanOperator*> workers;
+    MorselQueue* morsels;
+    DbTxn* snapshot;  // the statement's transaction, as of open()
+    std::vector<std::thread> threads;
+    std::mutex mutex;
+    std::condition_variable changed;
+    std::deque<Chunk> chunks;
+    size_t finished;
+    bool stopping;
+    std::exception_ptr error;
+
+    /**
+     * Run one worker's plan, in a child transaction of the snapshot.
+     * @param worker  which worker
+     */
+    virtual void work(size_t worker);
+
+    /**
+     * Run a plan, queueing its batches.
+     * @param plan  the worker's plan
+     */
+    virtual void scan(PlanOperator* plan);
+};
+
+
+/**
+ * @class ParallelAggregate - aggregate a table's rows in several worker threads at once
+ *
+ * Each worker runs its own HashAggregate over its share of the table (filters
+ * and all), and their groups are then merged into the first worker's, which
+ * produces the result. The workers don't spill, so this is only for when the
+ * groups are expected to fit in memory several times over.
+ */
+class ParallelAggregate : public PlanOperator {
+public:
+    /**
+     * Constructor
+     * @param workers  an aggregate for each worker to run, all alike and
+     *                 with no memory limit (now owned by the parallel aggregate)
+     * @param morsels  the queue the workers' scans take their morsels from (now owned by the parallel aggregate)
+     */
+    ParallelAggregate(std::vector<HashAggregate*> workers, MorselQueue* morsels);
+
+    virtual ~ParallelAggregate();
+
+    /**
+     * Run the workers' aggregates to completion and merge them.
+     */
+    virtual void open();
+
+    virtual bool next(RowBatch& batch);
+
+    virtual void close();
+
+    virtual std::string explain(uint depth = 0) const;
+
+protected:
+    std::vector<HashAggregate*> workers;
+    MorselQueue* morsels;
+};
@@ -109,6 +109,9 @@ string ParseTreeToString::expression(const Expr* expr) {
         case kExprLiteralInt:
             ret += to_string(expr->ival);
             break;
+        case kExprPlaceholder:
+            ret += "?";
+            break;
         case kExprFunctionRef:
             ret += string(expr->name) + "?" + expr->expr->name;
             break;
@@ -210,6 +213,14 @@ string ParseTreeToString::insert(const InsertStatement* stmt) {
     return "INSERT ...";
 }
 
+string ParseTreeToString::del(const DeleteStatement* stmt) {
+    string ret("DELETE FROM ");
+    ret += stmt->tableName;
+    if (stmt->expr != nullptr)
+        ret += " WHERE " + expression(stmt->expr);
+    return ret;
+}
+
 string ParseTreeToString::create(const CreateStatement* stmt) {
     string ret("CREATE ");
     if (stmt->type == CreateStatement::kTable) {
@@ -290,10 +301,11 @@ string ParseTreeToString::statement(const SQLStatement* stmt) {
             return drop((const DropStatement*) stmt);
         case kStmtShow:
             return show((const ShowStatement*) stmt);
+        case kStmtDelete:
+            return del((const DeleteStatement*) stmt);
         case kStmtError:
         case kStmtImport:
         case kStmtUpdate:
-        case kStmtDelete:
         case kStmtPrepare:
         case kStmtExecute:
         case kStmtExport:
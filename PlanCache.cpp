@@ -0,0 +1,289 @@
+/**
+ * @file PlanCache.cpp - implementation of prepared statements and the plan cache
+ * @author Justin Thoreson
+ * @see "Seattle University, CPSC5300, Winter 2023"
+ */
+
+#include <algorithm>
+#include <cctype>
+#include "PlanCache.h"
+#include "SQLExec.h"
+
+using namespace hsql;
+
+// Every placeholder in an expression.
+static void find_placeholders(Expr* expr, std::vector<Expr*>& placeholders);
+
+// Every placeholder in a SELECT, and the tables it reads.
+static void find_placeholders(const SelectStatement* statement, std::vector<Expr*>& placeholders,
+                              std::vector<Identifier>& table_names);
+
+static void find_placeholders(const TableRef* table_ref, std::vector<Expr*>& placeholders,
+                              std::vector<Identifier>& table_names) {
+    if (table_ref == nullptr)
+        return;
+    switch (table_ref->type) {
+        case kTableName:
+            table_names.push_back(table_ref->name);
+            break;
+        case kTableSelect:
+            find_placeholders(table_ref->select, placeholders, table_names);
+            break;
+        case kTableJoin:
+            find_placeholders(table_ref->join->left, placeholders, table_names);
+            find_placeholders(table_ref->join->right, placeholders, table_names);
+            if (table_ref->join->condition != nullptr)
+                find_placeholders(table_ref->join->condition, placeholders);
+            break;
+        case kTableCrossProduct:
+            for (const TableRef* item : *table_ref->list)
+                find_placeholders(item, placeholders, table_names);
+            break;
+        default:
+            break;
+    }
+}
+
+static void find_placeholders(Expr* expr, std::vector<Expr*>& placeholders) {
+    if (expr == nullptr)
+        return;
+    if (expr->type == kExprPlaceholder)
+        placeholders.push_back(expr);
+    find_placeholders(expr->expr, placeholders);
+    find_placeholders(expr->expr2, placeholders);
+    if (expr->exprList != nullptr)
+        for (Expr* item : *expr->exprList)
+            find_placeholders(item, placeholders);
+}
+
+static void find_placeholders(const SelectStatement* statement, std::vector<Expr*>& placeholders,
+                              std::vector<Identifier>& table_names) {
+    for (Expr* expr : *statement->selectList)
+        find_placeholders(expr, placeholders);
+    find_placeholders(statement->fromTable, placeholders, table_names);
+    find_placeholders(statement->whereClause, placeholders);
+    if (statement->groupBy != nullptr) {
+        for (Expr* expr : *statement->groupBy->columns)
+            find_placeholders(expr, placeholders);
+        find_placeholders(statement->groupBy->having, placeholders);
+    }
+    if (statement->order != nullptr)
+        find_placeholders(statement->order->expr, placeholders);
+    if (statement->unionSelect != nullptr)
+        find_placeholders(statement->unionSelect, placeholders, table_names);
+}
+
+// The parser numbers each placeholder by where it is in the SQL, so they are sorted into that order.
+PreparedStatement::PreparedStatement(SQLParserResult* parse)
+    : parse(parse), placeholders(), parameters(), bound(false), table_names(), plan(nullptr), column_names(),
+      column_attributes(), planned_in_transaction(false) {
+    const SQLStatement* statement = this->get_statement();
+    switch (statement->type()) {
+        case kStmtSelect:
+            find_placeholders((const SelectStatement*) statement, this->placeholders, this->table_names);
+            break;
+        case kStmtInsert: {
+            const InsertStatement* insert = (const InsertStatement*) statement;
+            this->table_names.push_back(insert->tableName);
+            if (insert->values != nullptr)
+                for (Expr* expr : *insert->values)
+                    find_placeholders(expr, this->placeholders);
+            if (insert->select != nullptr)
+                find_placeholders(insert->select, this->placeholders, this->table_names);
+            break;
+        }
+        case kStmtDelete: {
+            const DeleteStatement* del = (const DeleteStatement*) statement;
+            this->table_names.push_back(del->tableName);
+            find_placeholders(del->expr, this->placeholders);
+            break;
+        }
+        default:
+            break;
+    }
+    std::stable_sort(this->placeholders.begin(), this->placeholders.end(),
+                     [](const Expr* a, const Expr* b) { return a->ival < b->ival; });
+}
+
+// The bound strings belong to this->parameters, so they are taken back out of
+// the parse tree before it is freed.
+PreparedStatement::~PreparedStatement() {
+    this->forget_plan();
+    for (Expr* placeholder : this->placeholders) {
+        placeholder->type = kExprPlaceholder;
+        placeholder->name = nullptr;
+    }
+    delete this->parse;
+}
+
+const SQLStatement* PreparedStatement::bind(const std::vector<Value>& parameters) {
+    if (parameters.size() != this->placeholders.size())
+        throw SQLExecError("statement takes " + std::to_string(this->placeholders.size()) + " parameter(s), not "
+                           + std::to_string(parameters.size()));
+    if (this->bound && parameters == this->parameters)
+        return this->get_statement();
+    this->forget_plan();
+    this->parameters = parameters;
+    for (size_t i = 0; i < this->placeholders.size(); i++) {
+        Expr* placeholder = this->placeholders[i];
+        const Value& value = this->parameters[i];
+        if (value.data_type == ColumnAttribute::TEXT) {
+            placeholder->type = kExprLiteralString;
+            placeholder->name = const_cast<char*>(value.s.c_str());
+        } else {
+            placeholder->type = kExprLiteralInt;
+            placeholder->ival = value.n;
+            placeholder->name = nullptr;
+        }
+    }
+    this->bound = true;
+    return this->get_statement();
+}
+
+bool PreparedStatement::refers_to(const Identifier& table_name) const {
+    return std::find(this->table_names.begin(), this->table_names.end(), table_name) != this->table_names.end();
+}
+
+void PreparedStatement::set_plan(PlanOperator* plan, const ColumnNames& column_names,
+                                 const ColumnAttributes& column_attributes, bool in_transaction) {
+    this->forget_plan();
+    this->plan = plan;
+    this->column_names = column_names;
+    this->column_attributes = column_attributes;
+    this->planned_in_transaction = in_transaction;
+}
+
+void PreparedStatement::forget_plan() {
+    delete this->plan;
+    this->plan = nullptr;
+    this->column_names.clear();
+    this->column_attributes.clear();
+}
+
+// Is this character part of an identifier (or keyword)?
+static bool identifier_char(char c) {
+    return std::isalnum((unsigned char) c) || c == '_' || c == '$';
+}
+
+bool PlanCache::normalize(const std::string& sql, std::string& normalized, std::vector<Value>& parameters) {
+    normalized.clear();
+    parameters.clear();
+    std::string word;  // the keyword or identifier just before, in upper case
+    size_t i = 0;
+    while (i < sql.size()) {
+        char c = sql[i];
+        if (std::isspace((unsigned char) c)) {
+            while (i < sql.size() && std::isspace((unsigned char) sql[i]))
+                i++;
+            if (!normalized.empty())
+                normalized += ' ';
+        } else if (c == '?') {
+            return false;
+        } else if (c == '\'' || c == '"') {
+            size_t end = sql.find(c, i + 1);
+            if (end == std::string::npos)
+                return false;
+            if (c == '\'') {
+                parameters.push_back(Value(sql.substr(i + 1, end - i - 1)));
+                normalized += '?';
+            } else {
+                normalized += sql.substr(i, end + 1 - i);  // a quoted identifier
+            }
+            word.clear();
+            i = end + 1;
+        } else if (identifier_char(c) && !std::isdigit((unsigned char) c)) {
+            size_t end = i;
+            while (end < sql.size() && identifier_char(sql[end]))
+                end++;
+            word = sql.substr(i, end - i);
+            std::transform(word.begin(), word.end(), word.begin(), ::toupper);
+            normalized += sql.substr(i, end - i);
+            i = end;
+        } else if (std::isdigit((unsigned char) c) || c == '-') {
+            // a minus is the literal's sign unless it comes after something it could be subtracted from
+            size_t last = normalized.find_last_not_of(' ');
+            bool sign = c == '-' && i + 1 < sql.size() && std::isdigit((unsigned char) sql[i + 1])
+                        && (last == std::string::npos || (!identifier_char(normalized[last])
+                                                          && normalized[last] != ')' && normalized[last] != '?'
+                                                          && normalized[last] != '"'));
+            if (c == '-' && !sign) {
+                normalized += c;
+                word.clear();
+                i++;
+                continue;
+            }
+            size_t end = i + 1;
+            while (end < sql.size() && std::isdigit((unsigned char) sql[end]))
+                end++;
+            bool decimal = end < sql.size() && sql[end] == '.';
+            while (end < sql.size() && (std::isdigit((unsigned char) sql[end]) || sql[end] == '.'))
+                end++;
+            std::string text = sql.substr(i, end - i);
+            bool in_range = !decimal && text.size() <= 11 && std::stoll(text) >= INT32_MIN
+                            && std::stoll(text) <= INT32_MAX;
+            if (word == "LIMIT" || word == "OFFSET" || !in_range) {
+                normalized += text;
+            } else {
+                parameters.push_back(Value((int32_t) std::stoll(text)));
+                normalized += '?';
+            }
+            word.clear();
+            i = end;
+        } else {
+            normalized += c;
+            word.clear();
+            i++;
+        }
+    }
+    while (!normalized.empty() && (normalized.back() == ' ' || normalized.back() == ';'))
+        normalized.pop_back();
+    return true;
+}
+
+PlanCache::~PlanCache() {
+    for (auto& entry : this->entries)
+        delete entry.second.first;
+}
+
+PreparedStatement* PlanCache::take(const std::string& normalized) {
+    std::lock_guard<std::mutex> lock(this->mutex);
+    auto entry = this->entries.find(normalized);
+    if (entry == this->entries.end())
+        return nullptr;
+    PreparedStatement* statement = entry->second.first;
+    this->recent.erase(entry->second.second);
+    this->entries.erase(entry);
+    return statement;
+}
+
+void PlanCache::put(const std::string& normalized, PreparedStatement* statement) {
+    std::lock_guard<std::mutex> lock(this->mutex);
+    auto entry = this->entries.find(normalized);
+    if (entry != this->entries.end()) {
+        delete entry->second.first;
+        entry->second.first = statement;
+        this->recent.splice(this->recent.begin(), this->recent, entry->second.second);
+        return;
+    }
+    this->recent.push_front(normalized);
+    this->entries[normalized] = std::make_pair(statement, this->recent.begin());
+    if (this->entries.size() > CAPACITY) {
+        auto oldest = this->entries.find(this->recent.back());
+        delete oldest->second.first;
+        this->entries.erase(oldest);
+        this->recent.pop_back();
+    }
+}
+
+void PlanCache::invalidate(const Identifier& table_name) {
+    std::lock_guard<std::mutex> lock(this->mutex);
+    for (auto entry = this->entries.begin(); entry != this->entries.end();) {
+        if (entry->second.first->refers_to(table_name)) {
+            delete entry->second.first;
+            this->recent.erase(entry->second.second);
+            entry = this->entries.erase(entry);
+        } else {
+            entry++;
+        }
+    }
+}
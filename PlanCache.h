@@ -0,0 +1,181 @@
+/**
+ * @file PlanCache.h - Prepared statements and the cache of them keyed by normalized SQL.
+ * PreparedStatement
+ * PlanCache
+ *
+ * @author Justin Thoreson
+ * @see "Seattle University, CPSC5300, Winter 2023"
+ */
+
+#pragma once
+
+#include <list>
+#include <map>
+#include <mutex>
+#include <string>
+#include <vector>
+#include "SQLParser.h"
+#include "QueryPlan.h"
+
+/**
+ * @class PreparedStatement - a parsed SELECT, INSERT, or DELETE with a placeholder (?)
+ * for each of its parameters, executed with values bound to them
+ *
+ * Binding writes the values into the placeholders' nodes of the parse tree,
+ * which then reads as if the values had been written into the SQL. The plan
+ * built for the statement is kept with it and used again for as long as the
+ * same values are bound; binding different ones drops it, since the optimizer
+ * may choose differently for them.
+ */
+class PreparedStatement {
+public:
+    /**
+     * Constructor
+     * @param parse  the parse of a single statement (now owned by the prepared statement)
+     */
+    PreparedStatement(hsql::SQLParserResult* parse);
+
+    virtual ~PreparedStatement();
+
+    PreparedStatement(const PreparedStatement& other) = delete;
+
+    PreparedStatement& operator=(const PreparedStatement& other) = delete;
+
+    /**
+     * Bind values to the placeholders.
+     * @param parameters  a value (INT or TEXT) for each placeholder, in the order they appear
+     * @returns           the statement with them bound
+     * @throws            SQLExecError if there are too many or too few
+     */
+    virtual const hsql::SQLStatement* bind(const std::vector<Value>& parameters);
+
+    virtual const hsql::SQLStatement* get_statement() const { return parse->getStatement(0); }
+
+    virtual size_t get_parameter_count() const { return placeholders.size(); }
+
+    /**
+     * Tables the statement reads or changes.
+     */
+    virtual const std::vector<Identifier>& get_table_names() const { return table_names; }
+
+    /**
+     * Does the statement refer to the given table?
+     */
+    virtual bool refers_to(const Identifier& table_name) const;
+
+    /**
+     * The plan kept for the values bound now.
+     * @returns  the plan, or nullptr if there isn't one
+     */
+    virtual PlanOperator* get_plan() const { return plan; }
+
+    virtual const ColumnNames& get_column_names() const { return column_names; }
+
+    virtual const ColumnAttributes& get_column_attributes() const { return column_attributes; }
+
+    /**
+     * Was the kept plan built for a session in an explicit transaction?
+     */
+    virtual bool is_planned_in_transaction() const { return planned_in_transaction; }
+
+    /**
+     * Keep the plan built for the values bound now.
+     * @param plan               the plan (now owned by the prepared statement)
+     * @param column_names       the result's columns
+     * @param column_attributes  their attributes
+     * @param in_transaction     true if it was built for a session in an explicit transaction
+     */
+    virtual void set_plan(PlanOperator* plan, const ColumnNames& column_names,
+                          const ColumnAttributes& column_attributes, bool in_transaction = false);
+
+    /**
+     * Drop the kept plan (e.g., when a table it reads is changed by DDL).
+     */
+    virtual void forget_plan();
+
+protected:
+    hsql::SQLParserResult* parse;
+    std::vector<hsql::Expr*> placeholders;  // in the order they appear in the SQL
+    std::vector<Value> parameters;          // bound now (their strings are the placeholders' names)
+    bool bound;
+    std::vector<Identifier> table_names;
+    PlanOperator* plan;
+    ColumnNames column_names;
+    ColumnAttributes column_attributes;
+    bool planned_in_transaction;
+};
+
+
+/**
+ * @class PlanCache - prepared statements for the SQL seen lately, keyed by its normalized text
+ *
+ * Statements that differ only in their literals (and spacing) normalize to the
+ * same text, so they share an entry: the parse is done once, and each later
+ * statement just binds its own literals. At most CAPACITY entries are kept,
+ * dropping the least recently used.
+ *
+ * The cache is shared by every session. A statement is taken out of it while
+ * it runs, since binding it and running its kept plan change it; another
+ * session running the same SQL meanwhile parses its own.
+ */
+class PlanCache {
+public:
+    /**
+     * Most statements kept
+     */
+    static const size_t CAPACITY = 128;
+
+    /**
+     * Replace the integer and string literals in SQL with placeholders (?), and
+     * collapse its spacing. LIMIT and OFFSET counts are left as they are, as are
+     * integers out of the range of an INT (so that the parser reports them) and
+     * numbers with a decimal point.
+     * @param sql         the SQL
+     * @param normalized  returned by reference: the SQL with placeholders
+     * @param parameters  returned by reference: the literals replaced, in order
+     * @returns           false if the SQL can't be normalized (it already has a
+     *                    placeholder, or a string literal isn't closed)
+     */
+    static bool normalize(const std::string& sql, std::string& normalized, std::vector<Value>& parameters);
+
+    PlanCache() : entries(), recent(), mutex() {}
+
+    virtual ~PlanCache();
+
+    PlanCache(const PlanCache& other) = delete;
+
+    PlanCache& operator=(const PlanCache& other) = delete;
+
+    /**
+     * Take the statement for some normalized SQL out of the cache.
+     * @param normalized  the normalized SQL
+     * @returns           the statement (now owned by the caller, until it is put back), or nullptr if it isn't cached
+     */
+    virtual PreparedStatement* take(const std::string& normalized);
+
+    /**
+     * Add (or put back) the statement for some normalized SQL, replacing any
+     * other statement for it, and dropping the least recently used if the cache is full.
+     * @param normalized  the normalized SQL
+     * @param statement   its prepared statement (now owned by the cache)
+     */
+    virtual void put(const std::string& normalized, PreparedStatement* statement);
+
+    /**
+     * Drop every statement that refers to a table.
+     * @param table_name  the table
+     */
+    virtual void invalidate(const Identifier& table_name);
+
+    virtual size_t size() const {
+        std::lock_guard<std::mutex> lock(this->mutex);
+        return entries.size();
+    }
+
+protected:
+    using Recent = std::list<std::string>;  // normalized SQL, most recently used first
+
+    std::map<std::string, std::pair<PreparedStatement*, Recent::iterator>> entries;
+    Recent recent;
+    mutable std::mutex mutex;
+};
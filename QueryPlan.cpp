@@ -0,0 +1,382 @@
+/**
+ * @file QueryPlan.cpp
+ * @author Justin Thoreson
+ * @see Seattle University, CPSC5300
+ */
+
+#include <algorithm>
+#include <cstdio>
+#include "QueryPlan.h"
+#include "HeapTable.h"
+#include "Kernels.h"
+
+RowBatch::~RowBatch() {
+    this->clear();
+}
+
+void RowBatch::add(Handle handle, ValueDict* row) {
+    this->handles.push_back(handle);
+    this->rows.push_back(row);
+}
+
+void RowBatch::clear() {
+    for (ValueDict* row: this->rows)
+        delete row;
+    this->handles.clear();
+    this->rows.clear();
+}
+
+void RowBatch::retain(const std::vector<bool>& keep) {
+    size_t kept = 0;
+    for (size_t i = 0; i < this->rows.size(); i++) {
+        if (keep[i]) {
+            this->handles[kept] = this->handles[i];
+            this->rows[kept++] = this->rows[i];
+        } else {
+            delete this->rows[i];
+        }
+    }
+    this->handles.resize(kept);
+    this->rows.resize(kept);
+}
+
+void RowBatch::slice(size_t begin, size_t end) {
+    end = std::min(end, this->rows.size());
+    begin = std::min(begin, end);
+    std::vector<bool> keep(this->rows.size(), false);
+    for (size_t i = begin; i < end; i++)
+        keep[i] = true;
+    this->retain(keep);
+}
+
+void RowBatch::move_rows(ValueDicts& rows) {
+    rows.insert(rows.end(), this->rows.begin(), this->rows.end());
+    this->handles.clear();
+    this->rows.clear();
+}
+
+// INT and BOOLEAN compare by number, TEXT by characters.
+bool Comparison::matches(const ValueDict* row) const {
+    const Value& left = row->at(this->column_name);
+    const Value& right = this->is_literal() ? this->value : row->at(this->other_column_name);
+    int cmp;
+    if (left.data_type == ColumnAttribute::TEXT)
+        cmp = left.s.compare(right.s);
+    else
+        cmp = left.n < right.n ? -1 : (left.n > right.n ? 1 : 0);
+    switch (this->op) {
+        case EQ:
+            return cmp == 0;
+        case NE:
+            return cmp != 0;
+        case LT:
+            return cmp < 0;
+        case LE:
+            return cmp <= 0;
+        case GT:
+            return cmp > 0;
+        case GE:
+            return cmp >= 0;
+        default:
+            return false;
+    }
+}
+
+// Value as a SQL literal.
+static std::string literal_string(const Value& value) {
+    if (value.data_type == ColumnAttribute::TEXT)
+        return "\"" + value.s + "\"";
+    if (value.data_type == ColumnAttribute::BOOLEAN)
+        return value.n ? "true" : "false";
+    return std::to_string(value.n);
+}
+
+// Equality predicates as "a = 1 AND b = 2".
+static std::string where_string(const ValueDict& where) {
+    std::string ret;
+    for (auto const& column: where)
+        ret += (ret.empty() ? "" : " AND ") + column.first + " = " + literal_string(column.second);
+    return ret;
+}
+
+// Leading spaces for an explain line at depth.
+static std::string indent(uint depth) {
+    return std::string(2 * depth, ' ');
+}
+
+std::string Comparison::to_string() const {
+    static const char* const ops[] = {"=", "<>", "<", "<=", ">", ">="};
+    return this->column_name + " " + ops[this->op] + " "
+           + (this->is_literal() ? literal_string(this->value) : this->other_column_name);
+}
+
+HandleScan::~HandleScan() {
+    delete this->handles;
+}
+
+void HandleScan::open() {
+    this->close();
+    this->produced = 0;
+    this->handles = this->get_handles();
+    this->position = 0;
+}
+
+bool HandleScan::next(RowBatch& batch) {
+    batch.clear();
+    while (batch.size() < RowBatch::CAPACITY && this->produced < this->limit) {
+        if (this->position == this->handles->size()) {
+            Handles* more = this->get_more_handles(std::min(RowBatch::CAPACITY - batch.size(),
+                                                            this->limit - this->produced));
+            if (more == nullptr)
+                break;
+            delete this->handles;
+            this->handles = more;
+            this->position = 0;
+            continue;
+        }
+        Handle handle = (*this->handles)[this->position++];
+        batch.add(handle, this->relation.project(handle, &this->column_names));
+        this->produced++;
+    }
+    return !batch.empty();
+}
+
+void HandleScan::close() {
+    delete this->handles;
+    this->handles = nullptr;
+}
+
+std::string HandleScan::explain_line(uint depth, std::string description) const {
+    std::string ret = indent(depth) + description;
+    if (this->limit != SIZE_MAX)
+        ret += " LIMIT " + std::to_string(this->limit);
+    if (this->estimated_pages >= 0) {
+        char estimates[80];
+        std::snprintf(estimates, sizeof(estimates), "  (cost=%.1f pages, rows=%.1f)", this->estimated_pages,
+                      this->estimated_rows);
+        ret += estimates;
+    }
+    return ret + "\n";
+}
+
+TableScan::~TableScan() {
+    this->clear_block();
+}
+
+void TableScan::open() {
+    HandleScan::open();
+    this->clear_block();
+    HeapTable* table = this->get_table();
+    this->last_block = table != nullptr ? table->get_block_count() : 0;
+}
+
+// Passes on the rows of the current block, reading the next block as they run out.
+bool TableScan::next(RowBatch& batch) {
+    HeapTable* table = this->get_table();
+    if (table == nullptr)
+        return HandleScan::next(batch);
+    batch.clear();
+    const ValueDict* where = this->where.empty() ? nullptr : &this->where;
+    const IntRanges* ranges = this->ranges.empty() ? nullptr : &this->ranges;
+    while (batch.size() < RowBatch::CAPACITY && this->produced < this->limit) {
+        if (this->block_position == this->block_rows.size()) {
+            if (this->block_batches && !batch.empty())
+                break;  // the rows of one block at a time
+            this->clear_block();
+            BlockID block_id;
+            if (!this->take_block(block_id))
+                break;
+            table->scan_block(block_id, where, ranges, &this->column_names, this->block_handles, this->block_rows);
+            continue;
+        }
+        batch.add(this->block_handles[this->block_position], this->block_rows[this->block_position]);
+        this->block_rows[this->block_position++] = nullptr;
+        this->produced++;
+    }
+    return !batch.empty();
+}
+
+void TableScan::close() {
+    this->clear_block();
+    HandleScan::close();
+}
+
+HeapTable* TableScan::get_table() {
+    return dynamic_cast<HeapTable*>(&this->relation);
+}
+
+bool TableScan::take_block(BlockID& block_id) {
+    if (this->next_block == 0 || this->next_block > this->last_block) {
+        this->next_block = 0;
+        return false;
+    }
+    block_id = this->next_block++;
+    return true;
+}
+
+void TableScan::clear_block() {
+    for (ValueDict* row: this->block_rows)
+        delete row;
+    this->block_handles.clear();
+    this->block_rows.clear();
+    this->block_position = 0;
+}
+
+std::string TableScan::explain(uint depth) const {
+    return this->explain_line(depth, this->describe("TableScan"));
+}
+
+std::string TableScan::describe(const std::string& name) const {
+    std::string description = name + " " + this->relation.get_table_name();
+    std::string conditions = where_string(this->where);
+    for (auto const& range: this->ranges)
+        conditions += (conditions.empty() ? "" : " AND ") + range.first + " BETWEEN "
+                      + std::to_string(range.second.first) + " AND " + std::to_string(range.second.second);
+    if (!conditions.empty())
+        description += " WHERE " + conditions;
+    return description;
+}
+
+// Nothing is read until the first batch is asked for.
+Handles* TableScan::get_handles() {
+    this->next_block = 1;
+    return new Handles();
+}
+
+Handles* TableScan::get_more_handles(size_t wanted) {
+    if (this->next_block == 0)
+        return nullptr;
+    // an empty where would select nothing, so pass nullptr for "no predicates"
+    return this->relation.select(this->where.empty() ? nullptr : &this->where,
+                                 this->ranges.empty() ? nullptr : &this->ranges, wanted, this->next_block);
+}
+
+std::string IndexLookup::explain(uint depth) const {
+    return this->explain_line(depth, "IndexLookup " + this->relation.get_table_name() + "." + this->index.get_name()
+                                     + " WHERE " + where_string(this->key));
+}
+
+Handles* IndexLookup::get_handles() {
+    Handles* handles = this->index.lookup(&this->key);
+    if (handles->size() > this->limit)
+        handles->resize(this->limit);
+    return handles;
+}
+
+std::string IndexRange::explain(uint depth) const {
+    std::string description = "IndexRange " + this->relation.get_table_name() + "." + this->index.get_name();
+    if (!this->min_key.empty())
+        description += " FROM (" + where_string(this->min_key) + ")";
+    if (!this->max_key.empty())
+        description += " TO (" + where_string(this->max_key) + ")";
+    return this->explain_line(depth, description);
+}
+
+Handles* IndexRange::get_handles() {
+    ValueDict* min_key = this->min_key.empty() ? nullptr : &this->min_key;
+    ValueDict* max_key = this->max_key.empty() ? nullptr : &this->max_key;
+    return this->index.range(min_key, max_key, this->limit);
+}
+
+Filter::Filter(PlanOperator* child, Predicate predicate)
+    : PlanOperator(), child(child), predicate(predicate), kernels(Kernel::compile(predicate)), selected(),
+      limit(SIZE_MAX), produced(0) {
+}
+
+Filter::~Filter() {
+    for (Kernel* kernel: this->kernels)
+        delete kernel;
+    delete this->child;
+}
+
+void Filter::open() {
+    this->child->open();
+    this->produced = 0;
+}
+
+bool Filter::next(RowBatch& batch) {
+    batch.clear();
+    while (this->produced < this->limit && this->child->next(batch)) {
+        this->selected.assign(batch.size(), 1);
+        for (Kernel* kernel: this->kernels)
+            kernel->apply(batch, this->selected);
+        batch.retain(std::vector<bool>(this->selected.begin(), this->selected.end()));
+        if (batch.size() > this->limit - this->produced)
+            batch.slice(0, this->limit - this->produced);
+        this->produced += batch.size();
+        if (!batch.empty())
+            return true;
+    }
+    batch.clear();
+    return false;
+}
+
+std::string Filter::explain(uint depth) const {
+    std::string conditions;
+    for (const Comparison& comparison: this->predicate)
+        conditions += (conditions.empty() ? "" : " AND ") + comparison.to_string();
+    std::string ret = indent(depth) + "Filter " + conditions;
+    if (this->limit != SIZE_MAX)
+        ret += " LIMIT " + std::to_string(this->limit);
+    return ret + "\n" + this->child->explain(depth + 1);
+}
+
+std::string Project::explain(uint depth) const {
+    std::string columns;
+    for (size_t i = 0; i < this->column_names.size(); i++) {
+        columns += (columns.empty() ? "" : ", ") + this->column_names[i];
+        if (!this->new_names.empty())
+            columns += " AS " + this->new_names[i];
+    }
+    return indent(depth) + "Project " + columns + "\n" + this->child->explain(depth + 1);
+}
+
+bool Project::next(RowBatch& batch) {
+    if (!this->child->next(batch))
+        return false;
+    for (size_t i = 0; i < batch.size(); i++) {
+        ValueDict* row = batch.get_row(i);
+        if (!this->new_names.empty()) {
+            ValueDict renamed;
+            for (size_t j = 0; j < this->column_names.size(); j++)
+                renamed[this->new_names[j]] = row->at(this->column_names[j]);
+            row->swap(renamed);
+            continue;
+        }
+        // move the kept values over, one lookup each, rather than searching the kept names for every column
+        ValueDict kept;
+        for (const Identifier& column_name: this->column_names) {
+            ValueDict::iterator column = row->find(column_name);
+            if (column != row->end())
+                kept.emplace(column_name, std::move(column->second));
+        }
+        row->swap(kept);
+    }
+    return true;
+}
+
+std::string Limit::explain(uint depth) const {
+    std::string ret = indent(depth) + "Limit " + (this->limit == SIZE_MAX ? "ALL" : std::to_string(this->limit));
+    if (this->offset > 0)
+        ret += " OFFSET " + std::to_string(this->offset);
+    return ret + "\n" + this->child->explain(depth + 1);
+}
+
+void Limit::open() {
+    this->child->open();
+    this->seen = 0;
+}
+
+bool Limit::next(RowBatch& batch) {
+    batch.clear();
+    while (this->seen < this->offset + this->limit && this->child->next(batch)) {
+        size_t first = this->seen;
+        this->seen += batch.size();
+        if (this->seen <= this->offset)
+            continue;  // all still in the offset
+        batch.slice(first < this->offset ? this->offset - first : 0, this->offset + this->limit - first);
+        return true;
+    }
+    batch.clear();
+    return false;
+}
@@ -0,0 +1,540 @@
+/**
+ * @file QueryPlan.h - Physical query plan operators (Volcano-style iterators).
+ * RowBatch
+ * Comparison
+ * PlanOperator
+ * HandleScan: PlanOperator
+ * TableScan: HandleScan
+ * IndexLookup: HandleScan
+ * IndexRange: HandleScan
+ * Filter: PlanOperator
+ * Project: PlanOperator
+ * Limit: PlanOperator
+ *
+ * @author Justin Thoreson
+ * @see "Seattle University, CPSC5300, Winter 2023"
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "storage_engine.h"
+
+class HeapTable;
+
+/**
+ * @class RowBatch - a batch of rows passed from one plan operator to the next
+ *
+ * Holds up to CAPACITY rows along with the handles they were read from. The
+ * batch owns its rows and frees them when cleared, unless they are moved out.
+ */
+class RowBatch {
+public:
+    /**
+     * Most rows a scan puts in one batch
+     */
+    static const uint CAPACITY = 256;
+
+    RowBatch() : handles(), rows() {}
+
+    virtual ~RowBatch();
+
+    RowBatch(const RowBatch& other) = delete;
+
+    RowBatch(RowBatch&& temp) = delete;
+
+    RowBatch& operator=(const RowBatch& other) = delete;
+
+    RowBatch& operator=(RowBatch&& temp) = delete;
+
+    /**
+     * Add a row to the batch.
+     * @param handle  where the row came from
+     * @param row     the row (now owned by the batch)
+     */
+    virtual void add(Handle handle, ValueDict* row);
+
+    /**
+     * Free all the rows and empty the batch.
+     */
+    virtual void clear();
+
+    /**
+     * Keep only the rows flagged in keep (freeing the others).
+     * @param keep  one flag per row
+     */
+    virtual void retain(const std::vector<bool>& keep);
+
+    /**
+     * Keep only the rows in [begin, end) (freeing the others).
+     */
+    virtual void slice(size_t begin, size_t end);
+
+    /**
+     * Move all the rows onto the end of rows (caller now owns them) and empty the batch.
+     * @param rows  where to put the rows
+     */
+    virtual void move_rows(ValueDicts& rows);
+
+    virtual size_t size() const { return rows.size(); }
+
+    virtual bool empty() const { return rows.empty(); }
+
+    virtual Handle get_handle(size_t i) const { return handles[i]; }
+
+    virtual ValueDict* get_row(size_t i) const { return rows[i]; }
+
+protected:
+    Handles handles;
+    ValueDicts rows;
+};
+
+
+/**
+ * @class Comparison - a single <column> <op> <literal or column> predicate on a row
+ */
+class Comparison {
+public:
+    enum Op {
+        EQ,
+        NE,
+        LT,
+        LE,
+        GT,
+        GE
+    };
+
+    /**
+     * Compare a column to a literal value.
+     */
+    Comparison(Identifier column_name, Op op, Value value)
+        : column_name(column_name), op(op), value(value), other_column_name() {}
+
+    /**
+     * Compare a column to another column of the same row (of the same data type,
+     * which is kept as the data type of value).
+     */
+    Comparison(Identifier column_name, Op op, Identifier other_column_name,
+               ColumnAttribute::DataType data_type = ColumnAttribute::INT)
+        : column_name(column_name), op(op), value(), other_column_name(other_column_name) {
+        value.data_type = data_type;
+    }
+
+    virtual ~Comparison() {}
+
+    /**
+     * Check the comparison against a row.
+     * @param row  the row (must have the compared columns)
+     * @returns    true if the row satisfies the comparison
+     */
+    virtual bool matches(const ValueDict* row) const;
+
+    /**
+     * Is the right-hand side a literal (rather than another column)?
+     */
+    virtual bool is_literal() const { return other_column_name.empty(); }
+
+    /**
+     * The comparison as SQL, e.g. "a >= 5".
+     */
+    virtual std::string to_string() const;
+
+    Identifier column_name;
+    Op op;
+    Value value;
+    Identifier other_column_name;
+};
+
+/**
+ * A conjunction of comparisons (all must match)
+ */
+using Predicate = std::vector<Comparison>;
+
+
+/**
+ * @class PlanOperator - abstract base class for the operators of a query plan
+ *
+ * Each operator is an iterator over its result rows: open() it, call next()
+ * until it returns false, then close() it. Rows are handed over a batch at a
+ * time, so no operator needs to hold the whole result. Operators own their
+ * child operators.
+ */
+class PlanOperator {
+public:
+    PlanOperator() {}
+
+    virtual ~PlanOperator() {}
+
+    PlanOperator(const PlanOperator& other) = delete;
+
+    PlanOperator(PlanOperator&& temp) = delete;
+
+    PlanOperator& operator=(const PlanOperator& other) = delete;
+
+    PlanOperator& operator=(PlanOperator&& temp) = delete;
+
+    /**
+     * Get ready to produce rows (from the start).
+     */
+    virtual void open() = 0;
+
+    /**
+     * Produce the next batch of rows.
+     * @param batch  emptied and then filled with the next rows
+     * @returns      false (with an empty batch) once there are no more rows
+     */
+    virtual bool next(RowBatch& batch) = 0;
+
+    /**
+     * Release whatever open() acquired.
+     */
+    virtual void close() = 0;
+
+    /**
+     * Describe the plan rooted here, one operator per line, children indented.
+     * @param depth  how far down the plan this operator is
+     * @returns      the description
+     */
+    virtual std::string explain(uint depth = 0) const = 0;
+};
+
+
+/**
+ * @class HandleScan - abstract base class for the leaves of a plan
+ *
+ * Gets the handles of the qualifying rows from the storage engine and reads
+ * the rows themselves a batch at a time. A scan given a limit stops (and asks
+ * the storage engine for no more handles) once it has produced that many rows.
+ */
+class HandleScan : public PlanOperator {
+public:
+    /**
+     * Constructor
+     * @param relation      the table to read
+     * @param column_names  the columns to read (all if empty)
+     */
+    HandleScan(DbRelation& relation, ColumnNames column_names)
+        : PlanOperator(), relation(relation), column_names(column_names), handles(nullptr), position(0),
+          limit(SIZE_MAX), produced(0), estimated_pages(-1), estimated_rows(-1) {}
+
+    virtual ~HandleScan();
+
+    virtual void open();
+
+    virtual bool next(RowBatch& batch);
+
+    virtual void close();
+
+    /**
+     * Record the optimizer's estimates for this scan (shown by explain).
+     * @param pages  blocks expected to be read
+     * @param rows   rows expected to be produced
+     */
+    virtual void set_estimate(double pages, double rows) {
+        estimated_pages = pages;
+        estimated_rows = rows;
+    }
+
+    /**
+     * The optimizer's estimate of the rows this scan produces (negative if unknown).
+     */
+    virtual double get_estimated_rows() const { return estimated_rows; }
+
+    /**
+     * Stop after producing limit rows (e.g., for a LIMIT with nothing between it and the scan).
+     * @param limit  most rows to produce
+     */
+    virtual void set_limit(size_t limit) { this->limit = limit; }
+
+    virtual size_t get_limit() const { return limit; }
+
+    virtual DbRelation& get_relation() const { return relation; }
+
+    virtual const ColumnNames& get_column_names() const { return column_names; }
+
+protected:
+    DbRelation& relation;
+    ColumnNames column_names;
+    Handles* handles;
+    size_t position;
+    size_t limit;
+    size_t produced;
+    double estimated_pages;
+    double estimated_rows;
+
+    /**
+     * Get the handles of the rows to read first, on open() (freed by caller).
+     */
+    virtual Handles* get_handles() = 0;
+
+    /**
+     * Get the handles of the rows to read next, once those got before have all been read.
+     * @param wanted  rows still wanted (there may be more or fewer)
+     * @returns       the handles (freed by caller), or nullptr if there are no more
+     */
+    virtual Handles* get_more_handles(size_t wanted) { return nullptr; }
+
+    /**
+     * One line for explain: the description followed by the estimates, if any.
+     */
+    virtual std::string explain_line(uint depth, std::string description) const;
+};
+
+
+/**
+ * @class TableScan - read the rows of a table matching pushed-down predicates
+ *
+ * The equality predicates and INT ranges are passed to the storage engine so
+ * that it can skip blocks using its block summaries. The table is read a
+ * block at a time, only as far as the rows asked for so far, so a plan that
+ * stops early (as under a LIMIT) doesn't read the rest. Each block of a heap
+ * table is read and decoded once (see HeapTable::scan_block); other relations
+ * are read through DbRelation::select and project.
+ */
+class TableScan : public HandleScan {
+public:
+    /**
+     * Constructor
+     * @param relation      the table to read
+     * @param column_names  the columns to read (all if empty)
+     * @param where         equality predicates to push down
+     * @param ranges        INT ranges to push down
+     */
+    TableScan(DbRelation& relation, ColumnNames column_names, ValueDict where = ValueDict(),
+              IntRanges ranges = IntRanges())
+        : HandleScan(relation, column_names), where(where), ranges(ranges), next_block(0), last_block(0),
+          block_handles(), block_rows(), block_position(0), block_batches(false) {}
+
+    virtual ~TableScan();
+
+    virtual void open();
+
+    virtual bool next(RowBatch& batch);
+
+    virtual void close();
+
+    virtual std::string explain(uint depth = 0) const;
+
+    virtual const ValueDict& get_where() const { return where; }
+
+    virtual const IntRanges& get_ranges() const { return ranges; }
+
+    /**
+     * Pass on at most one block's rows in each batch, so that an operator
+     * above that stops early (as a Filter with a limit) has the scan read no
+     * block beyond the one where it stopped.
+     * @param block_batches  whether to end each batch at the end of a block
+     */
+    virtual void set_block_batches(bool block_batches) { this->block_batches = block_batches; }
+
+protected:
+    ValueDict where;
+    IntRanges ranges;
+    BlockID next_block;  // where to carry on reading from (0 once the table has all been read)
+    BlockID last_block;
+    Handles block_handles;  // the rows of the block being passed on
+    ValueDicts block_rows;
+    size_t block_position;
+    bool block_batches;
+
+    virtual Handles* get_handles();
+
+    virtual Handles* get_more_handles(size_t wanted);
+
+    /**
+     * The heap table whose blocks are decoded by the scan.
+     * @returns  the table, or nullptr if the relation isn't one (and is read a row at a time)
+     */
+    virtual HeapTable* get_table();
+
+    /**
+     * Pick the next block to read.
+     * @param block_id  returned by reference: the block
+     * @returns         false once there are no more
+     */
+    virtual bool take_block(BlockID& block_id);
+
+    /**
+     * Free the rows read but not yet passed on.
+     */
+    virtual void clear_block();
+
+    /**
+     * The scan for explain, e.g. "TableScan t WHERE a = 5".
+     * @param name  what to call the scan
+     */
+    virtual std::string describe(const std::string& name) const;
+};
+
+
+/**
+ * @class IndexLookup - read the rows of a table with a given search key
+ */
+class IndexLookup : public HandleScan {
+public:
+    /**
+     * Constructor
+     * @param relation      the table to read
+     * @param index         the index to look the key up in
+     * @param column_names  the columns to read (all if empty)
+     * @param key           value for each of the index's key columns
+     */
+    IndexLookup(DbRelation& relation, DbIndex& index, ColumnNames column_names, ValueDict key)
+        : HandleScan(relation, column_names), index(index), key(key) {}
+
+    virtual ~IndexLookup() {}
+
+    virtual std::string explain(uint depth = 0) const;
+
+protected:
+    DbIndex& index;
+    ValueDict key;
+
+    virtual Handles* get_handles();
+};
+
+
+/**
+ * @class IndexRange - read the rows of a table with search keys in a range
+ *
+ * The bounds may give fewer columns than the key: they then match every key
+ * starting with them (as DbIndex::range does).
+ */
+class IndexRange : public HandleScan {
+public:
+    /**
+     * Constructor
+     * @param relation      the table to read
+     * @param index         the index to scan
+     * @param column_names  the columns to read (all if empty)
+     * @param min_key       inclusive lower bound on leading key columns (none if empty)
+     * @param max_key       inclusive upper bound on leading key columns (none if empty)
+     */
+    IndexRange(DbRelation& relation, DbIndex& index, ColumnNames column_names, ValueDict min_key, ValueDict max_key)
+        : HandleScan(relation, column_names), index(index), min_key(min_key), max_key(max_key) {}
+
+    virtual ~IndexRange() {}
+
+    virtual std::string explain(uint depth = 0) const;
+
+protected:
+    DbIndex& index;
+    ValueDict min_key;
+    ValueDict max_key;
+
+    virtual Handles* get_handles();
+};
+
+
+class Kernel;
+
+/**
+ * @class Filter - pass on only the rows matching a predicate
+ *
+ * The predicate is compiled into Kernels, specialized on each comparison's
+ * data type and operator, which are run over each batch one after another.
+ * A filter given a limit stops (and asks its child for no more rows) once it
+ * has passed on that many.
+ */
+class Filter : public PlanOperator {
+public:
+    /**
+     * Constructor
+     * @param child      operator producing the rows to filter (now owned by the filter)
+     * @param predicate  comparisons the rows must all match
+     */
+    Filter(PlanOperator* child, Predicate predicate);
+
+    virtual ~Filter();
+
+    virtual void open();
+
+    virtual bool next(RowBatch& batch);
+
+    virtual void close() { child->close(); }
+
+    virtual std::string explain(uint depth = 0) const;
+
+    /**
+     * Stop after passing on limit rows (e.g., for a LIMIT with nothing between it and the filter).
+     * @param limit  most rows to pass on
+     */
+    virtual void set_limit(size_t limit) { this->limit = limit; }
+
+    virtual size_t get_limit() const { return limit; }
+
+protected:
+    PlanOperator* child;
+    Predicate predicate;
+    std::vector<Kernel*> kernels;
+    std::vector<uint8_t> selected;
+    size_t limit;
+    size_t produced;
+};
+
+
+/**
+ * @class Project - narrow the rows down to the given columns, optionally renaming them
+ */
+class Project : public PlanOperator {
+public:
+    /**
+     * Constructor
+     * @param child         operator producing the rows (now owned by the projection)
+     * @param column_names  columns to keep
+     * @param new_names     what to call each of the kept columns (unchanged if empty)
+     */
+    Project(PlanOperator* child, ColumnNames column_names, ColumnNames new_names = ColumnNames())
+        : PlanOperator(), child(child), column_names(column_names), new_names(new_names) {}
+
+    virtual ~Project() { delete child; }
+
+    virtual void open() { child->open(); }
+
+    virtual bool next(RowBatch& batch);
+
+    virtual void close() { child->close(); }
+
+    virtual std::string explain(uint depth = 0) const;
+
+protected:
+    PlanOperator* child;
+    ColumnNames column_names;
+    ColumnNames new_names;
+};
+
+
+/**
+ * @class Limit - pass on at most limit rows, after skipping offset rows
+ *
+ * Stops pulling from its child once it has passed on limit rows.
+ */
+class Limit : public PlanOperator {
+public:
+    /**
+     * Constructor
+     * @param child   operator producing the rows (now owned by the limit)
+     * @param limit   most rows to pass on
+     * @param offset  number of rows to skip first
+     */
+    Limit(PlanOperator* child, size_t limit, size_t offset = 0)
+        : PlanOperator(), child(child), limit(limit), offset(offset), seen(0) {}
+
+    virtual ~Limit() { delete child; }
+
+    virtual void open();
+
+    virtual bool next(RowBatch& batch);
+
+    virtual void close() { child->close(); }
+
+    virtual std::string explain(uint depth = 0) const;
+
+protected:
+    PlanOperator* child;
+    size_t limit;
+    size_t offset;
+    size_t seen;
+};
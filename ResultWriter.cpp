@@ -0,0 +1,301 @@
+/**
+ * @file ResultWriter.cpp - implementation of the result writers
+ * @author Justin Thoreson
+ * @see "Seattle University, CPSC5300, Winter 2023"
+ */
+
+#include <algorithm>
+#include <cctype>
+#include "ResultWriter.h"
+
+ResultWriter* ResultWriter::create(Format format, std::ostream& out) {
+    switch (format) {
+        case CSV:
+            return new CsvWriter(out);
+        case JSON_LINES:
+            return new JsonLinesWriter(out);
+        case BINARY:
+            return new BinaryWriter(out);
+        default:
+            return new TableWriter(out);
+    }
+}
+
+bool ResultWriter::get_format(std::string name, Format& format) {
+    std::transform(name.begin(), name.end(), name.begin(), ::tolower);
+    if (name == "table")
+        format = TABLE;
+    else if (name == "csv")
+        format = CSV;
+    else if (name == "json" || name == "jsonl")
+        format = JSON_LINES;
+    else if (name == "binary")
+        format = BINARY;
+    else
+        return false;
+    return true;
+}
+
+// The rows already in memory go first, then whatever is left in the cursor. The
+// ordinals are worked out again only if a row has different columns from the last.
+void ResultWriter::write(QueryResult& result) {
+    const ColumnNames* column_names = result.get_column_names();
+    if (column_names != nullptr) {
+        const ColumnAttributes* column_attributes = result.get_column_attributes();
+        this->begin(*column_names, column_attributes != nullptr ? *column_attributes
+                                                                : ColumnAttributes(column_names->size()));
+        this->ordinals.clear();
+        std::vector<const Value*> row(column_names->size());
+        size_t width = 0;  // columns in the row the ordinals were worked out for
+        auto write_row = [&](const ValueDict* dict) {
+            this->values.clear();
+            for (auto const& column: *dict)
+                this->values.push_back(&column.second);
+            if (this->ordinals.empty() || this->values.size() != width) {
+                width = this->values.size();
+                this->ordinals.clear();
+                for (const Identifier& column_name: *column_names) {
+                    auto found = dict->find(column_name);
+                    if (found == dict->end())
+                        throw SQLExecError("result row has no column " + column_name);
+                    this->ordinals.push_back(std::distance(dict->begin(), found));
+                }
+            }
+            for (size_t i = 0; i < row.size(); i++)
+                row[i] = this->values[this->ordinals[i]];
+            this->row(row);
+        };
+        if (result.rows != nullptr)
+            for (const ValueDict* dict: *result.rows)
+                write_row(dict);
+        RowBatch batch;
+        try {
+            while (result.next(batch))
+                for (size_t i = 0; i < batch.size(); i++)
+                    write_row(batch.get_row(i));
+        } catch (...) {
+            this->drain();
+            throw;
+        }
+    }
+    this->end(result.get_message(), column_names != nullptr);
+    this->drain();
+}
+
+void ResultWriter::drain() {
+    this->out.write(this->buffer.data(), this->buffer.size());
+    this->buffer.clear();
+}
+
+void ResultWriter::append_int(int32_t n) {
+    char digits[12];
+    char* end = digits + sizeof(digits);
+    char* p = end;
+    uint32_t magnitude = n < 0 ? 0U - (uint32_t) n : (uint32_t) n;
+    do {
+        *--p = (char) ('0' + magnitude % 10);
+        magnitude /= 10;
+    } while (magnitude != 0);
+    if (n < 0)
+        *--p = '-';
+    this->append(p, end - p);
+}
+
+void TableWriter::begin(const ColumnNames& column_names, const ColumnAttributes& column_attributes) {
+    for (const Identifier& column_name: column_names) {
+        this->append(column_name);
+        this->append(' ');
+    }
+    this->append("\n+", 2);
+    for (size_t i = 0; i < column_names.size(); i++)
+        this->append("----------+", 11);
+    this->append('\n');
+}
+
+void TableWriter::row(const std::vector<const Value*>& row) {
+    for (const Value* value: row) {
+        switch (value->data_type) {
+            case ColumnAttribute::INT:
+                this->append_int(value->n);
+                break;
+            case ColumnAttribute::TEXT:
+                this->append('"');
+                this->append(value->s);
+                this->append('"');
+                break;
+            case ColumnAttribute::BOOLEAN:
+                if (value->n == 0)
+                    this->append("false", 5);
+                else
+                    this->append("true", 4);
+                break;
+            default:
+                this->append("???", 3);
+        }
+        this->append(' ');
+    }
+    this->append('\n');
+}
+
+void TableWriter::end(const std::string& message, bool has_columns) {
+    this->append(message);
+    if (this->end_line)
+        this->append('\n');
+}
+
+void CsvWriter::begin(const ColumnNames& column_names, const ColumnAttributes& column_attributes) {
+    for (size_t i = 0; i < column_names.size(); i++) {
+        if (i > 0)
+            this->append(',');
+        this->append_field(column_names[i]);
+    }
+    this->append("\r\n", 2);
+}
+
+void CsvWriter::row(const std::vector<const Value*>& row) {
+    for (size_t i = 0; i < row.size(); i++) {
+        if (i > 0)
+            this->append(',');
+        const Value* value = row[i];
+        if (value->data_type == ColumnAttribute::TEXT)
+            this->append_field(value->s);
+        else if (value->data_type == ColumnAttribute::BOOLEAN)
+            this->append(value->n == 0 ? "false" : "true");
+        else
+            this->append_int(value->n);
+    }
+    this->append("\r\n", 2);
+}
+
+void CsvWriter::end(const std::string& message, bool has_columns) {
+    if (!has_columns) {
+        this->append(message);
+        this->append('\n');
+    }
+}
+
+// Quoted (with its quotes doubled) only if it has a comma, quote, or line break.
+void CsvWriter::append_field(const std::string& s) {
+    if (s.find_first_of(",\"\r\n") == std::string::npos) {
+        this->append(s);
+        return;
+    }
+    this->append('"');
+    for (char c: s) {
+        if (c == '"')
+            this->append('"');
+        this->append(c);
+    }
+    this->append('"');
+}
+
+// Add s to json as a string literal.
+static void json_string(const std::string& s, std::string& json) {
+    static const char* const hex = "0123456789abcdef";
+    json += '"';
+    for (char c: s) {
+        switch (c) {
+            case '"':
+                json += "\\\"";
+                break;
+            case '\\':
+                json += "\\\\";
+                break;
+            case '\n':
+                json += "\\n";
+                break;
+            case '\r':
+                json += "\\r";
+                break;
+            case '\t':
+                json += "\\t";
+                break;
+            default:
+                if ((unsigned char) c < 0x20) {
+                    json += "\\u00";
+                    json += hex[(c >> 4) & 0xf];
+                    json += hex[c & 0xf];
+                } else {
+                    json += c;
+                }
+        }
+    }
+    json += '"';
+}
+
+void JsonLinesWriter::begin(const ColumnNames& column_names, const ColumnAttributes& column_attributes) {
+    this->keys.clear();
+    for (size_t i = 0; i < column_names.size(); i++) {
+        std::string key(1, i == 0 ? '{' : ',');
+        json_string(column_names[i], key);
+        this->keys.push_back(key + ':');
+    }
+}
+
+void JsonLinesWriter::row(const std::vector<const Value*>& row) {
+    if (row.empty())
+        this->append('{');
+    for (size_t i = 0; i < row.size(); i++) {
+        this->append(this->keys[i]);
+        const Value* value = row[i];
+        if (value->data_type == ColumnAttribute::TEXT)
+            this->append_string(value->s);
+        else if (value->data_type == ColumnAttribute::BOOLEAN)
+            this->append(value->n == 0 ? "false" : "true");
+        else
+            this->append_int(value->n);
+    }
+    this->append("}\n", 2);
+}
+
+void JsonLinesWriter::end(const std::string& message, bool has_columns) {
+    if (!has_columns) {
+        this->append("{\"message\":", 11);
+        this->append_string(message);
+        this->append("}\n", 2);
+    }
+}
+
+void JsonLinesWriter::append_string(const std::string& s) {
+    json_string(s, this->buffer);
+    if (this->buffer.size() >= BUFFER_SIZE)
+        this->drain();
+}
+
+void BinaryWriter::begin(const ColumnNames& column_names, const ColumnAttributes& column_attributes) {
+    this->data_types.clear();
+    this->append_u32((uint32_t) column_names.size());
+    for (size_t i = 0; i < column_names.size(); i++) {
+        ColumnAttribute attribute = column_attributes[i];
+        this->data_types.push_back(attribute.get_data_type());
+        this->append((char) attribute.get_data_type());
+        this->append_bytes(column_names[i]);
+    }
+}
+
+void BinaryWriter::row(const std::vector<const Value*>& row) {
+    this->append((char) 1);
+    for (size_t i = 0; i < row.size(); i++) {
+        if (this->data_types[i] == ColumnAttribute::TEXT)
+            this->append_bytes(row[i]->s);
+        else
+            this->append_u32((uint32_t) row[i]->n);
+    }
+}
+
+void BinaryWriter::end(const std::string& message, bool has_columns) {
+    if (!has_columns)
+        this->append_u32(0);
+    this->append((char) 0);
+    this->append_bytes(message);
+}
+
+void BinaryWriter::append_u32(uint32_t n) {
+    char bytes[] = {(char) (n & 0xff), (char) ((n >> 8) & 0xff), (char) ((n >> 16) & 0xff), (char) (n >> 24)};
+    this->append(bytes, sizeof(bytes));
+}
+
+void BinaryWriter::append_bytes(const std::string& s) {
+    this->append_u32((uint32_t) s.size());
+    this->append(s);
+}
@@ -0,0 +1,224 @@
+/**
+ * @file ResultWriter.h - Writing query results out in one of several formats.
+ * ResultWriter
+ * TableWriter: ResultWriter
+ * CsvWriter: ResultWriter
+ * JsonLinesWriter: ResultWriter
+ * BinaryWriter: ResultWriter
+ *
+ * @author Justin Thoreson
+ * @see "Seattle University, CPSC5300, Winter 2023"
+ */
+
+#pragma once
+
+#include <ostream>
+#include <string>
+#include <vector>
+#include "SQLExec.h"
+
+/**
+ * @class ResultWriter - abstract base class for writing a query result's rows to a stream
+ *
+ * The output is gathered into a large buffer that is written to the stream
+ * only when it fills (and at the end), rather than a line at a time. Which
+ * value of a row goes in which column is worked out once per result from its
+ * first row: after that, each row's values are picked up in one pass over
+ * the row instead of a lookup by name per column.
+ */
+class ResultWriter {
+public:
+    enum Format {
+        TABLE,
+        CSV,
+        JSON_LINES,
+        BINARY
+    };
+
+    /**
+     * Bytes gathered before they are written to the stream
+     */
+    static const size_t BUFFER_SIZE = 1 << 16;
+
+    /**
+     * Make a writer for a format.
+     * @param format  the format
+     * @param out     stream to write to
+     * @returns       the writer (freed by caller)
+     */
+    static ResultWriter* create(Format format, std::ostream& out);
+
+    /**
+     * The format with a given name (table, csv, json, or binary, in any case).
+     * @param name    the name
+     * @param format  returned by reference: the format
+     * @returns       false if there is no format by that name
+     */
+    static bool get_format(std::string name, Format& format);
+
+    ResultWriter(std::ostream& out) : out(out), buffer(), values(), ordinals() { buffer.reserve(BUFFER_SIZE); }
+
+    virtual ~ResultWriter() {}
+
+    ResultWriter(const ResultWriter& other) = delete;
+
+    ResultWriter& operator=(const ResultWriter& other) = delete;
+
+    /**
+     * Write a result (reading the rest of its rows if it is a cursor). The
+     * stream is left for the caller to flush (e.g., once a commit is durable).
+     * @param result  the result
+     * @throws        SQLExecError if reading the result's rows fails
+     */
+    virtual void write(QueryResult& result);
+
+protected:
+    std::ostream& out;
+    std::string buffer;
+    std::vector<const Value*> values;  // the row being written, in the order of its columns in the ValueDict
+    std::vector<size_t> ordinals;      // for each result column, where it is in values
+
+    // the parts of a result, in the order they are written
+    virtual void begin(const ColumnNames& column_names, const ColumnAttributes& column_attributes) = 0;
+
+    /**
+     * Write a row.
+     * @param row  a value for each result column, in order
+     */
+    virtual void row(const std::vector<const Value*>& row) = 0;
+
+    /**
+     * Finish the result.
+     * @param message     the result's message
+     * @param has_columns false if the result was just a message
+     */
+    virtual void end(const std::string& message, bool has_columns) = 0;
+
+    /**
+     * Write whatever is in the buffer to the stream.
+     */
+    virtual void drain();
+
+    // add to the buffer, draining it when it fills
+    void append(const std::string& s) { append(s.data(), s.size()); }
+
+    void append(const char* s, size_t n) {
+        buffer.append(s, n);
+        if (buffer.size() >= BUFFER_SIZE)
+            drain();
+    }
+
+    void append(char c) {
+        buffer.push_back(c);
+        if (buffer.size() >= BUFFER_SIZE)
+            drain();
+    }
+
+    void append_int(int32_t n);
+};
+
+
+/**
+ * @class TableWriter - the shell's table format: the column names, a rule, and a line per row
+ */
+class TableWriter : public ResultWriter {
+public:
+    /**
+     * Constructor
+     * @param out       stream to write to
+     * @param end_line  false to leave off the newline after the message
+     */
+    TableWriter(std::ostream& out, bool end_line = true) : ResultWriter(out), end_line(end_line) {}
+
+    virtual ~TableWriter() {}
+
+protected:
+    bool end_line;
+
+    virtual void begin(const ColumnNames& column_names, const ColumnAttributes& column_attributes);
+
+    virtual void row(const std::vector<const Value*>& row);
+
+    virtual void end(const std::string& message, bool has_columns);
+};
+
+
+/**
+ * @class CsvWriter - comma-separated values (RFC 4180), with a header line of column names
+ *
+ * Only a result that is just a message (e.g., from CREATE) writes its message.
+ */
+class CsvWriter : public ResultWriter {
+public:
+    CsvWriter(std::ostream& out) : ResultWriter(out) {}
+
+    virtual ~CsvWriter() {}
+
+protected:
+    virtual void begin(const ColumnNames& column_names, const ColumnAttributes& column_attributes);
+
+    virtual void row(const std::vector<const Value*>& row);
+
+    virtual void end(const std::string& message, bool has_columns);
+
+    /**
+     * A field, quoted if it has to be.
+     */
+    void append_field(const std::string& s);
+};
+
+
+/**
+ * @class JsonLinesWriter - a JSON object per row, one to a line, keyed by column name
+ *
+ * A result that is just a message is written as {"message": ...}.
+ */
+class JsonLinesWriter : public ResultWriter {
+public:
+    JsonLinesWriter(std::ostream& out) : ResultWriter(out), keys() {}
+
+    virtual ~JsonLinesWriter() {}
+
+protected:
+    std::vector<std::string> keys;  // for each column, what comes before its value: {"name": or ,"name":
+
+    virtual void begin(const ColumnNames& column_names, const ColumnAttributes& column_attributes);
+
+    virtual void row(const std::vector<const Value*>& row);
+
+    virtual void end(const std::string& message, bool has_columns);
+
+    /**
+     * A JSON string literal.
+     */
+    void append_string(const std::string& s);
+};
+
+
+/**
+ * @class BinaryWriter - a length-prefixed binary format for programs to read
+ *
+ * All integers are little-endian. A result is:
+ *     u32 column count, then for each column: u8 data type, u32 name length, name
+ *     for each row: u8 1, then for each value: i32 (INT, BOOLEAN) or u32 length and bytes (TEXT)
+ *     u8 0, u32 message length, message
+ */
+class BinaryWriter : public ResultWriter {
+public:
+    BinaryWriter(std::ostream& out) : ResultWriter(out), data_types() {}
+
+    virtual ~BinaryWriter() {}
+
+protected:
+    std::vector<ColumnAttribute::DataType> data_types;
+
+    virtual void begin(const ColumnNames& column_names, const ColumnAttributes& column_attributes);
+
+    virtual void row(const std::vector<const Value*>& row);
+
+    virtual void end(const std::string& message, bool has_columns);
+
+    void append_u32(uint32_t n);
+
+    void append_bytes(const std::string& s);
+};
@@ -3,7 +3,10 @@
  * @authors Kevin Lundeen, Justin Thoreson
  * @see "Seattle University, CPSC5300, Winter 2023"
  */
+#include <algorithm>
+#include <cctype>
 #include "SQLExec.h"
+#include "ResultWriter.h"
 
 using namespace std;
 using namespace hsql;
@@ -11,42 +14,50 @@ using namespace hsql;
 // define static data
 Tables* SQLExec::tables = nullptr;
 Indices* SQLExec::indices = nullptr;
+Statistics* SQLExec::statistics = nullptr;
+PlanCache SQLExec::plan_cache;
+SharedMutex SQLExec::schema_lock;
+std::set<SQLSession*> SQLExec::sessions;  // before default_session, which registers itself here
+std::mutex SQLExec::sessions_mutex;
+std::map<Identifier, SQLSession*> SQLExec::writers;  // before default_session, whose dtor releases its tables
+std::mutex SQLExec::writers_mutex;
+std::condition_variable SQLExec::writers_changed;
+SQLSession SQLExec::default_session;
+thread_local SQLSession* SQLExec::session = nullptr;
+std::map<Identifier, Transaction::Durability> SQLExec::table_durabilities;
+thread_local std::vector<std::pair<Identifier, Identifier>> SQLExec::changed;
+thread_local std::vector<std::pair<Identifier, Identifier>> SQLExec::created;
 
-// make query result be printable
-ostream& operator<<(ostream& out, const QueryResult& qres) {
-    if (qres.column_names != nullptr) {
-        for (Identifier& column_name: *qres.column_names)
-            out << column_name << " ";
-        out << endl << "+";
-        for (unsigned int i = 0; i < qres.column_names->size(); i++)
-            out << "----------+";
-        out << endl;
-        for (ValueDict* row: *qres.rows) {
-            for (Identifier& column_name: *qres.column_names) {
-                Value value = row->at(column_name);
-                switch (value.data_type) {
-                    case ColumnAttribute::INT:
-                        out << value.n;
-                        break;
-                    case ColumnAttribute::TEXT:
-                        out << "\"" << value.s << "\"";
-                        break;
-                    case ColumnAttribute::BOOLEAN:
-                        out << (value.n == 0 ? "false" : "true");
-                        break;
-                    default:
-                        out << "???";
-                }
-                out << " ";
-            }
-            out << endl;
-        }
-    }
-    out << qres.message;
+SQLSession::SQLSession()
+    : prepared_statements(), transaction(nullptr), durability(Transaction::SYNC), written() {
+    std::lock_guard<std::mutex> lock(SQLExec::sessions_mutex);
+    SQLExec::sessions.insert(this);
+}
+
+SQLSession::~SQLSession() {
+    std::lock_guard<std::mutex> lock(SQLExec::sessions_mutex);
+    SQLExec::sessions.erase(this);
+    for (auto& prepared : this->prepared_statements)
+        delete prepared.second;
+    if (this->transaction != nullptr)
+        Transaction::abort(this->transaction);
+    SQLExec::release_write_locks(*this);
+    if (SQLExec::session == this)
+        SQLExec::session = nullptr;
+}
+
+// make query result be printable, in the table format (reading the rest of a cursor's rows as they are printed)
+ostream& operator<<(ostream& out, QueryResult& qres) {
+    TableWriter writer(out, false);
+    writer.write(qres);
     return out;
 }
 
 QueryResult::~QueryResult() {
+    if (this->plan != nullptr && this->opened)
+        this->plan->close();
+    if (this->owns_plan)
+        delete this->plan;
     if (this->column_names)
         delete this->column_names;
     if (this->column_attributes)
@@ -58,20 +69,90 @@ QueryResult::~QueryResult() {
     }
 }
 
-QueryResult* SQLExec::execute(const SQLStatement* statement) {
-    if (!SQLExec::tables)
-        SQLExec::tables = new Tables();
-    if (!SQLExec::indices)
-        SQLExec::indices = new Indices();
+ValueDicts* QueryResult::get_rows() {
+    if (this->plan != nullptr) {
+        if (this->rows == nullptr)
+            this->rows = new ValueDicts();
+        RowBatch batch;
+        while (this->next(batch))
+            batch.move_rows(*this->rows);
+    }
+    return this->rows;
+}
+
+// The plan is opened on the first call, and closed (and the count of rows
+// known) once it runs out or fails.
+bool QueryResult::next(RowBatch& batch) {
+    batch.clear();
+    if (this->plan == nullptr)
+        return false;
+    try {
+        if (!this->opened) {
+            this->opened = true;
+            this->plan->open();
+        }
+        if (this->plan->next(batch)) {
+            this->row_count += batch.size();
+            return true;
+        }
+    } catch (DbRelationError& e) {
+        this->finish();
+        throw SQLExecError("DbRelationError: " + string(e.what()));
+    } catch (...) {
+        this->finish();
+        throw;
+    }
+    this->finish();
+    return false;
+}
+
+void QueryResult::finish() {
+    if (this->opened)
+        this->plan->close();
+    this->opened = false;
+    if (this->owns_plan)
+        delete this->plan;
+    this->plan = nullptr;
+    this->message = "successfully returned " + to_string(this->row_count) + " rows";
+}
+
+void SQLExec::open_schema_tables() {
+    static std::once_flag opened;  // by whichever session gets here first
+    std::call_once(opened, [] {
+        if (!SQLExec::tables)
+            SQLExec::tables = new Tables();
+        if (!SQLExec::indices)
+            SQLExec::indices = new Indices();
+        if (!SQLExec::statistics)
+            SQLExec::statistics = new Statistics();
+    });
+}
+
+// Outside of any transaction, each write has been committed as it was made,
+// so the tables written are let go as soon as the statement is done.
+SQLExec::AutoCommitted::~AutoCommitted() {
+    if (Transaction::current() == nullptr && current_session().transaction == nullptr)
+        release_write_locks(current_session());
+}
+
+QueryResult* SQLExec::execute(const SQLStatement* statement, Identifier index_type) {
+    open_schema_tables();
+    AutoCommitted auto_committed;
 
     try {
         switch (statement->type()) {
             case kStmtCreate:
-                return create((const CreateStatement*) statement);
+                return create((const CreateStatement*) statement, index_type);
             case kStmtDrop:
                 return drop((const DropStatement*) statement);
             case kStmtShow:
                 return show((const ShowStatement*) statement);
+            case kStmtInsert:
+                return insert((const InsertStatement*) statement);
+            case kStmtDelete:
+                return del((const DeleteStatement*) statement);
+            case kStmtSelect:
+                return select((const SelectStatement*) statement);
             default:
                 return new QueryResult("not implemented");
         }
@@ -80,6 +161,310 @@ QueryResult* SQLExec::execute(const SQLStatement* statement) {
     }
 }
 
+QueryResult* SQLExec::explain(const SQLStatement* statement) {
+    open_schema_tables();
+
+    try {
+        string text;
+        PlanOperator* plan;
+        ColumnNames column_names;
+        ColumnAttributes column_attributes;
+        switch (statement->type()) {
+            case kStmtSelect:
+                plan = plan_select((const SelectStatement*) statement, column_names, column_attributes);
+                text = plan->explain();
+                break;
+            case kStmtDelete:
+                plan = plan_delete((const DeleteStatement*) statement);
+                text = "Delete " + string(((const DeleteStatement*) statement)->tableName) + "\n" + plan->explain(1);
+                break;
+            default:
+                return new QueryResult("can only explain SELECT and DELETE");
+        }
+        delete plan;
+        text.pop_back();  // trailing newline
+        return new QueryResult(text);
+    } catch (DbRelationError& e) {
+        throw SQLExecError("DbRelationError: " + string(e.what()));
+    }
+}
+
+QueryResult* SQLExec::analyze(Identifier table_name) {
+    open_schema_tables();
+    try {
+        DbRelation& table = get_existing_table(table_name);
+        invalidate(table_name);
+        double row_count = SQLExec::statistics->analyze(table);
+        return new QueryResult("analyzed " + table_name + ": about " + to_string((long) row_count) + " row(s) in "
+                               + to_string(table.get_block_count()) + " block(s)");
+    } catch (DbRelationError& e) {
+        throw SQLExecError("DbRelationError: " + string(e.what()));
+    }
+}
+
+QueryResult* SQLExec::begin() {
+    SQLSession& session = current_session();
+    if (session.transaction != nullptr)
+        throw SQLExecError("already in a transaction");
+    session.transaction = Transaction::begin();
+    session.written.clear();
+    return new QueryResult("BEGIN");
+}
+
+QueryResult* SQLExec::commit(uint64_t& ticket) {
+    SQLSession& session = current_session();
+    if (session.transaction == nullptr)
+        throw SQLExecError("not in a transaction");
+    DbTxn* txn = session.transaction;
+    session.transaction = nullptr;
+    ticket = commit_top_level(txn);
+    release_write_locks(session);
+    return new QueryResult("COMMIT");
+}
+
+QueryResult* SQLExec::rollback() {
+    SQLSession& session = current_session();
+    if (session.transaction == nullptr)
+        throw SQLExecError("not in a transaction");
+    DbTxn* txn = session.transaction;
+    session.transaction = nullptr;
+    session.written.clear();
+    Transaction::abort(txn);
+    release_write_locks(session);
+    return new QueryResult("ROLLBACK");
+}
+
+QueryResult* SQLExec::set_durability(Transaction::Durability durability, Identifier table_name) {
+    string name = Transaction::durability_name(durability);
+    if (table_name.empty()) {
+        current_session().durability = durability;
+        return new QueryResult("durability is " + name);
+    }
+    get_existing_table(table_name);
+    SQLExec::table_durabilities[table_name] = durability;
+    return new QueryResult("durability of " + table_name + " is " + name);
+}
+
+// Only a SYNC commit is waited for; the flusher thread takes care of the rest.
+uint64_t SQLExec::commit_top_level(DbTxn* txn) {
+    SQLSession& session = current_session();
+    Transaction::Durability durability = session.written.empty() ? session.durability : Transaction::ASYNC;
+    for (const Identifier& table_name : session.written) {
+        auto found = SQLExec::table_durabilities.find(table_name);
+        durability = min(durability, found != SQLExec::table_durabilities.end() ? found->second : session.durability);
+    }
+    session.written.clear();
+    uint64_t ticket = Transaction::commit(txn, false, durability);
+    return durability == Transaction::SYNC ? ticket : 0;
+}
+
+// Outside of BEGIN, a statement that writes starts its snapshot again once it
+// has the table's write lock (see lock_for_write), so the blocks it writes back
+// are the latest committed. Inside, a snapshot would be as old as the BEGIN,
+// and writing back a block read from it could undo another session's commit,
+// so those statements lock what they read.
+void SQLExec::begin_statement() {
+    DbTxn* parent = current_session().transaction;
+    Transaction::set_current(Transaction::begin(parent, parent == nullptr));
+    SQLExec::changed.clear();
+    SQLExec::created.clear();
+}
+
+uint64_t SQLExec::end_statement(bool ok) {
+    DbTxn* txn = Transaction::current();
+    Transaction::set_current(nullptr);
+    if (txn == nullptr)
+        return 0;
+    SQLSession& session = current_session();
+    if (!ok) {
+        if (session.transaction == nullptr)
+            session.written.clear();
+        Transaction::abort(txn);
+        if (session.transaction == nullptr)
+            release_write_locks(session);
+        if (!SQLExec::changed.empty())
+            undo_schema_changes();
+        return 0;
+    }
+    SQLExec::changed.clear();
+    SQLExec::created.clear();
+    if (session.transaction != nullptr)
+        return Transaction::commit(txn, true);
+    uint64_t ticket = commit_top_level(txn);
+    release_write_locks(session);
+    return ticket;
+}
+
+void SQLExec::lock_for_write(Identifier table_name) {
+    SQLSession& session = current_session();
+    {
+        std::unique_lock<std::mutex> lock(SQLExec::writers_mutex);
+        auto writable = [&] {
+            auto writer = SQLExec::writers.find(table_name);
+            return writer == SQLExec::writers.end() || writer->second == &session;
+        };
+        if (!SQLExec::writers_changed.wait_for(lock, std::chrono::microseconds(WRITE_LOCK_TIMEOUT), writable))
+            throw SQLExecError("table " + table_name + " is being written by another transaction");
+        if (SQLExec::writers.find(table_name) != SQLExec::writers.end())
+            return;  // already ours
+        SQLExec::writers[table_name] = &session;
+    }
+    DbTxn* txn = Transaction::current();
+    if (txn != nullptr && session.transaction == nullptr) {
+        Transaction::commit(txn, true);  // it has only read so far (a statement writes just the one table)
+        Transaction::set_current(Transaction::begin(nullptr, true));
+    }
+}
+
+void SQLExec::release_write_locks(SQLSession& session) {
+    {
+        std::lock_guard<std::mutex> lock(SQLExec::writers_mutex);
+        for (auto writer = SQLExec::writers.begin(); writer != SQLExec::writers.end();) {
+            if (writer->second == &session)
+                writer = SQLExec::writers.erase(writer);
+            else
+                writer++;
+        }
+    }
+    SQLExec::writers_changed.notify_all();
+}
+
+void SQLExec::invalidate(Identifier table_name) {
+    SQLExec::plan_cache.invalidate(table_name);
+    std::lock_guard<std::mutex> lock(SQLExec::sessions_mutex);
+    for (SQLSession* each : SQLExec::sessions)
+        for (auto& prepared : each->prepared_statements)
+            if (prepared.second->refers_to(table_name))
+                prepared.second->forget_plan();
+}
+
+// The rollback has put back the rows of _tables, _columns, and _indices, and
+// any file that was removed, so this is what the rollback doesn't reach.
+void SQLExec::undo_schema_changes() {
+    for (auto const& change : SQLExec::created) {
+        try {
+            if (change.second.empty())
+                SQLExec::tables->get_table(change.first).drop();
+            else
+                SQLExec::indices->get_index(change.first, change.second).drop();
+        } catch (...) {}  // failed before its file was made
+    }
+    std::vector<std::pair<Identifier, Identifier>> changes = SQLExec::changed;
+    SQLExec::changed.clear();
+    SQLExec::created.clear();
+    for (auto const& change : changes) {
+        invalidate(change.first);
+        Indices::forget(change.first, change.second);
+        if (change.second.empty())
+            Tables::forget(change.first);
+    }
+    Catalog::load(*SQLExec::tables, SQLExec::tables->get_table(Columns::TABLE_NAME), *SQLExec::indices);
+}
+
+// Only SELECT, INSERT, and DELETE are worth caching, so the rest aren't even normalized.
+PreparedStatement* SQLExec::cached(const string& sql, string& normalized, vector<Value>& parameters) {
+    size_t start = sql.find_first_not_of(" \t\n");
+    string verb = start == string::npos ? "" : sql.substr(start, 6);
+    transform(verb.begin(), verb.end(), verb.begin(), ::toupper);
+    if (verb != "SELECT" && verb != "INSERT" && verb != "DELETE")
+        return nullptr;
+    if (!PlanCache::normalize(sql, normalized, parameters))
+        return nullptr;
+    PreparedStatement* prepared = SQLExec::plan_cache.take(normalized);
+    if (prepared != nullptr)
+        return prepared;
+
+    // the SQL is left to be parsed as written if the placeholders don't parse or don't all come back
+    SQLParserResult* parse = SQLParser::parseSQLString(normalized);
+    if (!parse->isValid() || parse->size() != 1) {
+        delete parse;
+        return nullptr;
+    }
+    prepared = new PreparedStatement(parse);
+    if (prepared->get_parameter_count() != parameters.size()) {
+        delete prepared;
+        return nullptr;
+    }
+    return prepared;
+}
+
+void SQLExec::uncache(const string& normalized, PreparedStatement* prepared) {
+    SQLExec::plan_cache.put(normalized, prepared);
+}
+
+QueryResult* SQLExec::execute(PreparedStatement& prepared) {
+    open_schema_tables();
+    AutoCommitted auto_committed;
+    const SQLStatement* statement = prepared.get_statement();
+    if (statement->type() != kStmtSelect && statement->type() != kStmtDelete)
+        return execute(statement);
+
+    // a plan made outside of an explicit transaction may scan in parallel,
+    // which can't be done inside one (see plan_select), so a plan is rebuilt
+    // when the session is on the other side of that line from its planner's
+    bool in_transaction = current_session().transaction != nullptr;
+    if (prepared.get_plan() != nullptr && prepared.is_planned_in_transaction() != in_transaction)
+        prepared.forget_plan();
+
+    // a plan that failed part way through is rebuilt next time rather than trusted to reopen
+    try {
+        if (prepared.get_plan() == nullptr) {
+            ColumnNames column_names;
+            ColumnAttributes column_attributes;
+            PlanOperator* plan;
+            if (statement->type() == kStmtSelect)
+                plan = plan_select((const SelectStatement*) statement, column_names, column_attributes);
+            else
+                plan = plan_delete((const DeleteStatement*) statement);
+            prepared.set_plan(plan, column_names, column_attributes, in_transaction);
+        }
+        if (statement->type() == kStmtSelect)
+            return select(prepared.get_plan(), prepared.get_column_names(), prepared.get_column_attributes(), false);
+        return del((const DeleteStatement*) statement, *prepared.get_plan());
+    } catch (DbRelationError& e) {
+        prepared.forget_plan();
+        throw SQLExecError("DbRelationError: " + string(e.what()));
+    } catch (...) {
+        prepared.forget_plan();
+        throw;
+    }
+}
+
+QueryResult* SQLExec::prepare(Identifier name, const string& sql) {
+    std::map<Identifier, PreparedStatement*>& prepared_statements = current_session().prepared_statements;
+    if (prepared_statements.find(name) != prepared_statements.end())
+        throw SQLExecError("prepared statement " + name + " already exists");
+    SQLParserResult* parse = SQLParser::parseSQLString(sql);
+    if (!parse->isValid()) {
+        string message = "invalid SQL: " + string(parse->errorMsg());
+        delete parse;
+        throw SQLExecError(message);
+    }
+    StatementType type = parse->size() == 1 ? parse->getStatement(0)->type() : kStmtError;
+    if (type != kStmtSelect && type != kStmtInsert && type != kStmtDelete) {
+        delete parse;
+        throw SQLExecError("only a single SELECT, INSERT, or DELETE can be prepared");
+    }
+    PreparedStatement* prepared = new PreparedStatement(parse);
+    prepared_statements[name] = prepared;
+    size_t n = prepared->get_parameter_count();
+    return new QueryResult("prepared " + name + " with " + to_string(n) + " parameter" + (n == 1 ? "" : "s"));
+}
+
+PreparedStatement& SQLExec::get_prepared(Identifier name) {
+    std::map<Identifier, PreparedStatement*>& prepared_statements = current_session().prepared_statements;
+    auto prepared = prepared_statements.find(name);
+    if (prepared == prepared_statements.end())
+        throw SQLExecError("no prepared statement " + name);
+    return *prepared->second;
+}
+
+QueryResult* SQLExec::deallocate(Identifier name) {
+    delete &get_prepared(name);
+    current_session().prepared_statements.erase(name);
+    return new QueryResult("deallocated " + name);
+}
+
 void SQLExec::column_definition(const ColumnDefinition* col, Identifier& column_name, ColumnAttribute& column_attribute) {
     column_name = col->name;
     switch (col->type) {
@@ -94,66 +479,60 @@ void SQLExec::column_definition(const ColumnDefinition* col, Identifier& column_
     }
 }
 
-QueryResult* SQLExec::create(const CreateStatement* statement) {
+// Making files, and the in-memory catalog, are outside what a rollback undoes,
+// so DDL is only done in a statement's own transaction, which is undone by
+// undo_schema_changes if the statement fails.
+QueryResult* SQLExec::create(const CreateStatement* statement, Identifier index_type) {
+    if (current_session().transaction != nullptr)
+        throw SQLExecError("CREATE can't be done inside a transaction");
     switch(statement->type) {
         case CreateStatement::kTable:
             return create_table(statement);
         case CreateStatement::kIndex:
-            return create_index(statement);
+            return create_index(statement, index_type.empty() ? string(statement->indexType) : index_type);
         default:
             return new QueryResult("not implemented");
     }
 }
 
 QueryResult* SQLExec::create_table(const CreateStatement* statement) {
+    invalidate(statement->tableName);
+
     // update _tables schema
     ValueDict row = {{"table_name", Value(statement->tableName)}};
-    Handle tableHandle = SQLExec::tables->insert(&row);
-    try {
-        // update _columns schema
-        Handles columnHandles;
-        DbRelation& columns = SQLExec::tables->get_table(Columns::TABLE_NAME);
-        try {
-            for (ColumnDefinition* column : *statement->columns) {
-                Identifier cn;
-                ColumnAttribute ca;
-                column_definition(column, cn, ca);
-                std::string type = ca.get_data_type() == ColumnAttribute::DataType::TEXT ? "TEXT" : "INT";
-                ValueDict row = {
-                    {"table_name", Value(statement->tableName)},
-                    {"column_name", Value(cn)},
-                    {"data_type", Value(type)}
-                };
-                columnHandles.push_back(columns.insert(&row));
-            }
+    SQLExec::tables->insert(&row);
+    SQLExec::changed.push_back(std::make_pair(string(statement->tableName), string("")));
 
-            // create table
-            DbRelation& table = SQLExec::tables->get_table(statement->tableName);
-            if (statement->ifNotExists)
-                table.create_if_not_exists();
-            else
-                table.create();
-        } catch (...) {
-            // attempt to undo the insertions into _columns
-            try {
-                for (Handle& columnHandle : columnHandles)
-                    columns.del(columnHandle);
-            } catch (...) {}
-            throw;
-        }
-    } catch (...) {
-        // attempt to undo the insertion into _tables
-        try {
-            SQLExec::tables->del(tableHandle);
-        } catch (...) {}
-        throw;
+    // update _columns schema
+    DbRelation& columns = SQLExec::tables->get_table(Columns::TABLE_NAME);
+    for (ColumnDefinition* column : *statement->columns) {
+        Identifier cn;
+        ColumnAttribute ca;
+        column_definition(column, cn, ca);
+        std::string type = ca.get_data_type() == ColumnAttribute::DataType::TEXT ? "TEXT" : "INT";
+        ValueDict row = {
+            {"table_name", Value(statement->tableName)},
+            {"column_name", Value(cn)},
+            {"data_type", Value(type)}
+        };
+        columns.insert(&row);
     }
 
+    // create table
+    DbRelation& table = SQLExec::tables->get_table(statement->tableName);
+    SQLExec::created.push_back(std::make_pair(string(statement->tableName), string("")));
+    if (statement->ifNotExists)
+        table.create_if_not_exists();
+    else
+        table.create();
+
     return new QueryResult("created table " + string(statement->tableName));
 }
 
-QueryResult* SQLExec::create_index(const CreateStatement* statement) {
+QueryResult* SQLExec::create_index(const CreateStatement* statement, Identifier index_type) {
     DbRelation& table = SQLExec::tables->get_table(statement->tableName);
+    invalidate(statement->tableName);
+    SQLExec::changed.push_back(std::make_pair(string(statement->tableName), string(statement->indexName)));
 
     // check that all the index columns exist in the table
     const ColumnNames& cn = table.get_column_names();
@@ -167,8 +546,8 @@ QueryResult* SQLExec::create_index(const CreateStatement* statement) {
         {"index_name", Value(statement->indexName)},
         {"column_name", Value("")},
         {"seq_in_index", Value()},
-        {"index_type", Value(statement->indexType)},
-        {"is_unique", Value(string(statement->indexType) == "BTREE")}
+        {"index_type", Value(index_type)},
+        {"is_unique", Value(index_type == "BTREE")}
     };
     for (char* column_name : *statement->indexColumns) {
         row["column_name"] = Value(column_name);
@@ -178,12 +557,15 @@ QueryResult* SQLExec::create_index(const CreateStatement* statement) {
 
     // call get_index to get a reference to the new index and then invoke the create method on it
     DbIndex& index = SQLExec::indices->get_index(string(statement->tableName), string(statement->indexName));
+    SQLExec::created.push_back(std::make_pair(string(statement->tableName), string(statement->indexName)));
     index.create();
 
     return new QueryResult("created index " + string(statement->indexName));
 }
 
 QueryResult* SQLExec::drop(const DropStatement* statement) {
+    if (current_session().transaction != nullptr)
+        throw SQLExecError("DROP can't be done inside a transaction");
     switch (statement->type) {
         case DropStatement::kTable:
             return drop_table(statement);
@@ -200,16 +582,24 @@ QueryResult* SQLExec::drop_table(const DropStatement* statement) {
     
     // get table name
     Identifier table_name = statement->name;
-    if (table_name == Tables::TABLE_NAME || table_name == Columns::TABLE_NAME || table_name == Indices::TABLE_NAME)
+    if (table_name == Tables::TABLE_NAME || table_name == Columns::TABLE_NAME || table_name == Indices::TABLE_NAME
+        || table_name == Statistics::TABLE_NAME)
         throw SQLExecError("Cannot drop a schema table!");
+    invalidate(table_name);
+    SQLExec::changed.push_back(std::make_pair(table_name, string("")));
     ValueDict where = {{"table_name", Value(table_name)}};
 
     // before dropping the table, drop each index on the table
+    for (Identifier& index_name : SQLExec::indices->get_index_names(table_name))
+        SQLExec::indices->get_index(table_name, index_name).drop();
     Handles* selected = SQLExec::indices->select(&where);
     for (Handle& row : *selected)
         SQLExec::indices->del(row);
     delete selected;
 
+    // remove statistics
+    SQLExec::statistics->forget(table_name);
+
     // remove columns    
     DbRelation& columns = SQLExec::tables->get_table(Columns::TABLE_NAME);
     Handles* rows = columns.select(&where);
@@ -223,11 +613,15 @@ QueryResult* SQLExec::drop_table(const DropStatement* statement) {
     rows = SQLExec::tables->select(&where);
     SQLExec::tables->del(*rows->begin());
     delete rows;
+    SQLExec::table_durabilities.erase(table_name);
 
     return new QueryResult("dropped table " + table_name);    
 }
 
 QueryResult* SQLExec::drop_index(const DropStatement* statement) {
+    invalidate(statement->name);
+    SQLExec::changed.push_back(std::make_pair(string(statement->name), string(statement->indexName)));
+
     // call get_index to get a reference to the index and then invoke the drop method on it
     DbIndex& index = SQLExec::indices->get_index(string(statement->name), string(statement->indexName));
     index.drop();
@@ -265,30 +659,30 @@ QueryResult* SQLExec::show_tables() {
     SQLExec::tables->get_columns(Tables::TABLE_NAME, *cn, *ca);
 
     // get table names
-    Handles* tables = SQLExec::tables->select();
     ValueDicts* rows = new ValueDicts();
-    for (Handle& table : *tables) {
-        ValueDict* row = SQLExec::tables->project(table, cn);
-        Identifier table_name = (*row)["table_name"].s;
-        if (table_name != Tables::TABLE_NAME && table_name != Columns::TABLE_NAME && table_name != Indices::TABLE_NAME)
-            rows->push_back(row);
-        else
-            delete row;
-    }
-    delete tables;
+    for (const Identifier& table_name : Catalog::get_table_names())
+        if (table_name != Tables::TABLE_NAME && table_name != Columns::TABLE_NAME && table_name != Indices::TABLE_NAME
+            && table_name != Statistics::TABLE_NAME)
+            rows->push_back(new ValueDict({{"table_name", Value(table_name)}}));
     return new QueryResult(cn, ca, rows, "successfully returned " + to_string(rows->size()) + " rows");
 }
 
 QueryResult* SQLExec::show_columns(const ShowStatement* statement) {
     ColumnNames* cn = new ColumnNames({"table_name", "column_name", "data_type"});
     ColumnAttributes* ca = new ColumnAttributes({ColumnAttribute(ColumnAttribute::DataType::TEXT)});
-    DbRelation& columns = SQLExec::tables->get_table(Columns::TABLE_NAME);
-    ValueDict where = {{"table_name", Value(statement->tableName)}};
-    Handles* selected = columns.select(&where);
     ValueDicts* rows = new ValueDicts();
-    for (Handle& row : *selected)
-        rows->push_back(columns.project(row, cn));
-    delete selected;
+    const Catalog::TableEntry* table = Catalog::get_table(statement->tableName);
+    for (uint i = 0; table != nullptr && i < table->column_names.size(); i++) {
+        ColumnAttribute attribute = table->column_attributes[i];
+        ColumnAttribute::DataType data_type = attribute.get_data_type();
+        std::string type = data_type == ColumnAttribute::TEXT ? "TEXT"
+                           : data_type == ColumnAttribute::BOOLEAN ? "BOOLEAN" : "INT";
+        rows->push_back(new ValueDict({
+            {"table_name", Value(statement->tableName)},
+            {"column_name", Value(table->column_names[i])},
+            {"data_type", Value(type)}
+        }));
+    }
     return new QueryResult(cn, ca, rows, "successfully returned " + to_string(rows->size()) + " rows");
 }
 
@@ -305,11 +699,705 @@ QueryResult* SQLExec::show_index(const ShowStatement* statement){
         ColumnAttribute(ColumnAttribute::DataType::TEXT),
         ColumnAttribute(ColumnAttribute::DataType::BOOLEAN),
     });
-    ValueDict where = {{"table_name", Value(statement->tableName)}};
-    Handles* selected = SQLExec::indices->select(&where);
     ValueDicts* rows = new ValueDicts();
-    for (Handle& row : *selected)
-        rows->push_back(SQLExec::indices->project(row, cn));
-    delete selected;
+    const Catalog::TableEntry* table = Catalog::get_table(statement->tableName);
+    for (uint i = 0; table != nullptr && i < table->indices.size(); i++) {
+        const Catalog::IndexEntry& index = table->indices[i];
+        Value is_unique((int32_t) index.is_unique);
+        is_unique.data_type = ColumnAttribute::BOOLEAN;
+        for (uint seq = 0; seq < index.column_names.size(); seq++)
+            rows->push_back(new ValueDict({
+                {"table_name", Value(statement->tableName)},
+                {"index_name", Value(index.index_name)},
+                {"column_name", Value(index.column_names[seq])},
+                {"seq_in_index", Value((int32_t) seq + 1)},
+                {"index_type", Value(index.index_type)},
+                {"is_unique", is_unique}
+            }));
+    }
     return new QueryResult(cn, ca, rows, "successfully returned " + to_string(rows->size()) + " rows");
 }
+
+// Literal from the AST as a Value of the given column type.
+static Value literal(const Expr* expr, ColumnAttribute::DataType data_type) {
+    if (expr->type == kExprLiteralString && data_type == ColumnAttribute::TEXT)
+        return Value(string(expr->name));
+    if (expr->type == kExprLiteralInt && data_type != ColumnAttribute::TEXT) {
+        if (expr->ival < INT32_MIN || expr->ival > INT32_MAX)
+            throw SQLExecError("integer out of range: " + to_string(expr->ival));
+        Value value((int32_t) expr->ival);
+        value.data_type = data_type;
+        return value;
+    }
+    if (expr->type == kExprOperator && expr->opType == Expr::UMINUS && expr->expr->type == kExprLiteralInt) {
+        Value value = literal(expr->expr, data_type);
+        if (value.n == INT32_MIN)
+            throw SQLExecError("integer out of range: -" + to_string(expr->expr->ival));
+        value.n = -value.n;
+        return value;
+    }
+    throw SQLExecError("literal does not match the type of its column");
+}
+
+QueryResult* SQLExec::insert(const InsertStatement* statement) {
+    Identifier table_name = statement->tableName;
+    DbRelation& table = get_existing_table(table_name);
+    lock_for_write(table_name);
+    current_session().written.insert(table_name);
+
+    // resolve the target columns once for the whole statement
+    const ColumnNames& table_columns = table.get_column_names();
+    ColumnAttributes table_attributes = table.get_column_attributes();
+    ColumnNames column_names;
+    ColumnAttributes column_attributes;
+    if (statement->columns == nullptr) {
+        column_names = table_columns;
+        column_attributes = table_attributes;
+    } else {
+        for (char* column_name : *statement->columns) {
+            size_t i = find(table_columns.begin(), table_columns.end(), string(column_name)) - table_columns.begin();
+            if (i == table_columns.size())
+                throw SQLExecError("no such column " + string(column_name) + " in table " + table_name);
+            column_names.push_back(table_columns[i]);
+            column_attributes.push_back(table_attributes[i]);
+        }
+    }
+
+    // gather the rows
+    ValueDicts rows;
+    try {
+        if (statement->type == InsertStatement::kInsertValues) {
+            if (statement->values->size() != column_names.size())
+                throw SQLExecError("number of values does not match number of columns");
+            ValueDict* row = new ValueDict();
+            rows.push_back(row);
+            for (size_t i = 0; i < column_names.size(); i++)
+                (*row)[column_names[i]] = literal(statement->values->at(i), column_attributes[i].get_data_type());
+        } else {
+            ColumnNames select_names;
+            ColumnAttributes select_attributes;
+            PlanOperator* plan = plan_select(statement->select, select_names, select_attributes);
+            if (select_names.size() != column_names.size()) {
+                delete plan;
+                throw SQLExecError("number of selected columns does not match number of columns");
+            }
+            for (size_t i = 0; i < column_names.size(); i++) {
+                if (select_attributes[i].get_data_type() != column_attributes[i].get_data_type()) {
+                    delete plan;
+                    throw SQLExecError("type of selected column " + select_names[i] + " does not match column "
+                                       + column_names[i]);
+                }
+            }
+            RowBatch batch;
+            ValueDicts selected;
+            plan->open();
+            while (plan->next(batch))
+                batch.move_rows(selected);
+            plan->close();
+            delete plan;
+            for (ValueDict* selected_row : selected) {
+                ValueDict* row = new ValueDict();
+                for (size_t i = 0; i < column_names.size(); i++)
+                    (*row)[column_names[i]] = selected_row->at(select_names[i]);
+                delete selected_row;
+                rows.push_back(row);
+            }
+        }
+    } catch (...) {
+        for (ValueDict* row : rows)
+            delete row;
+        throw;
+    }
+
+    // append them all to the table, then add them to each index
+    Handles* handles;
+    try {
+        handles = table.insert(&rows);
+    } catch (...) {
+        for (ValueDict* row : rows)
+            delete row;
+        throw;
+    }
+    for (ValueDict* row : rows)
+        delete row;
+    IndexNames index_names = SQLExec::indices->get_index_names(table_name);
+    size_t n_indexed = 0, n_inserted = 0;
+    try {
+        for (; n_indexed < index_names.size(); n_indexed++) {
+            DbIndex& index = SQLExec::indices->get_index(table_name, index_names[n_indexed]);
+            for (n_inserted = 0; n_inserted < handles->size(); n_inserted++)
+                index.insert(handles->at(n_inserted));
+        }
+    } catch (...) {
+        // attempt to undo the insertions into the indices and the table
+        try {
+            for (size_t i = 0; i <= n_indexed && i < index_names.size(); i++) {
+                DbIndex& index = SQLExec::indices->get_index(table_name, index_names[i]);
+                size_t n = i < n_indexed ? handles->size() : n_inserted;
+                for (size_t j = 0; j < n; j++)
+                    index.del(handles->at(j));
+            }
+            for (Handle& handle : *handles)
+                table.del(handle);
+        } catch (...) {}
+        delete handles;
+        throw;
+    }
+
+    size_t n_rows = handles->size();
+    delete handles;
+    return new QueryResult("successfully inserted " + to_string(n_rows) + " row" + (n_rows == 1 ? "" : "s")
+                           + " into " + table_name + " and " + to_string(index_names.size()) + " ind"
+                           + (index_names.size() == 1 ? "ex" : "ices"));
+}
+
+QueryResult* SQLExec::del(const DeleteStatement* statement) {
+    PlanOperator* plan = plan_delete(statement);
+    try {
+        QueryResult* result = del(statement, *plan);
+        delete plan;
+        return result;
+    } catch (...) {
+        delete plan;
+        throw;
+    }
+}
+
+QueryResult* SQLExec::del(const DeleteStatement* statement, PlanOperator& plan) {
+    Identifier table_name = statement->tableName;
+    DbRelation& table = get_existing_table(table_name);
+    lock_for_write(table_name);
+    current_session().written.insert(table_name);
+    Handles handles;
+    RowBatch batch;
+    plan.open();
+    while (plan.next(batch))
+        for (size_t i = 0; i < batch.size(); i++)
+            handles.push_back(batch.get_handle(i));
+    plan.close();
+
+    // index entries first (they need the rows' key values), then all the rows, a block at a time
+    IndexNames index_names = SQLExec::indices->get_index_names(table_name);
+    for (Identifier& index_name : index_names) {
+        DbIndex& index = SQLExec::indices->get_index(table_name, index_name);
+        for (Handle& handle : handles)
+            index.del(handle);
+    }
+    table.del(&handles);
+
+    return new QueryResult("successfully deleted " + to_string(handles.size()) + " row"
+                           + (handles.size() == 1 ? "" : "s") + " from " + table_name + " and "
+                           + to_string(index_names.size()) + " ind" + (index_names.size() == 1 ? "ex" : "ices"));
+}
+
+// Find the doomed rows with the same access paths as a select.
+PlanOperator* SQLExec::plan_delete(const DeleteStatement* statement) {
+    DbRelation& table = get_existing_table(statement->tableName);
+    FromTables tables = {FromTable(statement->tableName, &table)};
+    Predicate predicate;
+    if (statement->expr != nullptr)
+        where_clause(statement->expr, tables, predicate);
+    ColumnNames needed;
+    for (const Comparison& comparison : predicate) {
+        needed.push_back(comparison.column_name);
+        if (!comparison.is_literal())
+            needed.push_back(comparison.other_column_name);
+    }
+    PlanOperator* plan = access_path(table, needed, predicate);
+    if (!predicate.empty())
+        plan = new Filter(plan, predicate);
+    return plan;
+}
+
+QueryResult* SQLExec::select(const SelectStatement* statement) {
+    ColumnNames column_names;
+    ColumnAttributes column_attributes;
+    PlanOperator* plan = plan_select(statement, column_names, column_attributes);
+    return select(plan, column_names, column_attributes, true);
+}
+
+// The rows are read from the plan as the result is printed.
+QueryResult* SQLExec::select(PlanOperator* plan, const ColumnNames& column_names,
+                             const ColumnAttributes& column_attributes, bool owns_plan) {
+    return new QueryResult(new ColumnNames(column_names), new ColumnAttributes(column_attributes), plan, owns_plan);
+}
+
+// Add an aggregate to the list unless it's already there.
+static void add_aggregate(Aggregates& aggregates, const Aggregate& aggregate) {
+    for (const Aggregate& existing : aggregates)
+        if (existing.output_name == aggregate.output_name)
+            return;
+    aggregates.push_back(aggregate);
+}
+
+PlanOperator* SQLExec::plan_select(const SelectStatement* statement, ColumnNames& column_names,
+                                   ColumnAttributes& column_attributes) {
+    if (statement->unionSelect != nullptr || statement->selectDistinct)
+        throw SQLExecError("not implemented");
+    if (statement->groupBy != nullptr && statement->groupBy->having != nullptr)
+        throw SQLExecError("HAVING is not implemented");
+
+    FromTables tables;
+    std::vector<const Expr*> conditions;
+    from_clause(statement->fromTable, tables, conditions);
+    if (statement->whereClause != nullptr)
+        conditions.push_back(statement->whereClause);
+
+    ColumnNames group_columns;
+    if (statement->groupBy != nullptr) {
+        for (Expr* expr : *statement->groupBy->columns) {
+            if (expr->type != kExprColumnRef)
+                throw SQLExecError("only grouping by columns is implemented");
+            ColumnAttribute::DataType data_type;
+            group_columns.push_back(column_ref(expr, tables, data_type));
+        }
+    }
+
+    // result columns (qualified with their tables' names when there is more than one table)
+    Aggregates aggregates;
+    for (Expr* expr : *statement->selectList) {
+        if (expr->type == kExprStar) {
+            for (const FromTable& from : tables) {
+                const ColumnNames& table_columns = from.second->get_column_names();
+                ColumnAttributes table_attributes = from.second->get_column_attributes();
+                for (size_t i = 0; i < table_columns.size(); i++) {
+                    column_names.push_back(tables.size() == 1 ? table_columns[i] : from.first + "." + table_columns[i]);
+                    column_attributes.push_back(table_attributes[i]);
+                }
+            }
+        } else if (expr->type == kExprColumnRef) {
+            ColumnAttribute::DataType data_type;
+            column_names.push_back(column_ref(expr, tables, data_type));
+            column_attributes.push_back(ColumnAttribute(data_type));
+        } else if (expr->type == kExprFunctionRef) {
+            Aggregate aggregate = aggregate_ref(expr, tables);
+            column_names.push_back(aggregate.output_name);
+            column_attributes.push_back(ColumnAttribute(aggregate.get_output_type()));
+            add_aggregate(aggregates, aggregate);
+        } else {
+            throw SQLExecError("only column names, aggregates, and * are implemented in the select list");
+        }
+    }
+
+    // with aggregates, the other result columns have to be grouped on
+    bool grouping = statement->groupBy != nullptr || !aggregates.empty();
+    if (grouping) {
+        for (size_t i = 0; i < column_names.size(); i++) {
+            bool aggregated = false;
+            for (const Aggregate& aggregate : aggregates)
+                aggregated = aggregated || aggregate.output_name == column_names[i];
+            if (!aggregated && find(group_columns.begin(), group_columns.end(), column_names[i]) == group_columns.end())
+                throw SQLExecError("column " + column_names[i] + " must be in the GROUP BY clause or an aggregate");
+        }
+    }
+
+    SortKeys sort_keys;
+    if (statement->order != nullptr) {
+        const Expr* expr = statement->order->expr;
+        Identifier column_name;
+        if (expr->type == kExprFunctionRef && grouping) {
+            Aggregate aggregate = aggregate_ref(expr, tables);
+            column_name = aggregate.output_name;
+            add_aggregate(aggregates, aggregate);
+        } else if (expr->type == kExprColumnRef) {
+            ColumnAttribute::DataType data_type;
+            column_name = column_ref(expr, tables, data_type);
+            if (grouping && find(group_columns.begin(), group_columns.end(), column_name) == group_columns.end())
+                throw SQLExecError("column " + column_name + " must be in the GROUP BY clause to order by it");
+        } else {
+            throw SQLExecError("only ordering by a column or an aggregate is implemented");
+        }
+        sort_keys.push_back(SortKey(column_name, statement->order->type == kOrderDesc));
+    }
+
+    // the leaves have to read the result and sort columns and whatever the remaining predicate compares
+    Predicate predicate;
+    for (const Expr* condition : conditions)
+        where_clause(condition, tables, predicate);
+    ColumnNames needed = grouping ? group_columns : column_names;
+    if (grouping) {
+        for (const Aggregate& aggregate : aggregates)
+            if (!aggregate.column_name.empty())
+                needed.push_back(aggregate.column_name);
+    } else {
+        for (const SortKey& sort_key : sort_keys)
+            needed.push_back(sort_key.column_name);
+    }
+    for (const Comparison& comparison : predicate) {
+        needed.push_back(comparison.column_name);
+        if (!comparison.is_literal())
+            needed.push_back(comparison.other_column_name);
+    }
+
+    // the hash table is sized for as many groups as the group columns' values could make
+    size_t expected_groups = 0;
+    if (grouping && tables.size() == 1 && !group_columns.empty()) {
+        TableStatistics statistics = table_statistics(*tables.front().second);
+        double groups = 1;
+        for (const Identifier& column_name : group_columns)
+            groups *= statistics.distinct_count(column_name);
+        expected_groups = (size_t) std::min(groups, statistics.get_row_count());
+    }
+
+    size_t limit = SIZE_MAX, offset = 0;
+    if (statement->limit != nullptr) {
+        limit = statement->limit->limit >= 0 ? (size_t) statement->limit->limit : SIZE_MAX;
+        offset = statement->limit->offset > 0 ? (size_t) statement->limit->offset : 0;
+    }
+    size_t last_row = limit == SIZE_MAX ? SIZE_MAX : limit + offset;
+
+    // a full scan of a table of more than one morsel is spread across the
+    // workers, which also aggregate if they can each hold all the groups.
+    // Either of two things keeps it to a single scan: a LIMIT that can stop
+    // the scan early, or an explicit transaction (whose own writes the
+    // workers, each reading a snapshot of what is committed, wouldn't see).
+    PlanOperator* plan;
+    bool aggregated = false;
+    bool streaming = last_row != SIZE_MAX && !grouping && sort_keys.empty();
+    if (tables.size() == 1) {
+        DbRelation& table = *tables.front().second;
+        HandleScan* scan = access_path(table, needed, predicate);
+        TableScan* table_scan = dynamic_cast<TableScan*>(scan);
+        uint workers = Gather::default_workers();
+        if (streaming && predicate.empty())
+            scan->set_limit(last_row);  // every row the scan produces is in the result up to the LIMIT
+        if (!streaming && table_scan != nullptr && workers > 1 && current_session().transaction == nullptr
+            && table.get_block_count() > MorselQueue::MORSEL_BLOCKS) {
+            aggregated = grouping && expected_groups * workers <= HashAggregate::MEMORY_GROUPS;
+            if (aggregated)
+                plan = plan_parallel(table_scan, predicate, workers, &group_columns, &aggregates, expected_groups);
+            else
+                plan = plan_parallel(table_scan, predicate, workers);
+        } else {
+            plan = scan;
+            if (!predicate.empty()) {
+                Filter* filter = new Filter(plan, predicate);
+                if (streaming) {
+                    // every row the filter passes on is in the result up to the LIMIT, so it stops
+                    // there, and the scan under it reads no block beyond the one where it stopped
+                    filter->set_limit(last_row);
+                    if (table_scan != nullptr)
+                        table_scan->set_block_batches(true);
+                }
+                plan = filter;
+            }
+        }
+    } else {
+        plan = plan_join(tables, needed, predicate);
+    }
+    if (grouping && !aggregated)
+        plan = new HashAggregate(plan, group_columns, aggregates, expected_groups);
+
+    // with a LIMIT, the sort only has to find the rows up to the end of it
+    if (!sort_keys.empty())
+        plan = new Sort(plan, sort_keys, last_row);
+    plan = new Project(plan, column_names);
+    if (statement->limit != nullptr)
+        plan = new Limit(plan, limit, offset);
+    return plan;
+}
+
+void SQLExec::from_clause(const TableRef* table_ref, FromTables& tables, std::vector<const Expr*>& conditions) {
+    switch (table_ref->type) {
+        case kTableName: {
+            Identifier name = table_ref->alias != nullptr ? table_ref->alias : table_ref->name;
+            for (const FromTable& from : tables)
+                if (from.first == name)
+                    throw SQLExecError("table " + name + " appears more than once (give it an alias)");
+            tables.push_back(FromTable(name, &get_existing_table(table_ref->name)));
+            break;
+        }
+        case kTableJoin:
+            if (table_ref->join->type != kJoinInner && table_ref->join->type != kJoinCross)
+                throw SQLExecError("only inner joins are implemented");
+            from_clause(table_ref->join->left, tables, conditions);
+            from_clause(table_ref->join->right, tables, conditions);
+            if (table_ref->join->condition != nullptr)
+                conditions.push_back(table_ref->join->condition);
+            break;
+        case kTableCrossProduct:
+            for (const TableRef* item : *table_ref->list)
+                from_clause(item, tables, conditions);
+            break;
+        default:
+            throw SQLExecError("only tables and joins of tables are implemented in the from clause");
+    }
+}
+
+// Table part of a qualified column name, e.g. "t" for "t.a".
+static Identifier qualifier(const Identifier& column_name) {
+    return column_name.substr(0, column_name.find('.'));
+}
+
+// Column part of a qualified column name, e.g. "a" for "t.a".
+static Identifier unqualified(const Identifier& column_name) {
+    return column_name.substr(column_name.find('.') + 1);
+}
+
+// Each table is read (with the comparisons on it alone pushed down) and has its
+// columns qualified; then the tables are hash joined in order, each into the
+// join of those before it, on the equalities between them.
+PlanOperator* SQLExec::plan_join(const FromTables& tables, const ColumnNames& column_names, Predicate& predicate) {
+    std::vector<PlanOperator*> inputs;
+    std::vector<double> estimates;
+    try {
+        for (const FromTable& from : tables) {
+            Predicate local, rest;
+            for (const Comparison& comparison : predicate) {
+                if (qualifier(comparison.column_name) == from.first
+                    && (comparison.is_literal() || qualifier(comparison.other_column_name) == from.first)) {
+                    local.push_back(comparison);
+                    local.back().column_name = unqualified(comparison.column_name);
+                    if (!comparison.is_literal())
+                        local.back().other_column_name = unqualified(comparison.other_column_name);
+                } else {
+                    rest.push_back(comparison);
+                }
+            }
+            predicate = rest;
+
+            ColumnNames read, qualified;
+            for (const Identifier& column_name : column_names) {
+                if (qualifier(column_name) == from.first
+                    && find(qualified.begin(), qualified.end(), column_name) == qualified.end()) {
+                    read.push_back(unqualified(column_name));
+                    qualified.push_back(column_name);
+                }
+            }
+            ColumnNames needed = read;
+            for (const Comparison& comparison : local) {
+                needed.push_back(comparison.column_name);
+                if (!comparison.is_literal())
+                    needed.push_back(comparison.other_column_name);
+            }
+            HandleScan* scan = access_path(*from.second, needed, local);
+            estimates.push_back(scan->get_estimated_rows());
+            PlanOperator* input = scan;
+            if (!local.empty())
+                input = new Filter(input, local);
+            inputs.push_back(new Project(input, read, qualified));
+        }
+
+        std::vector<Identifier> joined = {tables.front().first};
+        for (size_t i = 1; i < tables.size(); i++) {
+            ColumnNames joined_keys, keys;
+            Predicate rest;
+            for (Comparison comparison : predicate) {
+                if (comparison.op == Comparison::EQ && !comparison.is_literal()) {
+                    Identifier left = qualifier(comparison.column_name), right = qualifier(comparison.other_column_name);
+                    if (left == tables[i].first && find(joined.begin(), joined.end(), right) != joined.end()) {
+                        swap(comparison.column_name, comparison.other_column_name);
+                        swap(left, right);
+                    }
+                    if (right == tables[i].first && find(joined.begin(), joined.end(), left) != joined.end()) {
+                        joined_keys.push_back(comparison.column_name);
+                        keys.push_back(comparison.other_column_name);
+                        continue;
+                    }
+                }
+                rest.push_back(comparison);
+            }
+            if (keys.empty())
+                throw SQLExecError("no equality joins " + tables[i].first + " to the tables before it "
+                                   "(only equi-joins are implemented)");
+            predicate = rest;
+
+            // build on the smaller side; an equi-join is guessed to be as big as its bigger side
+            if (estimates[i] < estimates[0])
+                inputs[0] = new HashJoin(inputs[i], inputs[0], keys, joined_keys);
+            else
+                inputs[0] = new HashJoin(inputs[0], inputs[i], joined_keys, keys);
+            inputs[i] = nullptr;
+            estimates[0] = max(estimates[0], estimates[i]);
+            joined.push_back(tables[i].first);
+        }
+    } catch (...) {
+        for (PlanOperator* input : inputs)
+            delete input;
+        throw;
+    }
+
+    PlanOperator* plan = inputs[0];
+    if (!predicate.empty())
+        plan = new Filter(plan, predicate);
+    return plan;
+}
+
+HandleScan* SQLExec::access_path(DbRelation& table, const ColumnNames& column_names, Predicate& predicate) {
+    const Identifier& table_name = table.get_table_name();
+    IndexInfos indices;
+    for (Identifier& index_name : SQLExec::indices->get_index_names(table_name)) {
+        if (Catalog::get_index(table_name, index_name)->index_type == BloomIndex::INDEX_TYPE)
+            continue;  // the scans use its filters, but it can't find rows itself
+        ColumnNames key_columns;
+        bool is_hash, is_unique;
+        SQLExec::indices->get_columns(table_name, index_name, key_columns, is_hash, is_unique);
+        indices.push_back(IndexInfo(SQLExec::indices->get_index(table_name, index_name), key_columns, is_hash,
+                                    is_unique));
+    }
+    return Optimizer::access_path(table, indices, table_statistics(table), column_names, predicate);
+}
+
+PlanOperator* SQLExec::plan_parallel(TableScan* scan, const Predicate& predicate, uint workers,
+                                     const ColumnNames* group_columns, const Aggregates* aggregates,
+                                     size_t expected_groups) {
+    MorselQueue* morsels = new MorselQueue(scan->get_relation());
+    std::vector<PlanOperator*> pipelines;
+    std::vector<HashAggregate*> aggregators;
+    for (uint i = 0; i < workers; i++) {
+        PlanOperator* pipeline = new MorselScan(*scan, morsels);
+        if (!predicate.empty())
+            pipeline = new Filter(pipeline, predicate);
+        if (aggregates != nullptr)
+            aggregators.push_back(new HashAggregate(pipeline, *group_columns, *aggregates, expected_groups, SIZE_MAX));
+        else
+            pipelines.push_back(pipeline);
+    }
+    delete scan;
+    if (aggregates != nullptr)
+        return new ParallelAggregate(aggregators, morsels);
+    return new Gather(pipelines, morsels);
+}
+
+TableStatistics SQLExec::table_statistics(DbRelation& table) {
+    TableStatistics statistics(table);
+    double row_count, block_count;
+    ColumnStatisticsMap columns;
+    if (SQLExec::statistics->get_statistics(table.get_table_name(), row_count, block_count, columns))
+        statistics.use_collected(row_count, block_count, columns);
+    return statistics;
+}
+
+// Comparison with its sides swapped, e.g. 5 < x becomes x > 5.
+static Comparison::Op flip(Comparison::Op op) {
+    switch (op) {
+        case Comparison::LT:
+            return Comparison::GT;
+        case Comparison::LE:
+            return Comparison::GE;
+        case Comparison::GT:
+            return Comparison::LT;
+        case Comparison::GE:
+            return Comparison::LE;
+        default:
+            return op;
+    }
+}
+
+void SQLExec::where_clause(const Expr* expr, const FromTables& tables, Predicate& predicate) {
+    if (expr->type != kExprOperator)
+        throw SQLExecError("only comparisons are implemented in where clauses");
+    if (expr->opType == Expr::AND) {
+        where_clause(expr->expr, tables, predicate);
+        where_clause(expr->expr2, tables, predicate);
+        return;
+    }
+
+    Comparison::Op op;
+    switch (expr->opType) {
+        case Expr::SIMPLE_OP:
+            if (expr->opChar == '=')
+                op = Comparison::EQ;
+            else if (expr->opChar == '<')
+                op = Comparison::LT;
+            else if (expr->opChar == '>')
+                op = Comparison::GT;
+            else
+                throw SQLExecError("unrecognized operator " + string(1, expr->opChar));
+            break;
+        case Expr::NOT_EQUALS:
+            op = Comparison::NE;
+            break;
+        case Expr::LESS_EQ:
+            op = Comparison::LE;
+            break;
+        case Expr::GREATER_EQ:
+            op = Comparison::GE;
+            break;
+        default:
+            throw SQLExecError("only ANDs of comparisons are implemented in where clauses");
+    }
+
+    // put the column on the left
+    const Expr* left = expr->expr;
+    const Expr* right = expr->expr2;
+    if (left->type != kExprColumnRef) {
+        swap(left, right);
+        op = flip(op);
+    }
+    if (left->type != kExprColumnRef)
+        throw SQLExecError("a comparison in the where clause must involve a column");
+
+    ColumnAttribute::DataType data_type;
+    Identifier column_name = column_ref(left, tables, data_type);
+    if (right->type == kExprColumnRef) {
+        ColumnAttribute::DataType other_data_type;
+        Identifier other_column_name = column_ref(right, tables, other_data_type);
+        if (other_data_type != data_type)
+            throw SQLExecError("cannot compare columns " + column_name + " and " + other_column_name);
+        predicate.push_back(Comparison(column_name, op, other_column_name, data_type));
+    } else {
+        predicate.push_back(Comparison(column_name, op, literal(right, data_type)));
+    }
+}
+
+Identifier SQLExec::column_ref(const Expr* expr, const FromTables& tables, ColumnAttribute::DataType& data_type) {
+    Identifier found;
+    for (const FromTable& from : tables) {
+        if (expr->table != nullptr && from.first != expr->table)
+            continue;
+        const ColumnNames& table_columns = from.second->get_column_names();
+        size_t i = find(table_columns.begin(), table_columns.end(), string(expr->name)) - table_columns.begin();
+        if (i == table_columns.size())
+            continue;
+        if (!found.empty())
+            throw SQLExecError("column " + string(expr->name) + " is ambiguous");
+        found = tables.size() == 1 ? table_columns[i] : from.first + "." + table_columns[i];
+        ColumnAttribute column_attribute = from.second->get_column_attributes()[i];
+        data_type = column_attribute.get_data_type();
+    }
+    if (found.empty()) {
+        if (expr->table != nullptr)
+            throw SQLExecError("no such column " + string(expr->table) + "." + string(expr->name));
+        if (tables.size() == 1)
+            throw SQLExecError("no such column " + string(expr->name) + " in table " + tables.front().first);
+        throw SQLExecError("no such column " + string(expr->name));
+    }
+    return found;
+}
+
+Aggregate SQLExec::aggregate_ref(const Expr* expr, const FromTables& tables) {
+    static const std::vector<std::pair<string, Aggregate::Function>> functions = {
+            {"COUNT", Aggregate::COUNT}, {"SUM", Aggregate::SUM}, {"MIN", Aggregate::MIN}, {"MAX", Aggregate::MAX},
+            {"AVG", Aggregate::AVG}};
+    string name(expr->name);
+    transform(name.begin(), name.end(), name.begin(), ::toupper);
+    auto function = functions.begin();
+    while (function != functions.end() && function->first != name)
+        function++;
+    if (function == functions.end())
+        throw SQLExecError("unknown function " + string(expr->name));
+    if (expr->distinct)
+        throw SQLExecError(name + "(DISTINCT ...) is not implemented");
+    if (expr->expr == nullptr)
+        throw SQLExecError(name + " needs an argument");
+    if (expr->expr->type == kExprStar) {
+        if (function->second != Aggregate::COUNT)
+            throw SQLExecError(name + "(*) is not allowed");
+        return Aggregate(Aggregate::COUNT, "", "COUNT(*)");
+    }
+    if (expr->expr->type != kExprColumnRef)
+        throw SQLExecError("only aggregates of columns are implemented");
+    ColumnAttribute::DataType data_type;
+    Identifier column_name = column_ref(expr->expr, tables, data_type);
+    if (data_type == ColumnAttribute::TEXT && function->second != Aggregate::COUNT)
+        throw SQLExecError(name + " is only implemented for INT and BOOLEAN columns");
+    return Aggregate(function->second, column_name, name + "(" + column_name + ")", data_type);
+}
+
+DbRelation& SQLExec::get_existing_table(Identifier table_name) {
+    // check that the table exists before get_table makes one up
+    if (Catalog::get_table(table_name) == nullptr)
+        throw SQLExecError("no such table " + table_name);
+    return SQLExec::tables->get_table(table_name);
+}
@@ -5,10 +5,22 @@
  */
 #pragma once
 
+#include <condition_variable>
 #include <exception>
+#include <mutex>
+#include <set>
 #include <string>
 #include "SQLParser.h"
 #include "schema_tables.h"
+#include "QueryPlan.h"
+#include "Optimizer.h"
+#include "HashJoin.h"
+#include "Sort.h"
+#include "HashAggregate.h"
+#include "Parallel.h"
+#include "PlanCache.h"
+#include "SharedMutex.h"
+#include "Transaction.h"
 
 /**
  * @class SQLExecError - exception for SQLExec methods
@@ -21,34 +33,118 @@ public:
 
 /**
  * @class QueryResult - data structure to hold all the returned data for a query execution
+ *
+ * The result of a SELECT is a cursor over its plan rather than all of its rows:
+ * they are pulled from the plan a batch at a time as they are printed (or read
+ * with next()), so only one batch is held at once. Its message (the row count)
+ * is set once the last row has been read.
  */
 class QueryResult {
 public:
-    QueryResult() : column_names(nullptr), column_attributes(nullptr), rows(nullptr), message("") {}
+    QueryResult() : column_names(nullptr), column_attributes(nullptr), rows(nullptr), message(""), plan(nullptr),
+                    owns_plan(false), opened(false), row_count(0) {}
 
     QueryResult(std::string message) : column_names(nullptr), column_attributes(nullptr), rows(nullptr),
-                                       message(message) {}
+                                       message(message), plan(nullptr), owns_plan(false), opened(false),
+                                       row_count(0) {}
 
     QueryResult(ColumnNames* column_names, ColumnAttributes* column_attributes, ValueDicts* rows, std::string message)
-            : column_names(column_names), column_attributes(column_attributes), rows(rows), message(message) {}
+            : column_names(column_names), column_attributes(column_attributes), rows(rows), message(message),
+              plan(nullptr), owns_plan(false), opened(false), row_count(0) {}
+
+    /**
+     * Constructor for a cursor over the rows of a plan
+     * @param column_names       the result's columns (now owned by the result)
+     * @param column_attributes  their attributes (now owned by the result)
+     * @param plan               the plan, not yet opened
+     * @param owns_plan          true if the result is to free the plan; otherwise the plan must outlive it
+     */
+    QueryResult(ColumnNames* column_names, ColumnAttributes* column_attributes, PlanOperator* plan, bool owns_plan)
+            : column_names(column_names), column_attributes(column_attributes), rows(nullptr), message(""),
+              plan(plan), owns_plan(owns_plan), opened(false), row_count(0) {}
 
     virtual ~QueryResult();
 
+    QueryResult(const QueryResult& other) = delete;
+
+    QueryResult& operator=(const QueryResult& other) = delete;
+
     ColumnNames* get_column_names() const { return column_names; }
 
     ColumnAttributes* get_column_attributes() const { return column_attributes; }
 
-    ValueDicts* get_rows() const { return rows; }
+    /**
+     * Get the rows, first reading whatever rows are left in the cursor (if it is one) into memory.
+     * @returns  the rows (owned by the result), or nullptr if the result has no rows at all
+     */
+    virtual ValueDicts* get_rows();
+
+    /**
+     * Read the next rows of the cursor (or, if there is no cursor, none).
+     * @param batch  emptied and then filled with the next rows
+     * @returns      false (with an empty batch) once there are no more
+     * @throws       SQLExecError if the plan fails
+     */
+    virtual bool next(RowBatch& batch);
 
     const std::string& get_message() const { return message; }
 
-    friend std::ostream& operator<<(std::ostream& stream, const QueryResult& qres);
+    friend std::ostream& operator<<(std::ostream& stream, QueryResult& qres);
+
+    friend class ResultWriter;
 
 protected:
     ColumnNames* column_names;
     ColumnAttributes* column_attributes;
     ValueDicts* rows;
     std::string message;
+    PlanOperator* plan;  // the cursor's plan (nullptr once it has all been read)
+    bool owns_plan;
+    bool opened;
+    size_t row_count;  // rows read from the cursor
+
+    /**
+     * Done with the cursor's plan: close it and set the message.
+     */
+    virtual void finish();
+};
+
+
+/**
+ * A table in a FROM clause, with the name (its alias, if any) that qualifies its columns
+ */
+using FromTable = std::pair<Identifier, DbRelation*>;
+using FromTables = std::vector<FromTable>;
+
+
+/**
+ * @class SQLSession - what one client of the engine keeps from one statement to the next
+ *
+ * SQLExec works on behalf of the current session (see SQLExec::set_session),
+ * so that, e.g., two clients can each PREPARE a statement of the same name,
+ * have a transaction of their own going, or commit with a durability of their own.
+ */
+class SQLSession {
+public:
+    SQLSession();
+
+    virtual ~SQLSession();  // deallocates the session's prepared statements and rolls back its transaction
+
+    SQLSession(const SQLSession& other) = delete;
+
+    SQLSession& operator=(const SQLSession& other) = delete;
+
+    // those made by PREPARE
+    std::map<Identifier, PreparedStatement*> prepared_statements;
+
+    // from BEGIN until COMMIT or ROLLBACK (nullptr if none)
+    DbTxn* transaction;
+
+    // from SET DURABILITY, for commits that write tables without one of their own
+    Transaction::Durability durability;
+
+    // tables written since the top-level transaction began
+    std::set<Identifier> written;
 };
 
 
@@ -60,19 +156,229 @@ public:
     /**
      * Execute the given SQL statement.
      * @param statement   the Hyrise AST of the SQL statement to execute
+     * @param index_type  for CREATE INDEX, the kind of index if not the parsed one
+     *                    (the parser knows BTREE and HASH, but not BLOOM)
+     * @returns           the query result (freed by caller)
+     */
+    static QueryResult* execute(const hsql::SQLStatement* statement, Identifier index_type = "");
+
+    /**
+     * Describe how the given SQL statement would be executed, without executing it.
+     * @param statement   the Hyrise AST of the SELECT or DELETE statement to explain
+     * @returns           the query result, whose message is the plan (freed by caller)
+     */
+    static QueryResult* explain(const hsql::SQLStatement* statement);
+
+    /**
+     * Execute: ANALYZE <table_name>, collecting statistics on the table for the optimizer.
+     * @param table_name  table to analyze
      * @returns           the query result (freed by caller)
      */
-    static QueryResult* execute(const hsql::SQLStatement* statement);
+    static QueryResult* analyze(Identifier table_name);
+
+    /**
+     * Take the plan cache's statement for some SQL out of the cache, or parse a
+     * new one if it is a single SELECT, INSERT, or DELETE not seen before. No
+     * other thread can run the statement (or its kept plan) until it is given
+     * back with uncache.
+     * @param sql         the SQL
+     * @param normalized  returned by reference: the SQL the statement is cached under
+     * @param parameters  returned by reference: the SQL's literals, to bind to the statement
+     * @returns           the statement, or nullptr if the SQL isn't one the cache takes
+     */
+    static PreparedStatement* cached(const std::string& sql, std::string& normalized, std::vector<Value>& parameters);
+
+    /**
+     * Give a statement from cached back to the plan cache (before the schema
+     * lock is let go, so that DDL finds it there to invalidate).
+     * @param normalized  what cached returned it under
+     * @param prepared    the statement (now owned by the cache)
+     */
+    static void uncache(const std::string& normalized, PreparedStatement* prepared);
+
+    /**
+     * Execute a prepared statement with the values bound to it now, using the
+     * plan it kept if it has one (and keeping the one built if not).
+     * @param prepared  the statement
+     * @returns         the query result (freed by caller); a SELECT's reads from the
+     *                  kept plan, so it must be freed before the statement is
+     *                  executed again, bound to other values, or invalidated
+     */
+    static QueryResult* execute(PreparedStatement& prepared);
+
+    /**
+     * Execute: PREPARE <name> AS <statement>, with a placeholder (?) in the statement for each parameter.
+     * @param name  name to give the prepared statement
+     * @param sql   the SELECT, INSERT, or DELETE to prepare
+     * @returns     the query result (freed by caller)
+     */
+    static QueryResult* prepare(Identifier name, const std::string& sql);
+
+    /**
+     * Get a statement made by PREPARE (for EXECUTE).
+     * @param name  its name
+     * @returns     the statement
+     * @throws      SQLExecError if there is no prepared statement by that name
+     */
+    static PreparedStatement& get_prepared(Identifier name);
+
+    /**
+     * Execute: DEALLOCATE <name>, dropping a statement made by PREPARE.
+     * @param name  its name
+     * @returns     the query result (freed by caller)
+     */
+    static QueryResult* deallocate(Identifier name);
+
+    /**
+     * Execute: BEGIN, starting a transaction for the session that lasts until COMMIT or ROLLBACK.
+     * @returns  the query result (freed by caller)
+     */
+    static QueryResult* begin();
+
+    /**
+     * Execute: COMMIT. The commit is in the log, but may not be on disk until
+     * Transaction::wait_durable(ticket) returns.
+     * @param ticket  returned by reference: what to wait for
+     * @returns       the query result (freed by caller)
+     */
+    static QueryResult* commit(uint64_t& ticket);
+
+    /**
+     * Execute: ROLLBACK, undoing everything done since BEGIN.
+     * @returns  the query result (freed by caller)
+     */
+    static QueryResult* rollback();
+
+    /**
+     * Execute: SET DURABILITY = { SYNC | WRITE_NO_SYNC | ASYNC } [FOR table_name].
+     * A commit is as durable as the most durable of the tables it wrote, each
+     * at its own durability if it has one and at the session's if not.
+     * @param durability  the durability
+     * @param table_name  the table to set it for, or "" for the session
+     * @returns           the query result (freed by caller)
+     */
+    static QueryResult* set_durability(Transaction::Durability durability, Identifier table_name = "");
+
+    /**
+     * Start the transaction a statement (and the reading of its result) runs
+     * in: nested in the session's, so that a failed statement can be undone on
+     * its own, or else a snapshot transaction of the statement's own, which
+     * neither waits for nor blocks other sessions' open transactions.
+     */
+    static void begin_statement();
+
+    /**
+     * Finish the transaction begun by begin_statement().
+     * @param ok  false to undo what the statement did
+     * @returns   ticket for Transaction::wait_durable (0 if there's nothing to wait for)
+     */
+    static uint64_t end_statement(bool ok);
+
+    /**
+     * Make a session the one statements are executed for by the current thread.
+     * @param session  the session, or nullptr for the default one (used by the shell and the tests)
+     */
+    static void set_session(SQLSession* session) { SQLExec::session = session; }
+
+    /**
+     * Held shared by each statement while it runs (and its result is read), so
+     * that statements of different sessions run at the same time, and held
+     * exclusively by those that change what the others are planned and run on:
+     * CREATE, DROP, ANALYZE, and SET DURABILITY. Rows are kept apart by Berkeley
+     * DB's locks and snapshots, and by the write locks of lock_for_write.
+     */
+    static SharedMutex schema_lock;
+
+    /**
+     * Microseconds a write waits for another session's write lock on its table
+     */
+    static const unsigned WRITE_LOCK_TIMEOUT = 5000000;
 
 protected:
-    // the one place in the system that holds the _tables and _indices tables
+    // the one place in the system that holds the _tables, _indices, and _statistics tables
     static Tables* tables;
     static Indices* indices;
+    static Statistics* statistics;
+
+    // statements seen lately (by any session)
+    static PlanCache plan_cache;
+
+    // every session there is (so DDL can reach all their prepared statements), and the current thread's
+    static std::set<SQLSession*> sessions;
+    static std::mutex sessions_mutex;
+    static SQLSession default_session;
+    static thread_local SQLSession* session;
+
+    // from SET DURABILITY ... FOR table_name (kept in memory only)
+    static std::map<Identifier, Transaction::Durability> table_durabilities;
+
+    // the session writing each table (see lock_for_write)
+    static std::map<Identifier, SQLSession*> writers;
+    static std::mutex writers_mutex;
+    static std::condition_variable writers_changed;
+
+    // the tables (with an index name of "") and indices the current thread's statement creates or drops,
+    // and those of them it has made a file for
+    static thread_local std::vector<std::pair<Identifier, Identifier>> changed;
+    static thread_local std::vector<std::pair<Identifier, Identifier>> created;
+
+    /**
+     * Commit the session's top-level transaction (or the statement's, if that is the top level).
+     * @param txn  the transaction
+     * @returns    ticket for Transaction::wait_durable (0 if the commit needn't be waited for)
+     */
+    static uint64_t commit_top_level(DbTxn* txn);
+
+    /**
+     * Let the session write a table, once any other session that has written it
+     * has ended its top-level transaction. Two sessions writing a table at once
+     * would each change its blocks as of their own snapshots, and whichever
+     * committed last would undo the other's changes. The lock is kept until the
+     * session's top-level transaction ends, or, outside of any transaction,
+     * until the statement does. A statement outside of BEGIN starts its
+     * snapshot again once it has the lock, so that it writes on top of whatever
+     * the table's last writer committed.
+     * @param table_name  the table
+     * @throws            SQLExecError if the table is still being written after WRITE_LOCK_TIMEOUT
+     */
+    static void lock_for_write(Identifier table_name);
+
+    /**
+     * Let go of the tables the session has locked with lock_for_write.
+     * @param session  the session
+     */
+    static void release_write_locks(SQLSession& session);
+
+    // lets go of the session's write locks when it goes out of scope, if there is no transaction
+    // (the statement's writes were each committed as they were made)
+    struct AutoCommitted {
+        ~AutoCommitted();
+    };
+
+    friend class SQLSession;
+
+    static SQLSession& current_session() { return session != nullptr ? *session : default_session; }
+
+    static void open_schema_tables();
+
+    /**
+     * Drop the cached statements and kept plans that refer to a table, before
+     * DDL (or ANALYZE) changes what they were planned on.
+     * @param table_name  the table
+     */
+    static void invalidate(Identifier table_name);
+
+    /**
+     * Put the catalog and the cached tables and indices back the way they
+     * were before a DDL statement whose transaction has just been aborted,
+     * removing the files it created (which were made outside of it).
+     */
+    static void undo_schema_changes();
 
     // recursive decent into the AST
-    static QueryResult* create(const hsql::CreateStatement* statement);
+    static QueryResult* create(const hsql::CreateStatement* statement, Identifier index_type);
     static QueryResult* create_table(const hsql::CreateStatement* statement);
-    static QueryResult* create_index(const hsql::CreateStatement* statement);
+    static QueryResult* create_index(const hsql::CreateStatement* statement, Identifier index_type);
 
     static QueryResult* drop(const hsql::DropStatement* statement);
     static QueryResult* drop_table(const hsql::DropStatement* statement);
@@ -83,6 +389,141 @@ protected:
     static QueryResult* show_columns(const hsql::ShowStatement* statement);
     static QueryResult* show_index(const hsql::ShowStatement* statement);
 
+    static QueryResult* insert(const hsql::InsertStatement* statement);
+
+    static QueryResult* del(const hsql::DeleteStatement* statement);
+
+    /**
+     * Delete the rows a DELETE's plan finds, and their index entries.
+     * @param statement  AST of the DELETE
+     * @param plan       its plan (from plan_delete)
+     * @returns          the query result (freed by caller)
+     */
+    static QueryResult* del(const hsql::DeleteStatement* statement, PlanOperator& plan);
+
+    /**
+     * Build the plan producing the handles of the rows a DELETE removes.
+     * @param statement  AST of the DELETE
+     * @returns          the root of the plan (freed by caller)
+     */
+    static PlanOperator* plan_delete(const hsql::DeleteStatement* statement);
+
+    static QueryResult* select(const hsql::SelectStatement* statement);
+
+    /**
+     * Get a cursor over the rows of a SELECT's plan.
+     * @param plan               its plan (from plan_select)
+     * @param column_names       the result's columns
+     * @param column_attributes  their attributes
+     * @param owns_plan          true if the result is to free the plan; otherwise the plan must outlive it
+     * @returns                  the query result (freed by caller)
+     */
+    static QueryResult* select(PlanOperator* plan, const ColumnNames& column_names,
+                               const ColumnAttributes& column_attributes, bool owns_plan);
+
+    /**
+     * Build the physical plan for a SELECT. With more than one table in the
+     * FROM clause, column names are qualified with their tables' names.
+     * @param statement          AST of the SELECT
+     * @param column_names       returned by reference: the result's columns
+     * @param column_attributes  returned by reference: their attributes
+     * @returns                  the root of the plan (freed by caller)
+     */
+    static PlanOperator* plan_select(const hsql::SelectStatement* statement, ColumnNames& column_names,
+                                     ColumnAttributes& column_attributes);
+
+    /**
+     * Pick the leaf of the plan for reading a table: whichever of a table scan
+     * or a lookup or range scan on one of its indices the Optimizer estimates
+     * reads the fewest blocks (using the table's statistics, if analyzed).
+     * @param table         table to read
+     * @param column_names  columns the rest of the plan needs
+     * @param predicate     where-clause comparisons; those the leaf fully
+     *                      handles are removed (returned by reference)
+     * @returns             the leaf operator (freed by caller)
+     */
+    static HandleScan* access_path(DbRelation& table, const ColumnNames& column_names, Predicate& predicate);
+
+    /**
+     * Spread a table scan across worker threads, each taking morsels of the table
+     * and running its own copy of the filter (and of the aggregate, if given) on them.
+     * @param scan             the table scan to spread (freed here)
+     * @param predicate        comparisons left for the filter
+     * @param workers          number of worker threads
+     * @param group_columns    columns for the workers to group by (nullptr to not aggregate)
+     * @param aggregates       aggregates for the workers to compute (nullptr to not aggregate)
+     * @param expected_groups  estimated number of groups
+     * @returns                the root of the plan (freed by caller)
+     */
+    static PlanOperator* plan_parallel(TableScan* scan, const Predicate& predicate, uint workers,
+                                       const ColumnNames* group_columns = nullptr,
+                                       const Aggregates* aggregates = nullptr, size_t expected_groups = 0);
+
+    /**
+     * What the Optimizer knows about a table (from ANALYZE, if it has been analyzed).
+     * @param table  the table
+     * @returns      its statistics
+     */
+    static TableStatistics table_statistics(DbRelation& table);
+
+    /**
+     * Pull out the tables from an AST from clause (only tables, cross products,
+     * and inner joins are supported).
+     * @param table_ref   AST from clause
+     * @param tables      returned by reference: the tables, in order
+     * @param conditions  returned by reference: the joins' ON conditions
+     */
+    static void from_clause(const hsql::TableRef* table_ref, FromTables& tables,
+                            std::vector<const hsql::Expr*>& conditions);
+
+    /**
+     * Build the plan joining the tables of a multi-table SELECT.
+     * @param tables        the tables, in the order to join them
+     * @param column_names  qualified columns the rest of the plan needs
+     * @param predicate     comparisons on qualified columns; those the plan
+     *                      doesn't handle are left (returned by reference)
+     * @returns             the root of the plan (freed by caller)
+     */
+    static PlanOperator* plan_join(const FromTables& tables, const ColumnNames& column_names, Predicate& predicate);
+
+    /**
+     * Pull out the comparisons from an AST where clause (only ANDs of comparisons
+     * between a column and a literal or another column are supported).
+     * @param expr       AST where clause (or join condition)
+     * @param tables     tables the columns belong to
+     * @param predicate  returned by reference: the comparisons
+     */
+    static void where_clause(const hsql::Expr* expr, const FromTables& tables, Predicate& predicate);
+
+    /**
+     * Find the column an AST column reference is to.
+     * @param expr       AST column reference
+     * @param tables     the tables it could be in
+     * @param data_type  returned by reference: the column's data type
+     * @returns          the column's name (qualified if there is more than one table)
+     * @throws           SQLExecError if there is no such column or more than one
+     */
+    static Identifier column_ref(const hsql::Expr* expr, const FromTables& tables, ColumnAttribute::DataType& data_type);
+
+    /**
+     * Make the aggregate for an AST function call, e.g. COUNT(*) or SUM(a).
+     * Its output name is the call in upper case, with the column named as by column_ref.
+     * @param expr    AST function reference
+     * @param tables  the tables its column could be in
+     * @returns       the aggregate
+     * @throws        SQLExecError if it isn't COUNT, SUM, MIN, MAX, or AVG of a column
+     *                (only COUNT can be of a TEXT column, or of *)
+     */
+    static Aggregate aggregate_ref(const hsql::Expr* expr, const FromTables& tables);
+
+    /**
+     * Get a user or schema table, checking that it exists.
+     * @param table_name  table to get
+     * @returns           the table
+     * @throws            SQLExecError if there is no such table
+     */
+    static DbRelation& get_existing_table(Identifier table_name);
+
     /**
      * Pull out column name and attributes from AST's column definition clause
      * @param col                AST column definition
@@ -0,0 +1,256 @@
+/**
+ * @file SQLServer.cpp - implementation of SocketBuffer and SQLServer classes
+ * @author Justin Thoreson
+ * @see "Seattle University, CPSC5300, Winter 2023"
+ */
+
+#include <cctype>
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#include "SQLServer.h"
+
+SocketBuffer::SocketBuffer(int fd) : fd(fd), out(BUFFER_SIZE) {
+    this->setp(this->out.data(), this->out.data() + this->out.size());
+}
+
+SocketBuffer::~SocketBuffer() {
+    this->sync();
+    ::close(this->fd);
+}
+
+SocketBuffer::int_type SocketBuffer::overflow(int_type c) {
+    if (this->sync() != 0)
+        return traits_type::eof();
+    if (!traits_type::eq_int_type(c, traits_type::eof())) {
+        *this->pptr() = traits_type::to_char_type(c);
+        this->pbump(1);
+    }
+    return traits_type::not_eof(c);
+}
+
+// MSG_NOSIGNAL, so that a client that has gone away is an error here rather than a SIGPIPE.
+int SocketBuffer::sync() {
+    const char* p = this->pbase();
+    while (p < this->pptr()) {
+        ssize_t n = ::send(this->fd, p, this->pptr() - p, MSG_NOSIGNAL);
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n <= 0) {
+            this->setp(this->out.data(), this->out.data() + this->out.size());
+            return -1;
+        }
+        p += n;
+    }
+    this->setp(this->out.data(), this->out.data() + this->out.size());
+    return 0;
+}
+
+// Where the first statement in some text ends (just past its semicolon), by
+// the same rules as SQLShell::read_statement, or npos if it isn't all there yet.
+static size_t statement_end(const std::string& text) {
+    char quote = 0;
+    bool empty = true;
+    for (size_t i = 0; i < text.size(); i++) {
+        char c = text[i];
+        if (quote != 0) {
+            if (c == quote)
+                quote = 0;
+        } else if (c == '\'' || c == '"') {
+            quote = c;
+            empty = false;
+        } else if (c == '-' && i + 1 < text.size() && text[i + 1] == '-') {
+            i = text.find('\n', i);
+            if (i == std::string::npos)
+                break;
+        } else if (c == ';') {
+            if (!empty)
+                return i + 1;
+        } else if (!std::isspace(c)) {
+            empty = false;
+        }
+    }
+    return std::string::npos;
+}
+
+bool SQLServer::Session::is_ready() const {
+    return this->hung_up || statement_end(this->pending) != std::string::npos;
+}
+
+// Once the client has hung up, whatever it sent last counts as a statement, as at the end of a script.
+bool SQLServer::Session::take_statement(std::string& sql) {
+    size_t end = statement_end(this->pending);
+    std::istringstream in(this->pending.substr(0, end));
+    this->pending.erase(0, end);
+    return SQLShell::read_statement(in, sql);
+}
+
+SQLServer::SQLServer(const std::string& socket_path, uint workers)
+    : socket_path(socket_path), n_workers(workers == 0 ? 1 : workers), listen_fd(-1), wake_fds{-1, -1},
+      stopping(false), workers(), idle(), queue_mutex(), ready_cv(), ready(), returned(), done(false) {}
+
+SQLServer::~SQLServer() {
+    for (Session* session: this->idle)
+        delete session;
+    for (Session* session: this->ready)
+        delete session;
+    for (Session* session: this->returned)
+        delete session;
+    if (this->listen_fd >= 0) {
+        ::close(this->listen_fd);
+        ::unlink(this->socket_path.c_str());
+    }
+    for (int fd: this->wake_fds)
+        if (fd >= 0)
+            ::close(fd);
+}
+
+void SQLServer::run() {
+    struct sockaddr_un address;
+    if (this->socket_path.size() >= sizeof(address.sun_path))
+        throw std::runtime_error("socket path too long: " + this->socket_path);
+    std::memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    std::strcpy(address.sun_path, this->socket_path.c_str());
+    this->listen_fd = ::socket(AF_UNIX, SOCK_STREAM, 0);
+    if (this->listen_fd < 0 || ::pipe(this->wake_fds) != 0)
+        throw std::runtime_error(std::string("cannot make socket: ") + std::strerror(errno));
+    for (int fd: this->wake_fds)
+        ::fcntl(fd, F_SETFL, O_NONBLOCK);
+    ::unlink(this->socket_path.c_str());
+    if (::bind(this->listen_fd, (struct sockaddr*) &address, sizeof(address)) != 0
+        || ::listen(this->listen_fd, SOMAXCONN) != 0)
+        throw std::runtime_error("cannot listen on " + this->socket_path + ": " + std::strerror(errno));
+
+    for (uint i = 0; i < this->n_workers; i++)
+        this->workers.push_back(std::thread(&SQLServer::work, this));
+
+    std::vector<struct pollfd> fds;
+    while (!this->stopping) {
+        {
+            std::lock_guard<std::mutex> lock(this->queue_mutex);
+            this->idle.insert(this->idle.end(), this->returned.begin(), this->returned.end());
+            this->returned.clear();
+        }
+        fds.assign({{this->listen_fd, POLLIN, 0}, {this->wake_fds[0], POLLIN, 0}});
+        for (Session* session: this->idle)
+            fds.push_back({session->buffer.get_fd(), POLLIN, 0});
+        if (::poll(fds.data(), fds.size(), -1) < 0) {
+            if (errno == EINTR)
+                continue;
+            break;
+        }
+        if (fds[1].revents != 0) {
+            char drain[64];
+            while (::read(this->wake_fds[0], drain, sizeof(drain)) > 0)
+                continue;
+        }
+        if (fds[0].revents & POLLIN) {
+            int fd = ::accept(this->listen_fd, nullptr, nullptr);
+            if (fd >= 0)
+                this->idle.push_back(new Session(fd));
+        }
+
+        // a session goes to a worker once it has a whole statement (or the client has hung up)
+        std::vector<Session*> still_idle;
+        std::vector<Session*> woken;
+        for (size_t i = 2; i < fds.size(); i++) {
+            Session* session = this->idle[i - 2];
+            if (fds[i].revents != 0)
+                this->receive(*session);
+            (session->is_ready() ? woken : still_idle).push_back(session);
+        }
+        for (size_t i = fds.size() - 2; i < this->idle.size(); i++)
+            still_idle.push_back(this->idle[i]);  // accepted just now
+        this->idle.swap(still_idle);
+        if (!woken.empty()) {
+            std::lock_guard<std::mutex> lock(this->queue_mutex);
+            this->ready.insert(this->ready.end(), woken.begin(), woken.end());
+            this->ready_cv.notify_all();
+        }
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(this->queue_mutex);
+        this->done = true;
+        this->ready_cv.notify_all();
+    }
+    for (std::thread& worker: this->workers)
+        worker.join();
+    this->workers.clear();
+}
+
+void SQLServer::stop() {
+    this->stopping = true;
+    this->wake();
+}
+
+void SQLServer::wake() {
+    if (this->wake_fds[1] >= 0) {
+        char c = 0;
+        ssize_t ignored = ::write(this->wake_fds[1], &c, 1);
+        (void) ignored;
+    }
+}
+
+// A session whose client sent more than one statement at once goes straight
+// back on the ready queue, since poll() can't see what has already been read.
+void SQLServer::work() {
+    while (true) {
+        Session* session;
+        {
+            std::unique_lock<std::mutex> lock(this->queue_mutex);
+            this->ready_cv.wait(lock, [this] { return this->done || !this->ready.empty(); });
+            if (this->done)
+                return;
+            session = this->ready.front();
+            this->ready.pop_front();
+        }
+        if (!this->serve(*session)) {
+            delete session;
+            continue;
+        }
+        std::lock_guard<std::mutex> lock(this->queue_mutex);
+        if (session->is_ready()) {
+            this->ready.push_back(session);
+            this->ready_cv.notify_one();
+        } else {
+            this->returned.push_back(session);
+            this->wake();
+        }
+    }
+}
+
+// The shell writes to the socket as the result's rows are read (the socket's
+// buffer is sent whenever it fills), and flushes once any commit is durable;
+// the NUL then says the statement's output has ended.
+bool SQLServer::serve(Session& session) {
+    std::string sql;
+    if (!session.take_statement(sql) || sql == SQLShell::QUIT)
+        return false;
+    try {
+        session.shell.handle(sql);
+    } catch (std::exception& e) {
+        session.stream << "Error: " << e.what() << std::endl;
+    }
+    session.stream << '\0' << std::flush;
+    return session.stream.good();
+}
+
+// Called once poll() has said there is something to read, so the one recv() doesn't wait.
+void SQLServer::receive(Session& session) {
+    char data[SocketBuffer::BUFFER_SIZE];
+    ssize_t n;
+    do {
+        n = ::recv(session.buffer.get_fd(), data, sizeof(data), MSG_DONTWAIT);
+    } while (n < 0 && errno == EINTR);
+    if (n > 0)
+        session.pending.append(data, n);
+    else if (n == 0 || (errno != EAGAIN && errno != EWOULDBLOCK))
+        session.hung_up = true;
+}
@@ -0,0 +1,158 @@
+/**
+ * @file SQLServer.h - Serving SQL sessions on a Unix domain socket.
+ * SocketBuffer: std::streambuf
+ * SQLServer
+ *
+ * @author Justin Thoreson
+ * @see "Seattle University, CPSC5300, Winter 2023"
+ */
+
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <iostream>
+#include <mutex>
+#include <sstream>
+#include <streambuf>
+#include <string>
+#include <thread>
+#include <vector>
+#include "SQLShell.h"
+
+/**
+ * @class SocketBuffer - stream buffer writing to a connected socket
+ */
+class SocketBuffer : public std::streambuf {
+public:
+    static const size_t BUFFER_SIZE = 1 << 16;
+
+    /**
+     * Constructor
+     * @param fd  the socket (closed by the buffer's destructor)
+     */
+    SocketBuffer(int fd);
+
+    virtual ~SocketBuffer();
+
+    SocketBuffer(const SocketBuffer& other) = delete;
+
+    SocketBuffer& operator=(const SocketBuffer& other) = delete;
+
+    int get_fd() const { return fd; }
+
+protected:
+    int fd;
+    std::vector<char> out;
+
+    virtual int_type overflow(int_type c);
+
+    virtual int sync();
+};
+
+
+/**
+ * @class SQLServer - serves any number of SQL sessions from a fixed pool of worker threads
+ *
+ * Each connection to the socket is a session with its own SQLShell (and so
+ * its own output format and prepared statements). A client sends statements
+ * ended by semicolons, as in a script; after the output for each (results and
+ * errors alike, in the session's output format), the server writes a NUL byte.
+ *
+ * The server's own thread waits for idle sessions to send something, reads
+ * what has come, and keeps it with the session until a whole statement has
+ * (or the client has hung up). Only then is the session handed to a worker,
+ * which runs the statement and gives the session back, so a session only has
+ * a thread while it has a statement running, and a slow client can't keep one
+ * waiting for the rest of a statement. The statement's output is written
+ * straight to the socket as its rows are read, a buffer at a time, so a large
+ * result is never held in memory and a client that is slow to read holds up
+ * only its own worker (and its own statement).
+ */
+class SQLServer {
+public:
+    /**
+     * Constructor
+     * @param socket_path  where to make the socket (replacing whatever is there)
+     * @param workers      number of worker threads
+     */
+    SQLServer(const std::string& socket_path, uint workers);
+
+    virtual ~SQLServer();
+
+    SQLServer(const SQLServer& other) = delete;
+
+    SQLServer& operator=(const SQLServer& other) = delete;
+
+    /**
+     * Serve sessions until stop() is called.
+     * @throws  std::runtime_error if the socket can't be made
+     */
+    virtual void run();
+
+    /**
+     * Have run() finish (once the statements running now are done). Safe to call from a signal handler.
+     */
+    virtual void stop();
+
+protected:
+    /**
+     * @class SQLServer::Session - a client's connection and the shell that serves it
+     */
+    class Session {
+    public:
+        Session(int fd) : buffer(fd), stream(&buffer), shell(stream, stream, false), pending(""), hung_up(false) {}
+
+        SocketBuffer buffer;
+        std::ostream stream;
+        SQLShell shell;
+        std::string pending;  // what the client has sent that hasn't been run yet
+        bool hung_up;         // nothing more will come from the client
+
+        /**
+         * Is there a statement to run (or the end of the session to deal with)?
+         */
+        bool is_ready() const;
+
+        /**
+         * Take the next statement out of what the client has sent.
+         * @param sql  returned by reference: the statement
+         * @returns    false if there isn't one
+         */
+        bool take_statement(std::string& sql);
+    };
+
+    std::string socket_path;
+    uint n_workers;
+    int listen_fd;
+    int wake_fds[2];  // a pipe for waking the server's thread
+    std::atomic<bool> stopping;
+    std::vector<std::thread> workers;
+    std::vector<Session*> idle;       // waiting for the client (only the server's thread uses these)
+    std::mutex queue_mutex;           // guards ready, returned, and done
+    std::condition_variable ready_cv;
+    std::deque<Session*> ready;       // with a statement (or the end of the connection) to run
+    std::vector<Session*> returned;   // given back by the workers
+    bool done;
+
+    /**
+     * A worker thread: serve ready sessions until the server is done.
+     */
+    virtual void work();
+
+    /**
+     * Run a session's next statement and send its output.
+     * @param session  the session
+     * @returns        false if the session is over
+     */
+    virtual bool serve(Session& session);
+
+    /**
+     * Read what a client has sent (without waiting for more).
+     * @param session  the session
+     */
+    virtual void receive(Session& session);
+
+    virtual void wake();
+};
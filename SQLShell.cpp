@@ -0,0 +1,353 @@
+/**
+ * @file SQLShell.cpp - implementation of SQLShell class
+ * @authors Kevin Lundeen, Justin Thoreson
+ * @see "Seattle University, CPSC5300, Winter 2023"
+ */
+
+#include <algorithm>
+#include <sstream>
+#include <strings.h>
+#include "SQLShell.h"
+#include "ParseTreeToString.h"
+#include "tests.h"
+
+using namespace std;
+using namespace hsql;
+
+const string SQLShell::QUIT = "quit";
+static const string TEST = "test", EXPLAIN = "explain ", ANALYZE = "analyze ";
+static const string PREPARE = "prepare ", EXECUTE = "execute ", DEALLOCATE = "deallocate ";
+static const string SET_FORMAT = "set format ", SET_DURABILITY = "set durability";
+static const string BEGIN = "begin", COMMIT = "commit", ROLLBACK = "rollback";
+static const string CREATE = "create ", DROP = "drop ";
+static const string CREATE_INDEX = "create index ", USING_BLOOM = " using bloom";
+
+// Does the SQL start with the given keyword (which includes a trailing space)?
+static bool starts_with(const string& sql, const string& keyword) {
+    return sql.size() > keyword.size() && strncasecmp(sql.c_str(), keyword.c_str(), keyword.size()) == 0;
+}
+
+// Is the SQL just the given keyword (with an optional TRANSACTION or WORK after it)?
+static bool is_command(string sql, const string& keyword) {
+    sql.erase(sql.find_last_not_of(" ;") + 1);
+    if (sql.size() < keyword.size() || strncasecmp(sql.c_str(), keyword.c_str(), keyword.size()) != 0)
+        return false;
+    string rest = sql.substr(keyword.size());
+    rest.erase(0, rest.find_first_not_of(' '));
+    return rest.empty() || strcasecmp(rest.c_str(), "transaction") == 0 || strcasecmp(rest.c_str(), "work") == 0;
+}
+
+// Semicolons inside quotes don't end a statement, and empty statements are skipped.
+bool SQLShell::read_statement(istream& in, string& sql) {
+    sql.clear();
+    char quote = 0;
+    char c;
+    while (in.get(c)) {
+        if (quote != 0) {
+            sql += c;
+            if (c == quote)
+                quote = 0;
+        } else if (c == '\'' || c == '"') {
+            quote = c;
+            sql += c;
+        } else if (c == '-' && in.peek() == '-') {
+            while (in.get(c) && c != '\n')
+                continue;
+            sql += ' ';
+        } else if (c == ';') {
+            if (sql.find_first_not_of(' ') != string::npos)
+                break;
+            sql.clear();
+        } else {
+            sql += c == '\n' || c == '\r' || c == '\t' ? ' ' : c;
+        }
+    }
+    size_t start = sql.find_first_not_of(' ');
+    if (start == string::npos) {
+        sql.clear();
+        return false;
+    }
+    sql = sql.substr(start, sql.find_last_not_of(' ') + 1 - start);
+    return true;
+}
+
+// Take USING BLOOM out of a CREATE INDEX for the parser (which knows only BTREE
+// and HASH), putting USING HASH in its place so it still parses.
+static bool take_bloom_index(string& sql) {
+    if (!starts_with(sql, CREATE_INDEX))
+        return false;
+    string lower = sql;
+    transform(lower.begin(), lower.end(), lower.begin(), ::tolower);
+    size_t using_bloom = lower.find(USING_BLOOM);
+    if (using_bloom == string::npos)
+        return false;
+    size_t end = using_bloom + USING_BLOOM.size();
+    if (end < sql.size() && sql[end] != ' ' && sql[end] != '(')
+        return false;
+    sql.replace(using_bloom, USING_BLOOM.size(), " USING HASH");
+    return true;
+}
+
+// Does the SQL change what other sessions' statements are planned and run on
+// (see SQLExec::schema_lock)? The tests do all of these things.
+static bool is_exclusive(const string& sql) {
+    return starts_with(sql, CREATE) || starts_with(sql, DROP) || starts_with(sql, ANALYZE)
+           || starts_with(sql, SET_DURABILITY) || sql == TEST;
+}
+
+SQLShell::SQLShell(ostream& out, ostream& err, bool echo)
+    : out(out), err(err), echo(echo), format(ResultWriter::TABLE), failed(false), session() {}
+
+// The schema lock is let go before waiting for a commit to reach the disk, so
+// that DDL isn't held up by the flush; and the output isn't flushed until
+// then, so that the client doesn't hear of a commit before it is durable.
+void SQLShell::handle(string sql) {
+    if (sql == QUIT || !sql.length()) return;
+    uint64_t ticket = 0;
+    SQLExec::set_session(&this->session);
+    try {
+        SharedLock lock(SQLExec::schema_lock, is_exclusive(sql));
+        if (sql == TEST) {
+            this->run_tests();  // they make and drop tables, each in its own transaction
+        } else if (!this->handle_transaction(sql, ticket)) {
+            SQLExec::begin_statement();
+            this->failed = false;
+            try {
+                this->handle_sql(sql);
+            } catch (DbException& e) {
+                this->error("DbException: " + string(e.what()));
+            } catch (...) {
+                SQLExec::end_statement(false);
+                throw;
+            }
+            ticket = SQLExec::end_statement(!this->failed);
+        }
+    } catch (...) {
+        SQLExec::set_session(nullptr);
+        throw;
+    }
+    SQLExec::set_session(nullptr);
+    Transaction::wait_durable(ticket);
+    this->out.flush();
+}
+
+bool SQLShell::handle_transaction(const string& sql, uint64_t& ticket) {
+    QueryResult* result;
+    try {
+        if (is_command(sql, BEGIN))
+            result = SQLExec::begin();
+        else if (is_command(sql, COMMIT))
+            result = SQLExec::commit(ticket);
+        else if (is_command(sql, ROLLBACK))
+            result = SQLExec::rollback();
+        else
+            return false;
+    } catch (SQLExecError& e) {
+        this->error(e.what());
+        return true;
+    } catch (DbException& e) {
+        this->error("DbException: " + string(e.what()));
+        return true;
+    }
+    this->print_result(*result);
+    delete result;
+    return true;
+}
+
+void SQLShell::error(const string& message) {
+    this->failed = true;
+    this->err << "Error: " << message << endl;
+}
+
+void SQLShell::handle_sql(string sql) {
+    // the parser doesn't know ANALYZE (which just takes a table name), so handle it ourselves
+    if (starts_with(sql, ANALYZE)) {
+        Identifier table_name = sql.substr(ANALYZE.size());
+        table_name.erase(table_name.find_last_not_of(" ;") + 1);
+        try {
+            QueryResult* result = SQLExec::analyze(table_name);
+            this->print_result(*result);
+            delete result;
+        } catch (SQLExecError& e) {
+            this->error(e.what());
+        }
+        return;
+    }
+
+    if (this->handle_prepared(sql))
+        return;
+
+    // SET FORMAT { TABLE | CSV | JSON | BINARY } picks how the results that follow are written
+    if (starts_with(sql, SET_FORMAT)) {
+        string name = sql.substr(SET_FORMAT.size());
+        name.erase(name.find_last_not_of(" ;") + 1);
+        if (ResultWriter::get_format(name, this->format))
+            this->out << "output format is " << name << endl;
+        else
+            this->error("unknown output format " + name + " (expected table, csv, json, or binary)");
+        return;
+    }
+
+    // SET DURABILITY [=] { SYNC | WRITE_NO_SYNC | ASYNC } [FOR <table>] picks how soon commits reach the disk
+    if (starts_with(sql, SET_DURABILITY)) {
+        istringstream words(sql.substr(SET_DURABILITY.size()));
+        string name, word, table_name;
+        words >> name;
+        if (name == "=")
+            words >> name;
+        else if (name.size() > 1 && name[0] == '=')
+            name = name.substr(1);
+        Transaction::Durability durability;
+        if (words >> word && (strcasecmp(word.c_str(), "for") != 0 || !(words >> table_name) || words >> word)) {
+            this->error("expected SET DURABILITY = <durability> [FOR <table>]");
+        } else if (!Transaction::get_durability(name, durability)) {
+            this->error("unknown durability " + name + " (expected sync, write_no_sync, or async)");
+        } else {
+            try {
+                QueryResult* result = SQLExec::set_durability(durability, table_name);
+                this->print_result(*result);
+                delete result;
+            } catch (SQLExecError& e) {
+                this->error(e.what());
+            }
+        }
+        return;
+    }
+
+    // the parser doesn't know EXPLAIN, so take it off the front ourselves
+    bool explain = starts_with(sql, EXPLAIN);
+    if (explain)
+        sql = sql.substr(EXPLAIN.size());
+
+    // statements seen before (give or take their literals) skip the parser, and maybe the planner
+    string normalized;
+    vector<Value> parameters;
+    PreparedStatement* cached = explain ? nullptr : SQLExec::cached(sql, normalized, parameters);
+    if (cached != nullptr) {
+        try {
+            this->run_prepared(*cached, parameters);
+        } catch (...) {
+            SQLExec::uncache(normalized, cached);
+            throw;
+        }
+        SQLExec::uncache(normalized, cached);
+        return;
+    }
+
+    Identifier index_type = take_bloom_index(sql) ? BloomIndex::INDEX_TYPE : "";
+    SQLParserResult* const parse = SQLParser::parseSQLString(sql);
+    if (parse->isValid()) {
+        this->handle_statements(parse, explain, index_type);
+    } else {
+        this->failed = true;
+        this->err << "invalid SQL: " << sql << endl << parse->errorMsg() << endl;
+    }
+    delete parse;
+}
+
+void SQLShell::handle_statements(SQLParserResult* parse, bool explain, Identifier index_type) {
+    size_t n_statements = parse->size();
+    for (size_t i = 0; i < n_statements; ++i) {
+        const SQLStatement* statement = parse->getStatement(i);
+        try {
+            if (this->echo)
+                this->out << ParseTreeToString::statement(statement) << endl;
+            QueryResult* result = explain ? SQLExec::explain(statement) : SQLExec::execute(statement, index_type);
+            this->print_result(*result);
+            delete result;
+        } catch (SQLExecError& e) {
+            this->error(e.what());
+        }
+    }
+}
+
+bool SQLShell::handle_prepared(string sql) {
+    if (!starts_with(sql, PREPARE) && !starts_with(sql, EXECUTE) && !starts_with(sql, DEALLOCATE))
+        return false;
+    try {
+        // PREPARE <name> AS <statement> | EXECUTE <name> [(<literal>, ...)] | DEALLOCATE <name>
+        size_t start = sql.find_first_not_of(' ', sql.find(' '));
+        size_t end = start == string::npos ? string::npos : sql.find_first_of(" (;", start);
+        if (start == string::npos)
+            throw SQLExecError("missing statement name");
+        Identifier name = sql.substr(start, end - start);
+        string rest = end == string::npos ? "" : sql.substr(end);
+        QueryResult* result;
+        if (starts_with(sql, PREPARE)) {
+            size_t as = rest.find_first_not_of(' ');
+            if (as == string::npos || strncasecmp(rest.c_str() + as, "as ", 3) != 0)
+                throw SQLExecError("expected PREPARE <name> AS <statement>");
+            result = SQLExec::prepare(name, rest.substr(as + 3));
+        } else if (starts_with(sql, EXECUTE)) {
+            string normalized, expected;
+            vector<Value> parameters;
+            if (!PlanCache::normalize(rest, normalized, parameters))
+                throw SQLExecError("invalid parameters for " + name);
+            normalized.erase(remove(normalized.begin(), normalized.end(), ' '), normalized.end());
+            for (size_t i = 0; i < parameters.size(); i++)
+                expected += i == 0 ? "?" : ",?";
+            if (!normalized.empty() && normalized != "(" + expected + ")")
+                throw SQLExecError("parameters must be a list of literals, e.g. EXECUTE " + name + " (1, 'a')");
+            this->run_prepared(SQLExec::get_prepared(name), parameters);
+            return true;
+        } else {
+            result = SQLExec::deallocate(name);
+        }
+        this->print_result(*result);
+        delete result;
+    } catch (SQLExecError& e) {
+        this->error(e.what());
+    }
+    return true;
+}
+
+void SQLShell::run_prepared(PreparedStatement& prepared, const vector<Value>& parameters) {
+    try {
+        const SQLStatement* statement = prepared.bind(parameters);
+        if (this->echo)
+            this->out << ParseTreeToString::statement(statement) << endl;
+        QueryResult* result = SQLExec::execute(prepared);
+        this->print_result(*result);
+        delete result;
+    } catch (SQLExecError& e) {
+        this->error(e.what());
+    }
+}
+
+void SQLShell::print_result(QueryResult& result) {
+    ResultWriter* writer = ResultWriter::create(this->format, this->out);
+    try {
+        writer->write(result);
+    } catch (...) {
+        delete writer;
+        throw;
+    }
+    delete writer;
+}
+
+void SQLShell::run_tests() {
+    cout << "test_heap_storage: " << (test_heap_storage() ? "Passed" : "Failed") << endl;
+    cout << "test_batch_insert: " << (test_batch_insert() ? "Passed" : "Failed") << endl;
+    cout << "test_batch_delete: " << (test_batch_delete() ? "Passed" : "Failed") << endl;
+    cout << "test_bloom_filters: " << (test_bloom_filters() ? "Passed" : "Failed") << endl;
+    cout << "test_zone_maps: " << (test_zone_maps() ? "Passed" : "Failed") << endl;
+    cout << "test_key_encoder: " << (test_key_encoder() ? "Passed" : "Failed") << endl;
+    cout << "test_hash_index: " << (test_hash_index() ? "Passed" : "Failed") << endl;
+    cout << "test_btree_index: " << (test_btree_index() ? "Passed" : "Failed") << endl;
+    cout << "test_query_plan: " << (test_query_plan() ? "Passed" : "Failed") << endl;
+    cout << "test_limit_pushdown: " << (test_limit_pushdown() ? "Passed" : "Failed") << endl;
+    cout << "test_kernels: " << (test_kernels() ? "Passed" : "Failed") << endl;
+    cout << "test_optimizer: " << (test_optimizer() ? "Passed" : "Failed") << endl;
+    cout << "test_statistics: " << (test_statistics() ? "Passed" : "Failed") << endl;
+    cout << "test_hash_join: " << (test_hash_join() ? "Passed" : "Failed") << endl;
+    cout << "test_sort: " << (test_sort() ? "Passed" : "Failed") << endl;
+    cout << "test_hash_aggregate: " << (test_hash_aggregate() ? "Passed" : "Failed") << endl;
+    cout << "test_parallel_scan: " << (test_parallel_scan() ? "Passed" : "Failed") << endl;
+    cout << "test_catalog: " << (test_catalog() ? "Passed" : "Failed") << endl;
+    cout << "test_bloom_index: " << (test_bloom_index() ? "Passed" : "Failed") << endl;
+    cout << "test_plan_cache: " << (test_plan_cache() ? "Passed" : "Failed") << endl;
+    cout << "test_transactions: " << (test_transactions() ? "Passed" : "Failed") << endl;
+    cout << "test_query_result: " << (test_query_result() ? "Passed" : "Failed") << endl;
+    cout << "test_result_writers: " << (test_result_writers() ? "Passed" : "Failed") << endl;
+    cout << "test_sql_exec: " << (test_sql_exec() ? "Passed" : "Failed") << endl;
+}
@@ -0,0 +1,124 @@
+/**
+ * @file SQLShell.h - SQLShell class
+ * @author Justin Thoreson
+ * @see "Seattle University, CPSC5300, Winter 2023"
+ */
+#pragma once
+
+#include <istream>
+#include <ostream>
+#include <string>
+#include <vector>
+#include "SQLParser.h"
+#include "SQLExec.h"
+#include "ResultWriter.h"
+
+/**
+ * @class SQLShell - takes a client's SQL a statement at a time, executes it, and writes the results
+ *
+ * Besides what the parser knows, a shell handles EXPLAIN, ANALYZE, PREPARE,
+ * EXECUTE, DEALLOCATE, SET FORMAT, SET DURABILITY, BEGIN, COMMIT, ROLLBACK, and
+ * test. It keeps the client's session (its output format, prepared statements,
+ * transaction, and durability), and holds SQLExec::schema_lock while each
+ * statement runs (exclusively for CREATE, DROP, ANALYZE, SET DURABILITY, and
+ * test), so any number of shells can be used from different threads at once.
+ *
+ * Each statement runs in a transaction of its own (nested in the session's,
+ * if it has one), which is rolled back if the statement fails.
+ */
+class SQLShell {
+public:
+    /**
+     * The command that ends a session
+     */
+    static const std::string QUIT;
+
+    /**
+     * Read the next statement of a script, up to (but not including) its semicolon,
+     * with its line breaks and -- comments turned into spaces.
+     * @param in   the script
+     * @param sql  returned by reference: the statement
+     * @returns    false once there are no more statements
+     */
+    static bool read_statement(std::istream& in, std::string& sql);
+
+    /**
+     * Constructor
+     * @param out   stream for results
+     * @param err   stream for errors
+     * @param echo  true to show each statement as parsed before its result
+     */
+    SQLShell(std::ostream& out, std::ostream& err, bool echo = true);
+
+    virtual ~SQLShell() {}
+
+    SQLShell(const SQLShell& other) = delete;
+
+    SQLShell& operator=(const SQLShell& other) = delete;
+
+    virtual void set_echo(bool echo) { this->echo = echo; }
+
+    /**
+     * Process some SQL (a statement, or several the parser takes at once).
+     * @param sql  the SQL
+     */
+    virtual void handle(std::string sql);
+
+protected:
+    std::ostream& out;
+    std::ostream& err;
+    bool echo;
+    ResultWriter::Format format;  // how this session's results are written
+    bool failed;                  // the statement being handled has reported an error
+    SQLSession session;
+
+    // what handle() does once it holds the schema lock
+    virtual void handle_sql(std::string sql);
+
+    /**
+     * Process BEGIN, COMMIT, and ROLLBACK (which the parser doesn't know).
+     * @param sql     a SQL command
+     * @param ticket  returned by reference: for a COMMIT, what to wait for before the result is flushed
+     * @returns       false if the command isn't one of them
+     */
+    virtual bool handle_transaction(const std::string& sql, uint64_t& ticket);
+
+    /**
+     * Report an error in the statement being handled (which is then rolled back).
+     * @param message  what went wrong
+     */
+    virtual void error(const std::string& message);
+
+    /**
+     * Process the statements of a parse.
+     * @param parse       the parse
+     * @param explain     true to show each statement's plan instead of executing it
+     * @param index_type  for CREATE INDEX, the kind of index if not the parsed one (see SQLExec::execute)
+     */
+    virtual void handle_statements(hsql::SQLParserResult* parse, bool explain = false, Identifier index_type = "");
+
+    /**
+     * Process PREPARE, EXECUTE, and DEALLOCATE (which the parser doesn't know).
+     * @param sql  a SQL command
+     * @returns    false if the command isn't one of them
+     */
+    virtual bool handle_prepared(std::string sql);
+
+    /**
+     * Bind values to a prepared statement and execute it.
+     * @param prepared    the statement
+     * @param parameters  values for its placeholders
+     */
+    virtual void run_prepared(PreparedStatement& prepared, const std::vector<Value>& parameters);
+
+    /**
+     * Write a query result in the session's output format.
+     * @param result  the result
+     */
+    virtual void print_result(QueryResult& result);
+
+    /**
+     * Run the unit tests (on stdout).
+     */
+    virtual void run_tests();
+};
@@ -0,0 +1,39 @@
+/**
+ * @file SharedMutex.cpp - implementation of SharedMutex class
+ * @author Justin Thoreson
+ * @see "Seattle University, CPSC5300, Winter 2023"
+ */
+
+#include "SharedMutex.h"
+
+void SharedMutex::lock() {
+    std::unique_lock<std::mutex> lock(this->mutex);
+    this->writers_waiting++;
+    this->changed.wait(lock, [this] { return !this->writer && this->readers == 0; });
+    this->writers_waiting--;
+    this->writer = true;
+}
+
+void SharedMutex::unlock() {
+    {
+        std::lock_guard<std::mutex> lock(this->mutex);
+        this->writer = false;
+    }
+    this->changed.notify_all();
+}
+
+void SharedMutex::lock_shared() {
+    std::unique_lock<std::mutex> lock(this->mutex);
+    this->changed.wait(lock, [this] { return !this->writer && this->writers_waiting == 0; });
+    this->readers++;
+}
+
+void SharedMutex::unlock_shared() {
+    bool last;
+    {
+        std::lock_guard<std::mutex> lock(this->mutex);
+        last = --this->readers == 0;
+    }
+    if (last)
+        this->changed.notify_all();
+}
@@ -0,0 +1,80 @@
+/**
+ * @file SharedMutex.h - SharedMutex class
+ * SharedMutex, SharedLock
+ *
+ * @author Justin Thoreson
+ * @see "Seattle University, CPSC5300, Winter 2023"
+ */
+
+#pragma once
+
+#include <condition_variable>
+#include <mutex>
+
+/**
+ * @class SharedMutex - a lock that any number of threads can hold shared, or one exclusively
+ *
+ * (C++11 has no std::shared_mutex.) A thread waiting to hold it exclusively
+ * keeps new shared holders out, so that a steady stream of them can't keep it
+ * waiting forever.
+ */
+class SharedMutex {
+public:
+    SharedMutex() : mutex(), changed(), readers(0), writer(false), writers_waiting(0) {}
+
+    virtual ~SharedMutex() {}
+
+    SharedMutex(const SharedMutex& other) = delete;
+
+    SharedMutex& operator=(const SharedMutex& other) = delete;
+
+    /**
+     * Wait until no one else holds the lock, then hold it exclusively.
+     */
+    virtual void lock();
+
+    virtual void unlock();
+
+    /**
+     * Wait until no one holds (or is waiting to hold) the lock exclusively, then hold it shared.
+     */
+    virtual void lock_shared();
+
+    virtual void unlock_shared();
+
+protected:
+    std::mutex mutex;
+    std::condition_variable changed;
+    unsigned readers;          // threads holding it shared
+    bool writer;               // true while a thread holds it exclusively
+    unsigned writers_waiting;  // threads waiting to hold it exclusively
+};
+
+
+/**
+ * @class SharedLock - holds a SharedMutex, shared or exclusively, for as long as it's in scope
+ */
+class SharedLock {
+public:
+    SharedLock(SharedMutex& mutex, bool exclusive) : mutex(mutex), exclusive(exclusive) {
+        if (exclusive)
+            mutex.lock();
+        else
+            mutex.lock_shared();
+    }
+
+    virtual ~SharedLock() {
+        if (this->exclusive)
+            this->mutex.unlock();
+        else
+            this->mutex.unlock_shared();
+    }
+
+    SharedLock(const SharedLock& other) = delete;
+
+    SharedLock& operator=(const SharedLock& other) = delete;
+
+protected:
+    SharedMutex& mutex;
+    bool exclusive;
+};
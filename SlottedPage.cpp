@@ -4,6 +4,7 @@
  * @see Seattle University, CPSC5300
  */
 
+#include <cstdlib>
 #include <cstring>
 #include "SlottedPage.h"
 
@@ -25,6 +26,11 @@ SlottedPage::SlottedPage(Dbt& block, BlockID block_id, bool is_new) : DbBlock(bl
     }
 }
 
+SlottedPage::~SlottedPage() {
+    if (this->block.get_flags() & DB_DBT_MALLOC)
+        std::free(this->block.get_data());
+}
+
 RecordID SlottedPage::add(const Dbt* data) {
     if (!this->has_room(data->get_size()))
         throw DbBlockNoRoomError("not enough room for new record");
@@ -96,7 +102,8 @@ void SlottedPage::put_header(RecordID id, u16 size, u16 loc) {
 }
 
 bool SlottedPage::has_room(u16 size) const {
-    return 4 * (this->num_records + 1) + size <= this->end_free;
+    // leave room for the block header, the existing record headers, and the new record's header
+    return 4 * (this->num_records + 2) + size <= this->end_free;
 }
 
 void SlottedPage::slide(u_int16_t start, u_int16_t end) {
@@ -30,8 +30,8 @@ class SlottedPage : public DbBlock {
 public:
     SlottedPage(Dbt& block, BlockID block_id, bool is_new = false);
 
-     // Big 5 - use the defaults
-    virtual ~SlottedPage() {}
+     // Big 5 - use the defaults (but the block's memory is freed if Berkeley DB allocated it, see HeapFile::get)
+    virtual ~SlottedPage();
 
     /**
      * Adds a new record to a slotted page
@@ -0,0 +1,222 @@
+/**
+ * @file Sort.cpp - implementation of the sort operator
+ * @author Justin Thoreson
+ * @see "Seattle University, CPSC5300, Winter 2023"
+ */
+
+#include <algorithm>
+#include <atomic>
+#include "Sort.h"
+
+// sorts made so far (by any session), to give each one's runs their own names
+static std::atomic<uint> sorts(0);
+
+Sort::Sort(PlanOperator* child, SortKeys keys, size_t limit, size_t memory_rows)
+    : PlanOperator(), child(child), keys(keys), limit(limit), memory_rows(memory_rows), id(++sorts), entries(),
+      position(0), runs(), tree() {
+}
+
+Sort::~Sort() {
+    this->clear();
+    delete this->child;
+}
+
+void Sort::open() {
+    this->clear();
+    this->child->open();
+    if (this->limit <= this->memory_rows)
+        this->top_n();
+    else
+        this->sort_runs();
+    if (!this->runs.empty()) {
+        for (int i = 0; i < (int) this->runs.size(); i++)
+            this->advance(i);
+        this->tree.assign(this->runs.size(), -1);
+        this->tree[0] = this->build_tree(1);
+    }
+}
+
+// Rows come from memory, or else from whichever run the loser tree says is next.
+bool Sort::next(RowBatch& batch) {
+    batch.clear();
+    if (this->runs.empty()) {
+        while (this->position < this->entries.size() && batch.size() < RowBatch::CAPACITY) {
+            Entry& entry = this->entries[this->position++];
+            batch.add(entry.handle, entry.row);
+            entry.row = nullptr;  // now the batch's
+        }
+        return !batch.empty();
+    }
+
+    int k = (int) this->runs.size();
+    while (batch.size() < RowBatch::CAPACITY) {
+        int winner = this->tree[0];
+        Run& run = this->runs[winner];
+        if (run.row == nullptr)
+            break;  // every run is exhausted
+        batch.add((*run.handles)[run.position - 1], run.row);
+        run.row = nullptr;
+        this->advance(winner);
+
+        // replay the winner's path to the root: it takes on each loser that beats it
+        for (int node = (winner + k) / 2; node > 0; node /= 2)
+            if (this->beats(this->tree[node], winner))
+                std::swap(this->tree[node], winner);
+        this->tree[0] = winner;
+    }
+    return !batch.empty();
+}
+
+void Sort::close() {
+    this->child->close();
+    this->clear();
+}
+
+std::string Sort::explain(uint depth) const {
+    std::string columns;
+    for (const SortKey& key: this->keys)
+        columns += (columns.empty() ? "" : ", ") + key.column_name + (key.descending ? " DESC" : "");
+    std::string ret = std::string(2 * depth, ' ') + "Sort " + columns;
+    if (this->limit != SIZE_MAX)
+        ret += " (top " + std::to_string(this->limit) + ")";
+    return ret + "\n" + this->child->explain(depth + 1);
+}
+
+// INT and BOOLEAN values compare as numbers, TEXT values as strings.
+bool Sort::less(const ValueDict* a, const ValueDict* b) const {
+    for (const SortKey& key: this->keys) {
+        const Value& x = a->at(key.column_name);
+        const Value& y = b->at(key.column_name);
+        int comparison;
+        if (x.data_type == ColumnAttribute::TEXT)
+            comparison = x.s.compare(y.s);
+        else
+            comparison = x.n < y.n ? -1 : (x.n > y.n ? 1 : 0);
+        if (comparison != 0)
+            return key.descending ? comparison > 0 : comparison < 0;
+    }
+    return false;
+}
+
+bool Sort::before(const Entry& a, const Entry& b) const {
+    if (this->less(a.row, b.row))
+        return true;
+    if (this->less(b.row, a.row))
+        return false;
+    return a.sequence < b.sequence;
+}
+
+// Keeps a heap of the best limit rows so far, with the worst of them on top.
+void Sort::top_n() {
+    auto before = [this](const Entry& a, const Entry& b) { return this->before(a, b); };
+    size_t sequence = 0;
+    RowBatch batch;
+    while (this->child->next(batch)) {
+        Handles handles;
+        for (size_t i = 0; i < batch.size(); i++)
+            handles.push_back(batch.get_handle(i));
+        ValueDicts rows;
+        batch.move_rows(rows);
+        for (size_t i = 0; i < rows.size(); i++) {
+            Entry entry(handles[i], rows[i], sequence++);
+            if (this->entries.size() < this->limit) {
+                this->entries.push_back(entry);
+                std::push_heap(this->entries.begin(), this->entries.end(), before);
+            } else if (this->limit > 0 && this->before(entry, this->entries.front())) {
+                std::pop_heap(this->entries.begin(), this->entries.end(), before);
+                delete this->entries.back().row;
+                this->entries.back() = entry;
+                std::push_heap(this->entries.begin(), this->entries.end(), before);
+            } else {
+                delete entry.row;
+            }
+        }
+    }
+    std::sort_heap(this->entries.begin(), this->entries.end(), before);
+}
+
+void Sort::sort_runs() {
+    size_t sequence = 0;
+    RowBatch batch;
+    while (this->child->next(batch)) {
+        Handles handles;
+        for (size_t i = 0; i < batch.size(); i++)
+            handles.push_back(batch.get_handle(i));
+        ValueDicts rows;
+        batch.move_rows(rows);
+        for (size_t i = 0; i < rows.size(); i++) {
+            this->entries.push_back(Entry(handles[i], rows[i], sequence++));
+            if (this->entries.size() >= this->memory_rows)
+                this->spill();
+        }
+    }
+    if (!this->runs.empty() && !this->entries.empty())
+        this->spill();
+    else
+        std::sort(this->entries.begin(), this->entries.end(),
+                  [this](const Entry& a, const Entry& b) { return this->before(a, b); });
+}
+
+// Rows come back from a heap table in the order they were inserted.
+void Sort::spill() {
+    std::sort(this->entries.begin(), this->entries.end(),
+              [this](const Entry& a, const Entry& b) { return this->before(a, b); });
+    ValueDicts rows;
+    for (Entry& entry: this->entries)
+        rows.push_back(entry.row);
+    HeapTable* table = HeapTable::create_temporary(
+            "_sort_" + std::to_string(this->id) + "_run" + std::to_string(this->runs.size()), rows.front());
+    this->runs.push_back(Run(table, nullptr));
+    this->runs.back().handles = table->insert(&rows);
+    for (ValueDict* row: rows)
+        delete row;
+    this->entries.clear();
+}
+
+void Sort::advance(int run) {
+    Run& r = this->runs[run];
+    r.row = r.position < r.handles->size() ? r.table->project((*r.handles)[r.position++]) : nullptr;
+}
+
+// Ties go to the earlier run, which holds the rows that came first.
+bool Sort::beats(int a, int b) const {
+    const ValueDict* x = this->runs[a].row;
+    const ValueDict* y = this->runs[b].row;
+    if (x == nullptr || y == nullptr)
+        return y == nullptr && (x != nullptr || a < b);
+    if (this->less(x, y))
+        return true;
+    if (this->less(y, x))
+        return false;
+    return a < b;
+}
+
+// Runs are the leaves: run i is node k + i, and node n's children are 2n and 2n + 1.
+int Sort::build_tree(size_t node) {
+    size_t k = this->runs.size();
+    if (node >= k)
+        return (int) (node - k);
+    int left = this->build_tree(2 * node);
+    int right = this->build_tree(2 * node + 1);
+    if (this->beats(left, right)) {
+        this->tree[node] = right;
+        return left;
+    }
+    this->tree[node] = left;
+    return right;
+}
+
+void Sort::clear() {
+    for (Entry& entry: this->entries)
+        delete entry.row;
+    this->entries.clear();
+    this->position = 0;
+    for (Run& run: this->runs) {
+        delete run.row;
+        delete run.handles;
+        run.table->drop();
+        delete run.table;
+    }
+    this->runs.clear();
+    this->tree.clear();
+}
@@ -0,0 +1,160 @@
+/**
+ * @file Sort.h - Sort plan operator using an external merge sort.
+ * SortKey
+ * Sort: PlanOperator
+ *
+ * @author Justin Thoreson
+ * @see "Seattle University, CPSC5300, Winter 2023"
+ */
+
+#pragma once
+
+#include <vector>
+#include "QueryPlan.h"
+#include "HeapTable.h"
+
+/**
+ * @class SortKey - a column to sort on, and which way
+ */
+class SortKey {
+public:
+    SortKey(Identifier column_name, bool descending = false) : column_name(column_name), descending(descending) {}
+
+    Identifier column_name;
+    bool descending;
+};
+
+using SortKeys = std::vector<SortKey>;
+
+
+/**
+ * @class Sort - pass on the rows in order of the sort keys (stably)
+ *
+ * Rows are sorted in memory as long as there are no more than memory_rows of
+ * them. Beyond that, each memory_rows rows are sorted into a run that is
+ * spilled to a temporary heap file, and the runs are then merged all at once
+ * through a loser tree. When only the first limit rows are wanted, and that
+ * many fit in memory, they are picked out with a heap instead and nothing is
+ * spilled.
+ */
+class Sort : public PlanOperator {
+public:
+    /**
+     * Default for the most rows held in memory at once
+     */
+    static const size_t MEMORY_ROWS = 100000;
+
+    /**
+     * Constructor
+     * @param child        operator producing the rows to sort (now owned by the sort)
+     * @param keys         columns to sort on, most significant first
+     * @param limit        only the first limit rows are needed
+     * @param memory_rows  most rows to hold in memory before spilling
+     */
+    Sort(PlanOperator* child, SortKeys keys, size_t limit = SIZE_MAX, size_t memory_rows = MEMORY_ROWS);
+
+    virtual ~Sort();
+
+    /**
+     * Open the input and read all of it, sorting it into memory or into runs on disk.
+     */
+    virtual void open();
+
+    virtual bool next(RowBatch& batch);
+
+    /**
+     * Close the input and drop any runs.
+     */
+    virtual void close();
+
+    virtual std::string explain(uint depth = 0) const;
+
+    /**
+     * Number of runs spilled to disk since open() (0 if sorting in memory)
+     */
+    virtual size_t get_run_count() const { return runs.size(); }
+
+protected:
+    /**
+     * A row held in memory, where it came from, and where it was in the input
+     */
+    class Entry {
+    public:
+        Entry(Handle handle, ValueDict* row, size_t sequence) : handle(handle), row(row), sequence(sequence) {}
+
+        Handle handle;
+        ValueDict* row;
+        size_t sequence;
+    };
+
+    /**
+     * A run spilled to disk and how far it has been merged
+     */
+    class Run {
+    public:
+        Run(HeapTable* table, Handles* handles) : table(table), handles(handles), position(0), row(nullptr) {}
+
+        HeapTable* table;
+        Handles* handles;
+        size_t position;
+        ValueDict* row;  // current row (nullptr once exhausted)
+    };
+
+    PlanOperator* child;
+    SortKeys keys;
+    size_t limit;
+    size_t memory_rows;
+    uint id;
+    std::vector<Entry> entries;
+    size_t position;
+    std::vector<Run> runs;
+    std::vector<int> tree;
+
+    /**
+     * Does row a sort before row b?
+     */
+    virtual bool less(const ValueDict* a, const ValueDict* b) const;
+
+    /**
+     * Does entry a sort before entry b (ties going to whichever came first)?
+     */
+    virtual bool before(const Entry& a, const Entry& b) const;
+
+    /**
+     * Read the whole input, keeping only the first limit rows (in order) in entries.
+     */
+    virtual void top_n();
+
+    /**
+     * Read the whole input, sorting it into entries or, if it's too big, into runs.
+     */
+    virtual void sort_runs();
+
+    /**
+     * Sort the rows in entries and write them out as a new run.
+     */
+    virtual void spill();
+
+    /**
+     * Move a run on to its next row.
+     * @param run  index of the run
+     */
+    virtual void advance(int run);
+
+    /**
+     * Does run a's current row come first (an exhausted run never does)?
+     */
+    virtual bool beats(int a, int b) const;
+
+    /**
+     * Set up the loser tree over the runs' current rows.
+     * @param node  the subtree to set up
+     * @returns     the winning run in the subtree
+     */
+    virtual int build_tree(size_t node);
+
+    /**
+     * Free the in-memory rows and drop the runs.
+     */
+    virtual void clear();
+};
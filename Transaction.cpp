@@ -0,0 +1,150 @@
+/**
+ * @file Transaction.cpp - implementation of Transaction class
+ * @author Justin Thoreson
+ * @see "Seattle University, CPSC5300, Winter 2023"
+ */
+
+#include <algorithm>
+#include <iostream>
+#include "Transaction.h"
+#include "storage_engine.h"
+
+thread_local DbTxn* Transaction::current_txn = nullptr;
+std::atomic<uint64_t> Transaction::aborts(0);
+std::mutex Transaction::flush_mutex;
+std::condition_variable Transaction::flushed_cv;
+uint64_t Transaction::committed = 0;
+uint64_t Transaction::flushed = 0;
+bool Transaction::flushing = false;
+std::mutex Transaction::flusher_mutex;
+std::condition_variable Transaction::flusher_cv;
+std::thread Transaction::flusher;
+bool Transaction::flusher_stopping = false;
+
+bool Transaction::get_durability(std::string name, Durability& durability) {
+    std::transform(name.begin(), name.end(), name.begin(), ::tolower);
+    if (name == "sync")
+        durability = SYNC;
+    else if (name == "write_no_sync")
+        durability = WRITE_NO_SYNC;
+    else if (name == "async")
+        durability = ASYNC;
+    else
+        return false;
+    return true;
+}
+
+std::string Transaction::durability_name(Durability durability) {
+    switch (durability) {
+        case SYNC:
+            return "sync";
+        case WRITE_NO_SYNC:
+            return "write_no_sync";
+        default:
+            return "async";
+    }
+}
+
+DbTxn* Transaction::begin(DbTxn* parent, bool snapshot) {
+    DbTxn* txn;
+    _DB_ENV->txn_begin(parent, &txn, DB_TXN_NOWAIT | (snapshot ? DB_TXN_SNAPSHOT : 0));
+    return txn;
+}
+
+// The ticket is taken after the commit record is in the log buffer, so a
+// flush begun after that covers it.
+uint64_t Transaction::commit(DbTxn* txn, bool nested, Durability durability) {
+    if (nested) {
+        txn->commit(0);
+        return 0;
+    }
+    txn->commit(durability == WRITE_NO_SYNC ? DB_TXN_WRITE_NOSYNC : DB_TXN_NOSYNC);
+    std::lock_guard<std::mutex> lock(Transaction::flush_mutex);
+    return ++Transaction::committed;
+}
+
+void Transaction::abort(DbTxn* txn) {
+    txn->abort();
+    Transaction::aborts++;
+}
+
+void Transaction::remove(const std::string& filename, bool transactional) {
+    DbTxn* txn = transactional ? Transaction::current() : nullptr;
+    _DB_ENV->dbremove(txn, filename.c_str(), nullptr, txn == nullptr && transactional ? DB_AUTO_COMMIT : 0);
+}
+
+// Whoever finds no flush going becomes the leader and flushes for every ticket
+// handed out by then. The rest wait for a flush that covers theirs.
+void Transaction::wait_durable(uint64_t ticket) {
+    std::unique_lock<std::mutex> lock(Transaction::flush_mutex);
+    while (Transaction::flushed < ticket) {
+        if (Transaction::flushing) {
+            Transaction::flushed_cv.wait(lock);
+            continue;
+        }
+        Transaction::flushing = true;
+        uint64_t target = Transaction::committed;
+        lock.unlock();
+        try {
+            _DB_ENV->log_flush(nullptr);
+        } catch (...) {
+            lock.lock();
+            Transaction::flushing = false;
+            Transaction::flushed_cv.notify_all();
+            throw;
+        }
+        lock.lock();
+        Transaction::flushing = false;
+        if (target > Transaction::flushed)
+            Transaction::flushed = target;
+        Transaction::flushed_cv.notify_all();
+    }
+}
+
+bool Transaction::is_durable(uint64_t ticket) {
+    std::lock_guard<std::mutex> lock(Transaction::flush_mutex);
+    return Transaction::flushed >= ticket;
+}
+
+void Transaction::flush() {
+    uint64_t ticket;
+    {
+        std::lock_guard<std::mutex> lock(Transaction::flush_mutex);
+        ticket = Transaction::committed;
+    }
+    Transaction::wait_durable(ticket);
+}
+
+// The flusher shares wait_durable's flushes, so a tick that comes while a
+// SYNC committer is flushing just waits for that flush.
+void Transaction::start_flusher(std::chrono::milliseconds interval) {
+    std::lock_guard<std::mutex> lock(Transaction::flusher_mutex);
+    if (Transaction::flusher.joinable())
+        return;
+    Transaction::flusher_stopping = false;
+    Transaction::flusher = std::thread([interval] {
+        std::unique_lock<std::mutex> lock(Transaction::flusher_mutex);
+        while (!Transaction::flusher_stopping) {
+            Transaction::flusher_cv.wait_for(lock, interval);
+            lock.unlock();
+            try {
+                Transaction::flush();
+            } catch (DbException& e) {
+                std::cerr << "(log flusher: " << e.what() << ")" << std::endl;
+            }
+            lock.lock();
+        }
+    });
+}
+
+void Transaction::stop_flusher() {
+    {
+        std::lock_guard<std::mutex> lock(Transaction::flusher_mutex);
+        if (!Transaction::flusher.joinable())
+            return;
+        Transaction::flusher_stopping = true;
+    }
+    Transaction::flusher_cv.notify_all();
+    Transaction::flusher.join();
+    Transaction::flush();
+}
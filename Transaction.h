@@ -0,0 +1,170 @@
+/**
+ * @file Transaction.h - Berkeley DB transactions as the storage engine sees them.
+ * Transaction
+ *
+ * @author Justin Thoreson
+ * @see "Seattle University, CPSC5300, Winter 2023"
+ */
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <thread>
+#include "db_cxx.h"
+
+/**
+ * @class Transaction - the transaction each thread's reads and writes are done in, and group commit
+ *
+ * Heap files and hash indices pass the current thread's transaction to every
+ * Berkeley DB call, so whatever a statement does is committed or undone with
+ * it. (Threads that never set one read outside any transaction.)
+ *
+ * A top-level transaction is committed without waiting for its log records
+ * to reach the disk. The committer then waits in wait_durable(), where the
+ * first to arrive flushes the log for everyone committed by then, so
+ * concurrent committers share one fsync instead of each doing its own.
+ *
+ * Not every commit needs that. A WRITE_NO_SYNC commit is written to the log
+ * file, so it survives the process dying but not the machine, and an ASYNC one
+ * is left in the log buffer. Either way the committer doesn't wait, and the
+ * flusher thread (see start_flusher) puts such commits on disk a moment later.
+ *
+ * Heap files and hash indices are opened with DB_MULTIVERSION, so a snapshot
+ * transaction (see begin) reads the rows as they were committed when it
+ * began, from copies of the pages kept by Berkeley DB, without taking read
+ * locks. It neither waits for the writes of other transactions nor holds up
+ * their writers.
+ *
+ * Aborting undoes what is on disk but not the copies of it kept in memory
+ * (a heap file's last block), so each abort starts a new generation, and
+ * those copies are read again once their generation is past.
+ */
+class Transaction {
+public:
+    /**
+     * How soon a commit is on disk: before the committer hears of it (SYNC),
+     * in the operating system's hands (WRITE_NO_SYNC), or when the log is next
+     * flushed (ASYNC). The order is from most to least durable.
+     */
+    enum Durability {
+        SYNC, WRITE_NO_SYNC, ASYNC
+    };
+
+    /**
+     * The durability with a given name (sync, write_no_sync, or async, in any case).
+     * @param name        the name
+     * @param durability  returned by reference: the durability
+     * @returns           false if there is no durability by that name
+     */
+    static bool get_durability(std::string name, Durability& durability);
+
+    /**
+     * The name of a durability.
+     * @param durability  the durability
+     * @returns           its name, as get_durability takes it
+     */
+    static std::string durability_name(Durability durability);
+
+    /**
+     * The current thread's transaction.
+     * @returns  the transaction, or nullptr if there isn't one
+     */
+    static DbTxn* current() { return current_txn; }
+
+    /**
+     * Make a transaction the current thread's.
+     * @param txn  the transaction, or nullptr for none
+     */
+    static void set_current(DbTxn* txn) { current_txn = txn; }
+
+    /**
+     * Begin a transaction. It doesn't wait for locks: a conflict with another
+     * transaction is an error at once, rather than a wait that could hold up
+     * every session.
+     * @param parent    the transaction to nest it in, or nullptr for a top-level one
+     * @param snapshot  true to read a snapshot of what was committed when it began (DB_TXN_SNAPSHOT)
+     * @returns         the transaction (freed by commit or abort)
+     */
+    static DbTxn* begin(DbTxn* parent = nullptr, bool snapshot = false);
+
+    /**
+     * Commit a transaction, without waiting for the log to reach the disk.
+     * @param txn         the transaction
+     * @param nested      true if it has a parent (whose commit makes it durable)
+     * @param durability  for a top-level transaction, whether its commit is written to the log file now
+     * @returns           ticket to pass to wait_durable (0 for a nested transaction)
+     */
+    static uint64_t commit(DbTxn* txn, bool nested = false, Durability durability = SYNC);
+
+    /**
+     * Abort a transaction, and start a new generation.
+     * @param txn  the transaction
+     */
+    static void abort(DbTxn* txn);
+
+    /**
+     * Remove a database file: in the current thread's transaction if it has one
+     * (so that rolling it back brings the file back), and otherwise on its own.
+     * @param filename       the file
+     * @param transactional  false if the file is kept outside of transactions
+     */
+    static void remove(const std::string& filename, bool transactional = true);
+
+    /**
+     * Wait until a commit has reached the disk, flushing the log if no one else is.
+     * @param ticket  from commit() (0 returns at once)
+     */
+    static void wait_durable(uint64_t ticket);
+
+    /**
+     * Has a commit reached the disk?
+     * @param ticket  from commit()
+     * @returns       true if it has (as far as a wait_durable has seen)
+     */
+    static bool is_durable(uint64_t ticket);
+
+    /**
+     * Put every commit made so far on disk.
+     */
+    static void flush();
+
+    /**
+     * Start a thread that flushes the log every so often, if there is
+     * anything to flush, for the commits no one waits for. (Does nothing if it
+     * is already running.)
+     * @param interval  how often; the most an ASYNC commit can be lost by a crash
+     */
+    static void start_flusher(std::chrono::milliseconds interval);
+
+    /**
+     * Stop the flusher thread, after a last flush.
+     */
+    static void stop_flusher();
+
+    /**
+     * Number of aborts so far.
+     */
+    static uint64_t generation() { return aborts; }
+
+private:
+    static thread_local DbTxn* current_txn;
+    static std::atomic<uint64_t> aborts;
+
+    // group commit
+    static std::mutex flush_mutex;
+    static std::condition_variable flushed_cv;
+    static uint64_t committed;  // tickets handed out
+    static uint64_t flushed;    // tickets known to be on disk
+    static bool flushing;
+
+    // the flusher thread
+    static std::mutex flusher_mutex;
+    static std::condition_variable flusher_cv;
+    static std::thread flusher;
+    static bool flusher_stopping;
+};
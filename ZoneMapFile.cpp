@@ -0,0 +1,39 @@
+/**
+ * @file ZoneMapFile.cpp
+ * @author Justin Thoreson
+ * @see Seattle University, CPSC5300
+ */
+
+#include <algorithm>
+#include <cstring>
+#include "ZoneMapFile.h"
+
+// A zone is stored as min then max; an empty zone has min > max so it overlaps nothing.
+static IntRange get_zone(const char* summary) {
+    int32_t zone[2];
+    std::memcpy(zone, summary, sizeof(zone));
+    return IntRange(zone[0], zone[1]);
+}
+
+static void put_zone(char* summary, const IntRange& range) {
+    int32_t zone[] = {range.first, range.second};
+    std::memcpy(summary, zone, sizeof(zone));
+}
+
+void ZoneMapFile::init_column_summary(char* summary) const {
+    put_zone(summary, IntRange(INT32_MAX, INT32_MIN));
+}
+
+void ZoneMapFile::add_value(char* summary, const Value& value) const {
+    IntRange zone = get_zone(summary);
+    put_zone(summary, IntRange(std::min(zone.first, value.n), std::max(zone.second, value.n)));
+}
+
+bool ZoneMapFile::might_contain(const char* summary, const Value& value) const {
+    return this->might_overlap(summary, IntRange(value.n, value.n));
+}
+
+bool ZoneMapFile::might_overlap(const char* summary, const IntRange& range) const {
+    IntRange zone = get_zone(summary);
+    return zone.first <= range.second && range.first <= zone.second;
+}
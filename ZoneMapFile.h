@@ -0,0 +1,45 @@
+/**
+ * @file ZoneMapFile.h - Per-block min/max zone maps for INT range scans.
+ * ZoneMapFile: BlockSummaryFile
+ *
+ * @author Justin Thoreson
+ * @see "Seattle University, CPSC5300, Winter 2023"
+ */
+
+#pragma once
+
+#include "BlockSummaryFile.h"
+
+/**
+ * @class ZoneMapFile - the minimum and maximum value per block per INT column
+ *
+ * Lets a range (or equality) scan on an INT column skip blocks whose values
+ * all fall outside the range. Works best on columns whose values rise with
+ * insertion order, like timestamps, where each block covers a narrow band.
+ * Zones are only widened: deleted rows leave them as they are.
+ */
+class ZoneMapFile : public BlockSummaryFile {
+public:
+    /**
+     * Constructor
+     * @param table_name  table whose heap file is being summarized
+     */
+    ZoneMapFile(Identifier table_name) : BlockSummaryFile(table_name + "-zonemap") {}
+
+    virtual ~ZoneMapFile() {}
+
+protected:
+    virtual uint column_summary_size() const { return 2 * sizeof(int32_t); }
+
+    virtual bool can_summarize(ColumnAttribute::DataType data_type) const {
+        return data_type == ColumnAttribute::INT;
+    }
+
+    virtual void init_column_summary(char* summary) const;
+
+    virtual void add_value(char* summary, const Value& value) const;
+
+    virtual bool might_contain(const char* summary, const Value& value) const;
+
+    virtual bool might_overlap(const char* summary, const IntRange& range) const;
+};
@@ -4,19 +4,27 @@
  * @see "Seattle University, CPSC5300, Winter 2023"
  */
 
+#include <algorithm>
+#include <cmath>
+#include <sstream>
 #include "schema_tables.h"
 #include "ParseTreeToString.h"
 
 void initialize_schema_tables() {
     Tables tables;
     tables.create_if_not_exists();
-    tables.close();
     Columns columns;
     columns.create_if_not_exists();
-    columns.close();
     Indices indices;
     indices.create_if_not_exists();
+    Catalog::load(tables, columns, indices);
+    Statistics::register_schema(tables, columns);
+    tables.close();
+    columns.close();
     indices.close();
+    Statistics statistics;
+    statistics.create_if_not_exists();
+    statistics.close();
 }
 
 // Not terribly useful since the parser weeds most of these out
@@ -39,6 +47,97 @@ bool is_acceptable_data_type(std::string dt) {
     return dt == "INT" || dt == "TEXT" || dt == "BOOLEAN";  // for now
 }
 
+// The data type named in a _columns row.
+static ColumnAttribute::DataType data_type_of(const std::string& data_type) {
+    if (data_type == "INT")
+        return ColumnAttribute::INT;
+    else if (data_type == "TEXT")
+        return ColumnAttribute::TEXT;
+    else if (data_type == "BOOLEAN")
+        return ColumnAttribute::BOOLEAN;
+    else
+        throw DbRelationError("Unknown data type");
+}
+
+
+/*
+ * ********************************
+ * SchemaTable class implementation
+ * ********************************
+ */
+
+// ctor - the key index file is named after the schema table and its key columns
+SchemaTable::SchemaTable(Identifier table_name, ColumnNames column_names, ColumnAttributes column_attributes,
+                         ColumnNames key_columns, bool unique)
+        : HeapTable(table_name, column_names, column_attributes), key_columns(key_columns),
+          key_index(*this, "key", key_columns, unique) {
+}
+
+// Create the file and its (empty) key index.
+void SchemaTable::create() {
+    HeapTable::create();
+    this->key_index.create();
+}
+
+// Open the file and its key index, building the index if this catalog predates it.
+void SchemaTable::open() {
+    HeapTable::open();
+    try {
+        this->key_index.open();
+    } catch (DbException& e) {
+        this->key_index.create();
+    }
+}
+
+void SchemaTable::close() {
+    HeapTable::close();
+    this->key_index.close();
+}
+
+Handle SchemaTable::insert(const ValueDict* row) {
+    Handle handle = HeapTable::insert(row);
+    this->key_index.insert(handle);
+    return handle;
+}
+
+// One at a time, so that subclasses' checks on insert(row) still apply.
+Handles* SchemaTable::insert(const ValueDicts* rows) {
+    return DbRelation::insert(rows);
+}
+
+// The index entry must go first since it needs the row's key values.
+void SchemaTable::del(Handle handle) {
+    this->open();
+    this->key_index.del(handle);
+    HeapTable::del(handle);
+}
+
+// One at a time, so that subclasses' bookkeeping on del(handle) still happens.
+void SchemaTable::del(const Handles* handles) {
+    DbRelation::del(handles);
+}
+
+// Use the key index when the where-clause fixes every key column; otherwise scan.
+Handles* SchemaTable::select(const ValueDict* where) {
+    if (where == nullptr)
+        return HeapTable::select(where);
+    ValueDict key;
+    for (auto const& column_name: this->key_columns) {
+        ValueDict::const_iterator column = where->find(column_name);
+        if (column == where->end())
+            return HeapTable::select(where);
+        key[column_name] = column->second;
+    }
+    this->open();
+    Handles* candidates = this->key_index.lookup(&key);
+    Handles* handles = new Handles();
+    for (Handle& handle: *candidates)
+        if (where->size() == key.size() || this->selected(handle, where))
+            handles->push_back(handle);
+    delete candidates;
+    return handles;
+}
+
 
 /*
  * ***************************
@@ -48,6 +147,7 @@ bool is_acceptable_data_type(std::string dt) {
 const Identifier Tables::TABLE_NAME = "_tables";
 Columns *Tables::columns_table = nullptr;
 std::map<Identifier, DbRelation *> Tables::table_cache;
+std::mutex Tables::cache_mutex;
 
 // get the column name for _tables column
 ColumnNames& Tables::COLUMN_NAMES() {
@@ -67,8 +167,8 @@ ColumnAttributes& Tables::COLUMN_ATTRIBUTES() {
     return cas;
 }
 
-// ctor - we have a fixed table structure of just one column: table_name
-Tables::Tables() : HeapTable(TABLE_NAME, COLUMN_NAMES(), COLUMN_ATTRIBUTES()) {
+// ctor - we have a fixed table structure of just one column: table_name (which is unique)
+Tables::Tables() : SchemaTable(TABLE_NAME, COLUMN_NAMES(), COLUMN_ATTRIBUTES(), ColumnNames({"table_name"}), true) {
     Tables::table_cache[TABLE_NAME] = this;
     if (Tables::columns_table == nullptr)
         columns_table = new Columns();
@@ -77,7 +177,7 @@ Tables::Tables() : HeapTable(TABLE_NAME, COLUMN_NAMES(), COLUMN_ATTRIBUTES()) {
 
 // Create the file and also, manually add schema tables.
 void Tables::create() {
-    HeapTable::create();
+    SchemaTable::create();
     ValueDict row;
     row["table_name"] = Value("_tables");
     insert(&row);
@@ -95,7 +195,9 @@ Handle Tables::insert(const ValueDict* row) {
     delete handles;
     if (!unique)
         throw DbRelationError(row->at("table_name").s + " already exists");
-    return HeapTable::insert(row);
+    Handle handle = SchemaTable::insert(row);
+    Catalog::add_table(row);
+    return handle;
 }
 
 // Remove a row, but first remove from table cache if there
@@ -104,50 +206,26 @@ void Tables::del(Handle handle) {
     // remove from cache, if there
     ValueDict* row = project(handle);
     Identifier table_name = row->at("table_name").s;
+    forget(table_name);
+    SchemaTable::del(handle);
+    Catalog::drop_table(row);
     delete row;
-    if (Tables::table_cache.find(table_name) != Tables::table_cache.end()) {
-        DbRelation* table = Tables::table_cache.at(table_name);
-        Tables::table_cache.erase(table_name);
-        delete table;
-    }
-    HeapTable::del(handle);
 }
 
-// Return a list of column names and column attributes for given table.
+// Return a list of column names and column attributes for given table (from the catalog).
 void Tables::get_columns(Identifier table_name, ColumnNames& column_names, ColumnAttributes& column_attributes) {
-    // SELECT * FROM _columns WHERE table_name = <table_name>
-    ValueDict where;
-    where["table_name"] = table_name;
-    Handles* handles = Tables::columns_table->select(&where);
-
-    ColumnAttribute column_attribute;
-    for (Handle& handle: *handles) {
-        ValueDict *row = Tables::columns_table->project(
-                handle);  // get the row's values: {'column_name': <name>, 'data_type': <type>}
-
-        Identifier column_name = (*row)["column_name"].s;
-        column_names.push_back(column_name);
-
-        ColumnAttribute::DataType data_type;
-        if ((*row)["data_type"].s == "INT")
-            data_type = ColumnAttribute::INT;
-        else if ((*row)["data_type"].s == "TEXT")
-            data_type = ColumnAttribute::TEXT;
-        else if ((*row)["data_type"].s == "BOOLEAN")
-            data_type = ColumnAttribute::BOOLEAN;
-        else
-            throw DbRelationError("Unknown data type");
-        column_attribute.set_data_type(data_type);
-
-        column_attributes.push_back(column_attribute);
-
-        delete row;
-    }
-    delete handles;
+    const Catalog::TableEntry* table = Catalog::get_table(table_name);
+    if (table == nullptr)
+        return;
+    column_names.insert(column_names.end(), table->column_names.begin(), table->column_names.end());
+    column_attributes.insert(column_attributes.end(), table->column_attributes.begin(),
+                             table->column_attributes.end());
 }
 
 // Return a table for given table_name.
 DbRelation& Tables::get_table(Identifier table_name) {
+    std::lock_guard<std::mutex> lock(Tables::cache_mutex);
+
     // if they are asking about a table we've once constructed, then just return that one
     if (Tables::table_cache.find(table_name) != Tables::table_cache.end())
         return *Tables::table_cache[table_name];
@@ -192,13 +270,13 @@ ColumnAttributes& Columns::COLUMN_ATTRIBUTES() {
     return cas;
 }
 
-// ctor - we have a fixed table structure
-Columns::Columns() : HeapTable(TABLE_NAME, COLUMN_NAMES(), COLUMN_ATTRIBUTES()) {
+// ctor - we have a fixed table structure, indexed by table_name for get_columns
+Columns::Columns() : SchemaTable(TABLE_NAME, COLUMN_NAMES(), COLUMN_ATTRIBUTES(), ColumnNames({"table_name"}), false) {
 }
 
 // Create the file and also, manually add schema columns.
 void Columns::create() {
-    HeapTable::create();
+    SchemaTable::create();
     ValueDict row;
     row["data_type"] = Value("TEXT");  // all these are TEXT fields
     row["table_name"] = Value("_tables");
@@ -249,7 +327,26 @@ Handle Columns::insert(const ValueDict* row) {
     if (!unique)
         throw DbRelationError("duplicate column " + row->at("table_name").s + "." + row->at("column_name").s);
 
-    return HeapTable::insert(row);
+    Handle handle = SchemaTable::insert(row);
+    Catalog::add_column(row);
+    return handle;
+}
+
+void Columns::del(Handle handle) {
+    ValueDict* row = project(handle);
+    SchemaTable::del(handle);
+    Catalog::drop_column(row);
+    delete row;
+}
+
+void Tables::forget(Identifier table_name) {
+    std::lock_guard<std::mutex> lock(Tables::cache_mutex);
+    std::map<Identifier, DbRelation*>::iterator found = Tables::table_cache.find(table_name);
+    if (found == Tables::table_cache.end())
+        return;
+    DbRelation* table = found->second;
+    Tables::table_cache.erase(found);
+    delete table;
 }
 
 
@@ -260,6 +357,7 @@ Handle Columns::insert(const ValueDict* row) {
  */
 const Identifier Indices::TABLE_NAME = "_indices";
 std::map<std::pair<Identifier, Identifier>, DbIndex *> Indices::index_cache;
+std::mutex Indices::cache_mutex;
 
 // get the column name for _indices column
 ColumnNames &Indices::COLUMN_NAMES() {
@@ -293,8 +391,8 @@ ColumnAttributes &Indices::COLUMN_ATTRIBUTES() {
     return cas;
 }
 
-// ctor - we have a fixed table structure
-Indices::Indices() : HeapTable(TABLE_NAME, COLUMN_NAMES(), COLUMN_ATTRIBUTES()) {}
+// ctor - we have a fixed table structure, indexed by table_name
+Indices::Indices() : SchemaTable(TABLE_NAME, COLUMN_NAMES(), COLUMN_ATTRIBUTES(), ColumnNames({"table_name"}), false) {}
 
 // Manually check constraints -- unique on (table, index, column)
 Handle Indices::insert(const ValueDict *row) {
@@ -315,7 +413,9 @@ Handle Indices::insert(const ValueDict *row) {
     delete handles;
     if (!unique)
         throw DbRelationError("duplicate index " + row->at("table_name").s + " " + row->at("index_name").s);
-    return HeapTable::insert(row);
+    Handle handle = SchemaTable::insert(row);
+    Catalog::add_index_column(row);
+    return handle;
 }
 
 // Remove a row, but first remove from index cache if there
@@ -325,98 +425,353 @@ void Indices::del(Handle handle) {
     ValueDict* row = project(handle);
     Identifier table_name = row->at("table_name").s;
     Identifier index_name = row->at("index_name").s;
+    forget(table_name, index_name);
+    SchemaTable::del(handle);
+    Catalog::drop_index_column(row);
     delete row;
-    std::pair<Identifier, Identifier> cache_key(table_name, index_name);
-    if (Indices::index_cache.find(cache_key) != Indices::index_cache.end()) {
-        DbIndex* index = Indices::index_cache.at(cache_key);
-        Indices::index_cache.erase(cache_key);
-        delete index;
-    }
-    HeapTable::del(handle);
 }
 
-// Return a list of column names and column attributes for given table.
+// Return the search key and kind of the given index (from the catalog).
 void Indices::get_columns(Identifier table_name, Identifier index_name, ColumnNames &column_names, bool &is_hash,
                           bool &is_unique) {
-    // SELECT * FROM _indices WHERE table_name = <table_name> AND index_name = <index_name>
-    ValueDict where;
-    where["table_name"] = table_name;
-    where["index_name"] = index_name;
-    Handles *handles = select(&where);
-
-    Identifier colnames[DbIndex::MAX_COMPOSITE];
-    uint size = 0;
-    for (auto const &handle: *handles) {
-        ValueDict *row = project(handle);
-
-        Identifier column_name = (*row)["column_name"].s;
-        uint which = (uint) (*row)["seq_in_index"].n;
-        colnames[which - 1] = column_name;  // seq_in_index is 1-based
-        if (which > size)
-            size = which;
-        is_unique = (*row)["is_unique"].n != 0;
-        is_hash = (*row)["index_type"].s == "HASH";
-        delete row;
-    }
-    for (uint i = 0; i < size; i++)
-        column_names.push_back(colnames[i]);
-    delete handles;
+    const Catalog::IndexEntry* index = Catalog::get_index(table_name, index_name);
+    if (index == nullptr)
+        return;
+    column_names.insert(column_names.end(), index->column_names.begin(), index->column_names.end());
+    is_hash = index->is_hash;
+    is_unique = index->is_unique;
 }
 
-// FIXME - use this for now until we have BTreeIndex and HashIndex
-class DummyIndex : public DbIndex {
-public:
-    DummyIndex(DbRelation &rel, Identifier idx, ColumnNames key, bool unq) : DbIndex(rel, idx, key, unq) {}
-
-    void create() {}
-
-    void drop() {}
-
-    void open() {}
-
-    void close() {}
-
-    Handles *lookup(ValueDict *key_values) const { return nullptr; }
-
-    void insert(Handle handle) {}
-
-    void del(Handle handle) {}
-};
-
-
 // Return a table for given table_name.
 DbIndex &Indices::get_index(Identifier table_name, Identifier index_name) {
+    std::lock_guard<std::mutex> lock(Indices::cache_mutex);
+
     // if they are asking about an index we've once constructed, then just return that one
     std::pair<Identifier, Identifier> cache_key(table_name, index_name);
     if (Indices::index_cache.find(cache_key) != Indices::index_cache.end())
         return *Indices::index_cache[cache_key];
 
-    // otherwise assume it is a DummyIndex (for now)
+    // otherwise construct the right kind of index
     ColumnNames column_names;
     bool is_hash, is_unique;
     get_columns(table_name, index_name, column_names, is_hash, is_unique);
+    const Catalog::IndexEntry* entry = Catalog::get_index(table_name, index_name);
     DbRelation &table = Tables::get_table(table_name);
     DbIndex *index;
-    if (is_hash) {
-        index = new DummyIndex(table, index_name, column_names, is_unique);  // FIXME - change to HashIndex
+    if (entry != nullptr && entry->index_type == BloomIndex::INDEX_TYPE) {
+        index = new BloomIndex(table, index_name, column_names);
+    } else if (is_hash) {
+        index = new HashIndex(table, index_name, column_names, is_unique);
     } else {
-        index = new DummyIndex(table, index_name, column_names, is_unique);  // FIXME - change to BTreeIndex
+        index = new BTreeIndex(table, index_name, column_names, is_unique);
     }
     Indices::index_cache[cache_key] = index;
     return *index;
 }
 
+void Indices::forget(Identifier table_name, Identifier index_name) {
+    std::lock_guard<std::mutex> lock(Indices::cache_mutex);
+    for (auto cached = Indices::index_cache.begin(); cached != Indices::index_cache.end();) {
+        if (cached->first.first == table_name && (index_name.empty() || cached->first.second == index_name)) {
+            delete cached->second;
+            cached = Indices::index_cache.erase(cached);
+        } else {
+            cached++;
+        }
+    }
+}
+
 IndexNames Indices::get_index_names(Identifier table_name) {
     IndexNames ret;
+    const Catalog::TableEntry* table = Catalog::get_table(table_name);
+    if (table != nullptr)
+        for (auto const &index: table->indices)
+            ret.push_back(index.index_name);
+    return ret;
+}
+
+
+/*
+ * ****************************
+ * Catalog class implementation
+ * ****************************
+ */
+std::vector<Identifier> Catalog::table_names;
+std::map<Identifier, Catalog::TableEntry> Catalog::table_entries;
+
+int Catalog::TableEntry::ordinal(Identifier column_name) const {
+    std::map<Identifier, uint>::const_iterator found = this->ordinals.find(column_name);
+    return found == this->ordinals.end() ? -1 : (int) found->second;
+}
+
+// Feed every row of each schema table through the same write-through that later DDL uses.
+void Catalog::load(DbRelation& tables, DbRelation& columns, DbRelation& indices) {
+    Catalog::table_names.clear();
+    Catalog::table_entries.clear();
+    std::vector<std::pair<DbRelation*, void (*)(const ValueDict*)>> loads = {
+        {&tables, Catalog::add_table},
+        {&columns, Catalog::add_column},
+        {&indices, Catalog::add_index_column}
+    };
+    for (auto const& load: loads) {
+        Handles* handles = load.first->select();
+        for (Handle& handle: *handles) {
+            ValueDict* row = load.first->project(handle);
+            load.second(row);
+            delete row;
+        }
+        delete handles;
+    }
+}
+
+const Catalog::TableEntry* Catalog::get_table(Identifier table_name) {
+    std::map<Identifier, TableEntry>::const_iterator table = Catalog::table_entries.find(table_name);
+    return table == Catalog::table_entries.end() ? nullptr : &table->second;
+}
+
+const Catalog::IndexEntry* Catalog::get_index(Identifier table_name, Identifier index_name) {
+    const TableEntry* table = Catalog::get_table(table_name);
+    if (table != nullptr)
+        for (const IndexEntry& index: table->indices)
+            if (index.index_name == index_name)
+                return &index;
+    return nullptr;
+}
+
+void Catalog::add_table(const ValueDict* row) {
+    Identifier table_name = row->at("table_name").s;
+    if (Catalog::table_entries.find(table_name) == Catalog::table_entries.end()) {
+        Catalog::table_names.push_back(table_name);
+        Catalog::table_entries[table_name] = TableEntry();
+    }
+}
+
+void Catalog::drop_table(const ValueDict* row) {
+    Identifier table_name = row->at("table_name").s;
+    Catalog::table_entries.erase(table_name);
+    Catalog::table_names.erase(std::remove(Catalog::table_names.begin(), Catalog::table_names.end(), table_name),
+                               Catalog::table_names.end());
+}
+
+void Catalog::add_column(const ValueDict* row) {
+    TableEntry& table = Catalog::table_entries[row->at("table_name").s];
+    table.ordinals[row->at("column_name").s] = (uint) table.column_names.size();
+    table.column_names.push_back(row->at("column_name").s);
+    table.column_attributes.push_back(ColumnAttribute(data_type_of(row->at("data_type").s)));
+}
+
+void Catalog::drop_column(const ValueDict* row) {
+    std::map<Identifier, TableEntry>::iterator found = Catalog::table_entries.find(row->at("table_name").s);
+    if (found == Catalog::table_entries.end())
+        return;
+    TableEntry& table = found->second;
+    int ordinal = table.ordinal(row->at("column_name").s);
+    if (ordinal < 0)
+        return;
+    table.column_names.erase(table.column_names.begin() + ordinal);
+    table.column_attributes.erase(table.column_attributes.begin() + ordinal);
+    table.ordinals.clear();
+    for (uint i = 0; i < table.column_names.size(); i++)
+        table.ordinals[table.column_names[i]] = i;
+}
+
+// Rows for a composite index can come in any order, so each column goes where its seq_in_index says.
+void Catalog::add_index_column(const ValueDict* row) {
+    TableEntry& table = Catalog::table_entries[row->at("table_name").s];
+    Identifier index_name = row->at("index_name").s;
+    std::vector<IndexEntry>::iterator index = table.indices.begin();
+    while (index != table.indices.end() && index->index_name != index_name)
+        index++;
+    if (index == table.indices.end()) {
+        table.indices.push_back(IndexEntry(index_name, row->at("index_type").s, row->at("is_unique").n != 0));
+        index = table.indices.end() - 1;
+    }
+    uint seq_in_index = (uint) row->at("seq_in_index").n;  // 1-based
+    if (index->column_names.size() < seq_in_index)
+        index->column_names.resize(seq_in_index);
+    index->column_names[seq_in_index - 1] = row->at("column_name").s;
+}
+
+void Catalog::drop_index_column(const ValueDict* row) {
+    std::map<Identifier, TableEntry>::iterator found = Catalog::table_entries.find(row->at("table_name").s);
+    if (found == Catalog::table_entries.end())
+        return;
+    std::vector<IndexEntry>& indices = found->second.indices;
+    for (std::vector<IndexEntry>::iterator index = indices.begin(); index != indices.end(); index++) {
+        if (index->index_name != row->at("index_name").s)
+            continue;
+        ColumnNames& column_names = index->column_names;
+        column_names.erase(std::remove(column_names.begin(), column_names.end(), row->at("column_name").s),
+                           column_names.end());
+        if (column_names.empty())
+            indices.erase(index);
+        return;
+    }
+}
+
+
+
+/*
+ * *******************************
+ * Statistics class implementation
+ * *******************************
+ */
+const Identifier Statistics::TABLE_NAME = "_statistics";
+
+// get the column name for _statistics column
+ColumnNames& Statistics::COLUMN_NAMES() {
+    static ColumnNames cn;
+    if (cn.empty()) {
+        cn.push_back("table_name");
+        cn.push_back("column_name");
+        cn.push_back("row_count");
+        cn.push_back("block_count");
+        cn.push_back("distinct_count");
+        cn.push_back("null_count");
+        cn.push_back("histogram");
+    }
+    return cn;
+}
+
+// get the column attribute for _statistics column
+ColumnAttributes& Statistics::COLUMN_ATTRIBUTES() {
+    static ColumnAttributes cas;
+    if (cas.empty()) {
+        ColumnAttribute ca(ColumnAttribute::TEXT);
+        cas.push_back(ca);  // table_name
+        cas.push_back(ca);  // column_name
+        ca.set_data_type(ColumnAttribute::INT);
+        cas.push_back(ca);  // row_count
+        cas.push_back(ca);  // block_count
+        cas.push_back(ca);  // distinct_count
+        cas.push_back(ca);  // null_count
+        ca.set_data_type(ColumnAttribute::TEXT);
+        cas.push_back(ca);  // histogram
+    }
+    return cas;
+}
+
+// ctor - we have a fixed table structure, indexed by table_name
+Statistics::Statistics()
+        : SchemaTable(TABLE_NAME, COLUMN_NAMES(), COLUMN_ATTRIBUTES(), ColumnNames({"table_name"}), false) {}
+
+// Add whatever of _statistics's own rows are missing, whether the catalog is new or predates it.
+void Statistics::register_schema(DbRelation& tables, DbRelation& columns) {
+    ValueDict row;
+    row["table_name"] = Value(TABLE_NAME);
+    if (Catalog::get_table(TABLE_NAME) == nullptr)
+        tables.insert(&row);
+    const Catalog::TableEntry* table = Catalog::get_table(TABLE_NAME);
+    for (uint i = 0; i < COLUMN_NAMES().size(); i++) {
+        if (table != nullptr && table->ordinal(COLUMN_NAMES()[i]) != -1)
+            continue;
+        row["column_name"] = Value(COLUMN_NAMES()[i]);
+        row["data_type"] = Value(COLUMN_ATTRIBUTES()[i].get_data_type() == ColumnAttribute::INT ? "INT" : "TEXT");
+        columns.insert(&row);
+    }
+}
+
+// Estimate the number of distinct values in the whole table from the sample:
+// values seen more than once are taken to be common everywhere, while values
+// seen just once stand for sqrt(rows / sampled rows) values each (the GEE estimator).
+static double estimate_distinct(std::map<std::string, uint>& counts, double sampled_rows, double row_count) {
+    double singletons = 0, repeated = 0;
+    for (auto const& count: counts)
+        (count.second == 1 ? singletons : repeated) += 1;
+    if (sampled_rows >= row_count)
+        return singletons + repeated;
+    return std::min(row_count, std::sqrt(row_count / sampled_rows) * singletons + repeated);
+}
+
+// Read the rows of the sampled blocks and scale what we find up to the whole table.
+double Statistics::analyze(DbRelation& table, BlockID max_blocks) {
+    Identifier table_name = table.get_table_name();
+    const ColumnNames& column_names = table.get_column_names();
+    ColumnAttributes column_attributes = table.get_column_attributes();
+    BlockID block_count = table.get_block_count();
+    BlockID sampled_blocks = std::min(block_count, max_blocks);
+
+    std::vector<std::map<std::string, uint>> counts(column_names.size());
+    std::vector<std::vector<int32_t>> values(column_names.size());
+    std::vector<uint> nulls(column_names.size(), 0);
+    Handles* handles = table.sample(max_blocks);
+    for (Handle& handle: *handles) {
+        ValueDict* row = table.project(handle);
+        for (uint i = 0; i < column_names.size(); i++) {
+            ValueDict::const_iterator column = row->find(column_names[i]);
+            if (column == row->end()) {
+                nulls[i]++;
+            } else if (column_attributes[i].get_data_type() == ColumnAttribute::TEXT) {
+                counts[i][column->second.s]++;
+            } else {
+                counts[i][std::to_string(column->second.n)]++;
+                values[i].push_back(column->second.n);
+            }
+        }
+        delete row;
+    }
+    double sampled_rows = handles->size();
+    delete handles;
+    double row_count = sampled_blocks == 0 ? 0 : std::round(sampled_rows * block_count / sampled_blocks);
+
+    ValueDicts rows;
+    for (uint i = 0; i < column_names.size(); i++) {
+        ValueDict* row = new ValueDict();
+        (*row)["table_name"] = Value(table_name);
+        (*row)["column_name"] = Value(column_names[i]);
+        (*row)["row_count"] = Value((int32_t) row_count);
+        (*row)["block_count"] = Value((int32_t) block_count);
+        (*row)["distinct_count"] = Value((int32_t) estimate_distinct(counts[i], sampled_rows, row_count));
+        (*row)["null_count"] = Value(sampled_rows == 0 ? 0 : (int32_t) std::round(nulls[i] * row_count / sampled_rows));
+
+        // equi-depth: the bounds are the sampled values at evenly spaced ranks
+        std::stringstream histogram;
+        if (column_attributes[i].get_data_type() == ColumnAttribute::INT && !values[i].empty()) {
+            std::vector<int32_t>& sorted = values[i];
+            std::sort(sorted.begin(), sorted.end());
+            for (uint bucket = 0; bucket <= HISTOGRAM_BUCKETS; bucket++)
+                histogram << (bucket == 0 ? "" : " ") << sorted[bucket * (sorted.size() - 1) / HISTOGRAM_BUCKETS];
+        }
+        (*row)["histogram"] = Value(histogram.str());
+        rows.push_back(row);
+    }
+
+    this->forget(table_name);
+    Handles* inserted = this->insert(&rows);
+    delete inserted;
+    for (ValueDict* row: rows)
+        delete row;
+    return row_count;
+}
+
+bool Statistics::get_statistics(Identifier table_name, double& row_count, double& block_count,
+                                ColumnStatisticsMap& columns) {
+    // SELECT * FROM _statistics WHERE table_name = <table_name>
     ValueDict where;
-    where["table_name"] = Value(table_name);
-    where["seq_in_index"] = Value(1);  // only get the row for the first column if composite index
-    Handles *handles = select(&where);
-    for (auto const &handle: *handles) {
-        ValueDict *row = project(handle);
-        ret.push_back((*row)["index_name"].s);
+    where["table_name"] = table_name;
+    Handles* handles = select(&where);
+    bool found = !handles->empty();
+    for (auto const& handle: *handles) {
+        ValueDict* row = project(handle);
+        row_count = (*row)["row_count"].n;
+        block_count = (*row)["block_count"].n;
+        ColumnStatistics& column = columns[(*row)["column_name"].s];
+        column.distinct_count = (*row)["distinct_count"].n;
+        column.null_fraction = row_count == 0 ? 0 : (*row)["null_count"].n / row_count;
+        std::stringstream histogram((*row)["histogram"].s);
+        int32_t bound;
+        while (histogram >> bound)
+            column.histogram.push_back(bound);
         delete row;
     }
     delete handles;
-    return ret;
+    return found;
+}
+
+void Statistics::forget(Identifier table_name) {
+    ValueDict where;
+    where["table_name"] = table_name;
+    Handles* handles = select(&where);
+    this->del(handles);
+    delete handles;
 }
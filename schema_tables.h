@@ -2,12 +2,19 @@
  * @file schema_tables.h - schema table classes:
  * 		Columns
  * 		Tables
+ * 		Indices
+ * 		Catalog
+ * 		Statistics
  * @author Kevin Lundeen
  * @see "Seattle University, CPSC5300, Winter 2023"
  */
 #pragma once
 
+#include <mutex>
 #include "heap_storage.h"
+#include "HashIndex.h"
+#include "BTreeIndex.h"
+#include "BloomIndex.h"
 
 /**
  * Initialize access to the schema tables.
@@ -17,14 +24,59 @@
 void initialize_schema_tables();
 
 
+/**
+ * @class SchemaTable - A schema table backed by a persistent hash index on its key columns.
+ * Selects whose where-clause covers the key columns are answered through the index
+ * instead of a sequential scan, so catalog uniqueness checks and metadata lookups
+ * don't degrade as the catalog grows.
+ */
+class SchemaTable : public HeapTable {
+public:
+    /**
+     * Constructor
+     * @param table_name         name of the schema table
+     * @param column_names       columns of the schema table
+     * @param column_attributes  attributes of the columns
+     * @param key_columns        columns of the search key for the hash index
+     * @param unique             true if key_columns is a key for the schema table
+     */
+    SchemaTable(Identifier table_name, ColumnNames column_names, ColumnAttributes column_attributes,
+                ColumnNames key_columns, bool unique);
+
+    virtual ~SchemaTable() {}
+
+    // HeapTable overrides that also maintain the key index
+    virtual void create();
+
+    virtual void open();
+
+    virtual void close();
+
+    virtual Handle insert(const ValueDict* row);
+
+    virtual Handles* insert(const ValueDicts* rows);
+
+    virtual void del(Handle handle);
+
+    virtual void del(const Handles* handles);
+
+    virtual Handles* select(const ValueDict* where);
+
+    using HeapTable::select;
+
+protected:
+    ColumnNames key_columns;
+    HashIndex key_index;
+};
+
+
 class Columns; // forward declare
 
 /**
  * @class Tables - The singleton table that stores the metadata for all other tables.
- * For now, we are not indexing anything, so a query requires sequential scan
- * of the table.
+ * Indexed on table_name.
  */
-class Tables : public HeapTable {
+class Tables : public SchemaTable {
 public:
     /**
      * Name of the tables table ("_tables")
@@ -41,8 +93,12 @@ public:
 
     virtual Handle insert(const ValueDict* row);
 
+    using SchemaTable::insert;
+
     virtual void del(Handle handle);
 
+    using SchemaTable::del;
+
     /**
      * Get the columns and their attributes for a given table.
      * @param table_name         table to get column info for
@@ -60,25 +116,35 @@ public:
      */
     static DbRelation& get_table(Identifier table_name);
 
+    /**
+     * Let go of the DbRelation get_table handed out for a table, so that the
+     * next get_table makes a new one (e.g., once a rollback has undone the
+     * table's CREATE or DROP). Its indices must be forgotten first.
+     * @param table_name  the table
+     */
+    static void forget(Identifier table_name);
+
 protected:
     // hard-coded columns for _tables table
     static ColumnNames& COLUMN_NAMES();
 
     static ColumnAttributes& COLUMN_ATTRIBUTES();
 
-    // keep a reference to the columns table (for get_columns method)
+    // keep a reference to the columns table (so get_table hands out the one instance)
     static Columns* columns_table;
 
 private:
-    // keep a cache of all the tables we've instantiated so far
+    // keep a cache of all the tables we've instantiated so far (shared by every session)
     static std::map<Identifier, DbRelation*> table_cache;
+    static std::mutex cache_mutex;
 };
 
 
 /**
  * @class Columns - The singleton table that stores the column metadata for all tables.
+ * Indexed on table_name.
  */
-class Columns : public HeapTable {
+class Columns : public SchemaTable {
 public:
     /**
      * Name of the columns table ("_columns")
@@ -95,6 +161,12 @@ public:
 
     virtual Handle insert(const ValueDict* row);
 
+    using SchemaTable::insert;
+
+    virtual void del(Handle handle);
+
+    using SchemaTable::del;
+
 protected:
     // hard-coded columns for the _columns table
     static ColumnNames& COLUMN_NAMES();
@@ -105,7 +177,11 @@ protected:
 
 using IndexNames = ColumnNames;
 
-class Indices : public HeapTable {
+/**
+ * @class Indices - The singleton table that stores the index metadata for all tables.
+ * Indexed on table_name.
+ */
+class Indices : public SchemaTable {
 public:
     /**
      * Name of the indices table ("_indices")
@@ -145,11 +221,23 @@ public:
      */
     virtual IndexNames get_index_names(Identifier table_name);
 
+    /**
+     * Let go of the DbIndex get_index handed out for an index, so that the
+     * next get_index makes a new one.
+     * @param table_name  what table the index is on
+     * @param index_name  name of the index, or "" for all the table's indices
+     */
+    static void forget(Identifier table_name, Identifier index_name = "");
+
     // overrides
     virtual Handle insert(const ValueDict* row);
 
+    using SchemaTable::insert;
+
     virtual void del(Handle handle);
 
+    using SchemaTable::del;
+
 protected:
     static ColumnNames& COLUMN_NAMES();
 
@@ -157,4 +245,187 @@ protected:
 
 private:
     static std::map<std::pair<Identifier, Identifier>, DbIndex*> index_cache;
-};
\ No newline at end of file
+    static std::mutex cache_mutex;
+};
+
+
+/**
+ * @class Catalog - in-memory copy of what _tables, _columns, and _indices say
+ *
+ * Loaded once by initialize_schema_tables() and then kept current by the
+ * schema tables themselves: each insert into or delete from _tables, _columns,
+ * or _indices is written through to the catalog once it has been done on disk,
+ * so the DDL in SQLExec keeps the two in step. A rollback takes back the rows
+ * but not what was written through, so SQLExec reloads the catalog after a
+ * failed DDL statement. Metadata lookups (Tables::get_columns, Indices::get_columns,
+ * Indices::get_index_names, SHOW) are answered from here without any reads.
+ */
+class Catalog {
+public:
+    /**
+     * @class Catalog::IndexEntry - an index's search key and kind
+     */
+    class IndexEntry {
+    public:
+        IndexEntry(Identifier index_name, Identifier index_type, bool is_unique)
+            : index_name(index_name), column_names(), index_type(index_type), is_hash(index_type == "HASH"),
+              is_unique(is_unique) {}
+
+        Identifier index_name;
+        ColumnNames column_names;  // in seq_in_index order
+        Identifier index_type;     // BTREE, HASH, or BLOOM
+        bool is_hash;
+        bool is_unique;
+    };
+
+    /**
+     * @class Catalog::TableEntry - a table's columns and indices
+     */
+    class TableEntry {
+    public:
+        TableEntry() : column_names(), column_attributes(), ordinals(), indices() {}
+
+        /**
+         * Position of a column in the table's rows.
+         * @returns  the 0-based ordinal, or -1 if the table has no such column
+         */
+        int ordinal(Identifier column_name) const;
+
+        ColumnNames column_names;
+        ColumnAttributes column_attributes;
+        std::map<Identifier, uint> ordinals;
+        std::vector<IndexEntry> indices;  // in the order they were created
+    };
+
+    /**
+     * Read the metadata of every table from the schema tables, replacing whatever was loaded.
+     * @param tables   the _tables table
+     * @param columns  the _columns table
+     * @param indices  the _indices table
+     */
+    static void load(DbRelation& tables, DbRelation& columns, DbRelation& indices);
+
+    /**
+     * Names of all the tables, in the order they were created.
+     */
+    static const std::vector<Identifier>& get_table_names() { return table_names; }
+
+    /**
+     * Get a table's metadata.
+     * @param table_name  the table
+     * @returns           its entry, or nullptr if there is no such table
+     */
+    static const TableEntry* get_table(Identifier table_name);
+
+    /**
+     * Get an index's metadata.
+     * @param table_name  what table the index is on
+     * @param index_name  name of the index (unique by table)
+     * @returns           its entry, or nullptr if there is no such index
+     */
+    static const IndexEntry* get_index(Identifier table_name, Identifier index_name);
+
+    // write-through from the schema tables, each given the row inserted or deleted
+    static void add_table(const ValueDict* row);
+
+    static void drop_table(const ValueDict* row);
+
+    static void add_column(const ValueDict* row);
+
+    static void drop_column(const ValueDict* row);
+
+    static void add_index_column(const ValueDict* row);
+
+    static void drop_index_column(const ValueDict* row);
+
+private:
+    static std::vector<Identifier> table_names;
+    static std::map<Identifier, TableEntry> table_entries;
+};
+
+
+/**
+ * @class ColumnStatistics - what ANALYZE found out about the values in one column
+ */
+class ColumnStatistics {
+public:
+    ColumnStatistics() : distinct_count(0), null_fraction(0), histogram() {}
+
+    double distinct_count;
+    double null_fraction;
+
+    /**
+     * Equi-depth histogram bounds (INT columns only, empty otherwise): bucket i
+     * holds about the same share of the rows as every other bucket, all with
+     * values in [histogram[i], histogram[i + 1]].
+     */
+    std::vector<int32_t> histogram;
+};
+
+using ColumnStatisticsMap = std::map<Identifier, ColumnStatistics>;
+
+/**
+ * @class Statistics - The singleton table that stores the statistics ANALYZE collects.
+ * One row per column of each analyzed table, indexed on table_name.
+ */
+class Statistics : public SchemaTable {
+public:
+    /**
+     * Name of the statistics table ("_statistics")
+     */
+    static const Identifier TABLE_NAME;
+
+    /**
+     * Most blocks ANALYZE reads from a table
+     */
+    static const BlockID SAMPLE_BLOCKS = 64;
+
+    /**
+     * Number of buckets in each histogram
+     */
+    static const uint HISTOGRAM_BUCKETS = 10;
+
+    // ctor/dtor
+    Statistics();
+
+    virtual ~Statistics() {}
+
+    /**
+     * Collect statistics for a table from a sample of its blocks, replacing any
+     * collected before.
+     * @param table        table to analyze
+     * @param max_blocks   most blocks to read
+     * @returns            the estimated number of rows in the table
+     */
+    virtual double analyze(DbRelation& table, BlockID max_blocks = SAMPLE_BLOCKS);
+
+    /**
+     * Get the statistics last collected for a table.
+     * @param table_name   table to get statistics for
+     * @param row_count    returned by reference: estimated number of rows
+     * @param block_count  returned by reference: number of blocks when analyzed
+     * @param columns      returned by reference: statistics for each column
+     * @returns            false if the table has never been analyzed
+     */
+    virtual bool get_statistics(Identifier table_name, double& row_count, double& block_count,
+                                ColumnStatisticsMap& columns);
+
+    /**
+     * Remove the statistics for a table (e.g., when it is dropped).
+     * @param table_name  table to forget
+     */
+    virtual void forget(Identifier table_name);
+
+    /**
+     * Add the statistics table's rows to _tables and _columns where they are
+     * missing, as in a catalog created before there were statistics.
+     * @param tables   the _tables table
+     * @param columns  the _columns table
+     */
+    static void register_schema(DbRelation& tables, DbRelation& columns);
+
+protected:
+    static ColumnNames& COLUMN_NAMES();
+
+    static ColumnAttributes& COLUMN_ATTRIBUTES();
+};
@@ -4,20 +4,28 @@
  * @see "Seattle University, CPSC5300, Winter 2023"
  */
 
+#include <chrono>
+#include <csignal>
 #include <cstdlib>
+#include <ctime>
+#include <fstream>
+#include <iomanip>
+#include <thread>
+#include <unistd.h>
 #include <iostream>
 #include <string>
 #include "db_cxx.h"
-#include "ParseTreeToString.h"
-#include "SQLExec.h"
-#include "tests.h"
+#include "SQLShell.h"
+#include "SQLServer.h"
 
 using namespace std;
-using namespace hsql;
 
 DbEnv* _DB_ENV; // Global DB environment
-const u_int32_t ENV_FLAGS = DB_CREATE | DB_INIT_MPOOL;
-const std::string TEST = "test", QUIT = "quit";
+// shared by threads and sessions, with transactions (and recovery from the log on start-up)
+const u_int32_t ENV_FLAGS = DB_CREATE | DB_INIT_MPOOL | DB_THREAD | DB_INIT_LOCK | DB_INIT_LOG | DB_INIT_TXN | DB_RECOVER;
+const u_int32_t LOCK_TIMEOUT = 5000000;  // microseconds a read outside of any transaction waits for a lock
+const chrono::milliseconds FLUSH_INTERVAL(200);  // how often commits not waited for are put on disk
+SQLServer* server = nullptr;  // set while serving
 
 /**
  * Establishes a database environment
@@ -31,37 +39,89 @@ void initDbEnv(string);
 void runSQLShell();
 
 /**
- * Processes a single SQL query
- * @param sql A SQL query (or queries) to process
+ * Runs the statements of a script (each ended by a semicolon and possibly
+ * spanning lines) without echoing them, and then reports the throughput
+ * @param in The script
+ * @param timing True to report the wall and CPU time of each statement
  */
-void handleSQL(string);
+void runSQLScript(istream&, bool timing);
 
 /**
- * Processes SQL statements within a parsed query
- * @param parsedSQL A pointer to a parsed SQL query
+ * Serves sessions on a Unix domain socket until interrupted
+ * @param socketPath Where to make the socket
+ * @param workers Number of worker threads
+ * @return the exit status
  */
-void handleStatements(SQLParserResult*);
+int runSQLServer(string socketPath, uint workers);
 
 /**
  * Main entry point of the sql5300 program
  * @args dbenvpath  the path to the BerkeleyDB database environment
+ * @args -f script  run the statements in script instead of an interactive shell
+ *                  (as is done with stdin when it isn't a terminal)
+ * @args -t         report the time each statement of a script takes
+ * @args -s socket  serve sessions on a Unix domain socket instead
+ * @args -w workers number of threads running the sessions' statements
  */
 int main(int argc, char** argv) {
-    if (argc != 2) {
-        cerr << "USAGE: " << argv[0] << " [db_environment]\n";
+    string envHome, script, socketPath;
+    bool timing = false;
+    uint workers = thread::hardware_concurrency() > 0 ? thread::hardware_concurrency() : 4;
+    for (int i = 1; i < argc; i++) {
+        string arg = argv[i];
+        if (arg == "-f" && i + 1 < argc)
+            script = argv[++i];
+        else if (arg == "-t")
+            timing = true;
+        else if (arg == "-s" && i + 1 < argc)
+            socketPath = argv[++i];
+        else if (arg == "-w" && i + 1 < argc)
+            workers = (uint) atoi(argv[++i]);
+        else if (envHome.empty() && arg[0] != '-')
+            envHome = arg;
+        else {
+            envHome.clear();
+            break;
+        }
+    }
+    if (envHome.empty()) {
+        cerr << "USAGE: " << argv[0] << " [-f script] [-t] [-s socket [-w workers]] [db_environment]\n";
         return EXIT_FAILURE;
     }
-    initDbEnv(argv[1]);
-    runSQLShell();
-    return EXIT_SUCCESS;
+    bool interactive = script.empty() && socketPath.empty() && isatty(STDIN_FILENO);
+    if (!interactive)
+        ios::sync_with_stdio(false);  // nothing else reads or writes through stdio
+    if (interactive)
+        cout << "(sql5300: running with database environment at " << envHome << ")" << endl;
+    initDbEnv(envHome);
+    Transaction::start_flusher(FLUSH_INTERVAL);
+    int status = EXIT_SUCCESS;
+    if (!socketPath.empty()) {
+        status = runSQLServer(socketPath, workers);
+    } else if (interactive) {
+        runSQLShell();
+    } else if (script.empty()) {
+        runSQLScript(cin, timing);
+    } else {
+        ifstream in(script);
+        if (in) {
+            runSQLScript(in, timing);
+        } else {
+            cerr << "(sql5300: cannot read " << script << ")" << endl;
+            status = EXIT_FAILURE;
+        }
+    }
+    Transaction::stop_flusher();  // so the last ASYNC commits are on disk
+    return status;
 }
 
 void initDbEnv(string envHome) {
-    cout << "(sql5300: running with database environment at " << envHome << ")" << endl;
     _DB_ENV = new DbEnv(0U);
     _DB_ENV->set_message_stream(&cout);
     _DB_ENV->set_error_stream(&cerr);
     try {
+        _DB_ENV->set_lk_detect(DB_LOCK_DEFAULT);  // a thread caught in a deadlock gets an error rather than hanging
+        _DB_ENV->set_timeout(LOCK_TIMEOUT, DB_SET_LOCK_TIMEOUT);
         _DB_ENV->open(envHome.c_str(), ENV_FLAGS, 0);
     } catch (DbException& e) {
         cerr << "(sql5300: " << e.what() << ")" << endl;
@@ -71,38 +131,60 @@ void initDbEnv(string envHome) {
 }
 
 void runSQLShell() {
+    SQLShell shell(cout, cerr);
     std::string sql = "";
-    while (sql != QUIT) {
+    while (sql != SQLShell::QUIT) {
         std::cout << "SQL> ";
         std::getline(std::cin, sql);
-        handleSQL(sql);
+        shell.handle(sql);
+    }
+}
+
+void runSQLScript(istream& in, bool timing) {
+    using Clock = std::chrono::steady_clock;
+    SQLShell shell(cout, cerr, false);
+    size_t nStatements = 0;
+    Clock::time_point scriptStart = Clock::now();
+    clock_t scriptCpu = clock();
+    string sql;
+    while (SQLShell::read_statement(in, sql) && sql != SQLShell::QUIT) {
+        Clock::time_point start = Clock::now();
+        clock_t cpu = clock();
+        shell.handle(sql);
+        nStatements++;
+        if (timing) {
+            double wall = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+            double cpuTime = 1000.0 * (clock() - cpu) / CLOCKS_PER_SEC;
+            cerr << "(statement " << nStatements << ": " << fixed << setprecision(3) << wall << " ms, " << cpuTime
+                 << " ms CPU)" << endl;
+        }
     }
+    double wall = std::chrono::duration<double>(Clock::now() - scriptStart).count();
+    double cpuTime = (double) (clock() - scriptCpu) / CLOCKS_PER_SEC;
+    cerr << "(sql5300: " << nStatements << " statements in " << fixed << setprecision(3) << wall << " s, "
+         << setprecision(1) << (wall > 0 ? nStatements / wall : 0.0) << " statements/s, " << setprecision(3)
+         << cpuTime << " s CPU)" << endl;
 }
 
-void handleSQL(std::string sql) {
-    if (sql == QUIT || !sql.length()) return;
-    SQLParserResult* const parsedSQL = SQLParser::parseSQLString(sql);
-    if (parsedSQL->isValid())
-        handleStatements(parsedSQL);
-    else if (sql == TEST) {
-        cout << "test_heap_storage: " << (test_heap_storage() ? "Passed" : "Failed") << endl;
-        cout << "test_sql_exec: " << (test_sql_exec() ? "Passed" : "Failed") << endl;
-    } else
-        cerr << "invalid SQL: " << sql << endl << parsedSQL->errorMsg() << endl;
-    delete parsedSQL;
+static void stopServer(int) {
+    if (server != nullptr)
+        server->stop();
 }
 
-void handleStatements(hsql::SQLParserResult* parsedSQL) {
-    size_t nStatements = parsedSQL->size();
-    for (size_t i = 0; i < nStatements; ++i) {
-        const SQLStatement* statement = parsedSQL->getStatement(i);
-        try {
-            cout << ParseTreeToString::statement(statement) << endl;
-            QueryResult* result = SQLExec::execute(statement);
-            cout << *result << endl;
-            delete result;
-        } catch (SQLExecError& e) {
-            cerr << "Error: " << e.what() << endl;
-        }
+int runSQLServer(string socketPath, uint workers) {
+    server = new SQLServer(socketPath, workers);
+    signal(SIGINT, stopServer);
+    signal(SIGTERM, stopServer);
+    cerr << "(sql5300: serving on " << socketPath << " with " << workers << " workers)" << endl;
+    int status = EXIT_SUCCESS;
+    try {
+        server->run();
+    } catch (runtime_error& e) {
+        cerr << "(sql5300: " << e.what() << ")" << endl;
+        status = EXIT_FAILURE;
     }
-}
\ No newline at end of file
+    SQLServer* done = server;
+    server = nullptr;
+    delete done;
+    return status;
+}
@@ -9,9 +9,9 @@
 bool Value::operator==(const Value& other) const {
     if (this->data_type != other.data_type)
         return false;
-    if (this->data_type == ColumnAttribute::INT)
-        return this->n == other.n;
-    return this->s == other.s;
+    if (this->data_type == ColumnAttribute::TEXT)
+        return this->s == other.s;
+    return this->n == other.n;
 }
 
 bool Value::operator!=(const Value& other) const {
@@ -26,3 +26,63 @@ ValueDict* DbRelation::project(Handle handle, const ValueDict* where) {
     return this->project(handle, &t);
 }
 
+
+// Inserts the rows one at a time; storage engines that can do better override this.
+Handles* DbRelation::insert(const ValueDicts* rows) {
+    Handles* handles = new Handles();
+    for (ValueDict* row: *rows)
+        handles->push_back(this->insert(row));
+    return handles;
+}
+
+// Deletes the rows one at a time; storage engines that can do better override this.
+void DbRelation::del(const Handles* handles) {
+    for (const Handle& handle: *handles)
+        this->del(handle);
+}
+
+// Takes every row; storage engines that can read just some of their blocks override this.
+Handles* DbRelation::sample(BlockID max_blocks) {
+    return this->select();
+}
+
+// Selects everything at once; storage engines that can read a block at a time override this.
+Handles* DbRelation::select(const ValueDict* where, const IntRanges* ranges, size_t limit, BlockID& next_block) {
+    if (next_block == 0)
+        return new Handles();
+    next_block = 0;
+    return this->select(where, ranges);
+}
+
+// Filters select(where) by the ranges; storage engines that can do better override this.
+Handles* DbRelation::select(const ValueDict* where, const IntRanges* ranges) {
+    Handles* handles = this->select(where);
+    if (ranges == nullptr || ranges->empty())
+        return handles;
+    ColumnNames range_columns;
+    for (auto const& range: *ranges)
+        range_columns.push_back(range.first);
+    Handles* selected = new Handles();
+    for (Handle& handle: *handles) {
+        ValueDict* row = this->project(handle, &range_columns);
+        bool in_range = true;
+        for (auto const& range: *ranges) {
+            int32_t n = (*row)[range.first].n;
+            if (n < range.second.first || n > range.second.second)
+                in_range = false;
+        }
+        if (in_range)
+            selected->push_back(handle);
+        delete row;
+    }
+    delete handles;
+    return selected;
+}
+
+// Truncates the whole range; indices that can stop early override this.
+Handles* DbIndex::range(ValueDict* min_key, ValueDict* max_key, size_t limit) const {
+    Handles* handles = this->range(min_key, max_key);
+    if (handles->size() > limit)
+        handles->resize(limit);
+    return handles;
+}
@@ -241,6 +241,8 @@ using Handle = std::pair<BlockID, RecordID>;
 using Handles = std::vector<Handle>;  // FIXME: will need to turn this into an iterator at some point
 using ValueDict = std::map<Identifier, Value>;
 using ValueDicts = std::vector<ValueDict*>;
+using IntRange = std::pair<int32_t, int32_t>;  // inclusive [min, max]
+using IntRanges = std::map<Identifier, IntRange>;
 
 
 /**
@@ -264,10 +266,15 @@ public:
  * 	close()
  * 	
  *	insert(row)
+ *	insert(rows)
  *	update(handle, new_values)
  *	del(handle)
+ *	del(handles)
  *	select()
  *	select(where)
+ *	select(where, ranges)
+ *	select(where, ranges, limit, next_block)
+ *	sample(max_blocks)
  *	project(handle)
  *	project(handle, column_names)
  */
@@ -315,6 +322,13 @@ public:
      */
     virtual Handle insert(const ValueDict* row) = 0;
 
+    /**
+     * Execute: INSERT INTO <table_name> ( <row_keys> ) VALUES ( <row_values> ), ...
+     * @param rows  dictionaries keyed by column names
+     * @returns     a pointer to a list of handles to the new rows, in order (freed by caller)
+     */
+    virtual Handles* insert(const ValueDicts* rows);
+
     /**
      * Conceptually, execute: UPDATE INTO <table_name> SET <new_values> WHERE <handle>
      * where handle is sufficient to identify one specific record (e.g., returned
@@ -332,6 +346,12 @@ public:
      */
     virtual void del(const Handle handle) = 0;
 
+    /**
+     * Conceptually, execute: DELETE FROM <table_name> WHERE <handle> OR ...
+     * @param handles  the rows to delete
+     */
+    virtual void del(const Handles* handles);
+
     /**
      * Conceptually, execute: SELECT <handle> FROM <table_name> WHERE 1
      * @returns  a pointer to a list of handles for qualifying rows (caller frees)
@@ -345,6 +365,35 @@ public:
      */
     virtual Handles* select(const ValueDict* where) = 0;
 
+    /**
+     * Conceptually, execute: SELECT <handle> FROM <table_name> WHERE <where> AND <ranges>
+     * @param where   equality predicates (may be nullptr)
+     * @param ranges  INT columns' inclusive ranges (may be nullptr)
+     * @returns       a pointer to a list of handles for qualifying rows (freed by caller)
+     */
+    virtual Handles* select(const ValueDict* where, const IntRanges* ranges);
+
+    /**
+     * Like select(where, ranges), but a part of the relation at a time: stops
+     * once at least limit qualifying rows are found (at the end of the block
+     * they were found in), so that a scan can be picked up again where it left off.
+     * @param where       equality predicates (may be nullptr)
+     * @param ranges      INT columns' inclusive ranges (may be nullptr)
+     * @param limit       rows wanted
+     * @param next_block  block to start from (1 to start at the beginning);
+     *                    returned by reference: block to carry on from, or 0 once
+     *                    the whole relation has been read
+     * @returns           a pointer to a list of handles for qualifying rows (freed by caller)
+     */
+    virtual Handles* select(const ValueDict* where, const IntRanges* ranges, size_t limit, BlockID& next_block);
+
+    /**
+     * Get every row in a random sample of the relation's blocks (for gathering statistics).
+     * @param max_blocks  most blocks to sample (all of them if there are no more than this)
+     * @returns           a pointer to a list of handles for the sampled rows (freed by caller)
+     */
+    virtual Handles* sample(BlockID max_blocks);
+
     /**
      * Return a sequence of all values for handle (SELECT *).
      * @param handle  row to get values from
@@ -370,6 +419,14 @@ public:
      */
     virtual ValueDict *project(Handle handle, const ValueDict *column_names);
 
+    /**
+     * Accessor for table_name.
+     * @returns table_name   name of this relation
+     */
+    virtual const Identifier& get_table_name() const {
+        return table_name;
+    }
+
     /**
      * Accessor for column_names.
      * @returns column_names   list of column names for this relation, in order
@@ -386,6 +443,12 @@ public:
         return column_attributes;
     }
 
+    /**
+     * Number of blocks the relation takes up in storage.
+     * @returns  the block count
+     */
+    virtual BlockID get_block_count() = 0;
+
 protected:
     Identifier table_name;
     ColumnNames column_names;
@@ -444,6 +507,15 @@ public:
         throw DbRelationError("range index query not supported");
     }
 
+    /**
+     * Lookup the first limit records in a range of search keys.
+     * @param min_key  dictionary of min (inclusive) search key
+     * @param max_key  dictionary of max (inclusive) search key
+     * @param limit    most handles to return
+     * @returns        list of DbFile handles for records in range (freed by caller)
+     */
+    virtual Handles* range(ValueDict* min_key, ValueDict* max_key, size_t limit) const;
+
     /**
      * Insert the index entry for the given record.
      * @param record  handle (into relation) to the record to insert
@@ -458,6 +530,14 @@ public:
      */
     virtual void del(Handle record) = 0;
 
+    /**
+     * Accessor for name.
+     * @returns name  name of this index
+     */
+    virtual const Identifier& get_name() const {
+        return name;
+    }
+
 protected:
     DbRelation &relation;
     Identifier name;
@@ -5,12 +5,25 @@
  */
 
 #pragma once
+#include <algorithm>
+#include <atomic>
 #include <iostream>
+#include <sstream>
 #include <cstring>
+#include <functional>
+#include <future>
+#include <thread>
 #include "db_cxx.h"
 #include "SlottedPage.h"
 #include "HeapTable.h"
+#include "HashIndex.h"
+#include "KeyEncoder.h"
+#include "BTreeIndex.h"
+#include "QueryPlan.h"
+#include "Kernels.h"
+#include "Optimizer.h"
 #include "SQLExec.h"
+#include "ResultWriter.h"
 #include "ParseTreeToString.h"
 
 
@@ -299,6 +312,1700 @@ bool test_heap_storage() {
     return true;
 }
 
+/**
+ * Testing function for inserting many rows at once into a HeapTable.
+ * @return true if the tests all succeeded
+ */
+bool test_batch_insert() {
+    ColumnNames column_names = {"a", "b", "c"};
+    ColumnAttributes column_attributes = {
+        ColumnAttribute(ColumnAttribute::INT),
+        ColumnAttribute(ColumnAttribute::TEXT),
+        ColumnAttribute(ColumnAttribute::BOOLEAN)
+    };
+    HeapTable table("_test_batch_insert_cpp", column_names, column_attributes);
+    table.create();
+    ValueDict row;
+    test_set_row(row, -1, "single");
+    table.insert(&row);
+
+    ValueDicts rows;
+    for (int i = 0; i < 1000; i++) {
+        rows.push_back(new ValueDict());
+        test_set_row(*rows.back(), i, "batch " + std::to_string(i));
+    }
+    Handles* handles = table.insert(&rows);
+    for (ValueDict* batch_row: rows)
+        delete batch_row;
+    rows.clear();
+    if (handles->size() != 1000 || handles->front().first != 1)
+        return assertion_failure("batch insert handles", handles->size());
+    for (int i = 0; i < 1000; i++) {
+        if (!test_compare(table, handles->at(i), i, "batch " + std::to_string(i)))
+            return assertion_failure("batch insert row", i);
+        if (i > 0 && handles->at(i).first < handles->at(i - 1).first)
+            return assertion_failure("batch insert order", i);
+    }
+    delete handles;
+
+    // the zone maps were widened for the whole batch
+    IntRanges ranges = {{"a", IntRange(-1, 9)}};
+    handles = table.select(nullptr, &ranges);
+    if (handles->size() != 11)
+        return assertion_failure("batch insert zone maps", handles->size());
+    delete handles;
+
+    // a bad row stops the whole batch
+    rows.push_back(new ValueDict(row));
+    rows.push_back(new ValueDict({{"a", Value(1)}}));
+    try {
+        table.insert(&rows);
+        return assertion_failure("batch insert of incomplete row");
+    } catch (DbRelationError& e) {
+        // expected
+    }
+    for (ValueDict* batch_row: rows)
+        delete batch_row;
+    handles = table.select();
+    if (handles->size() != 1001)
+        return assertion_failure("batch insert of incomplete row inserted", handles->size());
+    delete handles;
+
+    table.drop();
+    return true;
+}
+
+/**
+ * Testing function for deleting many rows at once from a HeapTable.
+ * @return true if the tests all succeeded
+ */
+bool test_batch_delete() {
+    ColumnNames column_names = {"a", "b", "c"};
+    ColumnAttributes column_attributes = {
+        ColumnAttribute(ColumnAttribute::INT),
+        ColumnAttribute(ColumnAttribute::TEXT),
+        ColumnAttribute(ColumnAttribute::BOOLEAN)
+    };
+    HeapTable table("_test_batch_delete_cpp", column_names, column_attributes);
+    table.create();
+    ValueDict row;
+    for (int i = 0; i < 1000; i++) {
+        test_set_row(row, i, "row " + std::to_string(i));
+        table.insert(&row);
+    }
+
+    // delete the even rows, handed over in reverse so they aren't grouped by block
+    ValueDict where = {{"c", Value(true)}};
+    where["c"].data_type = ColumnAttribute::BOOLEAN;
+    Handles* handles = table.select(&where);
+    if (handles->size() != 500)
+        return assertion_failure("batch delete select", handles->size());
+    std::reverse(handles->begin(), handles->end());
+    table.del(handles);
+    delete handles;
+
+    handles = table.select();
+    if (handles->size() != 500)
+        return assertion_failure("batch delete", handles->size());
+    int i = 1;
+    for (Handle& handle: *handles) {
+        if (!test_compare(table, handle, i, "row " + std::to_string(i)))
+            return assertion_failure("batch delete left row", i);
+        i += 2;
+    }
+    delete handles;
+
+    table.drop();
+    return true;
+}
+
+/*
+ * ****************************
+ * Block summary tests
+ * ****************************
+ */
+
+/**
+ * Testing function for per-block Bloom filters on a HeapTable.
+ * @return true if the tests all succeeded
+ */
+bool test_bloom_filters() {
+    ColumnNames column_names = {"a", "b", "c"};
+    ColumnAttributes column_attributes = {
+        ColumnAttribute(ColumnAttribute::INT),
+        ColumnAttribute(ColumnAttribute::TEXT),
+        ColumnAttribute(ColumnAttribute::BOOLEAN)
+    };
+    HeapTable table("_test_bloom_cpp", column_names, column_attributes);
+    table.create();
+    ValueDict row;
+    for (int i = 0; i < 500; i++) {
+        test_set_row(row, i, "before " + std::to_string(i));
+        table.insert(&row);
+    }
+    table.create_bloom_filters(ColumnNames({"a", "b"}));
+    for (int i = 500; i < 1000; i++) {
+        test_set_row(row, i, "after " + std::to_string(i));
+        table.insert(&row);
+    }
+
+    // filters give the same answers as a plain scan, before and after reopening
+    for (int pass = 0; pass < 2; pass++) {
+        for (int i = 0; i < 1000; i += 99) {
+            ValueDict where = {{"a", Value(i)}};
+            Handles* handles = table.select(&where);
+            std::string b = (i < 500 ? "before " : "after ") + std::to_string(i);
+            if (handles->size() != 1 || !test_compare(table, handles->front(), i, b))
+                return assertion_failure("bloom filtered select", i);
+            delete handles;
+            where = {{"b", Value(b)}};
+            handles = table.select(&where);
+            if (handles->size() != 1)
+                return assertion_failure("bloom filtered select on text", i);
+            delete handles;
+        }
+        ValueDict where = {{"b", Value("never inserted")}};
+        Handles* handles = table.select(&where);
+        if (!handles->empty())
+            return assertion_failure("bloom filtered select of missing value");
+        delete handles;
+        table.close();
+    }
+    table.drop();
+    return true;
+}
+
+
+/**
+ * Testing function for per-block zone maps.
+ * @return true if the tests all succeeded
+ */
+bool test_zone_maps() {
+    ColumnNames column_names = {"a", "b", "c"};
+    ColumnAttributes column_attributes = {
+        ColumnAttribute(ColumnAttribute::INT),
+        ColumnAttribute(ColumnAttribute::TEXT),
+        ColumnAttribute(ColumnAttribute::BOOLEAN)
+    };
+    HeapTable table("_test_zone_maps_cpp", column_names, column_attributes);
+    table.create();
+    ValueDict row;
+    for (int i = 0; i < 1000; i++) {
+        test_set_row(row, i * 10, "zone " + std::to_string(i));
+        table.insert(&row);
+    }
+    Handles* handles = table.select();
+    Handle deleted = handles->at(500);  // a = 5000
+    delete handles;
+    table.del(deleted);
+
+    // zone maps give the same answers as a plain scan, before and after reopening
+    for (int pass = 0; pass < 2; pass++) {
+        IntRanges ranges = {{"a", IntRange(1995, 2100)}};
+        handles = table.select(nullptr, &ranges);
+        if (handles->size() != 11 || !test_compare(table, handles->front(), 2000, "zone 200"))
+            return assertion_failure("zone map range select", pass);
+        delete handles;
+        ranges = {{"a", IntRange(4990, 5010)}};
+        handles = table.select(nullptr, &ranges);
+        if (handles->size() != 2)
+            return assertion_failure("zone map range select after delete", pass);
+        delete handles;
+        ValueDict where = {{"b", Value("zone 300")}};
+        ranges = {{"a", IntRange(0, 2999)}};
+        handles = table.select(&where, &ranges);
+        if (!handles->empty())
+            return assertion_failure("zone map range select with predicate", pass);
+        delete handles;
+        ranges = {{"a", IntRange(10000, INT32_MAX)}};
+        handles = table.select(nullptr, &ranges);
+        if (!handles->empty())
+            return assertion_failure("zone map range select past the end", pass);
+        delete handles;
+        where = {{"a", Value(7770)}};
+        handles = table.select(&where);
+        if (handles->size() != 1 || !test_compare(table, handles->front(), 7770, "zone 777"))
+            return assertion_failure("zone map equality select", pass);
+        delete handles;
+        table.close();
+    }
+    table.drop();
+    return true;
+}
+
+
+/*
+ * ****************************
+ * Key encoder tests
+ * ****************************
+ */
+
+/**
+ * Testing function for KeyEncoder.
+ * @return true if the tests all succeeded
+ */
+bool test_key_encoder() {
+    ColumnNames column_names = {"a", "b", "c"};
+    ColumnAttributes column_attributes = {
+        ColumnAttribute(ColumnAttribute::INT),
+        ColumnAttribute(ColumnAttribute::TEXT),
+        ColumnAttribute(ColumnAttribute::BOOLEAN)
+    };
+    HeapTable table("_test_key_encoder_cpp", column_names, column_attributes);
+    KeyEncoder encoder(table, ColumnNames({"a", "b", "c"}));
+
+    // keys in ascending order, column by column
+    int32_t ints[] = {INT32_MIN, -65536, -1, 0, 1, 255, 256, INT32_MAX};
+    std::string texts[] = {"", std::string("\0", 1), std::string("\0\0", 2), std::string("a\0", 2), "a", "ab", "b"};
+    std::sort(texts, texts + 7);
+    std::vector<KeyBytes> keys;
+    for (int32_t n: ints) {
+        for (const std::string& text: texts) {
+            for (int c = 0; c < 2; c++) {
+                ValueDict row = {{"a", Value(n)}, {"b", Value(text)}, {"c", Value(c)}};
+                keys.push_back(encoder.encode(&row));
+                ValueDict* decoded = encoder.decode(keys.back());
+                if ((*decoded)["a"].n != n || (*decoded)["b"].s != text || (*decoded)["c"].n != c)
+                    return assertion_failure("key encoder round trip");
+                delete decoded;
+            }
+        }
+    }
+    for (size_t i = 1; i < keys.size(); i++)
+        if (!(keys[i - 1] < keys[i]))  // std::string compares bytes as unsigned, like memcmp
+            return assertion_failure("key encoder order", i);
+
+    // a key prefix encodes as a byte prefix of the full key
+    ValueDict row = {{"a", Value(42)}, {"b", Value("hello")}, {"c", Value(1)}};
+    ValueDict prefix = {{"a", Value(42)}, {"b", Value("hello")}};
+    if (encoder.encode(&row).compare(0, encoder.encode_prefix(&prefix).size(), encoder.encode_prefix(&prefix)) != 0)
+        return assertion_failure("key encoder prefix");
+    return true;
+}
+
+
+/*
+ * ****************************
+ * Hash index tests
+ * ****************************
+ */
+
+/**
+ * Testing function for HashIndex.
+ * @return true if the tests all succeeded
+ */
+bool test_hash_index() {
+    ColumnNames column_names = {"a", "b", "c"};
+    ColumnAttributes column_attributes = {
+        ColumnAttribute(ColumnAttribute::INT),
+        ColumnAttribute(ColumnAttribute::TEXT),
+        ColumnAttribute(ColumnAttribute::BOOLEAN)
+    };
+    HeapTable table("_test_hash_index_cpp", column_names, column_attributes);
+    table.create();
+    ValueDict row;
+    for (int i = 0; i < 1000; i++) {
+        test_set_row(row, i, "row" + std::to_string(i % 10));
+        table.insert(&row);
+    }
+
+    // index built over existing rows, then maintained on insert
+    HashIndex index(table, "fxa", ColumnNames({"b"}), false);
+    index.create();
+    test_set_row(row, 1000, "row0");
+    index.insert(table.insert(&row));
+    ValueDict key = {{"b", Value("row0")}};
+    Handles* handles = index.lookup(&key);
+    if (handles->size() != 101)
+        return assertion_failure("hash lookup of non-unique key", handles->size());
+    for (Handle& handle: *handles) {
+        ValueDict* result = table.project(handle);
+        if ((*result)["b"].s != "row0" || (*result)["a"].n % 10 != 0)
+            return assertion_failure("hash lookup returned wrong row");
+        delete result;
+    }
+
+    // del removes just the one entry
+    index.del(handles->front());
+    table.del(handles->front());
+    delete handles;
+    handles = index.lookup(&key);
+    if (handles->size() != 100)
+        return assertion_failure("hash lookup after del", handles->size());
+    delete handles;
+
+    // unique index rejects duplicates
+    HashIndex unique_index(table, "fxu", ColumnNames({"a"}), true);
+    unique_index.create();
+    key = {{"a", Value(500)}};
+    handles = unique_index.lookup(&key);
+    if (handles->size() != 1)
+        return assertion_failure("hash lookup of unique key", handles->size());
+    try {
+        unique_index.insert(handles->front());
+        return assertion_failure("unique hash index accepted duplicate");
+    } catch (DbRelationError& e) {
+        // expected
+    }
+    delete handles;
+
+    unique_index.drop();
+    index.drop();
+    table.drop();
+    return true;
+}
+
+
+/*
+ * ****************************
+ * BTree index tests
+ * ****************************
+ */
+
+/**
+ * Testing function for BTreeIndex.
+ * @return true if the tests all succeeded
+ */
+bool test_btree_index() {
+    ColumnNames column_names = {"a", "b", "c"};
+    ColumnAttributes column_attributes = {
+        ColumnAttribute(ColumnAttribute::INT),
+        ColumnAttribute(ColumnAttribute::TEXT),
+        ColumnAttribute(ColumnAttribute::BOOLEAN)
+    };
+    HeapTable table("_test_btree_index_cpp", column_names, column_attributes);
+    table.create();
+    BTreeIndex index(table, "fxb", ColumnNames({"b", "a"}), true);
+    index.create();
+
+    // urls with a long shared prefix, inserted out of order
+    const int N = 5000;
+    std::string prefix = "https://www.example.com/catalog/products/department/";
+    ValueDict row;
+    for (int i = 0; i < N; i++) {
+        int k = (i * 7919) % N;
+        test_set_row(row, k, prefix + std::to_string(k % 500));
+        index.insert(table.insert(&row));
+    }
+    if (index.get_height() > 3)
+        return assertion_failure("btree too tall for prefix-compressed keys", index.get_height());
+
+    // every key found
+    for (int k = 0; k < N; k += 37) {
+        ValueDict key = {{"a", Value(k)}, {"b", Value(prefix + std::to_string(k % 500))}};
+        Handles* handles = index.lookup(&key);
+        if (handles->size() != 1 || !test_compare(table, handles->front(), k, prefix + std::to_string(k % 500)))
+            return assertion_failure("btree lookup", k);
+        delete handles;
+    }
+
+    // range on the leading key column, in key order
+    ValueDict min_key = {{"b", Value(prefix + "10")}};
+    ValueDict max_key = {{"b", Value(prefix + "11")}};
+    Handles* handles = index.range(&min_key, &max_key);
+    if (handles->size() != 120)  // prefix + "10", "100".."109", and "11" each have 10 rows
+        return assertion_failure("btree range size", handles->size());
+    std::string last;
+    for (Handle& handle: *handles) {
+        ValueDict* result = table.project(handle);
+        if ((*result)["b"].s < last)
+            return assertion_failure("btree range order");
+        last = (*result)["b"].s;
+        delete result;
+    }
+    delete handles;
+
+    // unique enforcement and delete
+    ValueDict key = {{"a", Value(42)}, {"b", Value(prefix + "42")}};
+    handles = index.lookup(&key);
+    try {
+        index.insert(handles->front());
+        return assertion_failure("unique btree index accepted duplicate");
+    } catch (DbRelationError& e) {
+        // expected
+    }
+    index.del(handles->front());
+    delete handles;
+    handles = index.lookup(&key);
+    if (!handles->empty())
+        return assertion_failure("btree lookup after del", handles->size());
+    delete handles;
+
+    // survives close and reopen
+    index.close();
+    index.open();
+    key = {{"a", Value(43)}, {"b", Value(prefix + "43")}};
+    handles = index.lookup(&key);
+    if (handles->size() != 1)
+        return assertion_failure("btree lookup after reopen", handles->size());
+    delete handles;
+
+    index.drop();
+    table.drop();
+    return true;
+}
+
+
+/*
+ * ****************************
+ * Query plan tests
+ * ****************************
+ */
+
+/**
+ * Test helper. Runs a plan and collects its rows.
+ * @param plan     plan to run (freed here)
+ * @param rows     returned by reference: the plan's rows (freed by caller)
+ * @return         false if any batch was bigger than RowBatch::CAPACITY
+ */
+bool test_run_plan(PlanOperator* plan, ValueDicts& rows) {
+    bool ok = true;
+    RowBatch batch;
+    plan->open();
+    while (plan->next(batch)) {
+        if (batch.size() > RowBatch::CAPACITY)
+            ok = false;
+        batch.move_rows(rows);
+    }
+    plan->close();
+    delete plan;
+    return ok;
+}
+
+/**
+ * Test helper. Frees the rows collected by test_run_plan.
+ */
+void test_free_rows(ValueDicts& rows) {
+    for (ValueDict* row: rows)
+        delete row;
+    rows.clear();
+}
+
+/**
+ * Testing function for the query plan operators.
+ * @return true if the tests all succeeded
+ */
+bool test_query_plan() {
+    ColumnNames column_names = {"a", "b", "c"};
+    ColumnAttributes column_attributes = {
+        ColumnAttribute(ColumnAttribute::INT),
+        ColumnAttribute(ColumnAttribute::TEXT),
+        ColumnAttribute(ColumnAttribute::BOOLEAN)
+    };
+    HeapTable table("_test_query_plan_cpp", column_names, column_attributes);
+    table.create();
+    ValueDict row;
+    for (int i = 0; i < 1000; i++) {
+        test_set_row(row, i, "row " + std::to_string(i));
+        table.insert(&row);
+    }
+
+    // full scan, in batches
+    ValueDicts rows;
+    if (!test_run_plan(new TableScan(table, ColumnNames()), rows) || rows.size() != 1000)
+        return assertion_failure("table scan", rows.size());
+    if (rows[999]->at("a").n != 999 || rows[999]->size() != 3)
+        return assertion_failure("table scan row");
+    test_free_rows(rows);
+
+    // filter and project
+    Predicate predicate = {
+        Comparison("a", Comparison::GE, Value(100)),
+        Comparison("a", Comparison::LT, Value(200)),
+        Comparison("b", Comparison::NE, Value("row 150"))
+    };
+    PlanOperator* plan = new Project(new Filter(new TableScan(table, column_names), predicate), ColumnNames({"b"}));
+    if (!test_run_plan(plan, rows) || rows.size() != 99)
+        return assertion_failure("filter", rows.size());
+    if (rows[0]->size() != 1 || rows[0]->at("b").s != "row 100" || rows[50]->at("b").s != "row 151")
+        return assertion_failure("project");
+    test_free_rows(rows);
+
+    // pushed down equalities and ranges
+    ValueDict where = {{"c", Value(true)}};
+    where["c"].data_type = ColumnAttribute::BOOLEAN;
+    IntRanges ranges = {{"a", IntRange(10, 19)}};
+    if (!test_run_plan(new TableScan(table, column_names, where, ranges), rows) || rows.size() != 5)
+        return assertion_failure("table scan with where and ranges", rows.size());
+    test_free_rows(rows);
+
+    // limit and offset, across batches
+    plan = new Limit(new TableScan(table, column_names), 10, RowBatch::CAPACITY - 3);
+    if (!test_run_plan(plan, rows) || rows.size() != 10 || rows[0]->at("a").n != (int) RowBatch::CAPACITY - 3)
+        return assertion_failure("limit", rows.size());
+    test_free_rows(rows);
+    plan = new Limit(new TableScan(table, column_names), 10, 995);
+    if (!test_run_plan(plan, rows) || rows.size() != 5 || rows[4]->at("a").n != 999)
+        return assertion_failure("limit past the end", rows.size());
+    test_free_rows(rows);
+
+    // index lookup
+    HashIndex index(table, "fxa", ColumnNames({"a"}), true);
+    index.create();
+    plan = new IndexLookup(table, index, column_names, ValueDict({{"a", Value(777)}}));
+    if (!test_run_plan(plan, rows) || rows.size() != 1 || rows[0]->at("b").s != "row 777")
+        return assertion_failure("index lookup", rows.size());
+    test_free_rows(rows);
+
+    index.drop();
+    table.drop();
+    return true;
+}
+
+
+/**
+ * Test helper. A heap table that counts the blocks scanned.
+ */
+class CountingHeapTable : public HeapTable {
+public:
+    CountingHeapTable(Identifier table_name, ColumnNames column_names, ColumnAttributes column_attributes)
+        : HeapTable(table_name, column_names, column_attributes), blocks_scanned(0) {}
+
+    virtual void scan_block(BlockID block_id, const ValueDict* where, const IntRanges* ranges,
+                            const ColumnNames* column_names, Handles& handles, ValueDicts& rows) {
+        this->blocks_scanned++;
+        HeapTable::scan_block(block_id, where, ranges, column_names, handles, rows);
+    }
+
+    size_t blocks_scanned;
+};
+
+/**
+ * Testing function for pushing LIMITs down into the scans.
+ * @return true if the tests all succeeded
+ */
+bool test_limit_pushdown() {
+    ColumnNames column_names = {"a", "b", "c"};
+    ColumnAttributes column_attributes = {
+        ColumnAttribute(ColumnAttribute::INT),
+        ColumnAttribute(ColumnAttribute::TEXT),
+        ColumnAttribute(ColumnAttribute::BOOLEAN)
+    };
+    CountingHeapTable table("_test_limit_pushdown_cpp", column_names, column_attributes);
+    table.create();
+    ValueDict row;
+    for (int i = 0; i < 2000; i++) {
+        test_set_row(row, i, "row " + std::to_string(i));
+        table.insert(&row);
+    }
+    if (table.get_block_count() < 4)
+        return assertion_failure("limit pushdown table too small", table.get_block_count());
+
+    // a limited select reads only as many blocks as it needs, and carries on from there
+    BlockID next_block = 1;
+    Handles* handles = table.select(nullptr, nullptr, 10, next_block);
+    if (handles->size() < 10 || next_block != 2)
+        return assertion_failure("limited select", next_block);
+    size_t selected = handles->size();
+    delete handles;
+    while (next_block != 0) {
+        handles = table.select(nullptr, nullptr, 1, next_block);
+        selected += handles->size();
+        delete handles;
+    }
+    if (selected != 2000)
+        return assertion_failure("limited selects together", selected);
+
+    // a scan with a limit stops there
+    HandleScan* scan = new TableScan(table, column_names);
+    scan->set_limit(10);
+    if (scan->explain() != "TableScan _test_limit_pushdown_cpp LIMIT 10\n")
+        return assertion_failure("limited scan explained");
+    ValueDicts rows;
+    if (!test_run_plan(scan, rows) || rows.size() != 10 || rows[9]->at("a").n != 9)
+        return assertion_failure("limited scan", rows.size());
+    test_free_rows(rows);
+
+    // and can be run again
+    scan = new TableScan(table, column_names, ValueDict(), IntRanges({{"a", IntRange(1500, 1999)}}));
+    scan->set_limit(RowBatch::CAPACITY + 1);
+    RowBatch batch;
+    scan->open();
+    scan->next(batch);
+    scan->open();
+    while (scan->next(batch))
+        batch.move_rows(rows);
+    scan->close();
+    delete scan;
+    if (rows.size() != RowBatch::CAPACITY + 1 || rows[0]->at("a").n != 1500)
+        return assertion_failure("limited scan reopened", rows.size());
+    test_free_rows(rows);
+
+    // a filter with a limit stops there, and the scan under it at the end of the block it got to
+    TableScan* table_scan = new TableScan(table, column_names);
+    table_scan->set_block_batches(true);
+    Filter* filter = new Filter(table_scan, Predicate({Comparison("a", Comparison::GE, Value(5))}));
+    filter->set_limit(10);
+    PlanOperator* plan = new Limit(filter, 10);
+    if (plan->explain() != "Limit 10\n  Filter a >= 5 LIMIT 10\n    TableScan _test_limit_pushdown_cpp\n")
+        return assertion_failure("limited filter explained");
+    table.blocks_scanned = 0;
+    if (!test_run_plan(plan, rows) || rows.size() != 10 || rows[9]->at("a").n != 14)
+        return assertion_failure("limited filter", rows.size());
+    test_free_rows(rows);
+    if (table.blocks_scanned != 1)
+        return assertion_failure("blocks read for a limited filter", table.blocks_scanned);
+
+    // index ranges and lookups stop at the limit too
+    BTreeIndex btree_index(table, "bx", ColumnNames({"a"}), true);
+    btree_index.create();
+    ValueDict min_key = {{"a", Value(100)}};
+    handles = btree_index.range(&min_key, nullptr, 3);
+    if (handles->size() != 3 || !test_compare(table, handles->back(), 102, "row 102"))
+        return assertion_failure("limited btree range", handles->size());
+    delete handles;
+    scan = new IndexRange(table, btree_index, column_names, min_key, ValueDict());
+    scan->set_limit(5);
+    if (!test_run_plan(scan, rows) || rows.size() != 5 || rows[4]->at("a").n != 104)
+        return assertion_failure("limited index range", rows.size());
+    test_free_rows(rows);
+    HashIndex hash_index(table, "hx", ColumnNames({"c"}), false);
+    hash_index.create();
+    ValueDict key = {{"c", Value(true)}};
+    key["c"].data_type = ColumnAttribute::BOOLEAN;
+    scan = new IndexLookup(table, hash_index, column_names, key);
+    scan->set_limit(7);
+    if (!test_run_plan(scan, rows) || rows.size() != 7)
+        return assertion_failure("limited index lookup", rows.size());
+    test_free_rows(rows);
+
+    hash_index.drop();
+    btree_index.drop();
+    table.drop();
+    return true;
+}
+
+
+/**
+ * Testing function for the optimizer's choice of access paths.
+ * @return true if the tests all succeeded
+ */
+bool test_optimizer() {
+    ColumnNames column_names = {"a", "b", "c"};
+    ColumnAttributes column_attributes = {
+        ColumnAttribute(ColumnAttribute::INT),
+        ColumnAttribute(ColumnAttribute::TEXT),
+        ColumnAttribute(ColumnAttribute::BOOLEAN)
+    };
+    HeapTable table("_test_optimizer_cpp", column_names, column_attributes);
+    table.create();
+    ValueDict row;
+    for (int i = 0; i < 2000; i++) {
+        test_set_row(row, i, "row " + std::to_string(i));
+        table.insert(&row);
+    }
+    HashIndex hash_index(table, "hx", ColumnNames({"a"}), true);
+    hash_index.create();
+    BTreeIndex btree_index(table, "bx", ColumnNames({"b", "a"}), false);
+    btree_index.create();
+    IndexInfos indices = {
+        IndexInfo(hash_index, ColumnNames({"a"}), true, true),
+        IndexInfo(btree_index, ColumnNames({"b", "a"}), false, false)
+    };
+    TableStatistics statistics(table);
+    if (statistics.get_block_count() != table.get_block_count() || statistics.get_row_count() <= 0)
+        return assertion_failure("table statistics");
+
+    // the unique hash index for an equality on its key, with the rest left to a filter
+    Predicate predicate = {
+        Comparison("b", Comparison::NE, Value("row 4")),
+        Comparison("a", Comparison::EQ, Value(5))
+    };
+    HandleScan* scan = Optimizer::access_path(table, indices, statistics, column_names, predicate);
+    if (dynamic_cast<IndexLookup*>(scan) == nullptr || predicate.size() != 1 || predicate[0].column_name != "b")
+        return assertion_failure("hash index lookup chosen");
+    if (scan->explain().find("IndexLookup _test_optimizer_cpp.hx WHERE a = 5  (cost=") != 0)
+        return assertion_failure("hash index lookup explained");
+    ValueDicts rows;
+    if (!test_run_plan(new Filter(scan, predicate), rows) || rows.size() != 1 || rows[0]->at("b").s != "row 5")
+        return assertion_failure("hash index lookup rows", rows.size());
+    test_free_rows(rows);
+
+    // the btree index for an equality on its leading column and a range on the next
+    predicate = {
+        Comparison("a", Comparison::GE, Value(100)),
+        Comparison("b", Comparison::EQ, Value("row 150")),
+        Comparison("a", Comparison::LE, Value(199))
+    };
+    scan = Optimizer::access_path(table, indices, statistics, column_names, predicate);
+    if (dynamic_cast<IndexRange*>(scan) == nullptr || !predicate.empty())
+        return assertion_failure("btree index range chosen");
+    if (!test_run_plan(scan, rows) || rows.size() != 1 || rows[0]->at("a").n != 150)
+        return assertion_failure("btree index range rows", rows.size());
+    test_free_rows(rows);
+
+    // a scan when no index helps
+    predicate = {Comparison("a", Comparison::NE, Value(7))};
+    scan = Optimizer::access_path(table, indices, statistics, column_names, predicate);
+    if (dynamic_cast<TableScan*>(scan) == nullptr || predicate.size() != 1)
+        return assertion_failure("table scan chosen");
+    if (!test_run_plan(new Filter(scan, predicate), rows) || rows.size() != 1999)
+        return assertion_failure("table scan rows", rows.size());
+    test_free_rows(rows);
+
+    btree_index.drop();
+    hash_index.drop();
+    table.drop();
+    return true;
+}
+
+
+/**
+ * Testing function for ANALYZE's statistics and the optimizer's use of them.
+ * @return true if the tests all succeeded
+ */
+bool test_statistics() {
+    ColumnNames column_names = {"a", "b", "c"};
+    ColumnAttributes column_attributes = {
+        ColumnAttribute(ColumnAttribute::INT),
+        ColumnAttribute(ColumnAttribute::TEXT),
+        ColumnAttribute(ColumnAttribute::BOOLEAN)
+    };
+    HeapTable table("_test_statistics_cpp", column_names, column_attributes);
+    table.create();
+    ValueDict row;
+    for (int i = 0; i < 2000; i++) {
+        test_set_row(row, i, "row " + std::to_string(i));
+        table.insert(&row);
+    }
+    Statistics catalog;
+    catalog.open();
+
+    // reading every block gives exact counts
+    double row_count = catalog.analyze(table, table.get_block_count());
+    double block_count;
+    ColumnStatisticsMap columns;
+    if (row_count != 2000 || !catalog.get_statistics(table.get_table_name(), row_count, block_count, columns))
+        return assertion_failure("analyze all blocks", row_count);
+    if (row_count != 2000 || block_count != table.get_block_count() || columns.size() != 3)
+        return assertion_failure("collected table statistics", row_count);
+    if (columns["a"].distinct_count != 2000 || columns["c"].distinct_count != 2 || columns["b"].null_fraction != 0)
+        return assertion_failure("collected distinct counts", columns["a"].distinct_count);
+    std::vector<int32_t>& histogram = columns["a"].histogram;
+    if (histogram.size() != Statistics::HISTOGRAM_BUCKETS + 1 || histogram.front() != 0 || histogram.back() != 1999
+        || histogram[5] < 900 || histogram[5] > 1100 || !columns["b"].histogram.empty())
+        return assertion_failure("collected histogram", histogram.size());
+
+    // a sample of the blocks gives estimates (and replaces the earlier statistics)
+    if (std::abs(catalog.analyze(table, 4) - 2000) > 300)
+        return assertion_failure("analyze sampled blocks");
+    columns.clear();
+    catalog.get_statistics(table.get_table_name(), row_count, block_count, columns);
+    if (columns.size() != 3 || columns["a"].distinct_count < 1000 || columns["c"].distinct_count != 2)
+        return assertion_failure("sampled distinct counts", columns["a"].distinct_count);
+
+    // with exact statistics, the optimizer sees that a narrow range is worth an index
+    catalog.analyze(table, table.get_block_count());
+    columns.clear();
+    catalog.get_statistics(table.get_table_name(), row_count, block_count, columns);
+    BTreeIndex index(table, "bx", ColumnNames({"a"}), false);
+    index.create();
+    IndexInfos indices = {IndexInfo(index, ColumnNames({"a"}), false, false)};
+    Predicate predicate = {
+        Comparison("a", Comparison::GE, Value(100)),
+        Comparison("a", Comparison::LE, Value(103))
+    };
+    TableStatistics statistics(table);
+    HandleScan* scan = Optimizer::access_path(table, indices, statistics, column_names, predicate);
+    if (dynamic_cast<TableScan*>(scan) == nullptr)
+        return assertion_failure("table scan chosen on guesses");
+    delete scan;
+    predicate = {
+        Comparison("a", Comparison::GE, Value(100)),
+        Comparison("a", Comparison::LE, Value(103))
+    };
+    statistics.use_collected(row_count, block_count, columns);
+    double selectivity = statistics.selectivity(predicate);
+    if (selectivity < 0.001 || selectivity > 0.004)
+        return assertion_failure("histogram selectivity", selectivity);
+    if (statistics.selectivity(Comparison("c", Comparison::EQ, Value(true))) != 0.5)
+        return assertion_failure("distinct count selectivity");
+    scan = Optimizer::access_path(table, indices, statistics, column_names, predicate);
+    ValueDicts rows;
+    if (dynamic_cast<IndexRange*>(scan) == nullptr || !test_run_plan(scan, rows) || rows.size() != 4)
+        return assertion_failure("btree index range chosen on statistics", rows.size());
+    test_free_rows(rows);
+
+    catalog.forget(table.get_table_name());
+    columns.clear();
+    if (catalog.get_statistics(table.get_table_name(), row_count, block_count, columns))
+        return assertion_failure("forget statistics");
+    index.drop();
+    table.drop();
+    return true;
+}
+
+
+/**
+ * Testing function for the hash join, both in memory and spilling to disk.
+ * @return true if the tests all succeeded
+ */
+bool test_hash_join() {
+    ColumnNames column_names = {"a", "b", "c"};
+    ColumnAttributes column_attributes = {
+        ColumnAttribute(ColumnAttribute::INT),
+        ColumnAttribute(ColumnAttribute::TEXT),
+        ColumnAttribute(ColumnAttribute::BOOLEAN)
+    };
+    HeapTable left("_test_hash_join_left_cpp", column_names, column_attributes);
+    left.create();
+    HeapTable right("_test_hash_join_right_cpp", column_names, column_attributes);
+    right.create();
+    ValueDict row;
+    for (int i = 0; i < 1000; i++) {
+        test_set_row(row, i, "left " + std::to_string(i));
+        left.insert(&row);
+    }
+    for (int i = 0; i < 600; i++) {
+        test_set_row(row, i % 300 * 2, "right " + std::to_string(i));  // each even a < 600 twice
+        right.insert(&row);
+    }
+
+    for (size_t memory_rows: {HashJoin::MEMORY_ROWS, (size_t) 50}) {
+        HashJoin join(new Project(new TableScan(right, column_names), column_names, ColumnNames({"r.a", "r.b", "r.c"})),
+                      new Project(new TableScan(left, column_names), column_names, ColumnNames({"l.a", "l.b", "l.c"})),
+                      ColumnNames({"r.a", "r.c"}), ColumnNames({"l.a", "l.c"}), memory_rows);
+        if (join.explain().find("HashJoin r.a = l.a AND r.c = l.c\n  Project a AS r.a") != 0)
+            return assertion_failure("hash join explained");
+        ValueDicts rows;
+        RowBatch batch;
+        join.open();
+        while (join.next(batch))
+            batch.move_rows(rows);
+        bool spilled = join.spilled();
+        join.close();
+        if (spilled != (memory_rows == 50))
+            return assertion_failure("hash join spilled", memory_rows);
+        if (rows.size() != 600)
+            return assertion_failure("hash join rows", rows.size());
+        std::vector<int> matches(1000, 0);
+        for (ValueDict* joined: rows) {
+            if (joined->size() != 6 || joined->at("l.a").n != joined->at("r.a").n
+                || joined->at("l.b").s != "left " + std::to_string(joined->at("l.a").n))
+                return assertion_failure("hash join row", memory_rows);
+            matches[joined->at("l.a").n]++;
+        }
+        for (int i = 0; i < 1000; i++)
+            if (matches[i] != (i < 600 && i % 2 == 0 ? 2 : 0))
+                return assertion_failure("hash join matches", i);
+        test_free_rows(rows);
+    }
+
+    right.drop();
+    left.drop();
+    return true;
+}
+
+
+/**
+ * Test helper. Checks that rows are in order on column a (and, among equal a's, in insertion order).
+ * @param rows        rows to check
+ * @param descending  true if the rows should be in descending order
+ * @return            true if they are
+ */
+bool test_sorted(const ValueDicts& rows, bool descending) {
+    for (size_t i = 1; i < rows.size(); i++) {
+        int32_t a = rows[i - 1]->at("a").n, b = rows[i]->at("a").n;
+        if (descending ? a < b : a > b)
+            return false;
+        if (a == b && std::stoi(rows[i - 1]->at("b").s) > std::stoi(rows[i]->at("b").s))
+            return false;
+    }
+    return true;
+}
+
+/**
+ * Testing function for the sort, in memory, spilling to disk, and picking the top rows.
+ * @return true if the tests all succeeded
+ */
+bool test_sort() {
+    ColumnNames column_names = {"a", "b", "c"};
+    ColumnAttributes column_attributes = {
+        ColumnAttribute(ColumnAttribute::INT),
+        ColumnAttribute(ColumnAttribute::TEXT),
+        ColumnAttribute(ColumnAttribute::BOOLEAN)
+    };
+    HeapTable table("_test_sort_cpp", column_names, column_attributes);
+    table.create();
+    ValueDict row;
+    for (int i = 0; i < 1000; i++) {
+        test_set_row(row, i * 7 % 500, std::to_string(i));  // each a < 500 twice, in scrambled order
+        table.insert(&row);
+    }
+
+    // in memory and then in runs of 64 rows merged back together
+    for (size_t memory_rows: {Sort::MEMORY_ROWS, (size_t) 64}) {
+        Sort* sort = new Sort(new TableScan(table, column_names), SortKeys({SortKey("a")}), SIZE_MAX, memory_rows);
+        RowBatch batch;
+        ValueDicts rows;
+        sort->open();
+        size_t run_count = sort->get_run_count();
+        while (sort->next(batch))
+            batch.move_rows(rows);
+        sort->close();
+        delete sort;
+        if (run_count != (memory_rows == 64 ? 16 : 0))
+            return assertion_failure("sort runs", run_count);
+        if (rows.size() != 1000 || !test_sorted(rows, false) || rows[0]->at("a").n != 0 || rows[999]->at("a").n != 499)
+            return assertion_failure("sorted rows", memory_rows);
+        test_free_rows(rows);
+    }
+
+    // descending, and on more than one column
+    ValueDicts rows;
+    if (!test_run_plan(new Sort(new TableScan(table, column_names), SortKeys({SortKey("a", true)}), SIZE_MAX, 100),
+                       rows) || rows.size() != 1000 || !test_sorted(rows, true))
+        return assertion_failure("sorted descending");
+    test_free_rows(rows);
+    SortKeys keys = {SortKey("c", true), SortKey("a")};
+    if (!test_run_plan(new Sort(new TableScan(table, column_names), keys, SIZE_MAX, 100), rows) || rows.size() != 1000
+        || rows[0]->at("a").n != 0 || rows[499]->at("a").n != 498 || rows[500]->at("a").n != 1
+        || !test_sorted(ValueDicts(rows.begin(), rows.begin() + 500), false))
+        return assertion_failure("sorted on two columns");
+    test_free_rows(rows);
+
+    // just the top rows
+    Sort* top = new Sort(new TableScan(table, column_names), SortKeys({SortKey("a", true)}), 5, 64);
+    if (top->explain().find("Sort a DESC (top 5)\n  TableScan _test_sort_cpp") != 0)
+        return assertion_failure("sort explained");
+    if (!test_run_plan(top, rows) || rows.size() != 5 || !test_sorted(rows, true) || rows[0]->at("a").n != 499
+        || rows[4]->at("a").n != 497 || rows[0]->at("b").s != "357")
+        return assertion_failure("top rows", rows.size());
+    test_free_rows(rows);
+
+    table.drop();
+    return true;
+}
+
+
+/**
+ * Testing function for the hash aggregate, grouped (in memory and spilling to disk) and not.
+ * @return true if the tests all succeeded
+ */
+bool test_hash_aggregate() {
+    ColumnNames column_names = {"a", "b", "c"};
+    ColumnAttributes column_attributes = {
+        ColumnAttribute(ColumnAttribute::INT),
+        ColumnAttribute(ColumnAttribute::TEXT),
+        ColumnAttribute(ColumnAttribute::BOOLEAN)
+    };
+    HeapTable table("_test_hash_aggregate_cpp", column_names, column_attributes);
+    table.create();
+    ValueDict row;
+    for (int i = 0; i < 1000; i++) {
+        test_set_row(row, i % 300, std::to_string(i));  // a < 100 four times, the rest three times
+        table.insert(&row);
+    }
+    Aggregates aggregates = {
+        Aggregate(Aggregate::COUNT, "", "COUNT(*)"),
+        Aggregate(Aggregate::SUM, "a", "SUM(a)"),
+        Aggregate(Aggregate::MIN, "a", "MIN(a)"),
+        Aggregate(Aggregate::MAX, "a", "MAX(a)"),
+        Aggregate(Aggregate::AVG, "a", "AVG(a)")
+    };
+
+    // grouped in memory, and with only 40 groups held in memory at once
+    for (size_t memory_groups: {HashAggregate::MEMORY_GROUPS, (size_t) 40}) {
+        HashAggregate aggregate(new TableScan(table, column_names), ColumnNames({"a"}), aggregates, 300, memory_groups);
+        if (aggregate.explain().find("HashAggregate COUNT(*), SUM(a), MIN(a), MAX(a), AVG(a) GROUP BY a\n  TableScan")
+            != 0)
+            return assertion_failure("hash aggregate explained");
+        ValueDicts rows;
+        RowBatch batch;
+        aggregate.open();
+        while (aggregate.next(batch))
+            batch.move_rows(rows);
+        bool spilled = aggregate.spilled();
+        aggregate.close();
+        if (spilled != (memory_groups == 40))
+            return assertion_failure("hash aggregate spilled", memory_groups);
+        if (rows.size() != 300)
+            return assertion_failure("hash aggregate groups", rows.size());
+        std::vector<bool> seen(300, false);
+        for (ValueDict* group: rows) {
+            int32_t a = group->at("a").n;
+            int32_t count = a < 100 ? 4 : 3;
+            if (group->size() != 6 || seen[a] || group->at("COUNT(*)").n != count
+                || group->at("SUM(a)").n != a * count || group->at("MIN(a)").n != a || group->at("MAX(a)").n != a
+                || group->at("AVG(a)").n != a)
+                return assertion_failure("hash aggregate group", a);
+            seen[a] = true;
+        }
+        test_free_rows(rows);
+    }
+
+    // grouped on a BOOLEAN
+    ValueDicts rows;
+    Aggregates counts = {Aggregate(Aggregate::COUNT, "", "COUNT(*)"),
+                         Aggregate(Aggregate::MAX, "c", "MAX(c)", ColumnAttribute::BOOLEAN)};
+    if (!test_run_plan(new HashAggregate(new TableScan(table, column_names), ColumnNames({"c"}), counts), rows)
+        || rows.size() != 2 || rows[0]->at("COUNT(*)").n != 500 || rows[1]->at("COUNT(*)").n != 500
+        || rows[0]->at("MAX(c)").data_type != ColumnAttribute::BOOLEAN
+        || rows[0]->at("MAX(c)").n != rows[0]->at("c").n)
+        return assertion_failure("hash aggregate on a boolean");
+    test_free_rows(rows);
+
+    // not grouped, over all the rows and over none of them
+    if (!test_run_plan(new HashAggregate(new TableScan(table, column_names), ColumnNames(), aggregates), rows)
+        || rows.size() != 1 || rows[0]->size() != 5 || rows[0]->at("COUNT(*)").n != 1000
+        || rows[0]->at("SUM(a)").n != 139500 || rows[0]->at("MIN(a)").n != 0 || rows[0]->at("MAX(a)").n != 299
+        || rows[0]->at("AVG(a)").n != 139)
+        return assertion_failure("aggregate of all rows");
+    test_free_rows(rows);
+    ValueDict none = {{"a", Value(-1)}};
+    if (!test_run_plan(new HashAggregate(new TableScan(table, column_names, none), ColumnNames(), aggregates), rows)
+        || rows.size() != 1 || rows[0]->at("COUNT(*)").n != 0 || rows[0]->at("AVG(a)").n != 0)
+        return assertion_failure("aggregate of no rows");
+    test_free_rows(rows);
+
+    table.drop();
+    return true;
+}
+
+
+/**
+ * Testing function for the parallel scan operators: gathering rows from, and aggregating in, worker threads.
+ * @return true if the tests all succeeded
+ */
+bool test_parallel_scan() {
+    ColumnNames column_names = {"a", "b", "c"};
+    ColumnAttributes column_attributes = {
+        ColumnAttribute(ColumnAttribute::INT),
+        ColumnAttribute(ColumnAttribute::TEXT),
+        ColumnAttribute(ColumnAttribute::BOOLEAN)
+    };
+    HeapTable table("_test_parallel_scan_cpp", column_names, column_attributes);
+    table.create();
+    ValueDicts inserts;
+    for (int i = 0; i < 3000; i++) {
+        inserts.push_back(new ValueDict());
+        test_set_row(*inserts.back(), i, "parallel " + std::to_string(i));
+    }
+    delete table.insert(&inserts);
+    test_free_rows(inserts);
+    if (table.get_block_count() < 8)
+        return assertion_failure("parallel scan table too small", table.get_block_count());
+
+    // four workers taking two blocks at a time, with a pushed-down range and a filter in each
+    TableScan scan(table, ColumnNames({"a", "b"}), ValueDict(), IntRanges({{"a", IntRange(100, 2499)}}));
+    Predicate predicate = {Comparison("b", Comparison::NE, Value("parallel 200"))};
+    MorselQueue* morsels = new MorselQueue(table, 2);
+    std::vector<PlanOperator*> workers;
+    for (int i = 0; i < 4; i++)
+        workers.push_back(new Filter(new MorselScan(scan, morsels), predicate));
+    Gather* gather = new Gather(workers, morsels);
+    if (gather->explain().find("Gather (4 workers)\n  Filter b <> \"parallel 200\"\n    MorselScan "
+                               "_test_parallel_scan_cpp WHERE a BETWEEN 100 AND 2499 (2-block morsels)") != 0)
+        return assertion_failure("gather explained");
+    ValueDicts rows;
+    if (!test_run_plan(gather, rows) || rows.size() != 2399)
+        return assertion_failure("gathered rows", rows.size());
+    std::vector<bool> seen(3000, false);
+    for (ValueDict* row: rows) {
+        int32_t a = row->at("a").n;
+        if (row->size() != 2 || a < 100 || a > 2499 || a == 200 || seen[a]
+            || row->at("b").s != "parallel " + std::to_string(a))
+            return assertion_failure("gathered row", a);
+        seen[a] = true;
+    }
+    test_free_rows(rows);
+
+    // stopping the workers early
+    morsels = new MorselQueue(table, 1);
+    workers.clear();
+    for (int i = 0; i < 4; i++)
+        workers.push_back(new MorselScan(TableScan(table, column_names), morsels));
+    if (!test_run_plan(new Limit(new Gather(workers, morsels), 10), rows) || rows.size() != 10)
+        return assertion_failure("gather stopped early", rows.size());
+    test_free_rows(rows);
+
+    // each worker aggregating its share, then merged
+    Aggregates aggregates = {Aggregate(Aggregate::COUNT, "", "COUNT(*)"), Aggregate(Aggregate::SUM, "a", "SUM(a)"),
+                             Aggregate(Aggregate::MIN, "a", "MIN(a)"), Aggregate(Aggregate::MAX, "a", "MAX(a)")};
+    for (const ColumnNames& group_columns: {ColumnNames({"c"}), ColumnNames()}) {
+        morsels = new MorselQueue(table, 2);
+        std::vector<HashAggregate*> aggregators;
+        for (int i = 0; i < 4; i++)
+            aggregators.push_back(new HashAggregate(new MorselScan(TableScan(table, column_names), morsels),
+                                                    group_columns, aggregates, 2, SIZE_MAX));
+        if (!test_run_plan(new ParallelAggregate(aggregators, morsels), rows)
+            || rows.size() != (group_columns.empty() ? 1 : 2))
+            return assertion_failure("parallel aggregate groups", rows.size());
+        for (ValueDict* row: rows) {
+            bool even = group_columns.empty() || row->at("c").n;
+            int32_t odd = group_columns.empty() || !even ? 1 : 0;
+            int32_t count = group_columns.empty() ? 3000 : 1500;
+            int32_t sum = group_columns.empty() ? 4498500 : (even ? 2248500 : 2250000);
+            if (row->at("COUNT(*)").n != count || row->at("SUM(a)").n != sum
+                || row->at("MIN(a)").n != (group_columns.empty() ? 0 : odd) || row->at("MAX(a)").n != 2998 + odd)
+                return assertion_failure("parallel aggregate", count);
+        }
+        test_free_rows(rows);
+    }
+
+    table.drop();
+    return true;
+}
+
+
+/**
+ * Testing function for the predicate kernels, checked against Comparison::matches.
+ * @return true if the tests all succeeded
+ */
+bool test_kernels() {
+    RowBatch batch;
+    for (int i = 0; i < 200; i++) {
+        ValueDict* row = new ValueDict();
+        test_set_row(*row, i % 50 - 25, "k" + std::to_string(i % 13));
+        (*row)["d"] = Value(i % 7 - 3);
+        (*row)["e"] = Value("k" + std::to_string(i % 5));
+        batch.add(Handle(1, i), row);
+    }
+    Value yes(1);
+    yes.data_type = ColumnAttribute::BOOLEAN;
+    std::vector<Predicate> predicates;
+    for (Comparison::Op op: {Comparison::EQ, Comparison::NE, Comparison::LT, Comparison::LE, Comparison::GT,
+                             Comparison::GE}) {
+        predicates.push_back(Predicate({Comparison("a", op, Value(3))}));
+        predicates.push_back(Predicate({Comparison("b", op, Value("k5"))}));
+        predicates.push_back(Predicate({Comparison("c", op, yes)}));
+        predicates.push_back(Predicate({Comparison("a", op, "d")}));
+        predicates.push_back(Predicate({Comparison("b", op, "e", ColumnAttribute::TEXT)}));
+    }
+    predicates.push_back(Predicate({Comparison("a", Comparison::GT, Value(-10)), Comparison("a", Comparison::LE, Value(7)),
+                                    Comparison("d", Comparison::NE, Value(0))}));
+    predicates.push_back(Predicate({Comparison("a", Comparison::GE, Value(4)), Comparison("a", Comparison::LE, Value(4))}));
+    predicates.push_back(Predicate({Comparison("a", Comparison::LT, Value(INT32_MIN))}));
+    predicates.push_back(Predicate({Comparison("a", Comparison::GT, Value(5)), Comparison("a", Comparison::LT, Value(-5))}));
+
+    for (size_t p = 0; p < predicates.size(); p++) {
+        std::vector<Kernel*> kernels = Kernel::compile(predicates[p]);
+        std::vector<uint8_t> selected(batch.size(), 1);
+        for (Kernel* kernel: kernels)
+            kernel->apply(batch, selected);
+        for (Kernel* kernel: kernels)
+            delete kernel;
+        for (size_t i = 0; i < batch.size(); i++) {
+            bool matches = true;
+            for (const Comparison& comparison: predicates[p])
+                matches = matches && comparison.matches(batch.get_row(i));
+            if (matches != (selected[i] == 1))
+                return assertion_failure("kernel for predicate " + std::to_string(p), i);
+        }
+    }
+
+    // a range folded into one kernel, and an equality it pins down
+    std::vector<Kernel*> kernels = Kernel::compile(predicates[predicates.size() - 4]);
+    bool folded = kernels.size() == 2 && dynamic_cast<RangeKernel<ColumnAttribute::INT>*>(kernels[1]) != nullptr;
+    for (Kernel* kernel: kernels)
+        delete kernel;
+    kernels = Kernel::compile(predicates[predicates.size() - 3]);
+    folded = folded && kernels.size() == 1 && dynamic_cast<EqKernel<ColumnAttribute::INT>*>(kernels[0]) != nullptr;
+    for (Kernel* kernel: kernels)
+        delete kernel;
+    if (!folded)
+        return assertion_failure("kernels folded");
+    return true;
+}
+
+
+/**
+ * Test helper that deletes the rows of a schema table for one table.
+ */
+void test_delete_schema_rows(DbRelation& schema_table, Identifier table_name) {
+    ValueDict where = {{"table_name", Value(table_name)}};
+    Handles* handles = schema_table.select(&where);
+    schema_table.del(handles);
+    delete handles;
+}
+
+/**
+ * Testing function for the in-memory catalog: write-through on inserts and
+ * deletes of the schema tables, and the same answers after reloading from disk.
+ * @return true if the tests all succeeded
+ */
+bool test_catalog() {
+    const Identifier table_name = "_test_catalog_cpp";
+    Tables tables;
+    Columns columns;
+    Indices indices;
+    ValueDict row = {{"table_name", Value(table_name)}};
+    tables.insert(&row);
+    const char* column_types[][2] = {{"a", "INT"}, {"b", "TEXT"}, {"c", "BOOLEAN"}};
+    for (auto const& column_type: column_types) {
+        row["column_name"] = Value(column_type[0]);
+        row["data_type"] = Value(column_type[1]);
+        columns.insert(&row);
+    }
+    row = {{"table_name", Value(table_name)}, {"index_name", Value("ix")}, {"column_name", Value("a")},
+           {"seq_in_index", Value(1)}, {"index_type", Value("BTREE")}, {"is_unique", Value(1)}};
+    indices.insert(&row);
+    row["column_name"] = Value("c");
+    row["seq_in_index"] = Value(2);
+    indices.insert(&row);
+    row = {{"table_name", Value(table_name)}, {"index_name", Value("hx")}, {"column_name", Value("b")},
+           {"seq_in_index", Value(1)}, {"index_type", Value("HASH")}, {"is_unique", Value(0)}};
+    indices.insert(&row);
+
+    for (int reload = 0; reload < 2; reload++) {
+        if (reload == 1)
+            Catalog::load(tables, columns, indices);
+        ColumnNames column_names;
+        ColumnAttributes column_attributes;
+        Tables::get_columns(table_name, column_names, column_attributes);
+        if (column_names != ColumnNames({"a", "b", "c"}) || column_attributes.size() != 3
+            || column_attributes[2].get_data_type() != ColumnAttribute::BOOLEAN)
+            return assertion_failure("catalog columns", column_names.size(), reload);
+        const Catalog::TableEntry* table = Catalog::get_table(table_name);
+        if (table == nullptr || table->ordinal("c") != 2 || table->ordinal("z") != -1)
+            return assertion_failure("catalog ordinals", reload);
+        if (indices.get_index_names(table_name) != IndexNames({"ix", "hx"}))
+            return assertion_failure("catalog index names", reload);
+        column_names.clear();
+        bool is_hash = true, is_unique = false;
+        indices.get_columns(table_name, "ix", column_names, is_hash, is_unique);
+        if (column_names != ColumnNames({"a", "c"}) || is_hash || !is_unique)
+            return assertion_failure("catalog index key", column_names.size(), reload);
+    }
+
+    // deletes are written through too
+    ValueDict where = {{"table_name", Value(table_name)}, {"index_name", Value("ix")}};
+    Handles* handles = indices.select(&where);
+    indices.del(handles);
+    delete handles;
+    where = {{"table_name", Value(table_name)}, {"column_name", Value("b")}};
+    handles = columns.select(&where);
+    columns.del(handles);
+    delete handles;
+    const Catalog::TableEntry* table = Catalog::get_table(table_name);
+    if (indices.get_index_names(table_name) != IndexNames({"hx"}) || Catalog::get_index(table_name, "ix") != nullptr)
+        return assertion_failure("catalog drop index");
+    if (table->column_names != ColumnNames({"a", "c"}) || table->ordinal("c") != 1)
+        return assertion_failure("catalog drop column");
+
+    test_delete_schema_rows(indices, table_name);
+    test_delete_schema_rows(columns, table_name);
+    test_delete_schema_rows(tables, table_name);
+    ColumnNames column_names;
+    ColumnAttributes column_attributes;
+    Tables::get_columns(table_name, column_names, column_attributes);
+    if (Catalog::get_table(table_name) != nullptr || !column_names.empty())
+        return assertion_failure("catalog drop table");
+    Catalog::load(tables, columns, indices);
+    if (Catalog::get_table(table_name) != nullptr || Catalog::get_table(Columns::TABLE_NAME) == nullptr)
+        return assertion_failure("catalog reload after drop");
+
+    // a catalog made before there were statistics gets the statistics table's rows (just once)
+    test_delete_schema_rows(columns, Statistics::TABLE_NAME);
+    test_delete_schema_rows(tables, Statistics::TABLE_NAME);
+    if (Catalog::get_table(Statistics::TABLE_NAME) != nullptr)
+        return assertion_failure("catalog without statistics");
+    Statistics::register_schema(tables, columns);
+    Statistics::register_schema(tables, columns);
+    Catalog::load(tables, columns, indices);
+    Tables::get_columns(Statistics::TABLE_NAME, column_names, column_attributes);
+    if (column_names.size() != 7 || column_names[6] != "histogram"
+        || column_attributes[2].get_data_type() != ColumnAttribute::INT)
+        return assertion_failure("catalog statistics registered", column_names.size());
+    return true;
+}
+/**
+ * Testing function for BLOOM indices: the table keeps filters on the columns
+ * of all its BLOOM indices, and has them again when it is reopened.
+ * @return true if the tests all succeeded
+ */
+bool test_bloom_index() {
+    const Identifier table_name = "_test_bloom_index_cpp";
+    Tables tables;
+    Columns columns;
+    Indices indices;
+    ValueDict row = {{"table_name", Value(table_name)}};
+    tables.insert(&row);
+    const char* column_types[][2] = {{"a", "INT"}, {"b", "TEXT"}, {"c", "BOOLEAN"}};
+    for (auto const& column_type: column_types) {
+        row["column_name"] = Value(column_type[0]);
+        row["data_type"] = Value(column_type[1]);
+        columns.insert(&row);
+    }
+    HeapTable& table = dynamic_cast<HeapTable&>(Tables::get_table(table_name));
+    table.create();
+    ValueDict values;
+    for (int i = 0; i < 500; i++) {
+        test_set_row(values, i, "bloom " + std::to_string(i));
+        table.insert(&values);
+    }
+
+    // each index adds its columns to the filters
+    const char* bloom_indices[][2] = {{"fa", "a"}, {"fb", "b"}, {"fab", "b"}};
+    for (auto const& bloom_index: bloom_indices) {
+        row = {{"table_name", Value(table_name)}, {"index_name", Value(bloom_index[0])},
+               {"column_name", Value(bloom_index[1])}, {"seq_in_index", Value(1)},
+               {"index_type", Value(BloomIndex::INDEX_TYPE)}, {"is_unique", Value(0)}};
+        indices.insert(&row);
+        if (std::string(bloom_index[0]) == "fab") {
+            row["column_name"] = Value("a");
+            row["seq_in_index"] = Value(2);
+            indices.insert(&row);
+        }
+        indices.get_index(table_name, bloom_index[0]).create();
+    }
+    if (table.get_bloom_filter_columns() != ColumnNames({"a", "b"}))
+        return assertion_failure("bloom index columns", table.get_bloom_filter_columns().size());
+    ValueDict where = {{"b", Value("bloom 7")}};
+    Handles* handles = table.select(&where);
+    if (handles->size() != 1 || !test_compare(table, handles->front(), 7, "bloom 7"))
+        return assertion_failure("bloom index select", handles->size());
+    delete handles;
+    try {
+        delete indices.get_index(table_name, "fa").lookup(&where);
+        return assertion_failure("bloom index lookup");
+    } catch (DbRelationError& e) {
+        // can't find rows itself
+    }
+
+    // the filters are reopened with the table, and kept until no index needs them
+    table.close();
+    HeapTable reopened(table_name, table.get_column_names(), table.get_column_attributes());
+    if (reopened.get_bloom_filter_columns() != ColumnNames({"a", "b"}))
+        return assertion_failure("bloom index reopened", reopened.get_bloom_filter_columns().size());
+    reopened.close();
+    const char* dropped_columns[][2] = {{"fab", "a b"}, {"fa", "b"}, {"fb", ""}};
+    for (auto const& dropped: dropped_columns) {
+        indices.get_index(table_name, dropped[0]).drop();
+        where = {{"table_name", Value(table_name)}, {"index_name", Value(dropped[0])}};
+        handles = indices.select(&where);
+        indices.del(handles);
+        delete handles;
+        std::string names;
+        for (const Identifier& column_name: table.get_bloom_filter_columns())
+            names += (names.empty() ? "" : " ") + column_name;
+        if (names != dropped[1])
+            return assertion_failure("bloom index dropped: " + names);
+    }
+
+    table.drop();
+    test_delete_schema_rows(columns, table_name);
+    test_delete_schema_rows(tables, table_name);
+    return true;
+}
+
+/**
+ * Test normalizing SQL for the plan cache
+ */
+bool test_plan_cache() {
+    std::string normalized;
+    std::vector<Value> parameters;
+    if (!PlanCache::normalize("select  a, b from t\n where a = 5 and b = 'x y'; ", normalized, parameters))
+        return assertion_failure("normalize");
+    if (normalized != "select a, b from t where a = ? and b = ?")
+        return assertion_failure("normalized text " + normalized);
+    if (parameters != std::vector<Value>({Value(5), Value("x y")}))
+        return assertion_failure("normalized parameters");
+
+    // a minus is part of the literal only where it can't be subtracting
+    PlanCache::normalize("select a-1, (a) -2 from t where a = -3", normalized, parameters);
+    if (normalized != "select a-?, (a) -? from t where a = ?"
+        || parameters != std::vector<Value>({Value(1), Value(2), Value(-3)}))
+        return assertion_failure("normalize minus " + normalized);
+
+    // LIMIT counts, numbers out of range, decimals, and quoted identifiers are kept
+    PlanCache::normalize("select \"a 1\" from t where a > 2147483648 and b < 1.5 limit 10", normalized, parameters);
+    if (normalized != "select \"a 1\" from t where a > 2147483648 and b < 1.5 limit 10" || !parameters.empty())
+        return assertion_failure("normalize kept " + normalized);
+
+    if (PlanCache::normalize("select * from t where a = ?", normalized, parameters))
+        return assertion_failure("normalize placeholder");
+    if (PlanCache::normalize("select * from t where b = 'x", normalized, parameters))
+        return assertion_failure("normalize unclosed quote");
+
+    // statements differing only in their literals share an entry
+    std::string other;
+    PlanCache::normalize("delete from t where a = 1 and b = 'p'", normalized, parameters);
+    PlanCache::normalize("DELETE from t  where a = 22 and b = 'q'", other, parameters);
+    if (other != "DELETE from t where a = ? and b = ?" || normalized != "delete from t where a = ? and b = ?")
+        return assertion_failure("normalize case " + other);
+    PlanCache::normalize("delete from t where a = 22 and b = 'q'", other, parameters);
+    if (other != normalized)
+        return assertion_failure("normalize same key");
+    return true;
+}
+/**
+ * Test the cursor a SELECT's result reads its rows through
+ */
+bool test_query_result() {
+    ColumnNames column_names = {"a", "b", "c"};
+    ColumnAttributes column_attributes = {
+        ColumnAttribute(ColumnAttribute::INT),
+        ColumnAttribute(ColumnAttribute::TEXT),
+        ColumnAttribute(ColumnAttribute::BOOLEAN)
+    };
+    HeapTable table("_test_query_result_cpp", column_names, column_attributes);
+    table.create();
+    ValueDict row;
+    const int N = 3 * RowBatch::CAPACITY + 5;
+    for (int i = 0; i < N; i++) {
+        test_set_row(row, i, "row " + std::to_string(i));
+        table.insert(&row);
+    }
+
+    // printed a batch at a time, with the count once they've all been read
+    QueryResult* result = new QueryResult(new ColumnNames({"a", "b"}), new ColumnAttributes(column_attributes),
+                                          new TableScan(table, ColumnNames({"a", "b"})), true);
+    if (!result->get_message().empty())
+        return assertion_failure("cursor message before reading");
+    std::ostringstream out;
+    out << *result;
+    std::string text = out.str();
+    if (std::count(text.begin(), text.end(), '\n') != N + 2 || text.find("\n5 \"row 5\" \n") == std::string::npos)
+        return assertion_failure("cursor printed", std::count(text.begin(), text.end(), '\n'));
+    if (result->get_message() != "successfully returned " + std::to_string(N) + " rows"
+        || text.substr(text.rfind('\n') + 1) != result->get_message())
+        return assertion_failure("cursor message");
+    delete result;
+
+    // read with next, or all at once with whatever is left
+    TableScan scan(table, column_names);
+    result = new QueryResult(new ColumnNames(column_names), new ColumnAttributes(column_attributes), &scan, false);
+    RowBatch batch;
+    if (!result->next(batch) || batch.size() != RowBatch::CAPACITY || batch.get_row(0)->at("a").n != 0)
+        return assertion_failure("cursor next", batch.size());
+    ValueDicts* rows = result->get_rows();
+    if (rows->size() != N - RowBatch::CAPACITY || rows->front()->at("a").n != (int) RowBatch::CAPACITY)
+        return assertion_failure("cursor rest", rows->size());
+    if (result->next(batch) || result->get_message() != "successfully returned " + std::to_string(N) + " rows")
+        return assertion_failure("cursor done");
+    delete result;
+
+    // a borrowed plan left part way through can be read again from the start
+    result = new QueryResult(new ColumnNames(column_names), new ColumnAttributes(column_attributes), &scan, false);
+    result->next(batch);
+    delete result;
+    result = new QueryResult(new ColumnNames(column_names), new ColumnAttributes(column_attributes), &scan, false);
+    if (result->get_rows()->size() != (size_t) N)
+        return assertion_failure("cursor reopened", result->get_rows()->size());
+    delete result;
+
+    // results without a cursor are unchanged
+    result = new QueryResult("done");
+    if (result->next(batch) || result->get_rows() != nullptr || result->get_message() != "done")
+        return assertion_failure("message only result");
+    delete result;
+    table.drop();
+    return true;
+}
+/**
+ * Test helper that writes a query result in a format
+ */
+std::string test_write_result(ResultWriter::Format format, QueryResult& result) {
+    std::ostringstream out;
+    ResultWriter* writer = ResultWriter::create(format, out);
+    writer->write(result);
+    delete writer;
+    return out.str();
+}
+
+/**
+ * Test writing results in each of the output formats
+ */
+bool test_result_writers() {
+    ColumnAttributes column_attributes = {
+        ColumnAttribute(ColumnAttribute::TEXT),
+        ColumnAttribute(ColumnAttribute::INT),
+        ColumnAttribute(ColumnAttribute::BOOLEAN)
+    };
+    ValueDicts rows;
+    ValueDict row;
+    test_set_row(row, 1, "x,\"y\"");
+    row["c"].n = 1;
+    row["c"].data_type = ColumnAttribute::BOOLEAN;
+    rows.push_back(new ValueDict(row));
+    test_set_row(row, INT32_MIN, "line\nnext");
+    row["c"].n = 0;
+    row["c"].data_type = ColumnAttribute::BOOLEAN;
+    rows.push_back(new ValueDict(row));
+
+    // the columns aren't in the rows' order, so the ordinals matter
+    std::vector<std::string> written;
+    for (ResultWriter::Format format: {ResultWriter::TABLE, ResultWriter::CSV, ResultWriter::JSON_LINES,
+                                       ResultWriter::BINARY}) {
+        ValueDicts* copies = new ValueDicts();
+        for (ValueDict* r: rows)
+            copies->push_back(new ValueDict(*r));
+        QueryResult result(new ColumnNames({"b", "a", "c"}), new ColumnAttributes(column_attributes), copies, "ok");
+        written.push_back(test_write_result(format, result));
+    }
+    test_free_rows(rows);
+    if (written[0] != "b a c \n+----------+----------+----------+\n\"x,\"y\"\" 1 true \n"
+                      "\"line\nnext\" -2147483648 false \nok\n")
+        return assertion_failure("table format: " + written[0]);
+    if (written[1] != "b,a,c\r\n\"x,\"\"y\"\"\",1,true\r\n\"line\nnext\",-2147483648,false\r\n")
+        return assertion_failure("csv format: " + written[1]);
+    if (written[2] != "{\"b\":\"x,\\\"y\\\"\",\"a\":1,\"c\":true}\n"
+                      "{\"b\":\"line\\nnext\",\"a\":-2147483648,\"c\":false}\n")
+        return assertion_failure("json lines format: " + written[2]);
+    const std::string& binary = written[3];
+    if (binary.size() != 69 || binary.compare(0, 6, std::string("\3\0\0\0\1\1", 6)) != 0
+        || binary.compare(54, 4, std::string("\0\0\0\x80", 4)) != 0
+        || binary.compare(62, 7, std::string("\0\2\0\0\0ok", 7)) != 0)
+        return assertion_failure("binary format", binary.size());
+
+    // a result that's just a message
+    QueryResult message("done");
+    if (test_write_result(ResultWriter::TABLE, message) != "done\n"
+        || test_write_result(ResultWriter::CSV, message) != "done\n"
+        || test_write_result(ResultWriter::JSON_LINES, message) != "{\"message\":\"done\"}\n")
+        return assertion_failure("message formats");
+    std::ostringstream out;
+    out << message;
+    if (out.str() != "done")
+        return assertion_failure("message printed");
+
+    // a cursor bigger than the buffer
+    ColumnNames column_names = {"a", "b", "c"};
+    column_attributes = {
+        ColumnAttribute(ColumnAttribute::INT),
+        ColumnAttribute(ColumnAttribute::TEXT),
+        ColumnAttribute(ColumnAttribute::BOOLEAN)
+    };
+    HeapTable table("_test_result_writers_cpp", column_names, column_attributes);
+    table.create();
+    const int N = 8000;
+    for (int i = 0; i < N; i++) {
+        test_set_row(row, i, "row " + std::to_string(i));
+        table.insert(&row);
+    }
+    QueryResult cursor(new ColumnNames(column_names), new ColumnAttributes(column_attributes),
+                       new TableScan(table, column_names), true);
+    std::string csv = test_write_result(ResultWriter::CSV, cursor);
+    table.drop();
+    if (csv.size() <= ResultWriter::BUFFER_SIZE || std::count(csv.begin(), csv.end(), '\n') != N + 1
+        || csv.find("\r\n7999,row 7999,false\r\n") == std::string::npos)
+        return assertion_failure("csv cursor", csv.size());
+    return true;
+}
+
+bool test_transactions() {
+    // group commit: once wait_durable returns, the ticket's commit has been flushed
+    uint64_t first = Transaction::commit(Transaction::begin());
+    Transaction::wait_durable(first);
+    const int N_THREADS = 8, N_COMMITS = 50;
+    std::atomic<int> done(0);
+    std::vector<std::thread> committers;
+    for (int i = 0; i < N_THREADS; i++)
+        committers.push_back(std::thread([&done] {
+            for (int j = 0; j < N_COMMITS; j++)
+                Transaction::wait_durable(Transaction::commit(Transaction::begin()));
+            done++;
+        }));
+    for (std::thread& committer: committers)
+        committer.join();
+    if (done != N_THREADS)
+        return assertion_failure("concurrent committers");
+    uint64_t last = Transaction::commit(Transaction::begin());
+    if (last != first + N_THREADS * N_COMMITS + 1)
+        return assertion_failure("commit tickets");
+    Transaction::wait_durable(last);
+    Transaction::wait_durable(0);
+
+    // commits no one waits for are put on disk by the next flush
+    Transaction::Durability durability;
+    if (!Transaction::get_durability("Write_No_Sync", durability) || durability != Transaction::WRITE_NO_SYNC
+        || Transaction::get_durability("fsync", durability) || Transaction::durability_name(Transaction::ASYNC) != "async")
+        return assertion_failure("durability names");
+    uint64_t async = Transaction::commit(Transaction::begin(), false, Transaction::ASYNC);
+    uint64_t write_no_sync = Transaction::commit(Transaction::begin(), false, Transaction::WRITE_NO_SYNC);
+    if (write_no_sync != async + 1)
+        return assertion_failure("unsynced commit tickets");
+    Transaction::flush();
+    if (!Transaction::is_durable(async) || !Transaction::is_durable(write_no_sync))
+        return assertion_failure("flush");
+
+    // a nested commit waits for its parent's
+    DbTxn* parent = Transaction::begin();
+    if (Transaction::commit(Transaction::begin(parent), true) != 0)
+        return assertion_failure("nested commit ticket");
+
+    // an abort undoes the writes done in the transaction, and starts a new generation
+    ColumnNames column_names = {"a"};
+    ColumnAttributes column_attributes = {ColumnAttribute(ColumnAttribute::INT)};
+    HeapTable table("_test_transactions_cpp", column_names, column_attributes);
+    table.create();
+    ValueDict row;
+    row["a"] = Value(1);
+    table.insert(&row);
+    Transaction::set_current(parent);
+    for (int i = 0; i < 1000; i++)
+        table.insert(&row);  // more blocks than the one there was
+    Transaction::set_current(nullptr);
+    uint64_t generation = Transaction::generation();
+    Transaction::abort(parent);
+    if (Transaction::generation() != generation + 1)
+        return assertion_failure("abort generation");
+    table.insert(&row);  // goes back to the last block there was
+    Handles* handles = table.select();
+    size_t n = handles->size();
+    delete handles;
+    if (n != 2) {
+        table.drop();
+        return assertion_failure("rows after abort " + std::to_string(n));
+    }
+
+    // a snapshot sees neither the rows nor the blocks of a transaction still open, and doesn't wait for it
+    DbTxn* writer = Transaction::begin();
+    Transaction::set_current(writer);
+    for (int i = 0; i < 1000; i++)
+        table.insert(&row);
+    DbTxn* reader = Transaction::begin(nullptr, true);
+    Transaction::set_current(reader);
+    handles = table.select();
+    n = handles->size();
+    delete handles;
+    Transaction::set_current(nullptr);
+    Transaction::commit(writer);
+    Transaction::set_current(reader);
+    handles = table.select();
+    size_t still = handles->size();
+    delete handles;
+    Transaction::set_current(nullptr);
+    Transaction::commit(reader);
+    handles = table.select();
+    size_t after = handles->size();
+    delete handles;
+    if (n != 2 || still != 2 || after != 1002) {
+        table.drop();
+        return assertion_failure("snapshot saw " + std::to_string(n) + ", " + std::to_string(still) + ", "
+                                 + std::to_string(after));
+    }
+
+    // the workers of a parallel scan read in children of the statement's snapshot, so they see just what it does
+    reader = Transaction::begin(nullptr, true);
+    Transaction::set_current(reader);
+    handles = table.select();
+    n = handles->size();
+    delete handles;
+    writer = Transaction::begin();
+    Transaction::set_current(writer);
+    for (int i = 0; i < 1000; i++)
+        table.insert(&row);
+    Transaction::set_current(nullptr);
+    Transaction::commit(writer);
+    Transaction::set_current(reader);
+    MorselQueue* morsels = new MorselQueue(table, 1);
+    std::vector<PlanOperator*> workers;
+    for (int i = 0; i < 4; i++)
+        workers.push_back(new MorselScan(TableScan(table, table.get_column_names()), morsels));
+    ValueDicts rows;
+    bool gathered = test_run_plan(new Gather(workers, morsels), rows);
+    Transaction::set_current(nullptr);
+    Transaction::commit(reader);
+    size_t seen = rows.size();
+    test_free_rows(rows);
+    table.drop();
+    if (!gathered || n != 1002 || seen != 1002)
+        return assertion_failure("parallel snapshot saw " + std::to_string(seen) + " of " + std::to_string(n));
+    return true;
+}
+
 /*
  * ****************************
  * SQLExec tests
@@ -451,10 +2158,336 @@ bool test_drop_index() {
     return true;
 }
 
+bool test_insert(std::string sql, std::string expectedMessage) {
+    std::cout << "\n=====================\n";
+    QueryResult* result = parse(sql);
+    if (!result)
+        return false;
+    std::cout << *result << std::endl;
+    std::string message = result->get_message();
+    if (message != expectedMessage)
+        return false;
+    delete result;
+    std::cout << "insert ok\n";
+    return true;
+}
+
+bool test_delete(std::string sql, std::string expectedMessage) {
+    std::cout << "\n=====================\n";
+    QueryResult* result = parse(sql);
+    if (!result)
+        return false;
+    std::cout << *result << std::endl;
+    std::string message = result->get_message();
+    if (message != expectedMessage)
+        return false;
+    delete result;
+    std::cout << "delete ok\n";
+    return true;
+}
+
+bool test_select(std::string sql, std::size_t nExpectedRows) {
+    std::cout << "\n=====================\n";
+    QueryResult* result = parse(sql);
+    if (!result)
+        return false;
+    ValueDicts* rows = result->get_rows();
+    std::cout << *result << std::endl;
+    if (rows->size() != nExpectedRows)
+        return false;
+    delete result;
+    std::cout << "select ok\n";
+    return true;
+}
+
 /**
  * Testing functionality of SQLExec
  * @return true if all tests succeed
  */
+/**
+ * Test helper that executes a prepared statement with the given values and counts the rows
+ */
+bool test_execute_prepared(PreparedStatement& prepared, const std::vector<Value>& parameters,
+                           std::size_t nExpectedRows) {
+    std::cout << ParseTreeToString::statement(prepared.bind(parameters)) << std::endl;
+    QueryResult* result = SQLExec::execute(prepared);
+    ValueDicts* rows = result->get_rows();
+    std::cout << *result << std::endl;
+    bool ok = rows != nullptr && rows->size() == nExpectedRows;
+    delete result;
+    return ok;
+}
+
+bool test_prepared() {
+    std::cout << "\n=====================\n";
+    QueryResult* result = SQLExec::prepare("by_yolk", "select * from egg where yolk = ?");
+    bool ok = result->get_message() == "prepared by_yolk with 1 parameter";
+    delete result;
+    if (!ok)
+        return assertion_failure("prepare");
+    PreparedStatement& prepared = SQLExec::get_prepared("by_yolk");
+    if (!test_execute_prepared(prepared, {Value("sunny")}, 2))
+        return assertion_failure("execute prepared sunny");
+    PlanOperator* plan = prepared.get_plan();
+    if (plan == nullptr || !test_execute_prepared(prepared, {Value("sunny")}, 2) || prepared.get_plan() != plan)
+        return assertion_failure("prepared plan kept for the same values");
+    if (!test_execute_prepared(prepared, {Value("runny")}, 1))
+        return assertion_failure("execute prepared runny");
+    try {
+        prepared.bind({});
+        return assertion_failure("bind too few values");
+    } catch (SQLExecError& e) {}
+
+    // statements differing only in their literals share a cache entry, which is out of the cache while in use
+    std::string normalized, again;
+    std::vector<Value> parameters;
+    PreparedStatement* cached = SQLExec::cached("select * from egg where white = 1", normalized, parameters);
+    if (cached == nullptr || parameters != std::vector<Value>({Value(1)}))
+        return assertion_failure("cached");
+    PreparedStatement* other = SQLExec::cached("select * from egg where white = 2", again, parameters);
+    bool taken = other != nullptr && other != cached && again == normalized;
+    delete other;
+    SQLExec::uncache(normalized, cached);
+    if (!taken)
+        return assertion_failure("cached while in use");
+    ok = SQLExec::cached("select  *  from egg where white = 3;", again, parameters) == cached
+         && test_execute_prepared(*cached, parameters, 1);
+    SQLExec::uncache(normalized, cached);
+    if (!ok)
+        return assertion_failure("cached again");
+    if (SQLExec::cached("show tables", normalized, parameters) != nullptr)
+        return assertion_failure("cached show");
+
+    // DDL on the table drops the kept plans
+    if (!test_create_index() || prepared.get_plan() != nullptr)
+        return assertion_failure("prepared plan kept after create index");
+    if (!test_execute_prepared(prepared, {Value("sunny")}, 2) || !test_drop_index())
+        return assertion_failure("execute prepared after create index");
+
+    result = SQLExec::deallocate("by_yolk");
+    ok = result->get_message() == "deallocated by_yolk";
+    delete result;
+    if (!ok)
+        return assertion_failure("deallocate");
+    try {
+        SQLExec::get_prepared("by_yolk");
+        return assertion_failure("deallocated statement still there");
+    } catch (SQLExecError& e) {}
+    std::cout << "prepared statements ok\n";
+    return true;
+}
+
+bool test_sessions() {
+    std::cout << "\n=====================\n";
+    SQLSession* first = new SQLSession();
+    SQLSession second;
+    auto fail = [&](std::string message) {
+        SQLExec::set_session(nullptr);
+        delete first;
+        return assertion_failure(message);
+    };
+
+    // each session has its own names for its prepared statements
+    SQLExec::set_session(first);
+    delete SQLExec::prepare("mine", "select * from egg where yolk = ?");
+    SQLExec::set_session(&second);
+    try {
+        SQLExec::get_prepared("mine");
+        return fail("another session's prepared statement");
+    } catch (SQLExecError& e) {}
+    delete SQLExec::prepare("mine", "select * from egg where white = ?");
+    PreparedStatement& theirs = SQLExec::get_prepared("mine");
+    if (!test_execute_prepared(theirs, {Value(3)}, 1) || theirs.get_plan() == nullptr)
+        return fail("execute in second session");
+    SQLExec::set_session(first);
+    if (&SQLExec::get_prepared("mine") == &theirs || !test_execute_prepared(SQLExec::get_prepared("mine"),
+                                                                             {Value("sunny")}, 2))
+        return fail("execute in first session");
+
+    // DDL in one session drops the plans kept in all of them
+    if (!test_create_index() || theirs.get_plan() != nullptr || !test_drop_index())
+        return fail("other session's plan kept after create index");
+
+    SQLExec::set_session(nullptr);
+    delete first;
+    try {
+        SQLExec::get_prepared("mine");
+        return assertion_failure("session's prepared statement in the default session");
+    } catch (SQLExecError& e) {}
+    std::cout << "sessions ok\n";
+    return true;
+}
+
+bool test_sql_transactions() {
+    std::cout << "\n=====================\n";
+    // each statement runs nested in the session's transaction, as the shell does it
+    auto statement = [](std::function<bool()> test) {
+        SQLExec::begin_statement();
+        bool ok;
+        try {
+            ok = test();
+        } catch (SQLExecError& e) {
+            SQLExec::end_statement(false);
+            throw;
+        }
+        SQLExec::end_statement(ok);
+        return ok;
+    };
+    auto insert = [] {
+        return test_insert("insert into egg values ('poached', 7, 7)",
+                           "successfully inserted 1 row into egg and 0 indices");
+    };
+    auto select = [](std::size_t n) { return [n] { return test_select("select * from egg where white = 7", n); }; };
+
+    delete SQLExec::begin();
+    if (!statement(insert) || !statement(select(1))) {
+        delete SQLExec::rollback();
+        return assertion_failure("insert in transaction");
+    }
+    bool rejected = false;
+    try {
+        delete SQLExec::begin();
+    } catch (SQLExecError& e) {
+        rejected = true;
+    }
+    try {
+        statement([] { return parse("drop table egg") != nullptr; });
+        rejected = false;
+    } catch (SQLExecError& e) {}
+    delete SQLExec::rollback();
+    if (!rejected || !test_select("select * from egg where white = 7", 0))
+        return assertion_failure("rollback");
+
+    uint64_t ticket = 0;
+    delete SQLExec::begin();
+    if (!statement(insert)) {
+        delete SQLExec::rollback();
+        return assertion_failure("insert before commit");
+    }
+    delete SQLExec::commit(ticket);
+    Transaction::wait_durable(ticket);
+    if (ticket == 0 || !test_select("select * from egg where white = 7", 1))
+        return assertion_failure("commit");
+    try {
+        delete SQLExec::commit(ticket);
+        return assertion_failure("commit without a transaction");
+    } catch (SQLExecError& e) {}
+    if (!test_delete("delete from egg where white = 7", "successfully deleted 1 row from egg and 0 indices"))
+        return assertion_failure("delete after commit");
+
+    // a plan kept from outside of a transaction (which may scan in parallel) isn't reused inside one
+    std::string normalized;
+    std::vector<Value> parameters;
+    PreparedStatement* cached = SQLExec::cached("select * from egg where white = 8", normalized, parameters);
+    if (cached == nullptr)
+        return assertion_failure("cached");
+    if (!test_execute_prepared(*cached, parameters, 0) || cached->is_planned_in_transaction()) {
+        SQLExec::uncache(normalized, cached);
+        return assertion_failure("plan outside of a transaction");
+    }
+    delete SQLExec::begin();
+    bool replanned = statement([&] { return test_execute_prepared(*cached, parameters, 0); })
+                     && cached->get_plan() != nullptr && cached->is_planned_in_transaction();
+    delete SQLExec::rollback();
+    SQLExec::uncache(normalized, cached);
+    if (!replanned)
+        return assertion_failure("plan inside a transaction");
+
+    // a failed CREATE INDEX leaves nothing behind in the catalog, so the index can then be made
+    auto ddl = [](std::string sql, std::string expected) {
+        return [sql, expected] {
+            QueryResult* result = parse(sql);
+            bool ok = result != nullptr && result->get_message() == expected;
+            delete result;
+            return ok;
+        };
+    };
+    bool failed = false;
+    try {
+        statement(ddl("create index yolks on egg (yolk, yolk)", "created index yolks"));
+    } catch (SQLExecError& e) {
+        failed = true;
+    }
+    if (!failed || Catalog::get_index("egg", "yolks") != nullptr
+        || !statement(ddl("create index yolks on egg (yolk)", "created index yolks"))
+        || !statement(ddl("drop index yolks from egg", "dropped index yolks")))
+        return assertion_failure("failed create index");
+
+    // a commit is as durable as the most durable table it wrote (at the session's durability if not its own)
+    delete SQLExec::set_durability(Transaction::ASYNC, "egg");
+    SQLExec::begin_statement();
+    bool inserted = insert();
+    bool unsynced = SQLExec::end_statement(inserted) == 0;
+    delete SQLExec::set_durability(Transaction::SYNC, "egg");
+    delete SQLExec::set_durability(Transaction::ASYNC);
+    SQLExec::begin_statement();
+    bool deleted = test_delete("delete from egg where white = 7", "successfully deleted 1 row from egg and 0 indices");
+    ticket = SQLExec::end_statement(deleted);
+    delete SQLExec::set_durability(Transaction::SYNC);
+    Transaction::wait_durable(ticket);
+    if (!inserted || !unsynced || !deleted || ticket == 0)
+        return assertion_failure("table durability");
+    try {
+        delete SQLExec::set_durability(Transaction::ASYNC, "no_such_table");
+        return assertion_failure("durability of a missing table");
+    } catch (SQLExecError& e) {}
+    std::cout << "transactions ok\n";
+    return true;
+}
+
+bool test_snapshot_scan() {
+    std::cout << "\n=====================\n";
+    QueryResult* result = parse("select * from egg");
+    std::size_t n = result->get_rows()->size();
+    delete result;
+
+    // the scan's cursor is opened in its statement's snapshot and left part way through
+    SQLExec::begin_statement();
+    QueryResult* scan = parse("select * from egg");
+    RowBatch batch;
+    std::size_t seen = 0;
+    try {
+        scan->next(batch);
+    } catch (SQLExecError& e) {
+        delete scan;
+        SQLExec::end_statement(false);
+        return assertion_failure("open scan: " + std::string(e.what()));
+    }
+    seen += batch.size();
+
+    // meanwhile another session, on a thread of its own, inserts and commits without waiting for the scan
+    auto writer = std::async(std::launch::async, [] {
+        SQLSession other;
+        SQLExec::set_session(&other);
+        SQLExec::begin_statement();
+        bool ok = false;
+        try {
+            ok = test_insert("insert into egg values ('coddled', 9, 9)",
+                             "successfully inserted 1 row into egg and 0 indices");
+        } catch (SQLExecError& e) {}
+        SQLExec::end_statement(ok);
+        SQLExec::set_session(nullptr);
+        return ok;
+    });
+    bool unblocked = writer.wait_for(std::chrono::seconds(2)) == std::future_status::ready;
+
+    // and the rest of the scan doesn't see the row
+    while (scan->next(batch))
+        seen += batch.size();
+    delete scan;
+    SQLExec::end_statement(true);
+    bool inserted = writer.get();
+    if (!unblocked || !inserted)
+        return assertion_failure("insert while a scan is open");
+    if (seen != n)
+        return assertion_failure("scan saw a row committed after it began", seen);
+    if (!test_select("select * from egg", n + 1)
+        || !test_delete("delete from egg where white = 9", "successfully deleted 1 row from egg and 0 indices"))
+        return assertion_failure("row inserted while a scan was open");
+    std::cout << "snapshot scan ok\n";
+    return true;
+}
+
 bool test_sql_exec() {
     // test show columns
     if (!test_show_columns_from_schema_tables())
@@ -467,6 +2500,59 @@ bool test_sql_exec() {
         return false;
     if (!test_show_tables(1))
         return false;
+
+    // test insert and select
+    if (!test_select("select * from egg", 0))
+        return false;
+    if (!test_insert("insert into egg values ('sunny', 1, 3)", "successfully inserted 1 row into egg and 0 indices"))
+        return false;
+    if (!test_insert("insert into egg (shell, white, yolk) values (4, 2, 'runny')",
+                     "successfully inserted 1 row into egg and 0 indices"))
+        return false;
+    if (!test_insert("insert into egg select yolk, shell, white from egg",
+                     "successfully inserted 2 rows into egg and 0 indices"))
+        return false;
+    if (!test_select("select * from egg", 4))
+        return false;
+    if (!test_select("select yolk, shell from egg where white = 1 and shell > 2 limit 5", 1))
+        return false;
+
+    // test delete
+    if (!test_delete("delete from egg where yolk = 'runny' and white > 2",
+                     "successfully deleted 1 row from egg and 0 indices"))
+        return false;
+    if (!test_select("select * from egg", 3))
+        return false;
+
+    // test join
+    if (!test_select("select a.yolk, b.yolk from egg as a join egg as b on a.white = b.shell", 2))
+        return false;
+    if (!test_select("select * from egg as a, egg as b where a.white = b.shell and b.yolk = 'sunny'", 2))
+        return false;
+
+    // test order by
+    if (!test_select("select yolk, white from egg order by shell desc limit 2", 2))
+        return false;
+
+    // test group by and aggregates
+    if (!test_select("select yolk, count(*), sum(shell) from egg group by yolk order by count(*) desc", 2))
+        return false;
+    if (!test_select("select count(*), min(white), max(white), avg(shell) from egg", 1))
+        return false;
+
+    // test prepared statements and the plan cache
+    if (!test_prepared())
+        return false;
+    if (!test_sessions())
+        return false;
+
+    // test BEGIN, COMMIT, and ROLLBACK
+    if (!test_sql_transactions())
+        return false;
+
+    // test a session writing while another's scan is open
+    if (!test_snapshot_scan())
+        return false;
     
     // test create index
     if (!test_show_index(0))